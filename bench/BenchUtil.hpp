@@ -0,0 +1,84 @@
+/**
+ * @file BenchUtil.hpp
+ * @brief Shared helpers for the benchmark executables.
+ */
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Frame.hpp"
+#include "Parser.hpp"
+#include "Stmt.h"
+#include "TestUtil.hpp"
+
+namespace bench {
+
+using testutil::corpus;
+using testutil::parse;
+using testutil::parseCorpus;
+using testutil::Program;
+using testutil::readCorpus;
+using testutil::readFile;
+
+/// Loop kernels for the backends: counting, float matrix product,
+/// division-heavy gcd and a bool sieve.
+inline const std::pair<const char*, const char*> kernels[] = {
+    {"count",
+     "{ int i; int n; int s; n = 200000;"
+     "  while (i < n) { s = s + i; i = i + 1; } }"},
+    {"matmul32",
+     "{ float[32][32] x; float[32][32] y; float[32][32] z;"
+     "  int i; int j; int k; float acc;"
+     "  while (i < 32) { j = 0;"
+     "    while (j < 32) { x[i][j] = i + j * 0.5; y[i][j] = i - j;"
+     "      j = j + 1; }"
+     "    i = i + 1; }"
+     "  i = 0;"
+     "  while (i < 32) { j = 0;"
+     "    while (j < 32) { acc = 0.0; k = 0;"
+     "      while (k < 32) { acc = acc + x[i][k] * y[k][j]; k = k + 1; }"
+     "      z[i][j] = acc; j = j + 1; }"
+     "    i = i + 1; } }"},
+    {"gcd",
+     "{ int a; int b; int t; int r; int s;"
+     "  while (r < 2000) { a = r * 7 + 1000; b = r + 17;"
+     "    while (b != 0) { t = a - a / b * b; a = b; b = t; }"
+     "    s = s + a; r = r + 1; } }"},
+    {"sieve",
+     "{ bool[8192] c; int i; int j; int n;"
+     "  i = 2;"
+     "  while (i < 8192) {"
+     "    if (!c[i]) { n = n + 1; j = i + i;"
+     "      while (j < 8192) { c[j] = true; j = j + i; } }"
+     "    i = i + 1; } }"},
+};
+
+/// Best-of-@p reps wall time of @p fn in microseconds.
+template <typename Fn>
+double timeUs(int reps, Fn&& fn) {
+  double best = 1e300;
+  for (int r = 0; r < reps; ++r) {
+    auto t0 = std::chrono::steady_clock::now();
+    fn();
+    auto t1 = std::chrono::steady_clock::now();
+    double us = std::chrono::duration<double, std::micro>(t1 - t0).count();
+    if (us < best) best = us;
+  }
+  return best;
+}
+
+/// Best time in microseconds of native code @p f on a zeroed frame.
+template <typename EntryPoint>
+double nativeUs(EntryPoint f, int frameSize) {
+  std::vector<uint8_t> frame(frameSize + 1);
+  return timeUs(20, [&] {
+    std::fill(frame.begin(), frame.end(), 0);
+    f(frame.data());
+  });
+}
+
+}  // namespace bench
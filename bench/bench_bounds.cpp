@@ -0,0 +1,40 @@
+/**
+ * @file bench_bounds.cpp
+ * @brief Bounds-checked code with and without check elimination.
+ *
+ * Every corpus program is lowered with bounds checks and run through the
+ * interpreter as is and after eliminateBoundsChecks(); the table shows how
+ * many checks were removed, checks and instructions executed, and time.
+ */
+#include <cstdio>
+
+#include "BenchUtil.hpp"
+#include "BoundsCheck.hpp"
+#include "Interp.hpp"
+#include "Lower.hpp"
+
+int main() {
+  std::printf("%-12s %9s %8s %8s %9s %9s %9s %9s\n", "program", "removed",
+              "checks", "checks+e", "instrs", "instrs+e", "us", "us+e");
+  for (const auto& name : bench::corpus) {
+    auto prog = bench::parseCorpus(name);
+    ir::LowerOptions opts;
+    opts.boundsChecks = true;
+    ir::Function base = ir::lower(prog.root, prog.frame, opts);
+    ir::Function opt = base;
+    opt::BoundsStats st;
+    opt::eliminateBoundsChecks(opt, &st);
+
+    ir::Interpreter ib(base), io(opt);
+    double tb = bench::timeUs(50, [&] { ib.run(); });
+    double to = bench::timeUs(50, [&] { io.run(); });
+    auto checks = [](const ir::Interpreter& in) {
+      return (unsigned long long)
+          in.profile[static_cast<size_t>(ir::Opcode::Check)];
+    };
+    std::printf("%-12s %5d/%-3d %8llu %8llu %9llu %9llu %9.1f %9.1f\n",
+                name.c_str(), st.eliminated, st.checks, checks(ib), checks(io),
+                (unsigned long long)ib.executed,
+                (unsigned long long)io.executed, tb, to);
+  }
+}
@@ -0,0 +1,57 @@
+/**
+ * @file bench_c.cpp
+ * @brief Our optimizer and backend against a C compiler's.
+ *
+ * Every kernel and corpus program goes through two native pipelines: ours
+ * (lowering, the default pass pipeline, AsmEmitter, `cc`) and the C
+ * compiler's (CEmitter, `cc -O2`). The table shows run time of both, the
+ * ratio, and the wall time of each pipeline from AST to shared object,
+ * external tools included.
+ */
+#include <cstdio>
+
+#include "AsmEmitter.hpp"
+#include "BenchUtil.hpp"
+#include "CEmitter.hpp"
+#include "Lower.hpp"
+#include "PassManager.hpp"
+#include "Toolchain.hpp"
+
+namespace {
+
+void row(const char* name, const bench::Program& prog) {
+  codegen::TempDir dir;
+  std::string ours, theirs;
+  double co = bench::timeUs(1, [&] {
+    ir::Function fn = ir::lower(prog.root, prog.frame);
+    opt::PassManager().run(fn);
+    ours = codegen::assembleShared(dir, codegen::AsmEmitter().emit(fn), "ours");
+  });
+  double cc = bench::timeUs(1, [&] {
+    std::string c = dir.write(
+        "theirs.c", codegen::CEmitter().emit(prog.root, prog.frame));
+    theirs = dir.file("theirs.so");
+    codegen::runCommand("cc -O2 -shared -fPIC -o '" + theirs + "' '" + c +
+                        "'");
+  });
+
+  codegen::SharedLibrary a(ours), b(theirs);
+  double to = bench::nativeUs(a.entry("sc_main"), prog.frame.size);
+  double tc = bench::nativeUs(b.entry("sc_main"), prog.frame.size);
+  std::printf("%-11s %9.2f %9.2f %6.2fx %9.1f %9.1f\n", name, to, tc, to / tc,
+              co / 1000, cc / 1000);
+}
+
+}  // namespace
+
+int main() {
+  if (!codegen::haveTool("cc")) {
+    std::printf("no C compiler driver on PATH\n");
+    return 0;
+  }
+  std::printf("%-11s %9s %9s %7s %9s %9s\n", "program", "ours us", "cc us",
+              "ratio", "ours ms", "cc ms");
+  for (const auto& [name, src] : bench::kernels) row(name, bench::parse(src));
+  for (const auto& name : bench::corpus)
+    row(name.c_str(), bench::parseCorpus(name));
+}
@@ -0,0 +1,96 @@
+/**
+ * @file bench_coalesce.cpp
+ * @brief Copy propagation and temporary coalescing on large inputs.
+ *
+ * Inputs are the corpus programs pasted together many times and generated
+ * expression-heavy code, lowered and then run through propagateCopies()
+ * and coalesceTemps(). The table shows distinct temporaries after each
+ * step, the frame bytes of variables plus temporary slots before and
+ * after, and the time both passes take.
+ */
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "BenchUtil.hpp"
+#include "Coalesce.hpp"
+#include "Lower.hpp"
+
+namespace {
+
+/// Every corpus program @p copies times, one block each.
+std::string pastedCorpus(int copies) {
+  std::string src = "{\n";
+  for (int k = 0; k < copies; ++k)
+    for (const auto& name : bench::corpus)
+      src += bench::readCorpus(name) + "\n";
+  return src + "}\n";
+}
+
+/// @p n assignments of nested expressions over a few variables, in loops.
+std::string expressions(int n) {
+  std::string src = "{ int[64] a; float[64] x; int i; int j;";
+  for (int v = 0; v < 8; ++v) src += " int v" + std::to_string(v) + ";";
+  for (int v = 0; v < 4; ++v) src += " float f" + std::to_string(v) + ";";
+  uint32_t seed = 12345;
+  auto next = [&](int m) {
+    seed = seed * 1103515245 + 12345;
+    return static_cast<int>((seed >> 16) % static_cast<uint32_t>(m));
+  };
+  auto v = [&] { return "v" + std::to_string(next(8)); };
+  auto f = [&] { return "f" + std::to_string(next(4)); };
+  for (int s = 0; s < n; ++s) {
+    if (s % 10 == 0) src += " i = 0; while (i < 60) {";
+    switch (next(4)) {
+      case 0:
+        src += " " + v() + " = (" + v() + " + " + v() + " * 3) - " + v() +
+               " / (" + v() + " * " + v() + " + 1);";
+        break;
+      case 1:
+        src += " a[i + 1] = a[i] * " + v() + " + (" + v() + " - a[i + 2]);";
+        break;
+      case 2:
+        src += " " + f() + " = " + f() + " * 0.5 + x[i] * (" + f() +
+               " - x[i + 1]);";
+        break;
+      default:
+        src += " x[i] = (" + f() + " + " + v() + ") / (" + f() + " + 2.0);";
+        break;
+    }
+    if (s % 10 == 9) src += " i = i + 1; }";
+  }
+  if (n % 10) src += " i = i + 1; }";
+  return src + " }";
+}
+
+void row(const char* name, const std::string& src) {
+  bench::Program prog = bench::parse(src);
+  ir::Function fn = ir::lower(prog.root, prog.frame);
+  opt::TempFootprint lowered = opt::tempFootprint(fn);
+
+  opt::CoalesceStats st;
+  auto t0 = std::chrono::steady_clock::now();
+  opt::propagateCopies(fn, &st);
+  opt::TempFootprint propagated = opt::tempFootprint(fn);
+  opt::coalesceTemps(fn, &st);
+  auto t1 = std::chrono::steady_clock::now();
+  double ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+
+  int vars = fn.frame.size;
+  std::printf("%-14s %7zu %6d %6d %5d %8d %8d %8.2f\n", name,
+              fn.code.size(), lowered.temps, propagated.temps, st.tempsAfter,
+              vars + lowered.bytes, vars + st.bytesAfter, ms);
+}
+
+}  // namespace
+
+int main() {
+  std::printf("%-14s %7s %6s %6s %5s %8s %8s %8s\n", "input", "instrs",
+              "temps", "+copy", "+coal", "frame", "frame+c", "ms");
+  for (int copies : {1, 10, 100})
+    row(("corpus x" + std::to_string(copies)).c_str(), pastedCorpus(copies));
+  for (int n : {100, 1000, 10000})
+    row(("exprs " + std::to_string(n)).c_str(), expressions(n));
+}
@@ -0,0 +1,88 @@
+/**
+ * @file bench_context.cpp
+ * @brief One million small programs compiled with a fresh pipeline each
+ * and with one reused driver::CompilerContext.
+ *
+ * The programs are 64 generated snippets of a few declarations and
+ * statements, held in memory and compiled to text round robin. The fresh
+ * pipeline is driver::compile() on an istringstream: a new Lexer with its
+ * keyword table, a new Parser with its global scope and frame, a new
+ * TextEmitter with its output buffer, per program. The context rewinds
+ * and clears the same ones. The table shows the time, programs per second
+ * and allocations per program of each, and checks the output lengths
+ * agree.
+ */
+#include <cstdio>
+#include <sstream>
+
+#include "AllocCounter.hpp"
+#include "BenchUtil.hpp"
+#include "CompilerContext.hpp"
+#include "Driver.hpp"
+
+namespace {
+
+constexpr int kPrograms = 1000000;
+
+std::string snippet(int k) {
+  std::string n = std::to_string(k + 2);
+  switch (k % 4) {
+    case 0:
+      return "{ int x; x = " + n + " * 3 + 1; }";
+    case 1:
+      return "{ int i; int s; while (i < " + n + ") { s = s + i; i = i + 1; }"
+             " }";
+    case 2:
+      return "{ float[4] a; int i; a[i] = " + n + ".5; if (a[i] > 2.0) i = 1;"
+             " }";
+    default:
+      return "{ bool b; char c; b = !b && " + n + " > 3; }";
+  }
+}
+
+struct Run {
+  double us;
+  uint64_t allocs;
+  uint64_t bytes;
+};
+
+template <typename Compile>
+Run measure(const std::vector<std::string>& sources, Compile compile) {
+  uint64_t before = testutil::allocCounts().count;
+  uint64_t bytes = 0;
+  double us = bench::timeUs(1, [&] {
+    for (int k = 0; k < kPrograms; ++k)
+      bytes += compile(sources[k % sources.size()]);
+  });
+  return {us, testutil::allocCounts().count - before, bytes};
+}
+
+void row(const char* name, const Run& r, double base) {
+  std::printf("%-8s %9.1f %9.0f %9.2f %9.1f %7.2fx\n", name, r.us / 1000,
+              kPrograms / (r.us / 1e6), r.us / kPrograms,
+              double(r.allocs) / kPrograms, base / r.us);
+}
+
+}  // namespace
+
+int main() {
+  std::vector<std::string> sources;
+  for (int k = 0; k < 64; ++k) sources.push_back(snippet(k));
+
+  Run fresh = measure(sources, [](const std::string& src) {
+    std::istringstream in(src);
+    return driver::compile(in, driver::Target::Text).size();
+  });
+  driver::CompilerContext context;
+  Run warm = measure(sources, [&](const std::string& src) {
+    return context.compile(src).size();
+  });
+  if (fresh.bytes != warm.bytes) std::printf("outputs differ\n");
+
+  std::printf("%d programs, %.1f MB of text\n", kPrograms,
+              warm.bytes / 1e6);
+  std::printf("%-8s %9s %9s %9s %9s %8s\n", "pipeline", "ms", "progs/s",
+              "us/prog", "allocs", "speedup");
+  row("fresh", fresh, fresh.us);
+  row("context", warm, fresh.us);
+}
@@ -0,0 +1,31 @@
+/**
+ * @file bench_deadcode.cpp
+ * @brief Dead code elimination statistics over the test corpus.
+ */
+#include <cstdio>
+
+#include "AstUtil.hpp"
+#include "BenchUtil.hpp"
+#include "DeadCode.hpp"
+
+int main() {
+  std::printf("%-12s %6s %6s %7s %6s %6s %9s\n", "program", "stmts", "stores",
+              "unreach", "vars", "bytes", "frame");
+  opt::DeadCodeStats total;
+  for (const auto& name : bench::corpus) {
+    auto prog = bench::parseCorpus(name);
+    int stmts = opt::countStmts(prog.root);
+    int before = prog.frame.size;
+    opt::DeadCodeStats st;
+    opt::eliminateDeadCode(prog.root, prog.frame, &st);
+    std::printf("%-12s %6d %6d %7d %6d %6d %4d->%-4d\n", name.c_str(), stmts,
+                st.storesRemoved, st.unreachableRemoved, st.varsRemoved,
+                st.bytesSaved, before, prog.frame.size);
+    total.storesRemoved += st.storesRemoved;
+    total.unreachableRemoved += st.unreachableRemoved;
+    total.varsRemoved += st.varsRemoved;
+    total.bytesSaved += st.bytesSaved;
+  }
+  std::printf("%-12s %6s %6d %7d %6d %6d\n", "total", "", total.storesRemoved,
+              total.unreachableRemoved, total.varsRemoved, total.bytesSaved);
+}
@@ -0,0 +1,91 @@
+/**
+ * @file bench_driver.cpp
+ * @brief Files per second of the batch driver against the thread count.
+ *
+ * Writes 20000 small programs into a temporary directory, a mix of the
+ * corpus programs and generated loops of a few statements, and compiles
+ * them all with driver::compileAll() to text and to C on 1, 2, 4 and 8
+ * threads, reading and writing real files. Outputs and diagnostics are
+ * checked equal to the single-threaded run; the table shows the best of
+ * three, files per second and the speedup over one thread.
+ */
+#include <unistd.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+#include "BenchUtil.hpp"
+#include "Driver.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr int kFiles = 20000;
+
+std::string generated(int k) {
+  std::string n = std::to_string(k % 97 + 3);
+  return "{ int i; int s; float f; int[" + n + "] a;\n"
+         "  while (i < " + n + ") { a[i] = i * " + n + "; i = i + 1; }\n"
+         "  i = 0; do { s = s + a[i]; if (s > 100) f = f + s / 2.0;"
+         " i = i + 1; } while (i < " + n + "); }\n";
+}
+
+std::vector<driver::Result> batch(const std::vector<std::string>& inputs,
+                                  driver::Target target, const fs::path& out,
+                                  unsigned threads, double& us) {
+  driver::Options options;
+  options.target = target;
+  options.outDir = out.string();
+  task::ThreadPool pool(threads - 1);
+  std::vector<driver::Result> results;
+  us = bench::timeUs(
+      3, [&] { results = driver::compileAll(inputs, options, pool); });
+  return results;
+}
+
+}  // namespace
+
+int main() {
+  fs::path dir = fs::temp_directory_path() /
+                 ("bench-driver-" + std::to_string(getpid()));
+  fs::create_directories(dir);
+  std::vector<std::string> sources;
+  for (const auto& name : bench::corpus)
+    sources.push_back(bench::readCorpus(name));
+  std::vector<std::string> inputs;
+  for (int k = 0; k < kFiles; ++k) {
+    std::string path = (dir / ("p" + std::to_string(k) + ".sc")).string();
+    std::ofstream(path) << (k % 4 == 0 ? sources[k / 4 % sources.size()]
+                                       : generated(k));
+    inputs.push_back(path);
+  }
+
+  std::printf("%u hardware threads, %d files\n",
+              std::thread::hardware_concurrency(), kFiles);
+  std::printf("%6s %7s %9s %10s %8s\n", "target", "threads", "ms",
+              "files/s", "speedup");
+  for (auto [target, name] : {std::pair{driver::Target::Text, "text"},
+                              std::pair{driver::Target::C, "c"}}) {
+    fs::path out = dir / name;
+    double base = 0;
+    std::vector<std::string> expected;
+    for (unsigned threads : {1u, 2u, 4u, 8u}) {
+      double us;
+      auto results = batch(inputs, target, out, threads, us);
+      std::vector<std::string> seen;
+      for (const auto& r : results)
+        seen.push_back(r.ok() ? bench::readFile(r.output) : r.diagnostic);
+      if (threads == 1) {
+        base = us;
+        expected = std::move(seen);
+      } else if (seen != expected) {
+        std::printf("outputs differ on %u threads\n", threads);
+      }
+      std::printf("%6s %7u %9.1f %10.0f %7.2fx\n", name, threads, us / 1000,
+                  kFiles / (us / 1e6), base / us);
+    }
+  }
+  fs::remove_all(dir);
+}
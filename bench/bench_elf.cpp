@@ -0,0 +1,81 @@
+/**
+ * @file bench_elf.cpp
+ * @brief Writing ELF objects directly against going through GNU as.
+ *
+ * The corpus programs are lowered and optimized once. A module of N
+ * copies is every one of them emitted N times by AsmEmitter as separate
+ * functions, up to some 4000 functions and 12 MB of assembly ("emit" is
+ * the time of that). The object file is then made two ways: by writing
+ * the assembly text out and running `cc -c` on it, and in-process with
+ * codegen::assemble() and codegen::writeElf(), writing only the `.o`.
+ * "link" is `cc -shared` on the resulting object, the same for both. The
+ * last columns compare the times from IR to shared object.
+ */
+#include <cstdio>
+#include <string>
+
+#include "AsmEmitter.hpp"
+#include "BenchUtil.hpp"
+#include "Elf.hpp"
+#include "Lower.hpp"
+#include "PassManager.hpp"
+#include "Toolchain.hpp"
+
+namespace {
+
+std::vector<ir::Function> functions;  ///< The corpus, optimized
+
+void row(int copies) {
+  std::string text;
+  double emit = bench::timeUs(3, [&] {
+    text.clear();
+    for (int k = 0; k < copies; ++k)
+      for (size_t f = 0; f < functions.size(); ++f) {
+        codegen::AsmOptions options;
+        options.symbol = "sc_" + std::to_string(k) + "_" + std::to_string(f);
+        text += codegen::AsmEmitter(options).emit(functions[f]);
+      }
+  });
+
+  codegen::TempDir dir;
+  std::string gnu = dir.file("gnu.o");
+  double as = bench::timeUs(3, [&] {
+    std::string s = dir.write("gnu.s", text);
+    codegen::runCommand("cc -c -o '" + gnu + "' '" + s + "'");
+  });
+  size_t direct = 0;
+  double elf = bench::timeUs(3, [&] {
+    std::vector<uint8_t> bytes = codegen::writeElf(codegen::assemble(text));
+    dir.write("direct.o", std::string(bytes.begin(), bytes.end()));
+    direct = bytes.size();
+  });
+  double link = bench::timeUs(3, [&] {
+    codegen::runCommand("cc -shared -o '" + dir.file("direct.so") + "' '" +
+                        dir.file("direct.o") + "'");
+  });
+
+  double viaAs = emit + as + link, viaElf = emit + elf + link;
+  std::printf("%6d %7zu %8zu %8zu %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %6.2fx\n",
+              copies, copies * functions.size(), text.size() / 1024,
+              direct / 1024,
+              emit / 1000, as / 1000, elf / 1000, link / 1000, viaAs / 1000,
+              viaElf / 1000, viaAs / viaElf);
+}
+
+}  // namespace
+
+int main() {
+  if (!codegen::haveTool("cc")) {
+    std::printf("no C compiler driver on PATH\n");
+    return 0;
+  }
+  for (const auto& name : bench::corpus) {
+    bench::Program prog = bench::parseCorpus(name);
+    functions.push_back(ir::lower(prog.root, prog.frame));
+    opt::PassManager().run(functions.back());
+  }
+  std::printf("%6s %7s %8s %8s %9s %9s %9s %9s %9s %9s %7s\n", "copies",
+              "funcs", "asm KB", "obj KB", "emit ms", "as ms", "elf ms",
+              "link ms", "via as", "direct", "speedup");
+  for (int copies : {1, 8, 64, 512}) row(copies);
+}
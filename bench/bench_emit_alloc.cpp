@@ -0,0 +1,169 @@
+/**
+ * @file bench_emit_alloc.cpp
+ * @brief Heap allocations of the string and the operand emitter interfaces.
+ *
+ * Each kernel and corpus program, and a generated program of longer
+ * names and expressions ("wide"), is printed as text 100 times into
+ * /dev/null, once through emit::IEmitter by the string-returning emitter
+ * TextEmitter used to be (kept here, writing to the same Sink), once
+ * through emit::IOperandEmitter by TextEmitter. Both have emitted the
+ * program once before counting. The table shows allocations and
+ * allocated bytes per emitted statement, counted with testutil::allocCounts(),
+ * and the time per statement.
+ */
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdio>
+
+#include "AllocCounter.hpp"
+#include "BenchUtil.hpp"
+#include "Emitter.h"
+#include "IEmitter.hpp"
+#include "Sink.hpp"
+#include "Token.hpp"
+
+namespace {
+
+constexpr int kReps = 100;
+
+/// TextEmitter through the string interface, counting statements.
+struct StringTextEmitter : emit::IEmitter {
+  explicit StringTextEmitter(emit::Sink& out) : out(out) {}
+
+  emit::Sink& out;
+  uint64_t statements = 0;
+
+  std::string emitLoadConst(const sptr<lexer::Token>& value) override {
+    return value->lexeme;
+  }
+  std::string emitUnaryOp(const sptr<lexer::Token>& op,
+                          const std::string& operand) override {
+    return op->lexeme + operand;
+  }
+  std::string emitBinaryOp(const std::string& lhs, const sptr<lexer::Token>& op,
+                           const std::string& rhs) override {
+    return lhs + " " + op->lexeme + " " + rhs;
+  }
+  std::string emitArrayAccess(const std::string& arr,
+                              const std::string& idx) override {
+    return arr + "[" + idx + "]";
+  }
+  std::string emitTemp(int number) override {
+    return "t" + std::to_string(number);
+  }
+  std::string emitIdentifier(const std::string& name, int) override {
+    return name;
+  }
+
+  void emitIf(const std::string& cond,
+              const std::function<void()>& thenBlock) override {
+    ++statements;
+    out.format("if ({}) {{\n", cond);
+    thenBlock();
+    out.put("}\n");
+  }
+  void emitIfElse(const std::string& cond,
+                  const std::function<void()>& thenBlock,
+                  const std::function<void()>& elseBlock) override {
+    ++statements;
+    out.format("if ({}) {{\n", cond);
+    thenBlock();
+    out.put("} else {\n");
+    elseBlock();
+    out.put("}\n");
+  }
+  void emitWhile(const std::function<std::string()>& condGen,
+                 const std::function<void()>& bodyGen) override {
+    ++statements;
+    out.format("while ({}) {{\n", condGen());
+    bodyGen();
+    out.put("}\n");
+  }
+  void emitDoWhile(const std::function<void()>& bodyGen,
+                   const std::function<std::string()>& condGen) override {
+    ++statements;
+    out.put("do {\n");
+    bodyGen();
+    out.format("}} while ({});\n", condGen());
+  }
+  void emitBreak() override {
+    ++statements;
+    out.put("break;\n");
+  }
+  void emitAssign(const std::string& target,
+                  const std::string& value) override {
+    ++statements;
+    out.format("{} = {};\n", target, value);
+  }
+  void emitArrayAssign(const std::string& arr, const std::string& idx,
+                       const std::string& value) override {
+    ++statements;
+    out.format("{}[{}] = {};\n", arr, idx, value);
+  }
+};
+
+struct Counted {
+  double allocs, bytes, ns;
+};
+
+/// Allocations and time per statement of @p reps emissions by @p emit.
+template <typename Fn>
+Counted count(uint64_t statements, Fn&& emit) {
+  emit();
+  testutil::AllocCounts before = testutil::allocCounts();
+  double us = bench::timeUs(1, [&] {
+    for (int k = 0; k < kReps; ++k) emit();
+  });
+  testutil::AllocCounts after = testutil::allocCounts();
+  double n = static_cast<double>(statements) * kReps;
+  return {(after.count - before.count) / n, (after.bytes - before.bytes) / n,
+          us * 1000 / n};
+}
+
+/// Assignments of sums of products of named variables and array elements.
+std::string wide() {
+  const char* names[] = {"totalWeight", "rowIndex", "columnIndex",
+                         "runningSum", "scaleFactor", "itemCount"};
+  std::string src = "{ int[64] inputValues; ";
+  for (const char* n : names) src += std::string("int ") + n + "; ";
+  src += "while (rowIndex < 64) { ";
+  for (int s = 0; s < 24; ++s) {
+    src += names[s % 6] + std::string(" = ");
+    for (int t = 0; t < 4; ++t) {
+      if (t) src += " + ";
+      src += std::string(names[(s + t + 1) % 6]) + " * inputValues[" +
+             names[(s + t) % 3 + 1] + " - " + std::to_string(t) + "]";
+    }
+    src += "; ";
+  }
+  return src + "rowIndex = rowIndex + 1; } }";
+}
+
+void row(const char* name, const bench::Program& prog, int null) {
+  emit::FdSink sink(null);
+  StringTextEmitter strings(sink);
+  prog.root->emit(strings);
+  uint64_t statements = strings.statements;
+
+  Counted s = count(statements, [&] { prog.root->emit(strings); });
+  emit::TextEmitter operands(sink);
+  Counted o = count(statements, [&] { prog.root->emit(operands); });
+  std::printf("%-11s %6llu %9.2f %9.2f %9.1f %9.1f %8.1f %8.1f\n", name,
+              (unsigned long long)statements, s.allocs, o.allocs, s.bytes,
+              o.bytes, s.ns, o.ns);
+}
+
+}  // namespace
+
+int main() {
+  int null = open("/dev/null", O_WRONLY);
+  std::printf("%-11s %6s %9s %9s %9s %9s %8s %8s\n", "program", "stmts",
+              "str new", "op new", "str B", "op B", "str ns", "op ns");
+  for (const auto& [name, src] : bench::kernels)
+    row(name, bench::parse(src), null);
+  for (const auto& name : bench::corpus)
+    row(name.c_str(), bench::parseCorpus(name), null);
+  row("wide", bench::parse(wide()), null);
+  close(null);
+}
@@ -0,0 +1,81 @@
+/**
+ * @file bench_jit.cpp
+ * @brief In-process JIT against the bytecode interpreter and AOT assembly.
+ *
+ * Every kernel and corpus program goes from its parsed AST to a first
+ * result three ways: compiled to vm::Program and run by vm::Vm; emitted by
+ * AsmEmitter, assembled in-process and run from a codegen::JitModule; and
+ * emitted, assembled and linked by `cc -shared`, loaded with dlopen() and
+ * run. All three lower and optimize with the default pass pipeline first.
+ * The table shows the time to the first result of each, best of a few
+ * tries, then the steady-state time of one more run.
+ */
+#include <cstdio>
+
+#include "AsmEmitter.hpp"
+#include "BenchUtil.hpp"
+#include "Bytecode.hpp"
+#include "Jit.hpp"
+#include "Lower.hpp"
+#include "PassManager.hpp"
+#include "Toolchain.hpp"
+#include "Vm.hpp"
+
+namespace {
+
+ir::Function optimized(const bench::Program& src) {
+  ir::Function fn = ir::lower(src.root, src.frame);
+  opt::PassManager().run(fn);
+  return fn;
+}
+
+void row(const char* name, const bench::Program& src) {
+  std::vector<uint8_t> frame(src.frame.size + 1);
+  double fv = bench::timeUs(5, [&] {
+    std::fill(frame.begin(), frame.end(), 0);
+    ir::Function fn = optimized(src);
+    vm::Program prog = vm::compile(fn);
+    vm::Vm(prog).run(frame.data());
+  });
+  double fj = bench::timeUs(5, [&] {
+    std::fill(frame.begin(), frame.end(), 0);
+    codegen::JitModule mod(optimized(src));
+    mod.entry("sc_main")(frame.data());
+  });
+  double fa = bench::timeUs(3, [&] {
+    std::fill(frame.begin(), frame.end(), 0);
+    std::string text = codegen::AsmEmitter().emit(optimized(src));
+    codegen::TempDir dir;
+    codegen::SharedLibrary lib(codegen::assembleShared(dir, text));
+    lib.entry("sc_main")(frame.data());
+  });
+
+  ir::Function fn = optimized(src);
+  vm::Program prog = vm::compile(fn);
+  vm::Vm machine(prog);
+  double sv = bench::timeUs(10, [&] {
+    std::fill(frame.begin(), frame.end(), 0);
+    machine.run(frame.data());
+  });
+  codegen::JitModule mod(fn);
+  double sj = bench::nativeUs(mod.entry("sc_main"), fn.frame.size);
+  codegen::TempDir dir;
+  codegen::SharedLibrary lib(
+      codegen::assembleShared(dir, codegen::AsmEmitter().emit(fn)));
+  double sa = bench::nativeUs(lib.entry("sc_main"), fn.frame.size);
+
+  std::printf("%-11s %9.1f %9.1f %9.0f %9.2f %9.2f %9.2f %7.0fx\n", name, fv,
+              fj, fa, sv, sj, sa, fa / fj);
+}
+
+}  // namespace
+
+int main() {
+  std::printf("%-11s %29s %29s\n", "", "first result us",
+              "steady state us");
+  std::printf("%-11s %9s %9s %9s %9s %9s %9s %8s\n", "program", "vm", "jit",
+              "aot", "vm", "jit", "aot", "aot/jit");
+  for (const auto& [name, src] : bench::kernels) row(name, bench::parse(src));
+  for (const auto& name : bench::corpus)
+    row(name.c_str(), bench::parseCorpus(name));
+}
@@ -0,0 +1,36 @@
+/**
+ * @file bench_jumping.cpp
+ * @brief Jumping code versus bool values for conditions.
+ *
+ * Lowers every corpus program twice, once computing conditions into bool
+ * temporaries and once as jumping code, and compares static code size,
+ * executed instructions, executed branches and interpreter run time.
+ */
+#include <cstdio>
+
+#include "BenchUtil.hpp"
+#include "Interp.hpp"
+#include "Lower.hpp"
+
+int main() {
+  std::printf("%-12s %6s %6s %9s %9s %8s %8s %9s %9s\n", "program", "size",
+              "size+j", "instrs", "instrs+j", "jumps", "jumps+j", "us",
+              "us+j");
+  for (const auto& name : bench::corpus) {
+    auto prog = bench::parseCorpus(name);
+    ir::LowerOptions eager;
+    eager.jumpingCode = false;
+    ir::Function base = ir::lower(prog.root, prog.frame, eager);
+    ir::Function jump = ir::lower(prog.root, prog.frame);
+
+    ir::Interpreter ib(base), ij(jump);
+    double tb = bench::timeUs(50, [&] { ib.run(); });
+    double tj = bench::timeUs(50, [&] { ij.run(); });
+    std::printf("%-12s %6zu %6zu %9llu %9llu %8llu %8llu %9.1f %9.1f\n",
+                name.c_str(), base.code.size(), jump.code.size(),
+                (unsigned long long)ib.executed,
+                (unsigned long long)ij.executed,
+                (unsigned long long)ib.branches,
+                (unsigned long long)ij.branches, tb, tj);
+  }
+}
@@ -0,0 +1,64 @@
+/**
+ * @file bench_llvm.cpp
+ * @brief Our optimizer and backend against LLVM's.
+ *
+ * Every kernel and corpus program goes through two native pipelines: ours
+ * (lowering, the default pass pipeline, AsmEmitter, `cc`) and LLVM's
+ * (LlvmEmitter, `opt -O3`, `llc`, `cc`). The table shows run time of both,
+ * the ratio, and the wall time of each pipeline from AST to shared object,
+ * external tools included. Skipped when `opt` or `llc` are not on PATH.
+ */
+#include <cstdio>
+
+#include "AsmEmitter.hpp"
+#include "BenchUtil.hpp"
+#include "LlvmEmitter.hpp"
+#include "Lower.hpp"
+#include "PassManager.hpp"
+#include "Toolchain.hpp"
+
+namespace {
+
+codegen::LlvmOptions llvmOptions;
+
+void row(const char* name, const bench::Program& prog) {
+  codegen::TempDir dir;
+  std::string ours, theirs;
+  double co = bench::timeUs(1, [&] {
+    ir::Function fn = ir::lower(prog.root, prog.frame);
+    opt::PassManager().run(fn);
+    ours = codegen::assembleShared(dir, codegen::AsmEmitter().emit(fn), "ours");
+  });
+  double cl = bench::timeUs(1, [&] {
+    std::string ll = dir.write(
+        "theirs.ll",
+        codegen::LlvmEmitter(llvmOptions).emit(prog.root, prog.frame));
+    std::string obj = dir.file("theirs.o");
+    codegen::runCommand("opt -O3 '" + ll + "' | llc -O3 "
+                        "-relocation-model=pic -filetype=obj -o '" +
+                        obj + "'");
+    theirs = dir.file("theirs.so");
+    codegen::runCommand("cc -shared -o '" + theirs + "' '" + obj + "'");
+  });
+
+  codegen::SharedLibrary a(ours), b(theirs);
+  double to = bench::nativeUs(a.entry("sc_main"), prog.frame.size);
+  double tl = bench::nativeUs(b.entry("sc_main"), prog.frame.size);
+  std::printf("%-11s %9.2f %9.2f %6.2fx %9.1f %9.1f\n", name, to, tl, to / tl,
+              co / 1000, cl / 1000);
+}
+
+}  // namespace
+
+int main() {
+  if (!codegen::haveTool("opt") || !codegen::haveTool("llc")) {
+    std::printf("opt or llc not on PATH, skipped\n");
+    return 0;
+  }
+  llvmOptions.opaquePointers = codegen::llvmVersion("opt") >= 15;
+  std::printf("%-11s %9s %9s %7s %9s %9s\n", "program", "ours us", "llvm us",
+              "ratio", "ours ms", "llvm ms");
+  for (const auto& [name, src] : bench::kernels) row(name, bench::parse(src));
+  for (const auto& name : bench::corpus)
+    row(name.c_str(), bench::parseCorpus(name));
+}
@@ -0,0 +1,84 @@
+/**
+ * @file bench_parallel_emit.cpp
+ * @brief Text emission of a large program on 1 to 8 threads.
+ *
+ * The kernels and corpus programs are parsed once and N copies of each
+ * are joined into one right-leaning Seq chain, the shape the parser gives
+ * a block, so the program has some thousands of top-level statements.
+ * The serial row prints it with ast::emitStatic<TextEmitter> straight
+ * into /dev/null; the others go through ast::emitTextParallel() with a
+ * pool of T-1 workers plus the caller. Every output is compared with the
+ * serial one byte for byte; the table shows the best of five, MB/s and
+ * the speedup over serial.
+ */
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdio>
+
+#include "BenchUtil.hpp"
+#include "EmitParallel.hpp"
+#include "EmitStatic.hpp"
+#include "Emitter.h"
+#include "Sink.hpp"
+#include "ThreadPool.hpp"
+
+namespace {
+
+std::vector<sptr<ast::Stmt>> programs;
+
+void row(int copies, int null) {
+  sptr<ast::Stmt> root;
+  for (int k = 0; k < copies; ++k)
+    for (auto it = programs.rbegin(); it != programs.rend(); ++it)
+      root = root ? std::make_shared<ast::Seq>(SourceLocation{0, 0}, *it, root)
+                  : *it;
+  size_t blocks = ast::topLevel(*root).size();
+
+  emit::StringSink expected;
+  {
+    emit::TextEmitter em(expected);
+    ast::emitStatic(*root, em);
+  }
+  double mb = expected.str().size() / 1e6;
+
+  emit::FdSink sink(null);
+  double serial = bench::timeUs(5, [&] {
+    emit::TextEmitter em(sink);
+    ast::emitStatic(*root, em);
+    sink.flush();
+  });
+  std::printf("%6d %7zu %8.1f %7s %9.2f %8.1f %7.2fx\n", copies, blocks, mb,
+              "serial", serial / 1000, mb / (serial / 1e6), 1.0);
+
+  for (unsigned threads : {1u, 2u, 4u, 8u}) {
+    task::ThreadPool pool(threads - 1);
+    emit::StringSink check;
+    ast::emitTextParallel(*root, check, pool);
+    if (check.str() != expected.str()) {
+      std::printf("output differs on %u threads\n", threads);
+      return;
+    }
+    double us = bench::timeUs(5, [&] {
+      ast::emitTextParallel(*root, sink, pool);
+      sink.flush();
+    });
+    std::printf("%6d %7zu %8.1f %7u %9.2f %8.1f %7.2fx\n", copies, blocks, mb,
+                threads, us / 1000, mb / (us / 1e6), serial / us);
+  }
+}
+
+}  // namespace
+
+int main() {
+  for (const auto& [name, src] : bench::kernels)
+    programs.push_back(bench::parse(src).root);
+  for (const auto& name : bench::corpus)
+    programs.push_back(bench::parseCorpus(name).root);
+  int null = open("/dev/null", O_WRONLY);
+  std::printf("%u hardware threads\n", std::thread::hardware_concurrency());
+  std::printf("%6s %7s %8s %7s %9s %8s %8s\n", "copies", "blocks", "MB",
+              "threads", "ms", "MB/s", "speedup");
+  for (int copies : {64, 1024, 8192}) row(copies, null);
+  close(null);
+}
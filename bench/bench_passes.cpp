@@ -0,0 +1,37 @@
+/**
+ * @file bench_passes.cpp
+ * @brief Per-pass cost of the default pipeline.
+ *
+ * Runs a PassManager over every corpus program and over all of them
+ * pasted together, then prints its `-time-passes` report: wall time,
+ * heap allocations, instruction counts and analysis cache use per pass.
+ * An optional argument replaces the default pipeline.
+ */
+#include <cstdio>
+#include <string>
+
+#include "AllocCounter.hpp"
+#include "BenchUtil.hpp"
+#include "Lower.hpp"
+#include "PassManager.hpp"
+
+int main(int argc, char** argv) {
+  opt::PassManager pm(argc > 1 ? argv[1] : opt::kDefaultPipeline);
+  pm.countAllocs([] {
+    testutil::AllocCounts a = testutil::allocCounts();
+    return opt::AllocTotals{a.count, a.bytes};
+  });
+  std::string all = "{\n";
+  for (const auto& name : bench::corpus) {
+    bench::Program prog = bench::parseCorpus(name);
+    ir::Function fn = ir::lower(prog.root, prog.frame);
+    pm.run(fn);
+    all += bench::readCorpus(name) + "\n";
+  }
+  for (int k = 0; k < 20; ++k) {
+    bench::Program prog = bench::parse(all + "}\n");
+    ir::Function fn = ir::lower(prog.root, prog.frame);
+    pm.run(fn);
+  }
+  std::printf("%s", pm.report().c_str());
+}
@@ -0,0 +1,99 @@
+/**
+ * @file bench_sink.cpp
+ * @brief TextEmitter writing 100 MB of text into memory, a stream and a
+ * file descriptor.
+ *
+ * The kernels and corpus programs are parsed once and emitted by
+ * TextEmitter over and over until 100 MB of text have been written: into
+ * memory (a StringSink, as `code()` does), into a std::ofstream on a
+ * temporary file (StreamSink), and into the descriptor of a temporary file
+ * and of /dev/null (FdSink). The table shows the wall time, the
+ * throughput and how far the peak resident set grew. The streaming sinks
+ * run first, so the growth of the in-memory run is not hidden by theirs.
+ */
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <fstream>
+#include <functional>
+
+#include "BenchUtil.hpp"
+#include "Emitter.h"
+#include "Sink.hpp"
+
+namespace {
+
+constexpr uint64_t kTarget = 100ull << 20;
+
+std::vector<bench::Program> programs;
+
+long peakKb() {
+  rusage ru{};
+  getrusage(RUSAGE_SELF, &ru);
+  return ru.ru_maxrss;
+}
+
+/// Emit every program into @p em until @p out holds kTarget bytes.
+void fill(emit::TextEmitter& em, emit::Sink& out) {
+  while (out.size() < kTarget)
+    for (const auto& prog : programs) prog.root->emit(em);
+  out.flush();
+}
+
+void row(const char* name, const std::function<uint64_t()>& run) {
+  long before = peakKb();
+  uint64_t bytes = 0;
+  double us = bench::timeUs(1, [&] { bytes = run(); });
+  long grown = peakKb() - before;
+  std::printf("%-14s %8.1f %9.1f %9.1f %10.1f\n", name, bytes / 1048576.0,
+              us / 1000, bytes / 1048576.0 / (us / 1e6), grown / 1024.0);
+}
+
+}  // namespace
+
+int main() {
+  for (const auto& [name, src] : bench::kernels)
+    programs.push_back(bench::parse(src));
+  for (const auto& name : bench::corpus)
+    programs.push_back(bench::parseCorpus(name));
+
+  char path[] = "/tmp/bench_sinkXXXXXX";
+  int fd = mkstemp(path);
+  if (fd < 0) {
+    std::perror("mkstemp");
+    return 1;
+  }
+  std::printf("%-14s %8s %9s %9s %10s\n", "sink", "MB", "ms", "MB/s",
+              "peak +MB");
+  row("fd /dev/null", [] {
+    int null = open("/dev/null", O_WRONLY);
+    emit::FdSink out(null);
+    emit::TextEmitter em(out);
+    fill(em, out);
+    close(null);
+    return out.size();
+  });
+  row("fd file", [&] {
+    emit::FdSink out(fd);
+    emit::TextEmitter em(out);
+    fill(em, out);
+    return out.size();
+  });
+  row("ofstream file", [&] {
+    std::ofstream os(path, std::ios::binary | std::ios::trunc);
+    emit::StreamSink out(os);
+    emit::TextEmitter em(out);
+    fill(em, out);
+    return out.size();
+  });
+  row("memory", [] {
+    emit::TextEmitter em;
+    while (em.code().size() < kTarget)
+      for (const auto& prog : programs) prog.root->emit(em);
+    return static_cast<uint64_t>(em.code().size());
+  });
+  close(fd);
+  unlink(path);
+}
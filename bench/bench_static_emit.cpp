@@ -0,0 +1,138 @@
+/**
+ * @file bench_static_emit.cpp
+ * @brief The virtual emit walk against ast::emitStatic() on a large AST.
+ *
+ * The kernels and corpus programs are parsed once and joined by a
+ * balanced tree of ast::Seq nodes, N copies of each, into one AST of up
+ * to some 700k statements. TextEmitter prints it into /dev/null through
+ * Stmt::emit (a virtual call per node and per emitter method) and through
+ * ast::emitStatic<TextEmitter> (a switch on the node kind, emitter methods
+ * inlined). The table shows the best of five of each, ns per statement
+ * and the speedup; the outputs are compared byte for byte once. The last
+ * columns do the same with an emitter that only counts the calls, which
+ * leaves the cost of the walk itself.
+ */
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdio>
+
+#include "BenchUtil.hpp"
+#include "EmitStatic.hpp"
+#include "Emitter.h"
+#include "Sink.hpp"
+
+namespace {
+
+std::vector<sptr<ast::Stmt>> programs;
+
+/// Emitter doing nothing but counting calls.
+struct Counter final : emit::IOperandEmitter {
+  uint64_t calls = 0;
+
+  emit::Operand next() {
+    return {emit::Operand::Kind::Temp, static_cast<uint32_t>(calls++)};
+  }
+  emit::Operand emitLoadConst(const lexer::Token&) override { return next(); }
+  emit::Operand emitUnaryOp(const lexer::Token&, emit::Operand) override {
+    return next();
+  }
+  emit::Operand emitBinaryOp(emit::Operand, const lexer::Token&,
+                             emit::Operand) override {
+    return next();
+  }
+  emit::Operand emitArrayAccess(emit::Operand, emit::Operand) override {
+    return next();
+  }
+  emit::Operand emitTemp(int) override { return next(); }
+  emit::Operand emitIdentifier(std::string_view, int) override {
+    return next();
+  }
+  void emitIf(emit::Operand, emit::FunctionRef<void()> thenBlock) override {
+    ++calls;
+    thenBlock();
+  }
+  void emitIfElse(emit::Operand, emit::FunctionRef<void()> thenBlock,
+                  emit::FunctionRef<void()> elseBlock) override {
+    ++calls;
+    thenBlock();
+    elseBlock();
+  }
+  void emitWhile(emit::FunctionRef<emit::Operand()> condGen,
+                 emit::FunctionRef<void()> bodyGen) override {
+    ++calls;
+    condGen();
+    bodyGen();
+  }
+  void emitDoWhile(emit::FunctionRef<void()> bodyGen,
+                   emit::FunctionRef<emit::Operand()> condGen) override {
+    ++calls;
+    bodyGen();
+    condGen();
+  }
+  void emitBreak() override { ++calls; }
+  void emitAssign(emit::Operand, emit::Operand) override { ++calls; }
+  void emitArrayAssign(emit::Operand, emit::Operand, emit::Operand) override {
+    ++calls;
+  }
+};
+
+/// Seq tree of @p parts[lo, hi), balanced so the walks recurse shallowly.
+sptr<ast::Stmt> join(const std::vector<sptr<ast::Stmt>>& parts, size_t lo,
+                     size_t hi) {
+  if (hi - lo == 1) return parts[lo];
+  size_t mid = lo + (hi - lo) / 2;
+  return std::make_shared<ast::Seq>(SourceLocation{0, 0}, join(parts, lo, mid),
+                                    join(parts, mid, hi));
+}
+
+void row(int copies, int null) {
+  std::vector<sptr<ast::Stmt>> parts;
+  for (int k = 0; k < copies; ++k)
+    parts.insert(parts.end(), programs.begin(), programs.end());
+  sptr<ast::Stmt> root = join(parts, 0, parts.size());
+
+  emit::StringSink a, b;
+  emit::TextEmitter va(a), sb(b);
+  root->emit(va);
+  ast::emitStatic(*root, sb);
+  if (a.str() != b.str()) {
+    std::printf("outputs differ at %d copies\n", copies);
+    return;
+  }
+  // statements: lines not closing a block
+  uint64_t statements = 0;
+  for (size_t k = 0; k < a.str().size(); ++k)
+    statements += a.str()[k] == '\n' && a.str()[k - 1] != '}' &&
+                  a.str()[k - 1] != '{';
+
+  emit::FdSink sink(null);
+  emit::TextEmitter em(sink);
+  double virt = bench::timeUs(5, [&] { root->emit(em); });
+  double stat = bench::timeUs(5, [&] { ast::emitStatic(*root, em); });
+  Counter cv, cs;
+  double walkVirt = bench::timeUs(5, [&] { root->emit(cv); });
+  double walkStat = bench::timeUs(5, [&] { ast::emitStatic(*root, cs); });
+  if (cv.calls != cs.calls) std::printf("call counts differ\n");
+  std::printf("%6d %9llu %10.1f %10.1f %8.1f %8.1f %7.2fx %8.1f %8.1f %7.2fx\n",
+              copies, (unsigned long long)statements, virt / 1000,
+              stat / 1000, virt * 1000 / statements,
+              stat * 1000 / statements, virt / stat,
+              walkVirt * 1000 / statements, walkStat * 1000 / statements,
+              walkVirt / walkStat);
+}
+
+}  // namespace
+
+int main() {
+  for (const auto& [name, src] : bench::kernels)
+    programs.push_back(bench::parse(src).root);
+  for (const auto& name : bench::corpus)
+    programs.push_back(bench::parseCorpus(name).root);
+  int null = open("/dev/null", O_WRONLY);
+  std::printf("%6s %9s %10s %10s %8s %8s %8s %8s %8s %8s\n", "copies",
+              "stmts", "virtual ms", "static ms", "virt ns", "stat ns",
+              "speedup", "walk v", "walk s", "speedup");
+  for (int copies : {16, 256, 4096}) row(copies, null);
+  close(null);
+}
@@ -0,0 +1,98 @@
+/**
+ * @file bench_vm.cpp
+ * @brief Bytecode interpreter against the three-address code interpreter.
+ *
+ * Every kernel and corpus program is lowered, optimized with the default
+ * pass pipeline and compiled to bytecode. The table shows bytecode size,
+ * instructions dispatched per run, run time of ir::Interpreter and of
+ * vm::Vm with switch and with computed-goto dispatch, and the dispatch
+ * rate of the latter in millions of instructions per second.
+ *
+ * The last columns are for the same bytecode after vm::quicken() and
+ * vm::fuse() with a profile of one run: instructions dispatched, the
+ * reduction, computed-goto run time and the speedup over plain bytecode.
+ * The hottest pairs and triples over all programs follow the table.
+ */
+#include <cstdio>
+#include <string>
+
+#include "BenchUtil.hpp"
+#include "Bytecode.hpp"
+#include "Interp.hpp"
+#include "Lower.hpp"
+#include "PassManager.hpp"
+#include "Rewrite.hpp"
+#include "Vm.hpp"
+
+namespace {
+
+vm::Profile workload;  ///< Of every program, before fusion
+
+void row(const char* name, const bench::Program& src) {
+  ir::Function fn = ir::lower(src.root, src.frame);
+  opt::PassManager().run(fn);
+  vm::Program prog = vm::compile(fn);
+
+  ir::Interpreter interp(fn);
+  vm::Vm machine(prog);
+  std::vector<uint8_t> frame(prog.frameSize);
+  double ti = bench::timeUs(5, [&] { interp.run(); });
+  double ts = bench::timeUs(10, [&] {
+    std::fill(frame.begin(), frame.end(), 0);
+    machine.run(frame.data(), vm::Dispatch::Switch);
+  });
+  double tt = bench::timeUs(10, [&] {
+    std::fill(frame.begin(), frame.end(), 0);
+    machine.run(frame.data(), vm::Dispatch::Threaded);
+  });
+  uint64_t plain = machine.dispatched;
+
+  vm::Program fast = vm::compile(fn);
+  vm::quicken(fast);
+  vm::Profile profile;
+  std::fill(frame.begin(), frame.end(), 0);
+  vm::Vm(fast).run(frame.data(), profile);
+  std::fill(frame.begin(), frame.end(), 0);
+  vm::Vm(fast).run(frame.data(), workload);
+  vm::fuse(fast, profile);
+  vm::Vm fused(fast);
+  double tf = bench::timeUs(10, [&] {
+    std::fill(frame.begin(), frame.end(), 0);
+    fused.run(frame.data(), vm::Dispatch::Threaded);
+  });
+  std::printf(
+      "%-11s %6zu %10llu %10.1f %10.1f %10.1f %8.0f %6.1fx %10llu %5.1f%% "
+      "%10.1f %6.2fx\n",
+      name, prog.code.size() * sizeof(uint32_t),
+      static_cast<unsigned long long>(plain), ti, ts, tt, plain / tt, ti / tt,
+      static_cast<unsigned long long>(fused.dispatched),
+      100.0 * (plain - fused.dispatched) / plain, tf, tt / tf);
+}
+
+void hottest(int length) {
+  for (const vm::Sequence& s : vm::hottest(workload, length, 8)) {
+    std::string text;
+    for (vm::Op op : s.ops) text += std::string(text.empty() ? "" : " ") +
+                                    vm::opName(op);
+    std::printf("  %-24s %10llu\n", text.c_str(),
+                static_cast<unsigned long long>(s.count));
+  }
+}
+
+}  // namespace
+
+int main() {
+  std::printf("%-11s %6s %10s %10s %10s %10s %8s %7s %10s %6s %10s %7s\n",
+              "program", "bytes", "dispatch", "interp us", "switch us",
+              "goto us", "Mops/s", "speedup", "fused", "fewer", "fused us",
+              "speedup");
+  for (const auto& [name, src] : bench::kernels) row(name, bench::parse(src));
+  for (const auto& name : bench::corpus)
+    row(name.c_str(), bench::parseCorpus(name));
+  std::printf("\nhottest pairs after quickening\n");
+  hottest(2);
+  std::printf("hottest triples after quickening\n");
+  hottest(3);
+  if (!vm::haveThreadedDispatch())
+    std::printf("\nno computed goto in this build: both columns use switch\n");
+}
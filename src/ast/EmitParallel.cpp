@@ -0,0 +1,63 @@
+/**
+ * @file EmitParallel.cpp
+ * @brief Text emission of the top-level statements of a program on a
+ * thread pool.
+ */
+#include "EmitParallel.hpp"
+
+#include <algorithm>
+#include <memory>
+
+#include "EmitStatic.hpp"
+#include "Emitter.h"
+
+namespace ast {
+
+namespace {
+/// Runs handed out per thread of the pool, caller included.
+constexpr size_t kRunsPerThread = 8;
+/// Buffer of a run; runs hold a few statements, most of them far less.
+constexpr size_t kRunCapacity = 4 * 1024;
+}  // namespace
+
+std::vector<const Stmt*> topLevel(const Stmt& root) {
+  std::vector<const Stmt*> out;
+  std::vector<const Stmt*> pending{&root};
+  while (!pending.empty()) {
+    const Stmt* s = pending.back();
+    pending.pop_back();
+    if (s->kind != StmtKind::Seq) {
+      out.push_back(s);
+      continue;
+    }
+    const auto& seq = static_cast<const Seq&>(*s);
+    if (seq.second) pending.push_back(seq.second.get());
+    if (seq.first) pending.push_back(seq.first.get());
+  }
+  return out;
+}
+
+void emitTextParallel(const Stmt& root, emit::Sink& out,
+                      task::ThreadPool& pool, bool rotateLoops) {
+  std::vector<const Stmt*> stmts = topLevel(root);
+  size_t runs = std::min(stmts.size(), (pool.size() + 1) * kRunsPerThread);
+  if (pool.size() == 0 || runs <= 1) {
+    emit::TextEmitter em(out);
+    em.rotateLoops = rotateLoops;
+    for (const Stmt* s : stmts) emitStatic(*s, em);
+    return;
+  }
+
+  std::vector<std::unique_ptr<emit::StringSink>> buffers(runs);
+  pool.parallelFor(runs, [&](size_t k) {
+    size_t begin = stmts.size() * k / runs;
+    size_t end = stmts.size() * (k + 1) / runs;
+    buffers[k] = std::make_unique<emit::StringSink>(kRunCapacity);
+    emit::TextEmitter em(*buffers[k]);
+    em.rotateLoops = rotateLoops;
+    for (size_t i = begin; i < end; ++i) emitStatic(*stmts[i], em);
+  });
+  for (auto& b : buffers) out.put(b->str());
+}
+
+}  // namespace ast
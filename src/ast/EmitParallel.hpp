@@ -0,0 +1,33 @@
+/**
+ * @file EmitParallel.hpp
+ * @brief Text emission of the top-level statements of a program on a
+ * thread pool.
+ */
+#pragma once
+#include <vector>
+
+#include "Sink.hpp"
+#include "Stmt.h"
+#include "ThreadPool.hpp"
+
+namespace ast {
+
+/// The statements joined by the Seq nodes at the top of @p root, in source
+/// order; @p root itself when it is not a Seq.
+std::vector<const Stmt*> topLevel(const Stmt& root);
+
+/**
+ * @brief Write into @p out what emit::TextEmitter writes for @p root, with
+ * the top-level statements emitted concurrently on @p pool.
+ *
+ * The statements of topLevel() are cut into runs of consecutive ones, a
+ * few per thread so that stealing evens out runs of different cost; each
+ * run is emitted by its own TextEmitter into its own buffer, and the
+ * buffers are written to @p out in source order. The text of a statement
+ * depends on the statement only, so the output is byte for byte the
+ * serial one whatever the number of threads.
+ */
+void emitTextParallel(const Stmt& root, emit::Sink& out,
+                      task::ThreadPool& pool, bool rotateLoops = false);
+
+}  // namespace ast
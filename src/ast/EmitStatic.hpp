@@ -0,0 +1,157 @@
+/**
+ * @file EmitStatic.hpp
+ * @brief The AST walk of Expr::emit and Stmt::emit as a template over the
+ * emitter, for backends known at compile time.
+ */
+#pragma once
+#include "Expr.hpp"
+#include "IOperandEmitter.hpp"
+#include "Stmt.h"
+#include "Word.hpp"
+
+namespace ast {
+
+template <typename E>
+emit::Operand emitStatic(const Expr& e, E& out);
+
+namespace detail {
+/// emitStatic() with the leaves handled in place: most operands are
+/// leaves, and they need none of the frame of the full walk.
+template <typename E>
+inline emit::Operand operand(const Expr& e, E& out) {
+  switch (e.kind) {
+    case ExprKind::Constant:
+      return out.E::emitLoadConst(*static_cast<const Constant&>(e).value);
+    case ExprKind::Temp:
+      return out.E::emitTemp(static_cast<const Temp&>(e).number);
+    case ExprKind::Id: {
+      const auto& sym = *static_cast<const IdExpr&>(e).sym;
+      return out.E::emitIdentifier(sym.name, sym.offset);
+    }
+    default:
+      return emitStatic(e, out);
+  }
+}
+}  // namespace detail
+
+/**
+ * @brief Emit @p e into @p out making the calls `e.emit(out)` makes.
+ *
+ * Nodes are told apart by their ExprKind instead of a virtual call, and
+ * the emitter methods are called qualified with @p E, so with its
+ * definitions in sight (and E `final` for the ones it inherits) they
+ * inline into the walk; leaf operands need no recursive call at all.
+ * Nodes of kind `Other` go through their virtual emit().
+ */
+template <typename E>
+emit::Operand emitStatic(const Expr& e, E& out) {
+  switch (e.kind) {
+    case ExprKind::Op: {
+      const auto& n = static_cast<const Op&>(e);
+      emit::Operand l = detail::operand(*n.lhs, out);
+      emit::Operand r = detail::operand(*n.rhs, out);
+      return out.E::emitBinaryOp(l, *n.op_tok, r);
+    }
+    case ExprKind::Logical: {
+      const auto& n = static_cast<const Logical&>(e);
+      emit::Operand l = detail::operand(*n.lhs, out);
+      return out.E::emitLogicalOp(
+          l, *n.op_tok, [&] { return detail::operand(*n.rhs, out); });
+    }
+    case ExprKind::Unary: {
+      const auto& n = static_cast<const Unary&>(e);
+      emit::Operand operand = detail::operand(*n.expr, out);
+      return out.E::emitUnaryOp(*n.op_tok, operand);
+    }
+    case ExprKind::Constant:
+      return out.E::emitLoadConst(*static_cast<const Constant&>(e).value);
+    case ExprKind::Temp:
+      return out.E::emitTemp(static_cast<const Temp&>(e).number);
+    case ExprKind::Access: {
+      const auto& n = static_cast<const Access&>(e);
+      emit::Operand arr = detail::operand(*n.array, out);
+      emit::Operand idx = detail::operand(*n.index, out);
+      return out.E::emitArrayAccess(arr, idx);
+    }
+    case ExprKind::Id: {
+      const auto& sym = *static_cast<const IdExpr&>(e).sym;
+      return out.E::emitIdentifier(sym.name, sym.offset);
+    }
+    case ExprKind::Other:
+      break;
+  }
+  return e.emit(static_cast<emit::IOperandEmitter&>(out));
+}
+
+/**
+ * @brief Emit @p s into @p out making the calls `s.emit(out)` makes, see
+ * emitStatic(const Expr&, E&).
+ */
+template <typename E>
+void emitStatic(const Stmt& s, E& out) {
+  switch (s.kind) {
+    case StmtKind::Seq: {
+      // the `second` spine iteratively, the `first` side recursively
+      const Stmt* cur = &s;
+      while (cur && cur->kind == StmtKind::Seq) {
+        const auto& n = static_cast<const Seq&>(*cur);
+        if (n.first) emitStatic(*n.first, out);
+        cur = n.second.get();
+      }
+      if (cur) emitStatic(*cur, out);
+      return;
+    }
+    case StmtKind::If: {
+      const auto& n = static_cast<const If&>(s);
+      emit::Operand cond = detail::operand(*n.condition, out);
+      out.E::emitIf(cond, [&] { emitStatic(*n.thenStmt, out); });
+      return;
+    }
+    case StmtKind::Else: {
+      const auto& n = static_cast<const Else&>(s);
+      emit::Operand cond = detail::operand(*n.condition, out);
+      out.E::emitIfElse(
+          cond, [&] { emitStatic(*n.thenStmt, out); },
+          [&] { emitStatic(*n.elseStmt, out); });
+      return;
+    }
+    case StmtKind::While: {
+      const auto& n = static_cast<const While&>(s);
+      out.E::emitWhile([&] { return detail::operand(*n.condition, out); },
+                       [&] { emitStatic(*n.body, out); });
+      return;
+    }
+    case StmtKind::Do: {
+      const auto& n = static_cast<const Do&>(s);
+      out.E::emitDoWhile([&] { emitStatic(*n.body, out); },
+                         [&] { return detail::operand(*n.condition, out); });
+      return;
+    }
+    case StmtKind::Break:
+      out.E::emitBreak();
+      return;
+    case StmtKind::Set: {
+      const auto& n = static_cast<const Set&>(s);
+      emit::Operand lhs = detail::operand(*n.id, out);
+      emit::Operand rhs = detail::operand(*n.expr, out);
+      out.E::emitAssign(lhs, rhs);
+      return;
+    }
+    case StmtKind::SetElem: {
+      // SetElem::emit checks the target is an Access
+      const auto& n = static_cast<const SetElem&>(s);
+      if (!n.arrayAccess || n.arrayAccess->kind != ExprKind::Access) break;
+      const auto& access = static_cast<const Access&>(*n.arrayAccess);
+      emit::Operand arr = detail::operand(*access.array, out);
+      emit::Operand idx = detail::operand(*access.index, out);
+      emit::Operand val = detail::operand(*n.expr, out);
+      out.E::emitArrayAssign(arr, idx, val);
+      return;
+    }
+    case StmtKind::Other:
+      break;
+  }
+  s.emit(static_cast<emit::IOperandEmitter&>(out));
+}
+
+}  // namespace ast
@@ -9,18 +9,22 @@
 
 #include "Array.hpp"
 #include "IEmitter.hpp"
+#include "IOperandEmitter.hpp"
 #include "Id.hpp"
 #include "Token.hpp"
 #include "Type.hpp"
 #include "Word.hpp"
 
 using emit::IEmitter;
+using emit::IOperandEmitter;
+using emit::Operand;
 
 namespace ast {
 // Logical ctor
 Logical::Logical(SourceLocation loc, sptr<lexer::Token> tok, sptr<Expr> l,
                  sptr<Expr> r)
     : Op(loc, std::move(tok), std::move(l), std::move(r)) {
+  kind = ExprKind::Logical;
   // Type Check
   if (this->lhs->exprType != symbols::Type::Bool ||
       this->rhs->exprType != symbols::Type::Bool) {
@@ -31,6 +35,16 @@ Logical::Logical(SourceLocation loc, sptr<lexer::Token> tok, sptr<Expr> l,
   exprType = symbols::Type::Bool;
 }
 
+std::string Logical::emit(IEmitter& out) const {
+  auto leftName = lhs->emit(out);
+  return out.emitLogicalOp(leftName, op_tok, [&] { return rhs->emit(out); });
+}
+
+Operand Logical::emit(IOperandEmitter& out) const {
+  Operand left = lhs->emit(out);
+  return out.emitLogicalOp(left, *op_tok, [&] { return rhs->emit(out); });
+}
+
 // Binary Ops
 std::string Op::emit(IEmitter& out) const {
   auto leftName = lhs->emit(out);
@@ -38,6 +52,12 @@ std::string Op::emit(IEmitter& out) const {
   return out.emitBinaryOp(leftName, op_tok, rightName);
 }
 
+Operand Op::emit(IOperandEmitter& out) const {
+  Operand left = lhs->emit(out);
+  Operand right = rhs->emit(out);
+  return out.emitBinaryOp(left, *op_tok, right);
+}
+
 // Arith ctor
 Arith::Arith(SourceLocation loc, sptr<lexer::Token> tok, sptr<Expr> l,
              sptr<Expr> r)
@@ -59,9 +79,14 @@ std::string Constant::emit(IEmitter& out) const {
   return out.emitLoadConst(value);
 }
 
+Operand Constant::emit(IOperandEmitter& out) const {
+  return out.emitLoadConst(*value);
+}
+
 // Constant ctor
 Constant::Constant(SourceLocation loc, sptr<lexer::Word> v)
     : Expr(loc), value(std::move(v)) {
+  kind = ExprKind::Constant;
   switch (value->tag) {
     case lexer::Tag::NUM:
       exprType = symbols::Type::Int;
@@ -81,10 +106,12 @@ Constant::Constant(SourceLocation loc, sptr<lexer::Word> v)
 
 // Temp
 std::string Temp::emit(IEmitter& out) const { return out.emitTemp(number); }
+Operand Temp::emit(IOperandEmitter& out) const { return out.emitTemp(number); }
 
 // Temp ctor
 Temp::Temp(SourceLocation loc, int n, sptr<symbols::Type> t)
     : Expr(loc), number(n) {
+  kind = ExprKind::Temp;
   exprType = t;
 }
 
@@ -94,6 +121,11 @@ std::string Unary::emit(IEmitter& out) const {
   return out.emitUnaryOp(op_tok, exprName);
 }
 
+Operand Unary::emit(IOperandEmitter& out) const {
+  Operand operand = expr->emit(out);
+  return out.emitUnaryOp(*op_tok, operand);
+}
+
 // Not ctor
 Not::Not(SourceLocation loc, sptr<lexer::Token> tok, sptr<Expr> e)
     : Unary(loc, tok, e) {
@@ -108,9 +140,16 @@ std::string Access::emit(IEmitter& out) const {
   return out.emitArrayAccess(arrName, idxName);
 }
 
+Operand Access::emit(IOperandEmitter& out) const {
+  Operand arr = array->emit(out);
+  Operand idx = index->emit(out);
+  return out.emitArrayAccess(arr, idx);
+}
+
 // Access ctor
 Access::Access(SourceLocation loc, sptr<Expr> arr, sptr<Expr> idx)
     : Expr(loc), array(std::move(arr)), index(std::move(idx)) {
+  kind = ExprKind::Access;
   // Check Array type
   if (auto arrType =
           std::dynamic_pointer_cast<symbols::Array>(array->exprType)) {
@@ -124,4 +163,8 @@ std::string IdExpr::emit(emit::IEmitter& out) const {
   return out.emitIdentifier(sym->name, sym->offset);
 }
 
+Operand IdExpr::emit(IOperandEmitter& out) const {
+  return out.emitIdentifier(sym->name, sym->offset);
+}
+
 }  // namespace ast
\ No newline at end of file
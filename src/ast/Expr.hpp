@@ -4,6 +4,8 @@
  */
 
 #pragma once
+#include <cstdint>
+
 #include "ASTNode.hpp"
 #include "Id.hpp"
 #include "sptr.h"
@@ -20,10 +22,29 @@ struct Word;
 
 namespace emit {
 struct IEmitter;
+struct IOperandEmitter;
+struct Operand;
 }
 //-----------------------//
 
 namespace ast {
+/**
+ * @brief Which node class an expression is, for the walk of EmitStatic.hpp.
+ *
+ * Subclasses share the kind of the class whose emit() they use; nodes
+ * defined elsewhere are `Other`.
+ */
+enum class ExprKind : uint8_t {
+  Other,
+  Op,
+  Logical,
+  Unary,
+  Constant,
+  Temp,
+  Access,
+  Id,
+};
+
 /**
  * @brief Base class for all expressions AST nodes.
  *
@@ -31,6 +52,7 @@ namespace ast {
  */
 struct Expr : public ASTNode {
   sptr<symbols::Type> exprType;
+  ExprKind kind = ExprKind::Other;
 
   explicit Expr(SourceLocation loc) : ASTNode(loc), exprType(nullptr) {}
 
@@ -46,6 +68,9 @@ struct Expr : public ASTNode {
    * AST does not manage names and formats  this is done by the emitter.
    */
   virtual std::string emit(emit::IEmitter& out) const = 0;
+
+  /// The same calls through the handle-based interface.
+  virtual emit::Operand emit(emit::IOperandEmitter& out) const = 0;
 };
 
 /**
@@ -57,9 +82,12 @@ struct Op : public Expr {
   sptr<lexer::Token> op_tok;
 
   Op(SourceLocation loc, sptr<lexer::Token> tok, sptr<Expr> l, sptr<Expr> r)
-      : Expr(loc), lhs(std::move(l)), rhs(std::move(r)), op_tok(tok) {}
+      : Expr(loc), lhs(std::move(l)), rhs(std::move(r)), op_tok(tok) {
+    kind = ExprKind::Op;
+  }
 
   std::string emit(emit::IEmitter& out) const override;
+  emit::Operand emit(emit::IOperandEmitter& out) const override;
 };
 
 /**
@@ -77,9 +105,13 @@ struct Unary : public Expr {
   sptr<lexer::Token> op_tok;
 
   Unary(SourceLocation loc, sptr<lexer::Token> tok, sptr<Expr> e)
-      : Expr(loc), expr(std::move(e)), op_tok(tok) {}
+      : Expr(loc), expr(std::move(e)), op_tok(tok) {
+    kind = ExprKind::Unary;
+    exprType = expr->exprType;
+  }
 
   std::string emit(emit::IEmitter& out) const override;
+  emit::Operand emit(emit::IOperandEmitter& out) const override;
 };
 
 /**
@@ -114,6 +146,10 @@ struct GreaterEqual : public Rel {
 struct Logical : public Op {
   Logical(SourceLocation loc, sptr<lexer::Token> tok, sptr<Expr> l,
           sptr<Expr> r);
+
+  /// The right operand is generated lazily through IEmitter::emitLogicalOp.
+  std::string emit(emit::IEmitter& out) const override;
+  emit::Operand emit(emit::IOperandEmitter& out) const override;
 };
 struct And : public Logical {
   using Logical::Logical;
@@ -136,6 +172,7 @@ struct Constant : public Expr {
   sptr<lexer::Word> value;
   explicit Constant(SourceLocation loc, sptr<lexer::Word> v);
   std::string emit(emit::IEmitter& out) const override;
+  emit::Operand emit(emit::IOperandEmitter& out) const override;
 };
 
 /**
@@ -145,6 +182,7 @@ struct Temp : public Expr {
   int number;
   Temp(SourceLocation loc, int n, sptr<symbols::Type> t);
   std::string emit(emit::IEmitter& out) const override;
+  emit::Operand emit(emit::IOperandEmitter& out) const override;
 };
 
 /**
@@ -155,6 +193,7 @@ struct Access : public Expr {
   sptr<Expr> index;
   Access(SourceLocation loc, sptr<Expr> arr, sptr<Expr> idx);
   std::string emit(emit::IEmitter& out) const override;
+  emit::Operand emit(emit::IOperandEmitter& out) const override;
 };
 
 /**
@@ -164,8 +203,10 @@ struct IdExpr : public Expr {
   sptr<symbols::Id> sym;
   IdExpr(SourceLocation loc, sptr<symbols::Id> s)
       : Expr(loc), sym(std::move(s)) {
+    kind = ExprKind::Id;
     exprType = sym->type;
   }
   std::string emit(emit::IEmitter& out) const override;
+  emit::Operand emit(emit::IOperandEmitter& out) const override;
 };
 }  // namespace ast
\ No newline at end of file
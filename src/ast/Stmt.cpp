@@ -2,16 +2,26 @@
 
 #include "Stmt.h"
 
+#include <stdexcept>
+
 #include "Expr.hpp"
 #include "IEmitter.hpp"
+#include "IOperandEmitter.hpp"
 
 namespace ast {
+using emit::IOperandEmitter;
+using emit::Operand;
 
 void Seq::emit(emit::IEmitter& out) const {
   if (first) first->emit(out);
   if (second) second->emit(out);
 }
 
+void Seq::emit(IOperandEmitter& out) const {
+  if (first) first->emit(out);
+  if (second) second->emit(out);
+}
+
 void If::emit(emit::IEmitter& out) const {
   // Get string/value of condition(expr) using Expr::emit
   std::string condVal = condition->emit(out);
@@ -23,6 +33,11 @@ void If::emit(emit::IEmitter& out) const {
   });
 }
 
+void If::emit(IOperandEmitter& out) const {
+  Operand cond = condition->emit(out);
+  out.emitIf(cond, [this, &out]() { thenStmt->emit(out); });
+}
+
 void Else::emit(emit::IEmitter& out) const {
   auto condVal = condition->emit(out);
   out.emitIfElse(
@@ -30,17 +45,35 @@ void Else::emit(emit::IEmitter& out) const {
       [this, &out]() { elseStmt->emit(out); });
 }
 
+void Else::emit(IOperandEmitter& out) const {
+  Operand cond = condition->emit(out);
+  out.emitIfElse(
+      cond, [this, &out]() { thenStmt->emit(out); },
+      [this, &out]() { elseStmt->emit(out); });
+}
+
 void While::emit(emit::IEmitter& out) const {
   out.emitWhile([this, &out]() { return condition->emit(out); },
                 [this, &out]() { body->emit(out); });
 }
 
+void While::emit(IOperandEmitter& out) const {
+  out.emitWhile([this, &out]() { return condition->emit(out); },
+                [this, &out]() { body->emit(out); });
+}
+
 void Do::emit(emit::IEmitter& out) const {
   out.emitDoWhile([this, &out]() { body->emit(out); },
                   [this, &out]() { return condition->emit(out); });
 }
 
+void Do::emit(IOperandEmitter& out) const {
+  out.emitDoWhile([this, &out]() { body->emit(out); },
+                  [this, &out]() { return condition->emit(out); });
+}
+
 void Break::emit(emit::IEmitter& out) const { out.emitBreak(); }
+void Break::emit(IOperandEmitter& out) const { out.emitBreak(); }
 
 void Set::emit(emit::IEmitter& out) const {
   std::string lhsVal = id->emit(out);
@@ -48,17 +81,30 @@ void Set::emit(emit::IEmitter& out) const {
   out.emitAssign(lhsVal, rhsVal);
 }
 
+void Set::emit(IOperandEmitter& out) const {
+  Operand lhs = id->emit(out);
+  Operand rhs = expr->emit(out);
+  out.emitAssign(lhs, rhs);
+}
+
 void SetElem::emit(emit::IEmitter& out) const {
-  // arrayAccess and expr - ar Expr, emit them first:
-  auto arrStr = arrayAccess->emit(out);
+  // split the target a[i]...[j] into the array part and the last index, so
+  // the emitter gets them apart
+  auto access = std::dynamic_pointer_cast<Access>(arrayAccess);
+  if (!access) throw std::runtime_error("SetElem target is not an access");
+  auto arrStr = access->array->emit(out);
+  auto idxStr = access->index->emit(out);
   auto valStr = expr->emit(out);
-  out.emitArrayAssign(
-      arrStr,
-      /* The index from Access can be extracted directly in emitArrayAccess,
-         but if arrayAccess is a concrete Access node,
-         its emit() will already return arr[idx] as a string */
-      "",  // or idx, if the method is implemented separately
-      valStr);
+  out.emitArrayAssign(arrStr, idxStr, valStr);
+}
+
+void SetElem::emit(IOperandEmitter& out) const {
+  auto access = std::dynamic_pointer_cast<Access>(arrayAccess);
+  if (!access) throw std::runtime_error("SetElem target is not an access");
+  Operand arr = access->array->emit(out);
+  Operand idx = access->index->emit(out);
+  Operand val = expr->emit(out);
+  out.emitArrayAssign(arr, idx, val);
 }
 
 }  // namespace ast
\ No newline at end of file
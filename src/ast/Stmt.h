@@ -3,6 +3,7 @@
  * @brief Statement nodes for the Abstract Syntax Tree (AST).
  */
 #pragma once
+#include <cstdint>
 
 #include "ASTNode.hpp"
 #include "sptr.h"
@@ -14,19 +15,42 @@ struct Expr;
 
 namespace emit {
 struct IEmitter;
+struct IOperandEmitter;
 }
 //-----------------------//
 
 namespace ast {
+/**
+ * @brief Which node class a statement is, for the walk of EmitStatic.hpp;
+ * nodes defined elsewhere are `Other`.
+ */
+enum class StmtKind : uint8_t {
+  Other,
+  Seq,
+  If,
+  Else,
+  While,
+  Do,
+  Break,
+  Set,
+  SetElem,
+};
+
 /**
  * @brief Base class for all operators (statement).
  */
 struct Stmt : public ASTNode {
+  StmtKind kind = StmtKind::Other;
+
   explicit Stmt(SourceLocation loc) : ASTNode(loc) {}
+  Stmt(SourceLocation loc, StmtKind k) : ASTNode(loc), kind(k) {}
   virtual ~Stmt() = default;
 
   /// Codegen for statement
   virtual void emit(emit::IEmitter& out) const = 0;
+
+  /// The same calls through the handle-based interface.
+  virtual void emit(emit::IOperandEmitter& out) const = 0;
 };
 
 /**
@@ -37,8 +61,11 @@ struct Seq : public Stmt {
   sptr<Stmt> second;
 
   Seq(SourceLocation loc, sptr<Stmt> s1, sptr<Stmt> s2)
-      : Stmt(loc), first(std::move(s1)), second(std::move(s2)) {}
+      : Stmt(loc, StmtKind::Seq),
+        first(std::move(s1)),
+        second(std::move(s2)) {}
   void emit(emit::IEmitter& out) const override;
+  void emit(emit::IOperandEmitter& out) const override;
 };
 
 /**
@@ -49,10 +76,11 @@ struct If : public Stmt {
   sptr<Stmt> thenStmt;
 
   If(SourceLocation loc, sptr<Expr> cond, sptr<Stmt> thenBranch)
-      : Stmt(loc),
+      : Stmt(loc, StmtKind::If),
         condition(std::move(cond)),
         thenStmt(std::move(thenBranch)) {}
   void emit(emit::IEmitter& out) const override;
+  void emit(emit::IOperandEmitter& out) const override;
 };
 
 /**
@@ -65,11 +93,12 @@ struct Else : public Stmt {
 
   Else(SourceLocation loc, sptr<Expr> cond, sptr<Stmt> thenBranch,
        sptr<Stmt> elseBranch)
-      : Stmt(loc),
+      : Stmt(loc, StmtKind::Else),
         condition(std::move(cond)),
         thenStmt(std::move(thenBranch)),
         elseStmt(std::move(elseBranch)) {}
   void emit(emit::IEmitter& out) const override;
+  void emit(emit::IOperandEmitter& out) const override;
 };
 
 /**
@@ -80,8 +109,11 @@ struct While : public Stmt {
   sptr<Stmt> body;
 
   While(SourceLocation loc, sptr<Expr> cond, sptr<Stmt> bodyStmt)
-      : Stmt(loc), condition(std::move(cond)), body(std::move(bodyStmt)) {}
+      : Stmt(loc, StmtKind::While),
+        condition(std::move(cond)),
+        body(std::move(bodyStmt)) {}
   void emit(emit::IEmitter& out) const override;
+  void emit(emit::IOperandEmitter& out) const override;
 };
 
 /**
@@ -92,16 +124,20 @@ struct Do : public Stmt {
   sptr<Expr> condition;
 
   Do(SourceLocation loc, sptr<Stmt> bodyStmt, sptr<Expr> cond)
-      : Stmt(loc), body(std::move(bodyStmt)), condition(std::move(cond)) {}
+      : Stmt(loc, StmtKind::Do),
+        body(std::move(bodyStmt)),
+        condition(std::move(cond)) {}
   void emit(emit::IEmitter& out) const override;
+  void emit(emit::IOperandEmitter& out) const override;
 };
 
 /**
  * @brief break;
  */
 struct Break : public Stmt {
-  Break(SourceLocation loc) : Stmt(loc) {}
+  Break(SourceLocation loc) : Stmt(loc, StmtKind::Break) {}
   void emit(emit::IEmitter& out) const override;
+  void emit(emit::IOperandEmitter& out) const override;
 };
 
 /**
@@ -112,8 +148,11 @@ struct Set : public Stmt {
   sptr<Expr> expr;  // right expression
 
   Set(SourceLocation loc, sptr<Expr> identifier, sptr<Expr> value)
-      : Stmt(loc), id(std::move(identifier)), expr(std::move(value)) {}
+      : Stmt(loc, StmtKind::Set),
+        id(std::move(identifier)),
+        expr(std::move(value)) {}
   void emit(emit::IEmitter& out) const override;
+  void emit(emit::IOperandEmitter& out) const override;
 };
 
 /**
@@ -124,8 +163,11 @@ struct SetElem : public Stmt {
   sptr<Expr> expr;         // right expression
 
   SetElem(SourceLocation loc, sptr<Expr> access, sptr<Expr> value)
-      : Stmt(loc), arrayAccess(std::move(access)), expr(std::move(value)) {}
+      : Stmt(loc, StmtKind::SetElem),
+        arrayAccess(std::move(access)),
+        expr(std::move(value)) {}
   void emit(emit::IEmitter& out) const override;
+  void emit(emit::IOperandEmitter& out) const override;
 };
 
 }  // namespace ast
@@ -0,0 +1,811 @@
+/**
+ * @file AsmEmitter.cpp
+ * @brief x86-64 assembly (GNU as, AT&T syntax) from three-address code.
+ */
+#include "AsmEmitter.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <map>
+
+#include "Array.hpp"
+#include "Cfg.hpp"
+#include "Liveness.hpp"
+#include "RegAlloc.hpp"
+
+namespace codegen {
+namespace {
+
+using ir::Instr;
+using ir::Opcode;
+using ir::Operand;
+using symbols::Type;
+
+struct GpName {
+  const char* q;  ///< 64-bit
+  const char* d;  ///< 32-bit
+  const char* b;  ///< low byte
+};
+
+// Allocatable registers first, caller-saved before callee-saved, then the
+// scratch registers. %rdi holds the frame.
+constexpr GpName kGp[] = {
+    {"%rcx", "%ecx", "%cl"},    {"%rsi", "%esi", "%sil"},
+    {"%r8", "%r8d", "%r8b"},    {"%r9", "%r9d", "%r9b"},
+    {"%r10", "%r10d", "%r10b"}, {"%rbx", "%ebx", "%bl"},
+    {"%r12", "%r12d", "%r12b"}, {"%r13", "%r13d", "%r13b"},
+    {"%r14", "%r14d", "%r14b"}, {"%r15", "%r15d", "%r15b"},
+    {"%rax", "%eax", "%al"},    {"%rdx", "%edx", "%dl"},
+    {"%r11", "%r11d", "%r11b"},
+};
+constexpr int kGpRegs = 10;
+constexpr int kFirstCalleeSaved = 5;
+constexpr int RAX = 10, RDX = 11, R11 = 12;
+
+constexpr int kFpRegs = 14;
+constexpr int X14 = 14, X15 = 15;
+
+/// Innermost element type of a (possibly nested) array type.
+sptr<Type> scalarOf(sptr<Type> t) {
+  while (auto arr = std::dynamic_pointer_cast<symbols::Array>(t)) t = arr->of;
+  return t;
+}
+
+/// Integer constant as stored in a slot of type @p t.
+int64_t wrap(int64_t v, const sptr<Type>& t) {
+  if (t == Type::Bool) return v != 0;
+  if (t == Type::Char) return static_cast<int8_t>(v);
+  return static_cast<int32_t>(v);
+}
+
+/// Condition code of an integer relation.
+const char* intCond(Opcode rel) {
+  switch (rel) {
+    case Opcode::Lt: return "l";
+    case Opcode::Le: return "le";
+    case Opcode::Gt: return "g";
+    case Opcode::Ge: return "ge";
+    case Opcode::Eq: return "e";
+    default: return "ne";
+  }
+}
+
+/// Frame or stack address: displacement(%base, %index).
+struct Address {
+  const char* base;
+  int disp;
+  int index = -1;  ///< kGp entry or -1
+};
+
+class Generator {
+ public:
+  Generator(const ir::Function& fn, const AsmOptions& opts, AsmStats& stats)
+      : fn(fn), opts(opts), stats(stats) {}
+
+  std::string run();
+
+ private:
+  const ir::Function& fn;
+  const AsmOptions& opts;
+  AsmStats& stats;
+  Allocation alloc;
+  std::string out;
+  std::map<uint64_t, int> consts;  ///< double bits -> pool entry
+  bool signMask = false;
+
+  /* Output */
+
+  void ins(const char* op) {
+    out += '\t';
+    out += op;
+    out += '\n';
+    ++stats.instrs;
+  }
+  void ins(const char* op, const std::string& a) {
+    out += '\t';
+    out += op;
+    out += '\t';
+    out += a;
+    out += '\n';
+    ++stats.instrs;
+  }
+  void ins(const char* op, const std::string& a, const std::string& b) {
+    out += '\t';
+    out += op;
+    out += '\t';
+    out += a;
+    out += ", ";
+    out += b;
+    out += '\n';
+    ++stats.instrs;
+  }
+
+  std::string local(const std::string& name) const {
+    return ".L" + opts.symbol + "_" + name;
+  }
+  std::string label(int n) const { return local(std::to_string(n)); }
+  std::string trap() const { return local("trap"); }
+
+  static std::string imm(int64_t v) {
+    return "$" + std::to_string(static_cast<int32_t>(v));
+  }
+  static std::string xmm(int r) { return "%xmm" + std::to_string(r); }
+
+  static std::string format(const Address& a, int extra = 0) {
+    std::string s;
+    if (a.disp + extra) s = std::to_string(a.disp + extra);
+    s += "(";
+    s += a.base;
+    if (a.index >= 0) {
+      s += ",";
+      s += kGp[a.index].q;
+    }
+    return s + ")";
+  }
+
+  /* Locations */
+
+  bool inReg(const Operand& o) const {
+    return o.isTemp() && alloc.reg[o.temp] >= 0;
+  }
+  int reg(const Operand& o) const { return alloc.reg[o.temp]; }
+
+  std::string slot(const Operand& o, int extra = 0) const {
+    return format({"%rsp", alloc.slot[o.temp]}, extra);
+  }
+  std::string var(const Operand& o, int extra = 0) const {
+    return format({"%rdi", o.var->offset}, extra);
+  }
+
+  std::string constant(double v) {
+    uint64_t bits;
+    std::memcpy(&bits, &v, sizeof bits);
+    auto it = consts.emplace(bits, static_cast<int>(consts.size())).first;
+    return local("c" + std::to_string(it->second)) + "(%rip)";
+  }
+  std::string sign() {
+    signMask = true;
+    return local("sign") + "(%rip)";
+  }
+
+  /// Element @p off (a byte offset) of array variable @p arr.
+  Address address(const Operand& arr, const Operand& off) {
+    if (off.isConst())
+      return {"%rdi", arr.var->offset + static_cast<int32_t>(off.ival)};
+    // 32-bit results are zero-extended, which is exact for valid offsets
+    return {"%rdi", arr.var->offset, gpReg(off, R11)};
+  }
+
+  /* General-purpose values: 32 bits, sign-extended from char, 0/1 for
+     bool */
+
+  /// Operand usable as the source of a 32-bit instruction; char and bool
+  /// variables are loaded into @p scratch first.
+  std::string gpSrc(const Operand& o, int scratch) {
+    if (o.isConst()) return imm(wrap(o.ival, o.type));
+    if (o.isTemp())
+      return inReg(o) ? kGp[reg(o)].d : slot(o);
+    if (o.type == Type::Int) return var(o);
+    ins(o.type == Type::Char ? "movsbl" : "movzbl", var(o), kGp[scratch].d);
+    return kGp[scratch].d;
+  }
+
+  /// Register holding @p o, @p scratch unless @p o is in one already.
+  int gpReg(const Operand& o, int scratch) {
+    if (inReg(o)) return reg(o);
+    load(o, scratch);
+    return scratch;
+  }
+
+  void load(const Operand& o, int r) {
+    std::string s = gpSrc(o, r);
+    if (s != kGp[r].d) ins("movl", s, kGp[r].d);
+  }
+
+  int target(const Operand& dst) const { return inReg(dst) ? reg(dst) : RAX; }
+
+  /// Bring a 32-bit result in @p r to the representation of @p t.
+  void normalize(int r, const sptr<Type>& t) {
+    if (t == Type::Char) {
+      ins("movsbl", kGp[r].b, kGp[r].d);
+    } else if (t == Type::Bool) {
+      ins("testl", kGp[r].d, kGp[r].d);
+      ins("setne", kGp[r].b);
+      ins("movzbl", kGp[r].b, kGp[r].d);
+    }
+  }
+
+  void store(const Operand& dst, int r) {
+    if (inReg(dst)) {
+      if (reg(dst) != r) ins("movl", kGp[r].d, kGp[reg(dst)].d);
+    } else if (dst.isTemp()) {
+      ins("movl", kGp[r].d, slot(dst));
+    } else if (dst.type->width == 4) {
+      ins("movl", kGp[r].d, var(dst));
+    } else {
+      ins("movb", kGp[r].b, var(dst));
+    }
+  }
+
+  /// Store constant @p v into a destination not in a register.
+  void storeConst(const Operand& dst, int64_t v) {
+    v = wrap(v, dst.type);
+    if (dst.isTemp())
+      ins("movl", imm(v), slot(dst));
+    else
+      ins(dst.type->width == 4 ? "movl" : "movb", imm(v), var(dst));
+  }
+
+  /// Compare and set the flags for an integer relation `a rel b`.
+  void compareInt(const Operand& a, const Operand& b) {
+    int ra = gpReg(a, RAX);
+    ins("cmpl", gpSrc(b, RDX), kGp[ra].d);
+  }
+
+  /// Compare @p o with zero, loading it into @p scratch if need be.
+  void test(const Operand& o, int scratch) {
+    std::string s = gpSrc(o, scratch);
+    if (s[0] == '$') {
+      ins("movl", s, kGp[scratch].d);
+      s = kGp[scratch].d;
+    }
+    if (s[0] == '%')
+      ins("testl", s, s);
+    else
+      ins("cmpl", "$0", s);
+  }
+
+  /* Floats */
+
+  std::string fpSrc(const Operand& o) {
+    if (o.isConst()) return constant(o.fval);
+    if (o.isTemp()) return inReg(o) ? xmm(reg(o)) : slot(o);
+    return var(o);
+  }
+
+  void loadFp(const Operand& o, int x) {
+    if (inReg(o)) {
+      if (reg(o) != x) ins("movapd", xmm(reg(o)), xmm(x));
+    } else {
+      ins("movsd", fpSrc(o), xmm(x));
+    }
+  }
+
+  int fpReg(const Operand& o, int scratch) {
+    if (inReg(o)) return reg(o);
+    loadFp(o, scratch);
+    return scratch;
+  }
+
+  int fpTarget(const Operand& dst) const {
+    return inReg(dst) ? reg(dst) : X14;
+  }
+
+  void storeFp(const Operand& dst, int x) {
+    if (inReg(dst)) {
+      if (reg(dst) != x) ins("movapd", xmm(x), xmm(reg(dst)));
+    } else {
+      ins("movsd", xmm(x), dst.isTemp() ? slot(dst) : var(dst));
+    }
+  }
+
+  /**
+   * Compare for a float relation `a rel b` with ucomisd, which leaves
+   * unordered operands looking "below" and "equal": `<` and `<=` test
+   * b > a and b >= a, so that NaN fails them. Returns the condition; `e`
+   * and `ne` also need the parity flag.
+   */
+  const char* compareFp(Opcode rel, const Operand& a, const Operand& b) {
+    bool swap = rel == Opcode::Lt || rel == Opcode::Le;
+    const Operand& x = swap ? b : a;
+    const Operand& y = swap ? a : b;
+    int rx = fpReg(x, X14);
+    ins("ucomisd", fpSrc(y), xmm(rx));
+    switch (rel) {
+      case Opcode::Lt:
+      case Opcode::Gt: return "a";
+      case Opcode::Le:
+      case Opcode::Ge: return "ae";
+      case Opcode::Eq: return "e";
+      default: return "ne";
+    }
+  }
+
+  /* Instructions */
+
+  void instr(const Instr& in);
+  void copy(const Instr& in);
+  void arith(const Instr& in);
+  void divide(const Instr& in);
+  void convert(const Instr& in);
+  void relation(const Instr& in);
+  void vector(const Instr& in);
+  void branch(const Instr& in);
+
+  void prologue(const ir::Cfg& cfg, const ir::Liveness& live);
+  void epilogue();
+  void mainFunction();
+};
+
+void Generator::copy(const Instr& in) {
+  const Operand& dst = in.dst;
+  const Operand& a = in.a;
+  if (dst.isFloat()) {
+    if (inReg(a) && !inReg(dst)) {
+      storeFp(dst, reg(a));
+      return;
+    }
+    int x = fpTarget(dst);
+    loadFp(a, x);
+    storeFp(dst, x);
+    return;
+  }
+  bool same = a.type == dst.type || dst.type == Type::Int;
+  if (!inReg(dst)) {
+    if (a.isConst()) {
+      storeConst(dst, a.ival);
+      return;
+    }
+    if (inReg(a) && same) {
+      store(dst, reg(a));
+      return;
+    }
+  }
+  int r = target(dst);
+  load(a, r);
+  if (!same) normalize(r, dst.type);
+  store(dst, r);
+}
+
+void Generator::arith(const Instr& in) {
+  const Operand& dst = in.dst;
+  Operand a = in.a, b = in.b;
+  bool commutes = in.op == Opcode::Add || in.op == Opcode::Mul;
+  if (dst.isFloat()) {
+    int x = fpTarget(dst);
+    if (inReg(b) && reg(b) == x && !(inReg(a) && reg(a) == x)) {
+      if (commutes)
+        std::swap(a, b);
+      else
+        x = X14;
+    }
+    loadFp(a, x);
+    const char* op = in.op == Opcode::Add   ? "addsd"
+                     : in.op == Opcode::Sub ? "subsd"
+                     : in.op == Opcode::Mul ? "mulsd"
+                                            : "divsd";
+    ins(op, fpSrc(b), xmm(x));
+    storeFp(dst, x);
+    return;
+  }
+  if (in.op == Opcode::Div) {
+    divide(in);
+    return;
+  }
+  int r = target(dst);
+  if (inReg(b) && reg(b) == r && !(inReg(a) && reg(a) == r)) {
+    if (commutes)
+      std::swap(a, b);
+    else
+      r = RAX;
+  }
+  load(a, r);
+  const char* op = in.op == Opcode::Add   ? "addl"
+                   : in.op == Opcode::Sub ? "subl"
+                                          : "imull";
+  ins(op, gpSrc(b, RDX), kGp[r].d);
+  if (dst.type != Type::Int) normalize(r, dst.type);
+  store(dst, r);
+}
+
+void Generator::divide(const Instr& in) {
+  // In 64 bits, like the interpreter: INT_MIN / -1 must not fault
+  if (in.b.isConst()) {
+    if (wrap(in.b.ival, in.b.type) == 0) {
+      ins("jmp", trap());
+      return;
+    }
+    ins("movq", imm(wrap(in.b.ival, in.b.type)), "%r11");
+  } else {
+    ins("movslq", gpSrc(in.b, R11), "%r11");
+    ins("testq", "%r11", "%r11");
+    ins("jz", trap());
+  }
+  load(in.a, RAX);
+  ins("cltq");
+  ins("cqto");
+  ins("idivq", "%r11");
+  if (in.dst.type != Type::Int) normalize(RAX, in.dst.type);
+  store(in.dst, RAX);
+}
+
+void Generator::convert(const Instr& in) {
+  const Operand& dst = in.dst;
+  const Operand& a = in.a;
+  if (dst.isFloat()) {
+    int x = fpTarget(dst);
+    if (a.isFloat())
+      loadFp(a, x);
+    else if (a.isConst())
+      ins("movsd", constant(static_cast<double>(a.ival)), xmm(x));
+    else
+      ins("cvtsi2sdl", gpSrc(a, RDX), xmm(x));
+    storeFp(dst, x);
+  } else if (a.isFloat()) {
+    ins("cvttsd2siq", fpSrc(a), "%rax");
+    if (dst.type != Type::Int) normalize(RAX, dst.type);
+    store(dst, RAX);
+  } else {
+    copy(in);
+  }
+}
+
+void Generator::relation(const Instr& in) {
+  int r = target(in.dst);
+  switch (in.op) {
+    case Opcode::Not:
+      test(in.a, RAX);
+      ins("sete", "%al");
+      break;
+    case Opcode::And:
+    case Opcode::Or:
+      test(in.a, RAX);
+      ins("setne", "%al");
+      test(in.b, RDX);
+      ins("setne", "%dl");
+      ins(in.op == Opcode::And ? "andb" : "orb", "%dl", "%al");
+      break;
+    default:
+      if (!in.a.isFloat()) {
+        compareInt(in.a, in.b);
+        ins((std::string("set") + intCond(in.op)).c_str(), "%al");
+      } else {
+        std::string cc = compareFp(in.op, in.a, in.b);
+        ins(("set" + cc).c_str(), "%al");
+        if (in.op == Opcode::Eq) {
+          ins("setnp", "%dl");
+          ins("andb", "%dl", "%al");
+        } else if (in.op == Opcode::Ne) {
+          ins("setp", "%dl");
+          ins("orb", "%dl", "%al");
+        }
+      }
+      break;
+  }
+  ins("movzbl", "%al", kGp[r].d);
+  store(in.dst, r);
+}
+
+void Generator::branch(const Instr& in) {
+  std::string to = label(in.label);
+  switch (in.op) {
+    case Opcode::Jump:
+      ins("jmp", to);
+      return;
+    case Opcode::JumpIf:
+    case Opcode::JumpIfNot:
+      if (in.a.isConst()) {
+        if ((in.a.ival != 0) == (in.op == Opcode::JumpIf)) ins("jmp", to);
+        return;
+      }
+      test(in.a, RAX);
+      ins(in.op == Opcode::JumpIf ? "jne" : "je", to);
+      return;
+    default:
+      break;
+  }
+  Opcode rel = ir::compareOf(in.op);
+  if (!in.a.isFloat()) {
+    compareInt(in.a, in.b);
+    ins((std::string("j") + intCond(rel)).c_str(), to);
+    return;
+  }
+  std::string cc = compareFp(rel, in.a, in.b);
+  if (rel == Opcode::Eq) {
+    ins("jp", "1f");
+    ins("je", to);
+    out += "1:\n";
+  } else if (rel == Opcode::Ne) {
+    ins("jp", to);
+    ins("jne", to);
+  } else {
+    ins(("j" + cc).c_str(), to);
+  }
+}
+
+void Generator::vector(const Instr& in) {
+  sptr<Type> t = scalarOf(in.op == Opcode::VStore ? in.b.type : in.dst.type);
+  bool fl = t == Type::Float;
+  // An int vector is 16 bytes, a float vector two halves of 16
+  int halves = fl ? 2 : 1;
+  const char* mov = fl ? "movupd" : "movdqu";
+  switch (in.op) {
+    case Opcode::VSplat:
+      if (fl) {
+        loadFp(in.a, X14);
+        ins("unpcklpd", "%xmm14", "%xmm14");
+      } else {
+        ins("movd", kGp[gpReg(in.a, RAX)].d, "%xmm14");
+        ins("pshufd", "$0", "%xmm14, %xmm14");
+      }
+      for (int h = 0; h < halves; ++h)
+        ins(mov, "%xmm14", slot(in.dst, 16 * h));
+      return;
+    case Opcode::VLoad: {
+      Address at = address(in.a, in.b);
+      for (int h = 0; h < halves; ++h) {
+        ins(mov, format(at, 16 * h), "%xmm14");
+        ins(mov, "%xmm14", slot(in.dst, 16 * h));
+      }
+      return;
+    }
+    case Opcode::VStore: {
+      Address at = address(in.dst, in.a);
+      for (int h = 0; h < halves; ++h) {
+        ins(mov, slot(in.b, 16 * h), "%xmm14");
+        ins(mov, "%xmm14", format(at, 16 * h));
+      }
+      return;
+    }
+    default:
+      break;
+  }
+
+  if (!fl && in.op == Opcode::VMul) {
+    // no packed 32-bit multiply in SSE2
+    for (int k = 0; k < ir::kLanes; ++k) {
+      ins("movl", slot(in.a, 4 * k), "%eax");
+      ins("imull", slot(in.b, 4 * k), "%eax");
+      ins("movl", "%eax", slot(in.dst, 4 * k));
+    }
+    return;
+  }
+  if (!fl && in.op == Opcode::VDiv) {
+    ins("jmp", trap());
+    return;
+  }
+  for (int h = 0; h < halves; ++h) {
+    if (in.op == Opcode::VNeg) {
+      if (fl) {
+        ins(mov, slot(in.a, 16 * h), "%xmm14");
+        ins("xorpd", sign(), "%xmm14");
+      } else {
+        ins("pxor", "%xmm14", "%xmm14");
+        ins(mov, slot(in.a, 16 * h), "%xmm15");
+        ins("psubd", "%xmm15", "%xmm14");
+      }
+    } else {
+      const char* op;
+      switch (in.op) {
+        case Opcode::VAdd: op = fl ? "addpd" : "paddd"; break;
+        case Opcode::VSub: op = fl ? "subpd" : "psubd"; break;
+        case Opcode::VMul: op = "mulpd"; break;
+        default: op = "divpd"; break;
+      }
+      ins(mov, slot(in.a, 16 * h), "%xmm14");
+      ins(mov, slot(in.b, 16 * h), "%xmm15");
+      ins(op, "%xmm15", "%xmm14");
+    }
+    ins(mov, "%xmm14", slot(in.dst, 16 * h));
+  }
+}
+
+void Generator::instr(const Instr& in) {
+  switch (in.op) {
+    case Opcode::Copy:
+      copy(in);
+      break;
+    case Opcode::Add:
+    case Opcode::Sub:
+    case Opcode::Mul:
+    case Opcode::Div:
+      arith(in);
+      break;
+    case Opcode::Neg:
+      if (in.dst.isFloat()) {
+        int x = fpTarget(in.dst);
+        loadFp(in.a, x);
+        ins("xorpd", sign(), xmm(x));
+        storeFp(in.dst, x);
+      } else {
+        int r = target(in.dst);
+        load(in.a, r);
+        ins("negl", kGp[r].d);
+        if (in.dst.type != Type::Int) normalize(r, in.dst.type);
+        store(in.dst, r);
+      }
+      break;
+    case Opcode::Not:
+    case Opcode::Lt:
+    case Opcode::Le:
+    case Opcode::Gt:
+    case Opcode::Ge:
+    case Opcode::Eq:
+    case Opcode::Ne:
+    case Opcode::And:
+    case Opcode::Or:
+      relation(in);
+      break;
+    case Opcode::Cvt:
+      convert(in);
+      break;
+    case Opcode::Load: {
+      Address at = address(in.a, in.b);
+      sptr<Type> t = scalarOf(in.dst.type);
+      if (t == Type::Float) {
+        int x = fpTarget(in.dst);
+        ins("movsd", format(at), xmm(x));
+        storeFp(in.dst, x);
+      } else {
+        int r = target(in.dst);
+        const char* op = t == Type::Int    ? "movl"
+                         : t == Type::Char ? "movsbl"
+                                           : "movzbl";
+        ins(op, format(at), kGp[r].d);
+        store(in.dst, r);
+      }
+      break;
+    }
+    case Opcode::Store: {
+      Address at = address(in.dst, in.a);
+      sptr<Type> t = scalarOf(in.b.type);
+      if (t == Type::Float) {
+        ins("movsd", xmm(fpReg(in.b, X14)), format(at));
+      } else if (in.b.isConst()) {
+        ins(t->width == 4 ? "movl" : "movb", imm(wrap(in.b.ival, t)),
+            format(at));
+      } else {
+        int r = gpReg(in.b, RDX);
+        ins(t->width == 4 ? "movl" : "movb", t->width == 4 ? kGp[r].d : kGp[r].b,
+            format(at));
+      }
+      break;
+    }
+    case Opcode::Check:
+      // unsigned: a negative index is above any dimension
+      compareInt(in.a, in.b);
+      ins("jae", trap());
+      break;
+    case Opcode::VSplat:
+    case Opcode::VLoad:
+    case Opcode::VStore:
+    case Opcode::VAdd:
+    case Opcode::VSub:
+    case Opcode::VMul:
+    case Opcode::VDiv:
+    case Opcode::VNeg:
+      vector(in);
+      break;
+    case Opcode::Label:
+      out += label(in.label) + ":\n";
+      break;
+    default:
+      branch(in);
+      break;
+  }
+}
+
+void Generator::prologue(const ir::Cfg& cfg, const ir::Liveness& live) {
+  out += "\t.text\n\t.globl\t" + opts.symbol + "\n\t.type\t" + opts.symbol +
+         ", @function\n" + opts.symbol + ":\n";
+  int pushes = 0;
+  for (int r = kFirstCalleeSaved; r < alloc.gpUsed; ++r, ++pushes)
+    ins("pushq", kGp[r].q);
+  // 16-byte aligned slots: the call pushed 8 bytes
+  if (alloc.stackBytes)
+    ins("subq", imm(alloc.stackBytes + (pushes % 2 ? 0 : 8)), "%rsp");
+
+  // Temporaries read before any write start out as zero, as in the
+  // interpreter
+  if (cfg.blocks.empty()) return;
+  for (int t : live.in[0]) {
+    switch (alloc.cls[t]) {
+      case RegClass::Gp:
+        if (alloc.reg[t] >= 0)
+          ins("xorl", kGp[alloc.reg[t]].d, kGp[alloc.reg[t]].d);
+        else
+          ins("movq", "$0", format({"%rsp", alloc.slot[t]}));
+        break;
+      case RegClass::Fp:
+        if (alloc.reg[t] >= 0)
+          ins("xorpd", xmm(alloc.reg[t]), xmm(alloc.reg[t]));
+        else
+          ins("movq", "$0", format({"%rsp", alloc.slot[t]}));
+        break;
+      case RegClass::Vector:
+        for (int k = 0; k < 4; ++k)
+          ins("movq", "$0", format({"%rsp", alloc.slot[t]}, 8 * k));
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+void Generator::epilogue() {
+  int pushes = alloc.gpUsed > kFirstCalleeSaved
+                   ? alloc.gpUsed - kFirstCalleeSaved
+                   : 0;
+  ins("xorl", "%eax", "%eax");
+  out += local("ret") + ":\n";
+  if (alloc.stackBytes)
+    ins("addq", imm(alloc.stackBytes + (pushes % 2 ? 0 : 8)), "%rsp");
+  for (int r = alloc.gpUsed; r-- > kFirstCalleeSaved;) ins("popq", kGp[r].q);
+  ins("ret");
+  out += trap() + ":\n";
+  ins("movl", "$1", "%eax");
+  ins("jmp", local("ret"));
+  out += "\t.size\t" + opts.symbol + ", .-" + opts.symbol + "\n";
+
+  if (consts.empty() && !signMask) return;
+  out += "\t.section\t.rodata\n";
+  if (signMask) {
+    out += "\t.balign\t16\n" + local("sign") +
+           ":\n\t.quad\t0x8000000000000000, 0x8000000000000000\n";
+  }
+  out += "\t.balign\t8\n";
+  std::map<int, uint64_t> byIndex;
+  for (const auto& [bits, n] : consts) byIndex[n] = bits;
+  for (const auto& [n, bits] : byIndex)
+    out += local("c" + std::to_string(n)) + ":\n\t.quad\t" +
+           std::to_string(bits) + "\n";
+}
+
+void Generator::mainFunction() {
+  int size = (fn.frame.size + 15) / 16 * 16;
+  if (size == 0) size = 16;
+  out += "\t.text\n\t.globl\tmain\n\t.type\tmain, @function\nmain:\n";
+  ins("pushq", "%rbp");
+  ins("movq", "%rsp", "%rbp");
+  ins("subq", imm(size), "%rsp");
+  ins("movq", "%rsp", "%rdi");
+  ins("movl", imm(size / 8), "%ecx");
+  ins("xorl", "%eax", "%eax");
+  ins("rep stosq");
+  ins("movq", "%rsp", "%rdi");
+  ins("call", opts.symbol);
+  ins("leave");
+  ins("ret");
+  out += "\t.size\tmain, .-main\n";
+}
+
+std::string Generator::run() {
+  ir::Cfg cfg(fn);
+  ir::Liveness live(fn, cfg);
+  bool regs = opts.allocateRegisters;
+  alloc = linearScan(fn, cfg, live, regs ? kGpRegs : 0, regs ? kFpRegs : 0);
+
+  for (size_t t = 1; t < alloc.cls.size(); ++t)
+    if (alloc.cls[t] != RegClass::None) ++stats.temps;
+  stats.inRegisters += alloc.inRegisters;
+  stats.spilled += alloc.spilled;
+  stats.stackBytes += alloc.stackBytes;
+  ++stats.functions;
+
+  out.reserve(fn.code.size() * 32);
+  bool lines = !opts.sourceFile.empty();
+  if (lines) out += "\t.file\t1 \"" + opts.sourceFile + "\"\n";
+  prologue(cfg, live);
+  SourceLocation at{0, 0};
+  for (const Instr& in : fn.code) {
+    if (lines && in.loc.line > 0 &&
+        (in.loc.line != at.line || in.loc.column != at.column)) {
+      at = in.loc;
+      out += "\t.loc\t1 " + std::to_string(at.line) + " " +
+             std::to_string(at.column) + "\n";
+    }
+    instr(in);
+  }
+  epilogue();
+  if (opts.main) mainFunction();
+  out += "\t.section\t.note.GNU-stack,\"\",@progbits\n";
+  return std::move(out);
+}
+
+}  // namespace
+
+std::string AsmEmitter::emit(const ir::Function& fn) {
+  return Generator(fn, options, stats).run();
+}
+
+}  // namespace codegen
@@ -0,0 +1,77 @@
+/**
+ * @file AsmEmitter.hpp
+ * @brief x86-64 assembly (GNU as, AT&T syntax) from three-address code.
+ */
+#pragma once
+#include <string>
+#include <utility>
+
+#include "IR.hpp"
+
+namespace codegen {
+
+/**
+ * @brief Options of AsmEmitter.
+ */
+struct AsmOptions {
+  /// Name of the generated function, see EntryPoint.
+  std::string symbol = "sc_main";
+
+  /// Also emit `main`, which runs the function on a zeroed frame on its
+  /// stack and exits with its result, so the output links into a program.
+  bool main = false;
+
+  /// Keep temporaries in registers; when false every temporary lives in a
+  /// stack slot, as a baseline for the allocator.
+  bool allocateRegisters = true;
+
+  /// When not empty, add line information for this source file name: a
+  /// `.file` directive and a `.loc` wherever ir::Instr::loc changes, which
+  /// GNU as turns into DWARF line tables and assemble() into Object::lines.
+  std::string sourceFile;
+};
+
+/**
+ * @brief Counters collected by AsmEmitter, accumulated over emit() calls.
+ */
+struct AsmStats {
+  int functions = 0;    ///< Functions emitted
+  int instrs = 0;       ///< Machine instructions emitted
+  int temps = 0;        ///< Temporaries of the IR
+  int inRegisters = 0;  ///< Temporaries kept in a register
+  int spilled = 0;      ///< Scalar temporaries kept in a stack slot
+  int stackBytes = 0;   ///< Stack slots of spilled and vector temporaries
+};
+
+/**
+ * @brief Generates x86-64 code for the System V ABI.
+ *
+ * The function generated for an ir::Function has the EntryPoint signature:
+ * it takes the variable frame in `%rdi` and addresses every variable at its
+ * Id::offset from there, keeps the layout of ir::Interpreter (int as 32
+ * bits, float as double, bool and char as one byte) and leaves the same
+ * bytes in it. Temporaries are assigned to registers by linearScan():
+ * int, char and bool values to ten general-purpose registers, floats to
+ * `%xmm0`-`%xmm13` with scalar SSE2 arithmetic; the rest live in stack
+ * slots, as do the temporaries of the vector opcodes, which use packed
+ * SSE2 two doubles or four ints at a time. `%rax`, `%rdx`, `%r11`,
+ * `%xmm14` and `%xmm15` are scratch.
+ *
+ * A failed `check` or an integer division by zero returns 1. Loads and
+ * stores are not checked otherwise: unlike the interpreter, the code relies
+ * on the `check` instructions of ir::LowerOptions::boundsChecks.
+ */
+class AsmEmitter {
+ public:
+  explicit AsmEmitter(AsmOptions options = {}) : options(std::move(options)) {}
+
+  /// Assembly text of @p fn, ready for `as` or `cc`.
+  std::string emit(const ir::Function& fn);
+
+  AsmStats stats;
+
+ private:
+  AsmOptions options;
+};
+
+}  // namespace codegen
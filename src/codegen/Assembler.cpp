@@ -0,0 +1,616 @@
+/**
+ * @file Assembler.cpp
+ * @brief In-process x86-64 assembler for the code AsmEmitter writes.
+ */
+#include "Assembler.hpp"
+
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+
+namespace codegen {
+namespace {
+
+/// Register file of an operand, and for general-purpose registers its
+/// width in bytes.
+enum class RegKind { Gp8, Gp32, Gp64, Xmm, Rip };
+
+struct Reg {
+  RegKind kind;
+  int num;  ///< Encoding, 0-15
+};
+
+const std::unordered_map<std::string, Reg>& registers() {
+  static const std::unordered_map<std::string, Reg> table = [] {
+    std::unordered_map<std::string, Reg> t;
+    const char* q[] = {"rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi"};
+    const char* d[] = {"eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi"};
+    const char* b[] = {"al", "cl", "dl", "bl", "spl", "bpl", "sil", "dil"};
+    for (int r = 0; r < 8; ++r) {
+      t[q[r]] = {RegKind::Gp64, r};
+      t[d[r]] = {RegKind::Gp32, r};
+      t[b[r]] = {RegKind::Gp8, r};
+    }
+    for (int r = 8; r < 16; ++r) {
+      std::string n = "r" + std::to_string(r);
+      t[n] = {RegKind::Gp64, r};
+      t[n + "d"] = {RegKind::Gp32, r};
+      t[n + "b"] = {RegKind::Gp8, r};
+    }
+    for (int r = 0; r < 16; ++r)
+      t["xmm" + std::to_string(r)] = {RegKind::Xmm, r};
+    t["rip"] = {RegKind::Rip, 0};
+    return t;
+  }();
+  return table;
+}
+
+/// Condition code suffixes of jcc and setcc.
+int conditionCode(const std::string& cc) {
+  static const std::unordered_map<std::string, int> table = {
+      {"o", 0},  {"no", 1}, {"b", 2},   {"ae", 3}, {"e", 4},  {"z", 4},
+      {"ne", 5}, {"nz", 5}, {"be", 6},  {"a", 7},  {"s", 8},  {"ns", 9},
+      {"p", 10}, {"np", 11}, {"l", 12}, {"ge", 13}, {"le", 14}, {"g", 15}};
+  auto it = table.find(cc);
+  return it == table.end() ? -1 : it->second;
+}
+
+struct Operand {
+  enum class Kind { Reg, Imm, Mem, Label } kind = Kind::Imm;
+  Reg reg{RegKind::Gp32, 0};  ///< Kind::Reg
+  int64_t imm = 0;            ///< Kind::Imm
+  int base = -1;              ///< Kind::Mem: base register or -1 for %rip
+  int index = -1;             ///< Kind::Mem: index register or -1
+  int32_t disp = 0;           ///< Kind::Mem
+  std::string label;          ///< Kind::Label, or a %rip displacement
+
+  bool isReg(RegKind k) const { return kind == Kind::Reg && reg.kind == k; }
+  bool isGp() const {
+    return kind == Kind::Reg && reg.kind != RegKind::Xmm &&
+           reg.kind != RegKind::Rip;
+  }
+};
+
+/// A forward or cross-section reference: 32 bits at @ref offset.
+struct Fixup {
+  int section;
+  size_t offset;
+  std::string label;
+  int64_t addend;
+  int line;
+  bool branch;
+};
+
+class Assembler {
+ public:
+  Object run(const std::string& text);
+
+ private:
+  Object obj;
+  int section = -1;
+  int line = 0;
+  std::vector<Fixup> fixups;
+  std::unordered_map<std::string, size_t> symbolIndex;
+  std::map<std::string, int> numeric;  ///< local label -> definitions so far
+  std::vector<std::string> globals, functions;
+
+  [[noreturn]] void fail(const std::string& what) const {
+    throw std::runtime_error("Assembler, line " + std::to_string(line) +
+                             ": " + what);
+  }
+
+  std::vector<uint8_t>& out() {
+    if (section < 0) select(".text");
+    return obj.sections[section].bytes;
+  }
+  void byte(int b) { out().push_back(static_cast<uint8_t>(b)); }
+  void bytes(uint64_t v, int n) {
+    for (int k = 0; k < n; ++k) byte(static_cast<int>(v >> (8 * k)) & 0xff);
+  }
+
+  void select(const std::string& name) {
+    for (size_t k = 0; k < obj.sections.size(); ++k)
+      if (obj.sections[k].name == name) {
+        section = static_cast<int>(k);
+        return;
+      }
+    obj.sections.push_back({name, {}, 1});
+    section = static_cast<int>(obj.sections.size() - 1);
+  }
+
+  void define(const std::string& name) {
+    std::string n = name;
+    if (std::isdigit(static_cast<unsigned char>(name[0])))
+      n = ".Ln" + name + "_" + std::to_string(numeric[name]++);
+    if (symbolIndex.count(n)) fail("Symbol " + n + " defined twice");
+    size_t offset = out().size();
+    symbolIndex[n] = obj.symbols.size();
+    obj.symbols.push_back({n, section, offset, 0, false, false});
+  }
+
+  /// Name a label reference resolves to; `1f` and `1b` become the next or
+  /// previous definition of `1`.
+  std::string reference(const std::string& name) {
+    char dir = name.back();
+    if (!std::isdigit(static_cast<unsigned char>(name[0])) ||
+        (dir != 'f' && dir != 'b'))
+      return name;
+    std::string n = name.substr(0, name.size() - 1);
+    int k = numeric[n] - (dir == 'b' ? 1 : 0);
+    if (k < 0) fail("No label " + n + " before " + name);
+    return ".Ln" + n + "_" + std::to_string(k);
+  }
+
+  /// Leave 32 bits for @p label at the current offset.
+  void fixup(const std::string& label, int64_t addend, bool branch = false) {
+    fixups.push_back(
+        {section, out().size(), reference(label), addend, line, branch});
+    bytes(0, 4);
+  }
+
+  /* Operands */
+
+  Reg regNamed(std::string_view s) {
+    if (s.empty() || s[0] != '%') fail("Expected a register: " + std::string(s));
+    auto it = registers().find(std::string(s.substr(1)));
+    if (it == registers().end()) fail("Unknown register " + std::string(s));
+    return it->second;
+  }
+
+  /// Decimal or 0x hexadecimal; unsigned values wrap to 64 bits.
+  int64_t number(std::string_view s) {
+    bool negative = !s.empty() && s[0] == '-';
+    std::string_view digits = s.substr(negative);
+    int base = digits.compare(0, 2, "0x") ? 10 : 16;
+    if (base == 16) digits.remove_prefix(2);
+    uint64_t v = 0;
+    auto [end, ec] =
+        std::from_chars(digits.data(), digits.data() + digits.size(), v, base);
+    if (digits.empty() || ec != std::errc() ||
+        end != digits.data() + digits.size() ||
+        (negative && v > uint64_t(1) << 63))
+      fail("Bad number " + std::string(s));
+    return negative ? static_cast<int64_t>(0 - v) : static_cast<int64_t>(v);
+  }
+
+  Operand operand(std::string_view s) {
+    Operand o;
+    if (s.empty()) fail("Empty operand");
+    if (s[0] == '$') {
+      o.kind = Operand::Kind::Imm;
+      o.imm = number(s.substr(1));
+    } else if (s[0] == '%') {
+      o.kind = Operand::Kind::Reg;
+      o.reg = regNamed(s);
+    } else if (size_t open = s.find('('); open != std::string_view::npos) {
+      o.kind = Operand::Kind::Mem;
+      if (s.back() != ')') fail("Bad memory operand " + std::string(s));
+      std::string_view disp = s.substr(0, open);
+      std::string_view inside = s.substr(open + 1, s.size() - open - 2);
+      std::string_view base = inside.substr(0, inside.find(','));
+      Reg b = regNamed(base);
+      if (b.kind == RegKind::Rip) {
+        o.base = -1;
+        o.label = disp;
+      } else {
+        if (b.kind != RegKind::Gp64)
+          fail("Base must be 64-bit: " + std::string(s));
+        o.base = b.num;
+        o.disp = disp.empty() ? 0 : static_cast<int32_t>(number(disp));
+      }
+      if (base.size() < inside.size()) {
+        std::string_view index = inside.substr(base.size() + 1);
+        if (index.find(',') != std::string_view::npos)
+          fail("Scaled index " + std::string(s));
+        Reg x = regNamed(index);
+        if (x.kind != RegKind::Gp64 || x.num == 4)
+          fail("Bad index " + std::string(s));
+        o.index = x.num;
+      }
+    } else {
+      o.kind = Operand::Kind::Label;
+      o.label = s;
+    }
+    return o;
+  }
+
+  /* Encoding */
+
+  /**
+   * One instruction: optional mandatory @p prefix, REX, @p opcode, ModRM
+   * with @p reg in its reg field and @p rm as register or memory operand,
+   * then @p immBytes of @p imm. @p byteReg says @p reg is a byte register:
+   * spl, bpl, sil and dil need a REX prefix, as they do in @p rm.
+   */
+  void encode(int prefix, bool w, std::initializer_list<int> opcode, int reg,
+              const Operand& rm, int immBytes = 0, int64_t imm = 0,
+              bool byteReg = false) {
+    if (prefix) byte(prefix);
+    int rex = (w ? 8 : 0) | (reg & 8 ? 4 : 0);
+    if (rm.kind == Operand::Kind::Mem) {
+      if (rm.index >= 8) rex |= 2;
+      if (rm.base >= 8) rex |= 1;
+    } else if (rm.kind == Operand::Kind::Reg) {
+      if (rm.reg.num >= 8) rex |= 1;
+    } else {
+      fail("Expected a register or memory operand");
+    }
+    bool lowByte =
+        (byteReg && reg >= 4 && reg < 8) ||
+        (rm.isReg(RegKind::Gp8) && rm.reg.num >= 4 && rm.reg.num < 8);
+    if (rex || lowByte) byte(0x40 | rex);
+    for (int b : opcode) byte(b);
+
+    if (rm.kind == Operand::Kind::Reg) {
+      byte(0xc0 | (reg & 7) << 3 | (rm.reg.num & 7));
+    } else if (rm.base < 0) {
+      byte((reg & 7) << 3 | 5);
+      fixup(rm.label, -4 - immBytes);
+    } else {
+      int mod = rm.disp == 0 && (rm.base & 7) != 5 ? 0
+                : rm.disp == static_cast<int8_t>(rm.disp) ? 1
+                                                          : 2;
+      bool sib = rm.index >= 0 || (rm.base & 7) == 4;
+      byte(mod << 6 | (reg & 7) << 3 | (sib ? 4 : rm.base & 7));
+      if (sib)
+        byte((rm.index >= 0 ? rm.index & 7 : 4) << 3 | (rm.base & 7));
+      if (mod == 1) bytes(static_cast<uint32_t>(rm.disp), 1);
+      if (mod == 2) bytes(static_cast<uint32_t>(rm.disp), 4);
+    }
+    bytes(static_cast<uint64_t>(imm), immBytes);
+  }
+
+  void need(const std::vector<Operand>& ops, size_t n,
+            const std::string& mnemonic) {
+    if (ops.size() != n)
+      fail(mnemonic + " takes " + std::to_string(n) + " operands");
+  }
+
+  bool alu(const std::string& mnemonic, const std::vector<Operand>& ops);
+  bool mov(const std::string& mnemonic, const std::vector<Operand>& ops);
+  bool sse(const std::string& mnemonic, const std::vector<Operand>& ops);
+  void instruction(const std::string& mnemonic,
+                   const std::vector<Operand>& ops);
+  void directive(const std::string& name, const std::vector<std::string>& args);
+  void finish();
+};
+
+/// Operation size of a general-purpose mnemonic from its suffix: 1, 4 or 8.
+int suffixSize(char c) { return c == 'b' ? 1 : c == 'l' ? 4 : c == 'q' ? 8 : 0; }
+
+bool Assembler::alu(const std::string& m, const std::vector<Operand>& ops) {
+  // /digit of the immediate form and opcode of the r/m, reg form
+  static const std::unordered_map<std::string, std::pair<int, int>> table = {
+      {"add", {0, 0x01}}, {"or", {1, 0x09}},  {"and", {4, 0x21}},
+      {"sub", {5, 0x29}}, {"xor", {6, 0x31}}, {"cmp", {7, 0x39}},
+      {"test", {-1, 0x85}}};
+  int size = suffixSize(m.back());
+  auto it = table.find(m.substr(0, m.size() - 1));
+  if (!size || it == table.end()) return false;
+  need(ops, 2, m);
+  auto [digit, op] = it->second;
+  const Operand& src = ops[0];
+  const Operand& dst = ops[1];
+  bool w = size == 8;
+  bool b = size == 1;
+  if (src.kind == Operand::Kind::Imm) {
+    if (digit < 0) fail("test with an immediate");
+    bool acc = dst.isGp() && dst.reg.num == 0;
+    bool small = src.imm == static_cast<int8_t>(src.imm);
+    if (acc && (b || !small)) {
+      // short forms with %al, %eax or %rax
+      if (w) byte(0x48);
+      byte(digit << 3 | (b ? 4 : 5));
+      bytes(static_cast<uint64_t>(src.imm), b ? 1 : 4);
+    } else if (b) {
+      encode(0, false, {0x80}, digit, dst, 1, src.imm);
+    } else if (small) {
+      encode(0, w, {0x83}, digit, dst, 1, src.imm);
+    } else {
+      encode(0, w, {0x81}, digit, dst, 4, src.imm);
+    }
+  } else if (src.isGp()) {
+    encode(0, w, {op - b}, src.reg.num, dst, 0, 0, b);
+  } else if (dst.isGp() && digit >= 0) {
+    encode(0, w, {op + 2 - b}, dst.reg.num, src, 0, 0, b);
+  } else {
+    fail("Bad operands of " + m);
+  }
+  return true;
+}
+
+bool Assembler::mov(const std::string& m, const std::vector<Operand>& ops) {
+  if (m == "movb" || m == "movl" || m == "movq") {
+    need(ops, 2, m);
+    const Operand& src = ops[0];
+    const Operand& dst = ops[1];
+    bool w = m == "movq";
+    bool b = m == "movb";
+    if (src.kind == Operand::Kind::Imm) {
+      if (m == "movl" && dst.isGp()) {
+        // mov $imm32, %r32 has a short form
+        if (dst.reg.num >= 8) byte(0x41);
+        byte(0xb8 + (dst.reg.num & 7));
+        bytes(static_cast<uint64_t>(src.imm), 4);
+      } else {
+        encode(0, w, {b ? 0xc6 : 0xc7}, 0, dst, b ? 1 : 4, src.imm);
+      }
+    } else if (src.isGp()) {
+      encode(0, w, {b ? 0x88 : 0x89}, src.reg.num, dst, 0, 0, b);
+    } else if (dst.isGp()) {
+      encode(0, w, {b ? 0x8a : 0x8b}, dst.reg.num, src, 0, 0, b);
+    } else {
+      fail("Bad operands of " + m);
+    }
+    return true;
+  }
+  if (m == "movsbl" || m == "movzbl" || m == "movslq") {
+    need(ops, 2, m);
+    if (!ops[1].isGp()) fail(m + " needs a register destination");
+    if (m == "movslq")
+      encode(0, true, {0x63}, ops[1].reg.num, ops[0]);
+    else
+      encode(0, false, {0x0f, m == "movsbl" ? 0xbe : 0xb6}, ops[1].reg.num,
+             ops[0]);
+    return true;
+  }
+  return false;
+}
+
+bool Assembler::sse(const std::string& m, const std::vector<Operand>& ops) {
+  struct Form {
+    int prefix;
+    int load;   ///< Opcode with the register destination in ModRM.reg
+    int store;  ///< Opcode with a memory destination, or 0
+  };
+  static const std::unordered_map<std::string, Form> table = {
+      {"movsd", {0xf2, 0x10, 0x11}},  {"movapd", {0x66, 0x28, 0x29}},
+      {"movupd", {0x66, 0x10, 0x11}}, {"movdqu", {0xf3, 0x6f, 0x7f}},
+      {"addsd", {0xf2, 0x58, 0}},     {"subsd", {0xf2, 0x5c, 0}},
+      {"mulsd", {0xf2, 0x59, 0}},     {"divsd", {0xf2, 0x5e, 0}},
+      {"ucomisd", {0x66, 0x2e, 0}},   {"xorpd", {0x66, 0x57, 0}},
+      {"unpcklpd", {0x66, 0x14, 0}},  {"addpd", {0x66, 0x58, 0}},
+      {"subpd", {0x66, 0x5c, 0}},     {"mulpd", {0x66, 0x59, 0}},
+      {"divpd", {0x66, 0x5e, 0}},     {"pxor", {0x66, 0xef, 0}},
+      {"paddd", {0x66, 0xfe, 0}},     {"psubd", {0x66, 0xfa, 0}},
+      {"cvtsi2sdl", {0xf2, 0x2a, 0}}, {"cvttsd2siq", {0xf2, 0x2c, 0}},
+      {"movd", {0x66, 0x6e, 0}},      {"pshufd", {0x66, 0x70, 0}}};
+  auto it = table.find(m);
+  if (it == table.end()) return false;
+  const Form& f = it->second;
+  if (m == "pshufd") {
+    need(ops, 3, m);
+    if (ops[0].kind != Operand::Kind::Imm || !ops[2].isReg(RegKind::Xmm))
+      fail("Bad operands of pshufd");
+    encode(f.prefix, false, {0x0f, f.load}, ops[2].reg.num, ops[1], 1,
+           ops[0].imm);
+    return true;
+  }
+  need(ops, 2, m);
+  const Operand& src = ops[0];
+  const Operand& dst = ops[1];
+  if (dst.kind == Operand::Kind::Reg) {
+    bool w = m == "cvttsd2siq";
+    encode(f.prefix, w, {0x0f, f.load}, dst.reg.num, src);
+  } else if (f.store && src.isReg(RegKind::Xmm)) {
+    encode(f.prefix, false, {0x0f, f.store}, src.reg.num, dst);
+  } else {
+    fail("Bad operands of " + m);
+  }
+  return true;
+}
+
+void Assembler::instruction(const std::string& m,
+                            const std::vector<Operand>& ops) {
+  if (alu(m, ops) || mov(m, ops) || sse(m, ops)) return;
+
+  auto simple = [&](std::initializer_list<int> code) {
+    need(ops, 0, m);
+    for (int b : code) byte(b);
+  };
+  auto unary = [&](bool w, std::initializer_list<int> op, int digit) {
+    need(ops, 1, m);
+    encode(0, w, op, digit, ops[0]);
+  };
+  auto branch = [&](std::initializer_list<int> op) {
+    need(ops, 1, m);
+    if (ops[0].kind != Operand::Kind::Label) fail(m + " needs a label");
+    for (int b : op) byte(b);
+    fixup(ops[0].label, -4, true);
+  };
+
+  if (m == "ret") return simple({0xc3});
+  if (m == "leave") return simple({0xc9});
+  if (m == "cltq") return simple({0x48, 0x98});
+  if (m == "cqto") return simple({0x48, 0x99});
+  if (m == "rep stosq") return simple({0xf3, 0x48, 0xab});
+  if (m == "negl") return unary(false, {0xf7}, 3);
+  if (m == "idivq") return unary(true, {0xf7}, 7);
+  if (m == "pushq" || m == "popq") {
+    need(ops, 1, m);
+    if (!ops[0].isReg(RegKind::Gp64)) fail(m + " needs a 64-bit register");
+    if (ops[0].reg.num >= 8) byte(0x41);
+    byte((m == "pushq" ? 0x50 : 0x58) + (ops[0].reg.num & 7));
+    return;
+  }
+  if (m == "imull") {
+    need(ops, 2, m);
+    const Operand& dst = ops[1];
+    if (!dst.isGp()) fail("imull needs a register destination");
+    if (ops[0].kind != Operand::Kind::Imm)
+      encode(0, false, {0x0f, 0xaf}, dst.reg.num, ops[0]);
+    else if (ops[0].imm == static_cast<int8_t>(ops[0].imm))
+      encode(0, false, {0x6b}, dst.reg.num, dst, 1, ops[0].imm);
+    else
+      encode(0, false, {0x69}, dst.reg.num, dst, 4, ops[0].imm);
+    return;
+  }
+  if (m == "jmp") return branch({0xe9});
+  if (m == "call") return branch({0xe8});
+  if (m[0] == 'j') {
+    int cc = conditionCode(m.substr(1));
+    if (cc >= 0) return branch({0x0f, 0x80 + cc});
+  }
+  if (m.compare(0, 3, "set") == 0) {
+    int cc = conditionCode(m.substr(3));
+    if (cc >= 0) {
+      need(ops, 1, m);
+      return encode(0, false, {0x0f, 0x90 + cc}, 0, ops[0]);
+    }
+  }
+  fail("Unsupported instruction " + m);
+}
+
+void Assembler::directive(const std::string& name,
+                          const std::vector<std::string>& args) {
+  if (name == ".text") {
+    select(".text");
+  } else if (name == ".section") {
+    if (args.empty()) fail(".section without a name");
+    select(args[0]);
+  } else if (name == ".globl") {
+    globals.insert(globals.end(), args.begin(), args.end());
+  } else if (name == ".type") {
+    if (args.size() != 2 || args[1] != "@function")
+      fail(".type other than @function");
+    functions.push_back(args[0]);
+  } else if (name == ".size") {
+    auto it = symbolIndex.find(args.size() == 2 ? args[0] : "");
+    if (it == symbolIndex.end() || args[1] != ".-" + args[0])
+      fail(".size other than .-name of a defined symbol");
+    Symbol& s = obj.symbols[it->second];
+    s.size = out().size() - s.offset;
+  } else if (name == ".balign") {
+    if (args.size() != 1) fail(".balign takes one argument");
+    int align = static_cast<int>(number(args[0]));
+    if (align <= 0 || (align & (align - 1))) fail("Bad alignment");
+    Section& sec = (out(), obj.sections[section]);
+    if (align > sec.align) sec.align = align;
+    int pad = sec.name == ".text" ? 0x90 : 0;
+    while (sec.bytes.size() % align) sec.bytes.push_back(pad);
+  } else if (name == ".file" || name == ".loc") {
+    std::istringstream in(args.size() == 1 ? args[0] : "");
+    int file = 0;
+    if (!(in >> file) || file != 1) fail(name + " other than for file 1");
+    if (name == ".file") {
+      in >> std::quoted(obj.sourceFile);
+    } else {
+      LineEntry e;
+      if (!(in >> e.line >> e.column)) fail(".loc without line and column");
+      e.offset = out().size();  // selects .text if nothing is yet
+      e.section = section;
+      obj.lines.push_back(e);
+    }
+  } else if (name == ".quad") {
+    for (const std::string& a : args) bytes(static_cast<uint64_t>(number(a)), 8);
+  } else {
+    fail("Unsupported directive " + name);
+  }
+}
+
+void Assembler::finish() {
+  for (const std::string& g : globals) {
+    auto it = symbolIndex.find(g);
+    if (it != symbolIndex.end()) obj.symbols[it->second].global = true;
+  }
+  for (const std::string& f : functions) {
+    auto it = symbolIndex.find(f);
+    if (it != symbolIndex.end()) obj.symbols[it->second].function = true;
+  }
+  for (const Fixup& f : fixups) {
+    auto it = symbolIndex.find(f.label);
+    if (it != symbolIndex.end() && obj.symbols[it->second].section == f.section) {
+      int64_t v = static_cast<int64_t>(obj.symbols[it->second].offset) +
+                  f.addend - static_cast<int64_t>(f.offset);
+      uint8_t* p = &obj.sections[f.section].bytes[f.offset];
+      for (int k = 0; k < 4; ++k) p[k] = static_cast<uint8_t>(v >> (8 * k));
+      continue;
+    }
+    line = f.line;
+    if (f.label.compare(0, 2, ".L") == 0 && it == symbolIndex.end())
+      fail("Undefined local label " + f.label);
+    obj.relocations.push_back(
+        {f.section, f.offset, f.label, f.addend, f.branch});
+  }
+}
+
+/// Blanks (and a carriage return) at both ends of @p s removed.
+std::string_view trim(std::string_view s) {
+  size_t b = s.find_first_not_of(" \t\r");
+  if (b == std::string_view::npos) return {};
+  return s.substr(b, s.find_last_not_of(" \t\r") - b + 1);
+}
+
+/// Split at commas outside parentheses into @p out, trimming blanks.
+void splitOperands(std::string_view s, std::vector<std::string_view>& out) {
+  out.clear();
+  int depth = 0;
+  size_t from = 0;
+  for (size_t k = 0; k <= s.size(); ++k) {
+    char c = k < s.size() ? s[k] : ',';
+    if (c == '(') ++depth;
+    if (c == ')') --depth;
+    if (c == ',' && depth <= 0) {
+      std::string_view a = trim(s.substr(from, k - from));
+      if (!a.empty()) out.push_back(a);
+      from = k + 1;
+    }
+  }
+}
+
+Object Assembler::run(const std::string& text) {
+  std::vector<std::string_view> args;
+  std::vector<Operand> ops;
+  std::string_view all(text);
+  size_t pos = 0;
+  while (pos < all.size()) {
+    size_t end = all.find('\n', pos);
+    if (end == std::string_view::npos) end = all.size();
+    std::string_view l = trim(all.substr(pos, end - pos));
+    pos = end + 1;
+    ++line;
+
+    if (l.empty() || l[0] == '#') continue;
+    if (l.back() == ':' && l.find_first_of(" \t") == std::string_view::npos) {
+      define(std::string(l.substr(0, l.size() - 1)));
+      continue;
+    }
+    size_t split = l.find_first_of(" \t");
+    std::string head(l.substr(0, split));
+    std::string_view rest =
+        split == std::string_view::npos ? "" : l.substr(split + 1);
+    if (head == "rep") {
+      head += " ";
+      head += trim(rest);
+      rest = {};
+    }
+    splitOperands(rest, args);
+    if (head[0] == '.') {
+      directive(head, std::vector<std::string>(args.begin(), args.end()));
+      continue;
+    }
+    ops.clear();
+    for (std::string_view a : args) ops.push_back(operand(a));
+    instruction(head, ops);
+  }
+  finish();
+  return std::move(obj);
+}
+
+}  // namespace
+
+const Symbol* Object::find(const std::string& name) const {
+  for (const Symbol& s : symbols)
+    if (s.name == name) return &s;
+  return nullptr;
+}
+
+Object assemble(const std::string& text) { return Assembler().run(text); }
+
+}  // namespace codegen
@@ -0,0 +1,81 @@
+/**
+ * @file Assembler.hpp
+ * @brief In-process x86-64 assembler for the code AsmEmitter writes.
+ */
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace codegen {
+
+/// Bytes of one section of an Object.
+struct Section {
+  std::string name;  ///< ".text" or ".rodata"
+  std::vector<uint8_t> bytes;
+  int align = 1;  ///< Largest .balign seen in it
+};
+
+/// Label defined in an Object.
+struct Symbol {
+  std::string name;
+  int section = 0;        ///< Index into Object::sections
+  uint64_t offset = 0;    ///< Byte offset in the section
+  uint64_t size = 0;      ///< From `.size`, for functions
+  bool global = false;    ///< Named by `.globl`
+  bool function = false;  ///< Named by `.type ..., @function`
+};
+
+/**
+ * @brief A 32-bit PC-relative reference left for the linker or loader: the
+ * four bytes at @ref offset in @ref section become S + @ref addend - P,
+ * for S the address of @ref symbol and P that of the four bytes.
+ */
+struct Relocation {
+  int section = 0;
+  uint64_t offset = 0;
+  std::string symbol;
+  int64_t addend = 0;
+  bool branch = false;  ///< Of a call or jump, which may go through a PLT
+};
+
+/// Source position of the code from @ref offset on, from a `.loc`.
+struct LineEntry {
+  int section = 0;
+  uint64_t offset = 0;
+  int line = 0;
+  int column = 0;
+};
+
+/**
+ * @brief Machine code and data with their symbols.
+ *
+ * References to a label of the same section are resolved by assemble();
+ * those to another section, or to a symbol not defined at all, are left
+ * as relocations.
+ */
+struct Object {
+  std::vector<Section> sections;
+  std::vector<Symbol> symbols;
+  std::vector<Relocation> relocations;
+  std::string sourceFile;        ///< Named by `.file`, if any
+  std::vector<LineEntry> lines;  ///< In the order of the `.loc`s
+
+  /// Symbol named @p name, or null.
+  const Symbol* find(const std::string& name) const;
+};
+
+/**
+ * @brief Assemble x86-64 GNU as (AT&T syntax) text into an Object.
+ *
+ * Accepts what AsmEmitter writes: its instructions and operand forms,
+ * `.L` and numeric local labels (`1:` with `1f` and `1b`), and the
+ * directives `.text`, `.section`, `.globl`, `.type`, `.size` (only as
+ * `.-name`), `.balign`, `.quad`, and `.file` and `.loc` for file 1. Instructions are encoded as GNU as does,
+ * except that jumps and calls always take a 32-bit displacement.
+ *
+ * @throws std::runtime_error on anything else, naming the line.
+ */
+Object assemble(const std::string& text);
+
+}  // namespace codegen
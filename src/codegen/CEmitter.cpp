@@ -0,0 +1,395 @@
+/**
+ * @file CEmitter.cpp
+ * @brief Portable C (a complete translation unit) from the AST.
+ */
+#include "CEmitter.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "Array.hpp"
+#include "Expr.hpp"
+#include "Tag.hpp"
+#include "Token.hpp"
+#include "Word.hpp"
+
+namespace codegen {
+namespace {
+
+using lexer::Tag;
+using symbols::Type;
+
+/// A scalar C expression without side effects and its language type.
+struct Value {
+  std::string text;
+  sptr<Type> type;
+};
+
+/// C type of a scalar; bool is a byte holding 0 or 1.
+const char* cType(const sptr<Type>& t) {
+  if (t == Type::Float) return "double";
+  if (t == Type::Int) return "int32_t";
+  if (t == Type::Char) return "int8_t";
+  if (t == Type::Bool) return "uint8_t";
+  throw std::runtime_error("No C type for " + t->name);
+}
+
+/// Innermost element type of a (possibly nested) array type.
+sptr<Type> scalarOf(sptr<Type> t) {
+  while (auto arr = std::dynamic_pointer_cast<symbols::Array>(t)) t = arr->of;
+  return t;
+}
+
+/// Declaration of @p name with type @p t, dimensions outermost first.
+std::string declaration(const sptr<Type>& t, const std::string& name) {
+  std::string dims;
+  sptr<Type> cur = t;
+  while (auto arr = std::dynamic_pointer_cast<symbols::Array>(cur)) {
+    dims += "[" + std::to_string(arr->size) + "]";
+    cur = arr->of;
+  }
+  return std::string(cType(scalarOf(t))) + " " + name + dims;
+}
+
+/// printf conversion of a scalar type.
+const char* format(const sptr<Type>& t) {
+  return t == Type::Float ? "%.17g" : "%d";
+}
+
+class Writer {
+ public:
+  Writer(const COptions& o, const symbols::Frame& f) : opts(o), frame(f) {}
+
+  std::string unit(const sptr<ast::Stmt>& root) {
+    std::string decls, copyIn, copyOut;
+    for (size_t k = 0; k < frame.vars.size(); ++k) {
+      const symbols::Id& id = *frame.vars[k];
+      std::string name = id.name + "_" + std::to_string(k);
+      names[&id] = name;
+      bool array = std::dynamic_pointer_cast<symbols::Array>(id.type) != nullptr;
+      std::string ref = array ? name : "&" + name;
+      std::string at = "frame + " + std::to_string(id.offset);
+      std::string bytes = std::to_string(id.type->width);
+      decls += "  " + declaration(id.type, name) + ";\n";
+      copyIn += "  memcpy(" + ref + ", " + at + ", " + bytes + ");\n";
+      copyOut += "  memcpy(" + at + ", " + ref + ", " + bytes + ");\n";
+    }
+
+    indent = "  ";
+    stmt(root);
+
+    std::string out = "/* generated from " +
+                      std::to_string(frame.vars.size()) + " variables, " +
+                      std::to_string(frame.size) + " frame bytes */\n";
+    out += "#include <stdint.h>\n";
+    if (opts.main) out += "#include <stdio.h>\n";
+    out += "#include <string.h>\n\n";
+    out += "int " + opts.symbol + "(uint8_t* frame) {\n";
+    out += decls + temps + "  int status = 0;\n" + copyIn + body;
+    if (trapped) out += "  goto done;\ntrap:\n  status = 1;\ndone:\n";
+    out += copyOut + "  return status;\n}\n";
+    if (opts.main) out += mainFunction();
+    return out;
+  }
+
+ private:
+  const COptions& opts;
+  const symbols::Frame& frame;
+  std::string body;
+  std::string temps;  ///< Declarations of the ast::Temp nodes
+  std::string indent;
+  int values = 0;
+  bool trapped = false;  ///< Whether `trap` has a `goto`
+  std::unordered_map<const symbols::Id*, std::string> names;
+  std::unordered_map<int, std::string> tempNames;
+
+  void line(const std::string& text) { body += indent + text + "\n"; }
+
+  /// Local initialized with @p text, of the C type of @p t.
+  Value value(const sptr<Type>& t, const std::string& text) {
+    std::string v = "v" + std::to_string(values++);
+    line(std::string(cType(t)) + " " + v + " = " + text + ";");
+    return {v, t};
+  }
+
+  void trapIf(const std::string& c) {
+    line("if (" + c + ") goto trap;");
+    trapped = true;
+  }
+
+  const std::string& name(const symbols::Id* id) {
+    auto it = names.find(id);
+    if (it == names.end())
+      throw std::runtime_error("Variable " + id->name + " is not in the frame");
+    return it->second;
+  }
+
+  /// Statements of @p s one level deeper.
+  void nested(const sptr<ast::Stmt>& s) {
+    std::string outer = indent;
+    indent += "  ";
+    stmt(s);
+    indent = outer;
+  }
+
+  void stmt(const sptr<ast::Stmt>& s) {
+    if (!s) return;
+
+    if (auto seq = std::dynamic_pointer_cast<ast::Seq>(s)) {
+      // walk the `second` spine iteratively
+      sptr<ast::Stmt> cur = s;
+      for (; seq; seq = std::dynamic_pointer_cast<ast::Seq>(cur)) {
+        stmt(seq->first);
+        cur = seq->second;
+      }
+      stmt(cur);
+    } else if (auto node = std::dynamic_pointer_cast<ast::Set>(s)) {
+      auto target = std::dynamic_pointer_cast<ast::IdExpr>(node->id);
+      if (!target) throw std::runtime_error("Set target is not a variable");
+      Value v = convert(expr(*node->expr), target->sym->type);
+      line(name(target->sym.get()) + " = " + v.text + ";");
+    } else if (auto node = std::dynamic_pointer_cast<ast::SetElem>(s)) {
+      auto acc = std::dynamic_pointer_cast<ast::Access>(node->arrayAccess);
+      if (!acc) throw std::runtime_error("SetElem target is not an access");
+      std::string elem = element(*acc);
+      line(elem + " = " + convert(expr(*node->expr), acc->exprType).text +
+           ";");
+    } else if (auto node = std::dynamic_pointer_cast<ast::If>(s)) {
+      line("if (" + cond(*node->condition) + ") {");
+      nested(node->thenStmt);
+      line("}");
+    } else if (auto node = std::dynamic_pointer_cast<ast::Else>(s)) {
+      line("if (" + cond(*node->condition) + ") {");
+      nested(node->thenStmt);
+      line("} else {");
+      nested(node->elseStmt);
+      line("}");
+    } else if (auto node = std::dynamic_pointer_cast<ast::While>(s)) {
+      // a condition that needs statements is tested inside `for (;;)`
+      size_t mark = body.size();
+      std::string outer = indent;
+      indent += "  ";
+      std::string c = cond(*node->condition);
+      indent = outer;
+      if (body.size() == mark) {
+        line("while (" + c + ") {");
+      } else {
+        body.insert(mark, indent + "for (;;) {\n");
+        line("  if (!(" + c + ")) break;");
+      }
+      nested(node->body);
+      line("}");
+    } else if (auto node = std::dynamic_pointer_cast<ast::Do>(s)) {
+      line("for (;;) {");
+      nested(node->body);
+      std::string outer = indent;
+      indent += "  ";
+      line("if (!(" + cond(*node->condition) + ")) break;");
+      indent = outer;
+      line("}");
+    } else if (std::dynamic_pointer_cast<ast::Break>(s)) {
+      line("break;");
+    } else {
+      throw std::runtime_error("Unsupported statement in C emission");
+    }
+  }
+
+  std::string cond(const ast::Expr& e) {
+    Value c = expr(e);
+    if (c.type != Type::Bool)
+      throw std::runtime_error("Condition is not a bool");
+    return c.text;
+  }
+
+  Value expr(const ast::Expr& e) {
+    if (auto id = dynamic_cast<const ast::IdExpr*>(&e)) {
+      if (std::dynamic_pointer_cast<symbols::Array>(id->sym->type))
+        throw std::runtime_error("Array " + id->sym->name + " used as value");
+      return {name(id->sym.get()), id->sym->type};
+    }
+
+    if (auto c = dynamic_cast<const ast::Constant*>(&e)) {
+      switch (c->value->tag) {
+        case Tag::NUM: {
+          int32_t v = static_cast<int32_t>(std::stoll(c->value->lexeme));
+          if (v == INT32_MIN) return {"(-2147483647 - 1)", Type::Int};
+          return {v < 0 ? "(" + std::to_string(v) + ")" : std::to_string(v),
+                  Type::Int};
+        }
+        case Tag::REAL: {
+          // hexadecimal, so the value is exact
+          char buf[32];
+          std::snprintf(buf, sizeof buf, "%a", std::stod(c->value->lexeme));
+          return {buf, Type::Float};
+        }
+        case Tag::TRUE_:
+          return {"1", Type::Bool};
+        case Tag::FALSE_:
+          return {"0", Type::Bool};
+        default:
+          throw std::runtime_error("Unsupported constant " +
+                                   c->value->lexeme);
+      }
+    }
+
+    if (auto t = dynamic_cast<const ast::Temp*>(&e)) {
+      auto it = tempNames.find(t->number);
+      if (it == tempNames.end()) {
+        std::string n = "t" + std::to_string(t->number);
+        temps += "  " + declaration(t->exprType, n) + " = 0;\n";
+        it = tempNames.emplace(t->number, n).first;
+      }
+      return {it->second, t->exprType};
+    }
+
+    if (auto acc = dynamic_cast<const ast::Access*>(&e))
+      return value(acc->exprType, element(*acc));
+
+    if (auto un = dynamic_cast<const ast::Unary*>(&e)) {
+      Value a = expr(*un->expr);
+      if (un->op_tok->tag == Tag::UnaryNOT)
+        return value(Type::Bool, "!" + a.text);
+      if (a.type == Type::Float) return value(a.type, "-" + a.text);
+      return value(a.type, std::string("(") + cType(a.type) +
+                               ")(0u - (uint32_t)" + a.text + ")");
+    }
+
+    if (auto op = dynamic_cast<const ast::Logical*>(&e)) {
+      // the right operand only runs when the left one does not decide
+      bool isAnd = dynamic_cast<const ast::And*>(&e) != nullptr;
+      Value v = value(Type::Bool, cond(*op->lhs));
+      line(std::string("if (") + (isAnd ? "" : "!") + v.text + ") {");
+      std::string outer = indent;
+      indent += "  ";
+      line(v.text + " = " + cond(*op->rhs) + ";");
+      indent = outer;
+      line("}");
+      return v;
+    }
+
+    if (auto op = dynamic_cast<const ast::Op*>(&e)) {
+      Value a = expr(*op->lhs);
+      Value b = expr(*op->rhs);
+      if (a.type != b.type && a.type->isNumeric() && b.type->isNumeric()) {
+        sptr<Type> t = Type::max(a.type, b.type);
+        a = convert(a, t);
+        b = convert(b, t);
+      }
+      if (dynamic_cast<const ast::Arith*>(&e))
+        return arith(op->op_tok->tag, a, b);
+      return value(Type::Bool, compare(op->op_tok->tag, a, b));
+    }
+
+    throw std::runtime_error("Unsupported expression in C emission");
+  }
+
+  Value arith(Tag tag, const Value& a, const Value& b) {
+    const char* op;
+    switch (tag) {
+      case Tag::OP_PLUS: op = " + "; break;
+      case Tag::OP_MINUS: op = " - "; break;
+      case Tag::OP_MUL: op = " * "; break;
+      case Tag::OP_DIV: op = " / "; break;
+      default:
+        throw std::runtime_error("Unsupported operator in C emission");
+    }
+    if (a.type == Type::Float) return value(a.type, a.text + op + b.text);
+    std::string t = cType(a.type);
+    if (tag == Tag::OP_DIV) {
+      // 64 bits, so INT_MIN / -1 wraps instead of being undefined
+      trapIf(b.text + " == 0");
+      return value(a.type, "(" + t + ")((int64_t)" + a.text + op +
+                               "(int64_t)" + b.text + ")");
+    }
+    // unsigned, so overflow wraps instead of being undefined
+    return value(a.type, "(" + t + ")((uint32_t)" + a.text + op +
+                             "(uint32_t)" + b.text + ")");
+  }
+
+  std::string compare(Tag tag, const Value& a, const Value& b) {
+    const char* op;
+    switch (tag) {
+      case Tag::LESS: op = " < "; break;
+      case Tag::LE: op = " <= "; break;
+      case Tag::GREATER: op = " > "; break;
+      case Tag::GE: op = " >= "; break;
+      case Tag::EQ: op = " == "; break;
+      case Tag::NE: op = " != "; break;
+      default:
+        throw std::runtime_error("Unsupported operator in C emission");
+    }
+    return a.text + op + b.text;
+  }
+
+  /// Convert @p v to @p to as ir::Opcode::Cvt does.
+  Value convert(const Value& v, const sptr<Type>& to) {
+    if (v.type == to) return v;
+    if (to == Type::Bool) return value(to, v.text + " != 0");
+    if (v.type == Type::Float) {
+      // through 64 bits, then wrap like the interpreter
+      return value(to, std::string("(") + cType(to) + ")(int64_t)" + v.text);
+    }
+    return value(to, std::string("(") + cType(to) + ")" + v.text);
+  }
+
+  /// Element lvalue of an access chain `a[i][j]...`.
+  std::string element(const ast::Access& acc) {
+    std::vector<const ast::Access*> chain;
+    const ast::Expr* cur = &acc;
+    while (auto a = dynamic_cast<const ast::Access*>(cur)) {
+      chain.push_back(a);
+      cur = a->array.get();
+    }
+    auto id = dynamic_cast<const ast::IdExpr*>(cur);
+    if (!id) throw std::runtime_error("Indexed expression is not an array");
+
+    std::string out = name(id->sym.get());
+    for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+      Value idx = convert(expr(*(*it)->index), Type::Int);
+      if (opts.boundsChecks) {
+        auto arr =
+            std::dynamic_pointer_cast<symbols::Array>((*it)->array->exprType);
+        if (!arr)
+          throw std::runtime_error("Indexed expression is not an array");
+        // unsigned, so negative indices fail too
+        trapIf("(uint32_t)" + idx.text + " >= " + std::to_string(arr->size) +
+               "u");
+      }
+      out += "[" + idx.text + "]";
+    }
+    return out;
+  }
+
+  std::string mainFunction() const {
+    std::string out = "\nint main(void) {\n";
+    out += "  static uint8_t frame[" + std::to_string(frame.size + 1) + "];\n";
+    out += "  int status = " + opts.symbol + "(frame);\n";
+    for (size_t k = 0; k < frame.globals; ++k) {
+      const symbols::Id& id = *frame.vars[k];
+      sptr<Type> t = scalarOf(id.type);
+      int count = id.type->width / t->width;
+      std::string print = std::string("printf(") + "k ? \" " + format(t) +
+                          "\" : \"" + format(t) + "\", v)";
+      out += "  printf(\"" + id.name + " = \");\n";
+      out += "  for (int k = 0; k < " + std::to_string(count) + "; ++k) {\n";
+      out += std::string("    ") + cType(t) + " v;\n";
+      out += "    memcpy(&v, frame + " + std::to_string(id.offset) + " + k * " +
+             std::to_string(t->width) + ", sizeof v);\n";
+      out += "    " + print + ";\n  }\n";
+      out += "  printf(\"\\n\");\n";
+    }
+    out += "  return status;\n}\n";
+    return out;
+  }
+};
+
+}  // namespace
+
+std::string CEmitter::emit(const sptr<ast::Stmt>& root,
+                           const symbols::Frame& frame) {
+  return Writer(options, frame).unit(root);
+}
+
+}  // namespace codegen
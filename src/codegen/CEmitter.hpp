@@ -0,0 +1,63 @@
+/**
+ * @file CEmitter.hpp
+ * @brief Portable C (a complete translation unit) from the AST.
+ */
+#pragma once
+#include <string>
+#include <utility>
+
+#include "Frame.hpp"
+#include "Stmt.h"
+#include "sptr.h"
+
+namespace codegen {
+
+/**
+ * @brief Options of CEmitter.
+ */
+struct COptions {
+  /// Name of the generated function, see EntryPoint.
+  std::string symbol = "sc_main";
+
+  /// Check every array index against its dimension, as
+  /// ir::LowerOptions::boundsChecks does.
+  bool boundsChecks = false;
+
+  /// Also define `main`: run the program on a zeroed frame, print the final
+  /// value of every variable of the outermost block as `name = value` (array
+  /// elements in a row) and exit with the status.
+  bool main = false;
+};
+
+/**
+ * @brief Writes a program as C99 that any `cc -O2` builds, as an
+ * optimizing baseline for our own backends.
+ *
+ * The unit defines one function with the EntryPoint signature,
+ * `int sc_main(uint8_t* frame)`. Every symbols::Id of the frame is a local
+ * of its own type (int `int32_t`, float `double`, char `int8_t`, bool
+ * `uint8_t`, arrays nested `T a[n][m]`), copied in from the frame at its
+ * Id::offset on entry and back on exit, so the C compiler can keep scalars
+ * in registers. Each operation gets a local of the type the `exprType` of
+ * its node says, with the conversions of ir::lower(); integer arithmetic
+ * goes through unsigned types and division through 64 bits after a zero
+ * test, so the unit has no undefined behaviour the interpreter would not
+ * trap on. A trap leaves through `goto` and returns 1.
+ */
+class CEmitter {
+ public:
+  explicit CEmitter(COptions options = {}) : options(std::move(options)) {}
+
+  /**
+   * @brief Translation unit of a program.
+   * @param root Program root produced by parser::Parser::program().
+   * @param frame Variable layout of the program.
+   * @throws std::runtime_error on nodes outside the language.
+   */
+  std::string emit(const sptr<ast::Stmt>& root, const symbols::Frame& frame);
+
+ private:
+  COptions options;
+};
+
+}  // namespace codegen
@@ -0,0 +1,194 @@
+/**
+ * @file Elf.cpp
+ * @brief Relocatable ELF64 object files from assembled code.
+ */
+#include "Elf.hpp"
+
+#include <elf.h>
+
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace codegen {
+namespace {
+
+bool startsWith(const std::string& s, const char* prefix) {
+  return s.compare(0, std::strlen(prefix), prefix) == 0;
+}
+
+bool isLocalLabel(const std::string& name) { return startsWith(name, ".L"); }
+
+/// String table under construction; offset 0 is the empty string.
+class StringTable {
+ public:
+  StringTable() : bytes(1, 0) {}
+
+  uint32_t add(const std::string& s) {
+    auto it = offsets.find(s);
+    if (it != offsets.end()) return it->second;
+    uint32_t at = static_cast<uint32_t>(bytes.size());
+    bytes.insert(bytes.end(), s.begin(), s.end());
+    bytes.push_back(0);
+    offsets.emplace(s, at);
+    return at;
+  }
+
+  std::vector<uint8_t> bytes;
+
+ private:
+  std::unordered_map<std::string, uint32_t> offsets;
+};
+
+template <typename T>
+void append(std::vector<uint8_t>& out, const T& v) {
+  const uint8_t* p = reinterpret_cast<const uint8_t*>(&v);
+  out.insert(out.end(), p, p + sizeof v);
+}
+
+uint64_t sectionFlags(const std::string& name) {
+  if (startsWith(name, ".text")) return SHF_ALLOC | SHF_EXECINSTR;
+  if (startsWith(name, ".rodata")) return SHF_ALLOC;
+  if (startsWith(name, ".note")) return 0;
+  return SHF_ALLOC | SHF_WRITE;
+}
+
+}  // namespace
+
+std::vector<uint8_t> writeElf(const Object& obj) {
+  const size_t nsec = obj.sections.size();
+  // Section header indices: 0 null, 1.. the sections of obj, then one
+  // .rela per section with relocations, .symtab, .strtab, .shstrtab.
+  std::vector<std::vector<Elf64_Rela>> relas(nsec);
+
+  // Symbols: null, one per section, locals, then globals
+  StringTable strtab;
+  std::vector<Elf64_Sym> syms(1, Elf64_Sym{});
+  for (size_t k = 0; k < nsec; ++k) {
+    Elf64_Sym s{};
+    s.st_info = ELF64_ST_INFO(STB_LOCAL, STT_SECTION);
+    s.st_shndx = static_cast<uint16_t>(k + 1);
+    syms.push_back(s);
+  }
+  std::unordered_map<std::string, uint32_t> symIndex;
+  std::unordered_map<std::string, const Symbol*> defined;
+  for (const Symbol& sym : obj.symbols) defined[sym.name] = &sym;
+  auto define = [&](const Symbol& sym) {
+    Elf64_Sym s{};
+    s.st_name = strtab.add(sym.name);
+    s.st_info = ELF64_ST_INFO(sym.global ? STB_GLOBAL : STB_LOCAL,
+                              sym.function ? STT_FUNC : STT_NOTYPE);
+    s.st_shndx = static_cast<uint16_t>(sym.section + 1);
+    s.st_value = sym.offset;
+    s.st_size = sym.size;
+    symIndex[sym.name] = static_cast<uint32_t>(syms.size());
+    syms.push_back(s);
+  };
+  for (const Symbol& sym : obj.symbols)
+    if (!sym.global && !isLocalLabel(sym.name)) define(sym);
+  const uint32_t firstGlobal = static_cast<uint32_t>(syms.size());
+  for (const Symbol& sym : obj.symbols)
+    if (sym.global) define(sym);
+
+  for (const Relocation& r : obj.relocations) {
+    Elf64_Rela rela{};
+    rela.r_offset = r.offset;
+    rela.r_addend = r.addend;
+    uint32_t index;
+    auto it = defined.find(r.symbol);
+    if (it != defined.end() && isLocalLabel(r.symbol)) {
+      index = static_cast<uint32_t>(it->second->section + 1);
+      rela.r_addend += static_cast<int64_t>(it->second->offset);
+    } else if (symIndex.count(r.symbol)) {
+      index = symIndex[r.symbol];
+    } else {
+      Elf64_Sym s{};
+      s.st_name = strtab.add(r.symbol);
+      s.st_info = ELF64_ST_INFO(STB_GLOBAL, STT_NOTYPE);
+      s.st_shndx = SHN_UNDEF;
+      index = symIndex[r.symbol] = static_cast<uint32_t>(syms.size());
+      syms.push_back(s);
+    }
+    rela.r_info = ELF64_R_INFO(index, r.branch ? R_X86_64_PLT32 : R_X86_64_PC32);
+    relas[r.section].push_back(rela);
+  }
+
+  // Headers of the sections, contents laid out after the ELF header
+  StringTable shstrtab;
+  std::vector<Elf64_Shdr> shdrs(1, Elf64_Shdr{});
+  std::vector<uint8_t> out(sizeof(Elf64_Ehdr), 0);
+  auto place = [&](Elf64_Shdr sh, const uint8_t* data, size_t size) {
+    uint64_t align = sh.sh_addralign ? sh.sh_addralign : 1;
+    out.resize((out.size() + align - 1) / align * align, 0);
+    sh.sh_offset = out.size();
+    sh.sh_size = size;
+    out.insert(out.end(), data, data + size);
+    shdrs.push_back(sh);
+  };
+  for (const Section& sec : obj.sections) {
+    Elf64_Shdr sh{};
+    sh.sh_name = shstrtab.add(sec.name);
+    sh.sh_type = SHT_PROGBITS;
+    sh.sh_flags = sectionFlags(sec.name);
+    sh.sh_addralign = static_cast<uint64_t>(sec.align);
+    place(sh, sec.bytes.data(), sec.bytes.size());
+  }
+  size_t relaSections = 0;
+  for (const auto& r : relas) relaSections += !r.empty();
+  const uint32_t symtabIndex = static_cast<uint32_t>(nsec + 1 + relaSections);
+  for (size_t k = 0; k < nsec; ++k) {
+    if (relas[k].empty()) continue;
+    Elf64_Shdr sh{};
+    sh.sh_name = shstrtab.add(".rela" + obj.sections[k].name);
+    sh.sh_type = SHT_RELA;
+    sh.sh_flags = SHF_INFO_LINK;
+    sh.sh_link = symtabIndex;
+    sh.sh_info = static_cast<uint32_t>(k + 1);
+    sh.sh_addralign = 8;
+    sh.sh_entsize = sizeof(Elf64_Rela);
+    place(sh, reinterpret_cast<const uint8_t*>(relas[k].data()),
+          relas[k].size() * sizeof(Elf64_Rela));
+  }
+  Elf64_Shdr symtab{};
+  symtab.sh_name = shstrtab.add(".symtab");
+  symtab.sh_type = SHT_SYMTAB;
+  symtab.sh_link = symtabIndex + 1;
+  symtab.sh_info = firstGlobal;
+  symtab.sh_addralign = 8;
+  symtab.sh_entsize = sizeof(Elf64_Sym);
+  place(symtab, reinterpret_cast<const uint8_t*>(syms.data()),
+        syms.size() * sizeof(Elf64_Sym));
+  Elf64_Shdr str{};
+  str.sh_name = shstrtab.add(".strtab");
+  str.sh_type = SHT_STRTAB;
+  str.sh_addralign = 1;
+  place(str, strtab.bytes.data(), strtab.bytes.size());
+  Elf64_Shdr shstr{};
+  shstr.sh_name = shstrtab.add(".shstrtab");
+  shstr.sh_type = SHT_STRTAB;
+  shstr.sh_addralign = 1;
+  place(shstr, shstrtab.bytes.data(), shstrtab.bytes.size());
+  if (shdrs.size() >= SHN_LORESERVE)
+    throw std::runtime_error("Too many sections for an ELF object");
+
+  out.resize((out.size() + 7) / 8 * 8, 0);
+  Elf64_Ehdr eh{};
+  std::memcpy(eh.e_ident, ELFMAG, SELFMAG);
+  eh.e_ident[EI_CLASS] = ELFCLASS64;
+  eh.e_ident[EI_DATA] = ELFDATA2LSB;
+  eh.e_ident[EI_VERSION] = EV_CURRENT;
+  eh.e_ident[EI_OSABI] = ELFOSABI_SYSV;
+  eh.e_type = ET_REL;
+  eh.e_machine = EM_X86_64;
+  eh.e_version = EV_CURRENT;
+  eh.e_shoff = out.size();
+  eh.e_ehsize = sizeof(Elf64_Ehdr);
+  eh.e_shentsize = sizeof(Elf64_Shdr);
+  eh.e_shnum = static_cast<uint16_t>(shdrs.size());
+  eh.e_shstrndx = static_cast<uint16_t>(shdrs.size() - 1);
+  std::memcpy(out.data(), &eh, sizeof eh);
+  for (const Elf64_Shdr& sh : shdrs) append(out, sh);
+  return out;
+}
+
+}  // namespace codegen
@@ -0,0 +1,31 @@
+/**
+ * @file Elf.hpp
+ * @brief Relocatable ELF64 object files from assembled code.
+ */
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Assembler.hpp"
+
+namespace codegen {
+
+/**
+ * @brief Relocatable x86-64 ELF64 object (`.o`) of @p obj, for the system
+ * linker.
+ *
+ * Every section of @p obj is written with its alignment, `.text` sections
+ * executable, `.rodata` read-only and `.note.*` without flags (so
+ * `.note.GNU-stack` keeps the stack non-executable). As GNU as does,
+ * `.L` labels stay out of the symbol table: references to them become
+ * relocations against their section's symbol with the label's offset in
+ * the addend. Other symbols keep their binding, `@function` type and
+ * size; symbols only referenced are undefined globals. Relocations are
+ * R_X86_64_PLT32 for calls and jumps and R_X86_64_PC32 otherwise.
+ *
+ * The line table of @p obj is not written; there are no debug sections.
+ */
+std::vector<uint8_t> writeElf(const Object& obj);
+
+}  // namespace codegen
@@ -0,0 +1,102 @@
+/**
+ * @file Jit.cpp
+ * @brief Running generated x86-64 code in this process.
+ */
+#include "Jit.hpp"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include "PerfMap.hpp"
+
+namespace codegen {
+
+JitModule::JitModule(const Object& obj) { load(obj); }
+
+JitModule::JitModule(const ir::Function& fn, AsmOptions options) {
+  load(assemble(AsmEmitter(std::move(options)).emit(fn)));
+}
+
+JitModule::~JitModule() {
+  if (base) munmap(base, mapped);
+}
+
+void JitModule::load(const Object& obj) {
+  const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  auto roundUp = [](size_t n, size_t to) { return (n + to - 1) / to * to; };
+
+  // .text at offset 0, the others from the next page
+  std::vector<size_t> offset(obj.sections.size(), 0);
+  size_t code = 0;
+  for (size_t k = 0; k < obj.sections.size(); ++k)
+    if (obj.sections[k].name == ".text") code = obj.sections[k].bytes.size();
+  size_t end = roundUp(code, page);
+  for (size_t k = 0; k < obj.sections.size(); ++k) {
+    const Section& s = obj.sections[k];
+    if (s.name == ".text" || s.bytes.empty()) continue;
+    end = roundUp(end, static_cast<size_t>(s.align));
+    offset[k] = end;
+    end += s.bytes.size();
+  }
+  mapped = roundUp(end > 0 ? end : 1, page);
+
+  std::unordered_map<std::string, size_t> at;
+  for (const Symbol& s : obj.symbols) at[s.name] = offset[s.section] + s.offset;
+  for (const Relocation& r : obj.relocations)
+    if (!at.count(r.symbol))
+      throw std::runtime_error("Undefined symbol " + r.symbol);
+
+  void* mem = mmap(nullptr, mapped, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mem == MAP_FAILED) {
+    mapped = 0;
+    throw std::runtime_error("Cannot map memory for generated code");
+  }
+  base = static_cast<uint8_t*>(mem);
+  for (const auto& [name, off] : at) symbols[name] = base + off;
+  for (const Symbol& s : obj.symbols)
+    if (s.function) funcs.push_back({s.name, symbols[s.name], s.size});
+  std::sort(funcs.begin(), funcs.end(),
+            [](const JitFunction& a, const JitFunction& b) {
+              return a.start < b.start;
+            });
+  for (const LineEntry& e : obj.lines)
+    lineTable.push_back({base + offset[e.section] + e.offset, e.line, e.column});
+  std::stable_sort(lineTable.begin(), lineTable.end(),
+                   [](const JitLine& a, const JitLine& b) {
+                     return a.start < b.start;
+                   });
+  file = obj.sourceFile;
+  for (size_t k = 0; k < obj.sections.size(); ++k)
+    if (!obj.sections[k].bytes.empty())
+      std::memcpy(base + offset[k], obj.sections[k].bytes.data(),
+                  obj.sections[k].bytes.size());
+  for (const Relocation& r : obj.relocations) {
+    size_t p = offset[r.section] + r.offset;
+    int32_t v = static_cast<int32_t>(static_cast<int64_t>(at[r.symbol]) -
+                                     static_cast<int64_t>(p) + r.addend);
+    std::memcpy(base + p, &v, sizeof v);
+  }
+
+  size_t text = roundUp(code, page);
+  if ((text && mprotect(base, text, PROT_READ | PROT_EXEC) != 0) ||
+      (mapped > text && mprotect(base + text, mapped - text, PROT_READ) != 0)) {
+    munmap(base, mapped);
+    base = nullptr;
+    throw std::runtime_error("Cannot make generated code executable");
+  }
+  announce(*this);
+}
+
+void* JitModule::symbol(const std::string& name) const {
+  auto it = symbols.find(name);
+  if (it == symbols.end()) throw std::runtime_error("No symbol " + name);
+  return it->second;
+}
+
+}  // namespace codegen
@@ -0,0 +1,80 @@
+/**
+ * @file Jit.hpp
+ * @brief Running generated x86-64 code in this process.
+ */
+#pragma once
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "AsmEmitter.hpp"
+#include "Assembler.hpp"
+#include "Toolchain.hpp"
+
+namespace codegen {
+
+/// A function of a JitModule, from its `.type` and `.size`.
+struct JitFunction {
+  std::string name;
+  const uint8_t* start = nullptr;
+  size_t size = 0;
+};
+
+/// Source position of the loaded code from @ref start on.
+struct JitLine {
+  const uint8_t* start = nullptr;
+  int line = 0;
+  int column = 0;
+};
+
+/**
+ * @brief An Object loaded into executable memory, unmapped on destruction.
+ *
+ * The sections are copied into one anonymous mapping, `.text` first and
+ * every other section from the next page on, and relocated there. The
+ * pages of `.text` are then made read-only and executable, the rest
+ * read-only; nothing is writable and executable at once.
+ */
+class JitModule {
+ public:
+  /// @throws std::runtime_error on a reference to a symbol the Object does
+  /// not define, or if the memory cannot be mapped.
+  explicit JitModule(const Object& obj);
+
+  /// Emit @p fn with AsmEmitter, assemble and load it: the assemble and
+  /// link steps of assembleShared() without leaving the process.
+  explicit JitModule(const ir::Function& fn, AsmOptions options = {});
+
+  ~JitModule();
+  JitModule(const JitModule&) = delete;
+  JitModule& operator=(const JitModule&) = delete;
+
+  /// @throws std::runtime_error if there is no such symbol.
+  void* symbol(const std::string& name) const;
+
+  EntryPoint entry(const std::string& name) const {
+    return reinterpret_cast<EntryPoint>(symbol(name));
+  }
+
+  size_t size() const { return mapped; }  ///< Bytes mapped
+
+  /// Functions in address order.
+  const std::vector<JitFunction>& functions() const { return funcs; }
+  /// Line table of the code in address order; empty unless the Object had
+  /// one (AsmOptions::sourceFile).
+  const std::vector<JitLine>& lines() const { return lineTable; }
+  const std::string& sourceFile() const { return file; }
+
+ private:
+  void load(const Object& obj);
+
+  uint8_t* base = nullptr;
+  size_t mapped = 0;
+  std::unordered_map<std::string, uint8_t*> symbols;
+  std::vector<JitFunction> funcs;
+  std::vector<JitLine> lineTable;
+  std::string file;
+};
+
+}  // namespace codegen
@@ -0,0 +1,515 @@
+/**
+ * @file LlvmEmitter.cpp
+ * @brief Textual LLVM IR (`.ll`) from the AST.
+ */
+#include "LlvmEmitter.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#include "Array.hpp"
+#include "Expr.hpp"
+#include "Tag.hpp"
+#include "Token.hpp"
+#include "Word.hpp"
+
+namespace codegen {
+namespace {
+
+using lexer::Tag;
+using symbols::Type;
+
+/// A scalar SSA value: its text and its language type.
+struct Value {
+  std::string text;
+  sptr<Type> type;
+};
+
+/// Type of a scalar value in registers; bool is `i1`.
+const char* valueType(const sptr<Type>& t) {
+  if (t == Type::Float) return "double";
+  if (t == Type::Int) return "i32";
+  if (t == Type::Char) return "i8";
+  if (t == Type::Bool) return "i1";
+  throw std::runtime_error("No LLVM type for " + t->name);
+}
+
+/// Type of a value in memory; bool is a byte, arrays nest.
+std::string memoryType(const sptr<Type>& t) {
+  if (auto arr = std::dynamic_pointer_cast<symbols::Array>(t))
+    return "[" + std::to_string(arr->size) + " x " + memoryType(arr->of) +
+           "]";
+  return t == Type::Bool ? "i8" : valueType(t);
+}
+
+class Writer {
+ public:
+  Writer(const LlvmOptions& o, const symbols::Frame& f) : opts(o), frame(f) {}
+
+  std::string module(const sptr<ast::Stmt>& root) {
+    for (size_t k = 0; k < frame.vars.size(); ++k) {
+      const symbols::Id& id = *frame.vars[k];
+      std::string slot = "%" + id.name + "." + std::to_string(k);
+      slots[&id] = slot;
+      line(allocas, slot + " = alloca " + memoryType(id.type));
+    }
+    copy(true, allocas);
+
+    stmt(root);
+    br("exit");
+    label("trap");
+    br("exit");
+    label("exit");
+    line(body, "%status = phi i32 " + phiIncoming());
+    copy(false, body);
+    line(body, "ret i32 %status");
+
+    std::string out = "; generated from " + std::to_string(frame.vars.size()) +
+                      " variables, " + std::to_string(frame.size) +
+                      " frame bytes\n";
+    out += "declare void @" + memcpyName() + "(" + ptr("i8") + ", " +
+           ptr("i8") + ", i64, i1)\n\n";
+    out += "define i32 @" + opts.symbol + "(" + ptr("i8") +
+           " %frame) nounwind {\n";
+    out += "entry:\n" + allocas + body + "}\n";
+    return out;
+  }
+
+ private:
+  const LlvmOptions& opts;
+  const symbols::Frame& frame;
+  std::string allocas;  ///< Entry block: slots and copy-in
+  std::string body;     ///< Every block after the entry one
+  std::string block = "entry";  ///< Block being written
+  bool terminated = false;      ///< Whether @ref block has its terminator
+  int values = 0;
+  int labels = 0;
+  std::unordered_map<const symbols::Id*, std::string> slots;
+  std::unordered_map<int, std::pair<std::string, sptr<Type>>> temps;
+  std::vector<std::string> exits;  ///< Exit blocks of enclosing loops
+  std::vector<std::string> exitPreds;  ///< Blocks branching to `exit`
+
+  static void line(std::string& to, const std::string& text) {
+    to += "  " + text + "\n";
+  }
+
+  /// Emit an instruction; code after a terminator goes to a fresh block.
+  void ins(const std::string& text) {
+    if (terminated) label(newLabel());
+    line(body, text);
+  }
+
+  std::string value(const std::string& rhs) {
+    std::string v = "%v" + std::to_string(values++);
+    ins(v + " = " + rhs);
+    return v;
+  }
+
+  std::string newLabel() { return "L" + std::to_string(labels++); }
+
+  /// Start block @p name, falling through into it from an open block.
+  void label(const std::string& name) {
+    if (!terminated) br(name);
+    body += name + ":\n";
+    block = name;
+    terminated = false;
+  }
+
+  void note(const std::string& target) {
+    if (target == "exit") exitPreds.push_back(block);
+  }
+
+  void br(const std::string& target) {
+    ins("br label %" + target);
+    note(target);
+    terminated = true;
+  }
+
+  void br(const std::string& c, const std::string& t, const std::string& f) {
+    ins("br i1 " + c + ", label %" + t + ", label %" + f);
+    note(t);
+    note(f);
+    terminated = true;
+  }
+
+  /// Leave for the trap block when @p c holds.
+  void trapIf(const std::string& c) {
+    std::string ok = newLabel();
+    br(c, "trap", ok);
+    label(ok);
+  }
+
+  std::string phiIncoming() const {
+    std::string out;
+    for (const std::string& b : exitPreds)
+      out += std::string(out.empty() ? "" : ", ") + "[" +
+             (b == "trap" ? "1" : "0") + ", %" + b + "]";
+    return out;
+  }
+
+  /// Type of a pointer to @p memType.
+  std::string ptr(const std::string& memType) const {
+    return opts.opaquePointers ? "ptr" : memType + "*";
+  }
+
+  /// @p p, a pointer to @p from, as a pointer to @p to, computed into @p out.
+  std::string cast(const std::string& p, const std::string& from,
+                   const std::string& to, std::string& out) {
+    if (opts.opaquePointers || from == to) return p;
+    std::string c = "%v" + std::to_string(values++);
+    line(out, c + " = bitcast " + ptr(from) + " " + p + " to " + ptr(to));
+    return c;
+  }
+
+  /// `memcpy` of @p bytes from byte pointer @p src to @p dst, into @p out.
+  void memcpy(const std::string& dst, const std::string& src, int bytes,
+              std::string& out) {
+    line(out, "call void @" + memcpyName() + "(" + ptr("i8") + " " + dst +
+                  ", " + ptr("i8") + " " + src + ", i64 " +
+                  std::to_string(bytes) + ", i1 false)");
+  }
+
+  std::string memcpyName() const {
+    return opts.opaquePointers ? "llvm.memcpy.p0.p0.i64"
+                               : "llvm.memcpy.p0i8.p0i8.i64";
+  }
+
+  /// Address of @p id in the frame as a pointer to @p memType, computed
+  /// into @p out.
+  std::string framePtr(const symbols::Id& id, const std::string& memType,
+                       std::string& out) {
+    std::string p = "%frame";
+    if (id.offset != 0) {
+      p = "%v" + std::to_string(values++);
+      line(out, p + " = getelementptr inbounds i8, " + ptr("i8") +
+                    " %frame, i64 " + std::to_string(id.offset));
+    }
+    return cast(p, "i8", memType, out);
+  }
+
+  /// Copy every variable between its slot and the frame, into @p out.
+  void copy(bool in, std::string& out) {
+    for (const auto& var : frame.vars) {
+      std::string t = memoryType(var->type);
+      const std::string& slot = slots[var.get()];
+      if (std::dynamic_pointer_cast<symbols::Array>(var->type)) {
+        std::string f = framePtr(*var, "i8", out);
+        std::string a = cast(slot, t, "i8", out);
+        memcpy(in ? a : f, in ? f : a, var->type->width, out);
+      } else {
+        std::string f = framePtr(*var, t, out);
+        std::string v = "%v" + std::to_string(values++);
+        if (in) {
+          line(out, v + " = load " + t + ", " + ptr(t) + " " + f +
+                        ", align 1");
+          line(out, "store " + t + " " + v + ", " + ptr(t) + " " + slot);
+        } else {
+          line(out, v + " = load " + t + ", " + ptr(t) + " " + slot);
+          line(out, "store " + t + " " + v + ", " + ptr(t) + " " + f +
+                        ", align 1");
+        }
+      }
+    }
+  }
+
+  const std::string& slot(const symbols::Id* id) {
+    auto it = slots.find(id);
+    if (it == slots.end())
+      throw std::runtime_error("Variable " + id->name + " is not in the frame");
+    return it->second;
+  }
+
+  void stmt(const sptr<ast::Stmt>& s) {
+    if (!s) return;
+
+    if (auto seq = std::dynamic_pointer_cast<ast::Seq>(s)) {
+      // walk the `second` spine iteratively
+      sptr<ast::Stmt> cur = s;
+      for (; seq; seq = std::dynamic_pointer_cast<ast::Seq>(cur)) {
+        stmt(seq->first);
+        cur = seq->second;
+      }
+      stmt(cur);
+    } else if (auto node = std::dynamic_pointer_cast<ast::Set>(s)) {
+      auto target = std::dynamic_pointer_cast<ast::IdExpr>(node->id);
+      if (!target) throw std::runtime_error("Set target is not a variable");
+      Value v = convert(expr(*node->expr), target->sym->type);
+      store(v, slot(target->sym.get()));
+    } else if (auto node = std::dynamic_pointer_cast<ast::SetElem>(s)) {
+      auto acc = std::dynamic_pointer_cast<ast::Access>(node->arrayAccess);
+      if (!acc) throw std::runtime_error("SetElem target is not an access");
+      std::string p = address(*acc);
+      store(convert(expr(*node->expr), acc->exprType), p);
+    } else if (auto node = std::dynamic_pointer_cast<ast::If>(s)) {
+      std::string then = newLabel(), after = newLabel();
+      br(cond(*node->condition), then, after);
+      label(then);
+      stmt(node->thenStmt);
+      label(after);
+    } else if (auto node = std::dynamic_pointer_cast<ast::Else>(s)) {
+      std::string then = newLabel(), other = newLabel(), after = newLabel();
+      br(cond(*node->condition), then, other);
+      label(then);
+      stmt(node->thenStmt);
+      br(after);
+      label(other);
+      stmt(node->elseStmt);
+      label(after);
+    } else if (auto node = std::dynamic_pointer_cast<ast::While>(s)) {
+      std::string head = newLabel(), loop = newLabel(), exit = newLabel();
+      label(head);
+      br(cond(*node->condition), loop, exit);
+      label(loop);
+      exits.push_back(exit);
+      stmt(node->body);
+      exits.pop_back();
+      br(head);
+      label(exit);
+    } else if (auto node = std::dynamic_pointer_cast<ast::Do>(s)) {
+      std::string loop = newLabel(), exit = newLabel();
+      label(loop);
+      exits.push_back(exit);
+      stmt(node->body);
+      exits.pop_back();
+      br(cond(*node->condition), loop, exit);
+      label(exit);
+    } else if (std::dynamic_pointer_cast<ast::Break>(s)) {
+      if (exits.empty()) throw std::runtime_error("break outside of a loop");
+      br(exits.back());
+    } else {
+      throw std::runtime_error("Unsupported statement in LLVM emission");
+    }
+  }
+
+  /// Store a scalar of the memory slot's type at @p p.
+  void store(const Value& v, const std::string& p) {
+    std::string text = v.text;
+    if (v.type == Type::Bool) text = value("zext i1 " + text + " to i8");
+    std::string t = memoryType(v.type);
+    ins("store " + t + " " + text + ", " + ptr(t) + " " + p);
+  }
+
+  Value load(const sptr<Type>& t, const std::string& p) {
+    std::string mt = memoryType(t);
+    std::string v = value("load " + mt + ", " + ptr(mt) + " " + p);
+    if (t == Type::Bool) v = value("icmp ne i8 " + v + ", 0");
+    return {v, t};
+  }
+
+  std::string cond(const ast::Expr& e) {
+    Value c = expr(e);
+    if (c.type != Type::Bool)
+      throw std::runtime_error("Condition is not a bool");
+    return c.text;
+  }
+
+  Value expr(const ast::Expr& e) {
+    if (auto id = dynamic_cast<const ast::IdExpr*>(&e)) {
+      if (std::dynamic_pointer_cast<symbols::Array>(id->sym->type))
+        throw std::runtime_error("Array " + id->sym->name + " used as value");
+      return load(id->sym->type, slot(id->sym.get()));
+    }
+
+    if (auto c = dynamic_cast<const ast::Constant*>(&e)) {
+      switch (c->value->tag) {
+        case Tag::NUM:
+          return {std::to_string(static_cast<int32_t>(
+                      std::stoll(c->value->lexeme))),
+                  Type::Int};
+        case Tag::REAL: {
+          // exact bit pattern; decimal literals must be exact in LLVM
+          double d = std::stod(c->value->lexeme);
+          uint64_t bits;
+          std::memcpy(&bits, &d, sizeof bits);
+          char buf[24];
+          std::snprintf(buf, sizeof buf, "0x%016llX",
+                        static_cast<unsigned long long>(bits));
+          return {buf, Type::Float};
+        }
+        case Tag::TRUE_:
+          return {"true", Type::Bool};
+        case Tag::FALSE_:
+          return {"false", Type::Bool};
+        default:
+          throw std::runtime_error("Unsupported constant " +
+                                   c->value->lexeme);
+      }
+    }
+
+    if (auto t = dynamic_cast<const ast::Temp*>(&e)) {
+      auto it = temps.find(t->number);
+      if (it == temps.end()) {
+        std::string p = "%t" + std::to_string(t->number);
+        std::string mt = memoryType(t->exprType);
+        line(allocas, p + " = alloca " + mt);
+        line(allocas, "store " + mt + " zeroinitializer, " + ptr(mt) + " " + p);
+        it = temps.emplace(t->number, std::make_pair(p, t->exprType)).first;
+      }
+      return load(it->second.second, it->second.first);
+    }
+
+    if (auto acc = dynamic_cast<const ast::Access*>(&e))
+      return load(acc->exprType, address(*acc));
+
+    if (auto un = dynamic_cast<const ast::Unary*>(&e)) {
+      Value a = expr(*un->expr);
+      const char* t = valueType(a.type);
+      if (un->op_tok->tag == Tag::UnaryNOT)
+        return {value("xor i1 " + a.text + ", true"), Type::Bool};
+      if (a.type == Type::Float)
+        return {value("fneg double " + a.text), a.type};
+      return {value(std::string("sub ") + t + " 0, " + a.text), a.type};
+    }
+
+    if (auto op = dynamic_cast<const ast::Logical*>(&e)) {
+      // the right operand only runs when the left one does not decide
+      bool isAnd = dynamic_cast<const ast::And*>(&e) != nullptr;
+      std::string l = cond(*op->lhs);
+      std::string from = block, rhs = newLabel(), after = newLabel();
+      if (isAnd)
+        br(l, rhs, after);
+      else
+        br(l, after, rhs);
+      label(rhs);
+      std::string r = cond(*op->rhs);
+      std::string rhsEnd = block;
+      label(after);
+      return {value(std::string("phi i1 [") + (isAnd ? "false" : "true") +
+                    ", %" + from + "], [" + r + ", %" + rhsEnd + "]"),
+              Type::Bool};
+    }
+
+    if (auto op = dynamic_cast<const ast::Op*>(&e)) {
+      Value a = expr(*op->lhs);
+      Value b = expr(*op->rhs);
+      if (a.type != b.type && a.type->isNumeric() && b.type->isNumeric()) {
+        sptr<Type> t = Type::max(a.type, b.type);
+        a = convert(a, t);
+        b = convert(b, t);
+      }
+      if (dynamic_cast<const ast::Arith*>(&e)) return arith(op->op_tok->tag, a, b);
+      return {value(compare(op->op_tok->tag, a, b)), Type::Bool};
+    }
+
+    throw std::runtime_error("Unsupported expression in LLVM emission");
+  }
+
+  Value arith(Tag tag, const Value& a, const Value& b) {
+    bool fp = a.type == Type::Float;
+    const char* t = valueType(a.type);
+    const char* name;
+    switch (tag) {
+      case Tag::OP_PLUS: name = fp ? "fadd" : "add"; break;
+      case Tag::OP_MINUS: name = fp ? "fsub" : "sub"; break;
+      case Tag::OP_MUL: name = fp ? "fmul" : "mul"; break;
+      case Tag::OP_DIV:
+        if (fp) {
+          name = "fdiv";
+          break;
+        }
+        return divide(a, b);
+      default:
+        throw std::runtime_error("Unsupported operator in LLVM emission");
+    }
+    return {value(std::string(name) + " " + t + " " + a.text + ", " + b.text),
+            a.type};
+  }
+
+  /// Integer division in 64 bits, so INT_MIN / -1 wraps instead of being
+  /// undefined; a zero divisor traps.
+  Value divide(const Value& a, const Value& b) {
+    std::string t = valueType(a.type);
+    std::string x = value("sext " + t + " " + a.text + " to i64");
+    std::string y = value("sext " + t + " " + b.text + " to i64");
+    trapIf(value("icmp eq i64 " + y + ", 0"));
+    std::string q = value("sdiv i64 " + x + ", " + y);
+    return {value("trunc i64 " + q + " to " + t), a.type};
+  }
+
+  std::string compare(Tag tag, const Value& a, const Value& b) {
+    bool fp = a.type == Type::Float;
+    // bools order as 0 < 1, other integers are signed
+    bool sign = a.type != Type::Bool;
+    const char* pred;
+    switch (tag) {
+      case Tag::LESS: pred = fp ? "olt" : sign ? "slt" : "ult"; break;
+      case Tag::LE: pred = fp ? "ole" : sign ? "sle" : "ule"; break;
+      case Tag::GREATER: pred = fp ? "ogt" : sign ? "sgt" : "ugt"; break;
+      case Tag::GE: pred = fp ? "oge" : sign ? "sge" : "uge"; break;
+      case Tag::EQ: pred = fp ? "oeq" : "eq"; break;
+      case Tag::NE: pred = fp ? "une" : "ne"; break;
+      default:
+        throw std::runtime_error("Unsupported operator in LLVM emission");
+    }
+    return std::string(fp ? "fcmp " : "icmp ") + pred + " " +
+           valueType(a.type) + " " + a.text + ", " + b.text;
+  }
+
+  /// Convert @p v to @p to as ir::Opcode::Cvt does.
+  Value convert(const Value& v, const sptr<Type>& to) {
+    if (v.type == to) return v;
+    std::string from = valueType(v.type);
+    std::string target = valueType(to);
+    std::string op;
+    if (to == Type::Bool) {
+      return {value("icmp ne " + from + " " + v.text + ", " +
+                    (v.type == Type::Float ? "0.0" : "0")),
+              to};
+    } else if (to == Type::Float) {
+      op = v.type == Type::Bool ? "uitofp" : "sitofp";
+    } else if (v.type == Type::Float) {
+      // through 64 bits, then wrap like the interpreter
+      std::string w = value("fptosi double " + v.text + " to i64");
+      return {value("trunc i64 " + w + " to " + target), to};
+    } else if (v.type == Type::Bool) {
+      op = "zext";
+    } else {
+      op = v.type->width < to->width ? "sext" : "trunc";
+    }
+    return {value(op + " " + from + " " + v.text + " to " + target), to};
+  }
+
+  /// Element pointer of an access chain `a[i][j]...`, with one
+  /// getelementptr over all of its indices.
+  std::string address(const ast::Access& acc) {
+    std::vector<const ast::Access*> chain;
+    const ast::Expr* cur = &acc;
+    while (auto a = dynamic_cast<const ast::Access*>(cur)) {
+      chain.push_back(a);
+      cur = a->array.get();
+    }
+    auto id = dynamic_cast<const ast::IdExpr*>(cur);
+    if (!id) throw std::runtime_error("Indexed expression is not an array");
+
+    std::string indices;
+    for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+      Value idx = convert(expr(*(*it)->index), Type::Int);
+      if (opts.boundsChecks) {
+        auto arr =
+            std::dynamic_pointer_cast<symbols::Array>((*it)->array->exprType);
+        if (!arr)
+          throw std::runtime_error("Indexed expression is not an array");
+        // unsigned, so negative indices fail too
+        trapIf(value("icmp uge i32 " + idx.text + ", " +
+                     std::to_string(arr->size)));
+      }
+      indices += ", i64 " + value("sext i32 " + idx.text + " to i64");
+    }
+    std::string t = memoryType(id->sym->type);
+    return value("getelementptr inbounds " + t + ", " + ptr(t) + " " +
+                 slot(id->sym.get()) + ", i64 0" + indices);
+  }
+};
+
+}  // namespace
+
+std::string LlvmEmitter::emit(const sptr<ast::Stmt>& root,
+                              const symbols::Frame& frame) {
+  return Writer(options, frame).module(root);
+}
+
+}  // namespace codegen
@@ -0,0 +1,63 @@
+/**
+ * @file LlvmEmitter.hpp
+ * @brief Textual LLVM IR (`.ll`) from the AST.
+ */
+#pragma once
+#include <string>
+#include <utility>
+
+#include "Frame.hpp"
+#include "Stmt.h"
+#include "sptr.h"
+
+namespace codegen {
+
+/**
+ * @brief Options of LlvmEmitter.
+ */
+struct LlvmOptions {
+  /// Name of the generated function, see EntryPoint.
+  std::string symbol = "sc_main";
+
+  /// Check every array index against its dimension, as
+  /// ir::LowerOptions::boundsChecks does.
+  bool boundsChecks = false;
+
+  /// Write opaque pointers (`ptr`), as LLVM 15 and later expect; when
+  /// false, typed pointers (`i32*`) for LLVM 14 and older, see llvmVersion().
+  bool opaquePointers = true;
+};
+
+/**
+ * @brief Writes a program as an LLVM module, without linking LLVM.
+ *
+ * The module defines one function with the EntryPoint signature,
+ * `i32 @sc_main(ptr %frame)`. Every symbols::Id gets an `alloca` of its
+ * own type (int `i32`, float `double`, char and bool `i8`, arrays nested
+ * `[n x T]`), filled from the frame at its Id::offset on entry and copied
+ * back on exit, so `opt` can promote the scalars to SSA values. Arithmetic
+ * is typed by the `exprType` of each node with the conversions of
+ * ir::lower(), array elements are addressed with one `getelementptr` over
+ * all indices of an ast::Access chain, and `&&`/`||` branch around their
+ * right operand. Integer division is done in 64 bits after a zero test, so
+ * the module has no undefined behaviour the interpreter would not trap
+ * on; a trap returns 1.
+ */
+class LlvmEmitter {
+ public:
+  explicit LlvmEmitter(LlvmOptions options = {})
+      : options(std::move(options)) {}
+
+  /**
+   * @brief Module text of a program.
+   * @param root Program root produced by parser::Parser::program().
+   * @param frame Variable layout of the program.
+   * @throws std::runtime_error on nodes outside the language.
+   */
+  std::string emit(const sptr<ast::Stmt>& root, const symbols::Frame& frame);
+
+ private:
+  LlvmOptions options;
+};
+
+}  // namespace codegen
@@ -0,0 +1,220 @@
+/**
+ * @file PerfMap.cpp
+ * @brief Symbols of JIT code for Linux perf: perf maps and jitdump files.
+ */
+#include "PerfMap.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace codegen {
+namespace {
+
+/// Code of one function from one source position; line 0 for the code
+/// ahead of the first.
+struct Region {
+  const uint8_t* start;
+  size_t size;
+  int line;
+  int column;
+};
+
+std::vector<Region> regions(const JitFunction& fn,
+                            const std::vector<JitLine>& lines) {
+  const uint8_t* end = fn.start + fn.size;
+  auto first = std::lower_bound(
+      lines.begin(), lines.end(), fn.start,
+      [](const JitLine& l, const uint8_t* p) { return l.start < p; });
+  std::vector<Region> out;
+  const uint8_t* at = fn.start;
+  int line = 0, column = 0;
+  for (auto it = first; it != lines.end() && it->start < end; ++it) {
+    if (it->start > at) out.push_back({at, size_t(it->start - at), line, column});
+    if (it->start >= at) at = it->start;
+    line = it->line;
+    column = it->column;
+  }
+  if (end > at) out.push_back({at, size_t(end - at), line, column});
+  return out;
+}
+
+uint64_t timestamp() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+// jitdump.h
+constexpr uint32_t kJitMagic = 0x4A695444;  // "JiTD"
+constexpr uint32_t kJitVersion = 1;
+constexpr uint32_t kElfMachX86_64 = 62;
+enum : uint32_t { JitCodeLoad = 0, JitCodeClose = 3, JitCodeDebugInfo = 2 };
+
+struct JitHeader {
+  uint32_t magic, version, totalSize, elfMach, pad, pid;
+  uint64_t timestamp, flags;
+};
+struct RecordPrefix {
+  uint32_t id, totalSize;
+  uint64_t timestamp;
+};
+struct CodeLoad {
+  RecordPrefix p;
+  uint32_t pid, tid;
+  uint64_t vma, codeAddr, codeSize, codeIndex;
+};
+struct DebugInfo {
+  RecordPrefix p;
+  uint64_t codeAddr, entries;
+};
+struct DebugEntry {
+  uint64_t addr;
+  uint32_t line, discriminator;
+};
+
+}  // namespace
+
+std::string perfMapPath() {
+  return "/tmp/perf-" + std::to_string(getpid()) + ".map";
+}
+
+std::string jitDumpPath() {
+  return "/tmp/jit-" + std::to_string(getpid()) + ".dump";
+}
+
+PerfMap::PerfMap(const std::string& path)
+    : file(std::fopen(path.c_str(), "a")) {
+  if (!file) throw std::runtime_error("Cannot open " + path);
+}
+
+PerfMap::~PerfMap() { std::fclose(file); }
+
+void PerfMap::add(const void* start, size_t size, const std::string& name) {
+  std::fprintf(file, "%lx %zx %s\n", reinterpret_cast<unsigned long>(start),
+               size, name.c_str());
+  std::fflush(file);
+}
+
+void PerfMap::add(const JitModule& mod) {
+  const std::string& src = mod.sourceFile();
+  for (const JitFunction& fn : mod.functions()) {
+    for (const Region& r : regions(fn, mod.lines())) {
+      std::string name = fn.name;
+      if (r.line)
+        name += " " + src + ":" + std::to_string(r.line) + ":" +
+                std::to_string(r.column);
+      add(r.start, r.size, name);
+    }
+  }
+}
+
+JitDump::JitDump(const std::string& path) {
+  int fd = open(path.c_str(), O_CREAT | O_TRUNC | O_RDWR, 0666);
+  if (fd < 0) throw std::runtime_error("Cannot create " + path);
+  file = fdopen(fd, "w+");
+  if (!file) {
+    close(fd);
+    throw std::runtime_error("Cannot create " + path);
+  }
+  JitHeader h{kJitMagic,
+              kJitVersion,
+              sizeof(JitHeader),
+              kElfMachX86_64,
+              0,
+              static_cast<uint32_t>(getpid()),
+              timestamp(),
+              0};
+  write(&h, sizeof h);
+  std::fflush(file);
+  // perf record notices the file by this mapping
+  markerSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  marker = mmap(nullptr, markerSize, PROT_READ | PROT_EXEC, MAP_PRIVATE, fd, 0);
+  if (marker == MAP_FAILED) marker = nullptr;
+}
+
+JitDump::~JitDump() {
+  RecordPrefix close{JitCodeClose, sizeof(RecordPrefix), timestamp()};
+  write(&close, sizeof close);
+  if (marker) munmap(marker, markerSize);
+  std::fclose(file);
+}
+
+void JitDump::write(const void* data, size_t size) {
+  if (std::fwrite(data, 1, size, file) != size)
+    throw std::runtime_error("Cannot write jitdump record");
+}
+
+void JitDump::add(const JitModule& mod) {
+  std::string src = mod.sourceFile();
+  uint32_t tid = static_cast<uint32_t>(syscall(SYS_gettid));
+  for (const JitFunction& fn : mod.functions()) {
+    std::vector<Region> lines;
+    for (const Region& r : regions(fn, mod.lines()))
+      if (r.line) lines.push_back(r);
+    if (!lines.empty()) {
+      DebugInfo d{{JitCodeDebugInfo, 0, timestamp()},
+                  reinterpret_cast<uint64_t>(fn.start),
+                  lines.size()};
+      d.p.totalSize = static_cast<uint32_t>(
+          sizeof d + lines.size() * (sizeof(DebugEntry) + src.size() + 1));
+      write(&d, sizeof d);
+      for (const Region& r : lines) {
+        DebugEntry e{reinterpret_cast<uint64_t>(r.start),
+                     static_cast<uint32_t>(r.line), 0};
+        write(&e, sizeof e);
+        write(src.c_str(), src.size() + 1);
+      }
+    }
+    CodeLoad l{{JitCodeLoad, 0, timestamp()},
+               static_cast<uint32_t>(getpid()),
+               tid,
+               reinterpret_cast<uint64_t>(fn.start),
+               reinterpret_cast<uint64_t>(fn.start),
+               fn.size,
+               index++};
+    l.p.totalSize =
+        static_cast<uint32_t>(sizeof l + fn.name.size() + 1 + fn.size);
+    write(&l, sizeof l);
+    write(fn.name.c_str(), fn.name.size() + 1);
+    write(fn.start, fn.size);
+  }
+  std::fflush(file);
+}
+
+void announce(const JitModule& mod) {
+  static const bool map = [] {
+    const char* v = std::getenv("SC_PERF_MAP");
+    return v && std::strcmp(v, "1") == 0;
+  }();
+  static const bool dump = [] {
+    const char* v = std::getenv("SC_PERF_JITDUMP");
+    return v && std::strcmp(v, "1") == 0;
+  }();
+  if (!map && !dump) return;
+
+  static std::mutex lock;
+  static std::unique_ptr<PerfMap> perfMap;
+  static std::unique_ptr<JitDump> jitDump;
+  std::lock_guard<std::mutex> guard(lock);
+  if (map) {
+    if (!perfMap) perfMap = std::make_unique<PerfMap>();
+    perfMap->add(mod);
+  }
+  if (dump) {
+    if (!jitDump) jitDump = std::make_unique<JitDump>();
+    jitDump->add(mod);
+  }
+}
+
+}  // namespace codegen
@@ -0,0 +1,83 @@
+/**
+ * @file PerfMap.hpp
+ * @brief Symbols of JIT code for Linux perf: perf maps and jitdump files.
+ */
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include "Jit.hpp"
+
+namespace codegen {
+
+/// `/tmp/perf-<pid>.map`, where perf looks for the map of this process.
+std::string perfMapPath();
+
+/// `/tmp/jit-<pid>.dump`, the name `perf inject --jit` expects.
+std::string jitDumpPath();
+
+/**
+ * @brief Appends `start size name` lines for JIT code to a perf map.
+ *
+ * Each function of a module is one region named after it, or with a line
+ * table one region per run of code from one statement, named
+ * `function file:line:column`; code ahead of the first statement (the
+ * prologue) keeps the plain function name. Every add() is flushed, so a
+ * profiler sees the entries even if the process dies.
+ */
+class PerfMap {
+ public:
+  /// @throws std::runtime_error if @p path cannot be opened for appending.
+  explicit PerfMap(const std::string& path = perfMapPath());
+  ~PerfMap();
+  PerfMap(const PerfMap&) = delete;
+  PerfMap& operator=(const PerfMap&) = delete;
+
+  void add(const JitModule& mod);
+  void add(const void* start, size_t size, const std::string& name);
+
+ private:
+  std::FILE* file;
+};
+
+/**
+ * @brief Writes a jitdump file (the format of perf's jitdump.h, version 1).
+ *
+ * Each function of a module becomes a JIT_CODE_DEBUG_INFO record with the
+ * line table, if any, followed by a JIT_CODE_LOAD record with a copy of
+ * the code, so `perf inject --jit` can build ELF images with line numbers
+ * for annotate. The file is also mapped executable once, the marker perf
+ * record looks for. Timestamps are CLOCK_MONOTONIC, so record with
+ * `perf record -k 1`.
+ */
+class JitDump {
+ public:
+  /// @throws std::runtime_error if @p path cannot be created.
+  explicit JitDump(const std::string& path = jitDumpPath());
+  /// Writes JIT_CODE_CLOSE.
+  ~JitDump();
+  JitDump(const JitDump&) = delete;
+  JitDump& operator=(const JitDump&) = delete;
+
+  void add(const JitModule& mod);
+
+ private:
+  void write(const void* data, size_t size);
+
+  std::FILE* file;
+  void* marker = nullptr;
+  size_t markerSize = 0;
+  uint64_t index = 0;  ///< code_index of the next load
+};
+
+/**
+ * @brief Record @p mod in this process's perf map if the environment has
+ * `SC_PERF_MAP=1`, and in its jitdump if it has `SC_PERF_JITDUMP=1`.
+ *
+ * JitModule calls this for every module it loads; both files are opened
+ * on first use and shared by all threads.
+ */
+void announce(const JitModule& mod);
+
+}  // namespace codegen
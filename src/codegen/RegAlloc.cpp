@@ -0,0 +1,105 @@
+/**
+ * @file RegAlloc.cpp
+ * @brief Linear-scan register allocation of IR temporaries.
+ */
+#include "RegAlloc.hpp"
+
+#include <algorithm>
+#include <map>
+#include <utility>
+
+namespace codegen {
+
+Allocation linearScan(const ir::Function& fn, const ir::Cfg& cfg,
+                      const ir::Liveness& live, int gpRegs, int fpRegs) {
+  size_t nt = static_cast<size_t>(fn.numTemps) + 1;
+  Allocation a;
+  a.cls.assign(nt, RegClass::None);
+  a.reg.assign(nt, -1);
+  a.slot.assign(nt, -1);
+
+  for (const ir::Instr& in : fn.code)
+    for (const ir::Operand* o : {&in.dst, &in.a, &in.b}) {
+      if (!o->isTemp()) continue;
+      RegClass& c = a.cls[o->temp];
+      if (o == &in.dst && in.isVector() && in.hasResult())
+        c = RegClass::Vector;
+      else if (c == RegClass::None)
+        c = o->isFloat() ? RegClass::Fp : RegClass::Gp;
+    }
+
+  std::vector<ir::LiveRange> range = ir::liveRanges(fn, cfg, live);
+  std::vector<int> order;
+  for (size_t t = 1; t < nt; ++t)
+    if (a.cls[t] != RegClass::None) order.push_back(static_cast<int>(t));
+  std::sort(order.begin(), order.end(), [&](int x, int y) {
+    return std::make_pair(range[x].start, x) <
+           std::make_pair(range[y].start, y);
+  });
+
+  struct File {
+    std::vector<int> free;          // register indices, lowest last
+    std::multimap<int, int> active; // end -> temp
+    int used = 0;
+  };
+  File files[2];
+  files[0].free.resize(gpRegs);
+  files[1].free.resize(fpRegs);
+  for (File& f : files)
+    for (size_t k = 0; k < f.free.size(); ++k)
+      f.free[k] = static_cast<int>(f.free.size() - 1 - k);
+
+  std::vector<int> spill;
+  for (int t : order) {
+    if (a.cls[t] == RegClass::Vector) {
+      spill.push_back(t);
+      continue;
+    }
+    File& f = files[a.cls[t] == RegClass::Fp];
+    int s = range[t].start;
+    while (!f.active.empty() && f.active.begin()->first < s) {
+      f.free.push_back(a.reg[f.active.begin()->second]);
+      f.active.erase(f.active.begin());
+    }
+    if (!f.free.empty()) {
+      a.reg[t] = f.free.back();
+      f.free.pop_back();
+      f.used = std::max(f.used, a.reg[t] + 1);
+      f.active.emplace(range[t].end, t);
+      continue;
+    }
+    auto last = f.active.empty() ? f.active.end() : std::prev(f.active.end());
+    if (last != f.active.end() && last->first > range[t].end) {
+      int u = last->second;
+      a.reg[t] = a.reg[u];
+      a.reg[u] = -1;
+      spill.push_back(u);
+      f.active.erase(last);
+      f.active.emplace(range[t].end, t);
+    } else {
+      spill.push_back(t);
+    }
+  }
+  a.gpUsed = files[0].used;
+  a.fpUsed = files[1].used;
+
+  // Vector slots first, so all of them stay 16-byte aligned
+  std::stable_partition(spill.begin(), spill.end(), [&](int t) {
+    return a.cls[t] == RegClass::Vector;
+  });
+  for (int t : spill) {
+    a.slot[t] = a.stackBytes;
+    if (a.cls[t] == RegClass::Vector) {
+      a.stackBytes += 32;
+    } else {
+      a.stackBytes += 8;
+      ++a.spilled;
+    }
+  }
+  a.stackBytes = (a.stackBytes + 15) / 16 * 16;
+  for (size_t t = 1; t < nt; ++t)
+    if (a.reg[t] >= 0) ++a.inRegisters;
+  return a;
+}
+
+}  // namespace codegen
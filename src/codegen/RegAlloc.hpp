@@ -0,0 +1,56 @@
+/**
+ * @file RegAlloc.hpp
+ * @brief Linear-scan register allocation of IR temporaries.
+ */
+#pragma once
+#include <vector>
+
+#include "Cfg.hpp"
+#include "IR.hpp"
+#include "Liveness.hpp"
+
+namespace codegen {
+
+/**
+ * @brief Register file a temporary needs.
+ */
+enum class RegClass : unsigned char {
+  None,    ///< Temporary number not used by the code
+  Gp,      ///< int, char and bool values
+  Fp,      ///< float values
+  Vector,  ///< Results of the vector opcodes, always kept in memory
+};
+
+/**
+ * @brief Where every temporary of a function lives.
+ */
+struct Allocation {
+  std::vector<RegClass> cls;  ///< temp -> register class
+  std::vector<int> reg;       ///< temp -> register index in its class, or -1
+  std::vector<int> slot;      ///< temp -> stack byte offset when reg < 0
+  int stackBytes = 0;         ///< Stack area of the slots, a multiple of 16
+  int gpUsed = 0;             ///< Registers of each class handed out:
+  int fpUsed = 0;             ///< indices 0 .. used - 1
+  int inRegisters = 0;        ///< Temporaries given a register
+  int spilled = 0;            ///< Scalar temporaries left in a stack slot
+};
+
+/**
+ * @brief Assign registers to temporaries by linear scan.
+ *
+ * The live range of a temporary is the single interval of ir::liveRanges().
+ * Intervals are visited by start; a register is free again once the
+ * interval holding it has ended before the current one starts. When every
+ * register of the class is taken, the interval reaching furthest, the
+ * current one or an active one, goes to a stack slot for its whole
+ * lifetime (Poletto and Sarkar). Vector temporaries always get a 32-byte
+ * slot, scalar ones an 8-byte slot; slots are 16-byte aligned and not
+ * shared.
+ *
+ * @param gpRegs Registers available for RegClass::Gp, 0 to spill all.
+ * @param fpRegs Registers available for RegClass::Fp, 0 to spill all.
+ */
+Allocation linearScan(const ir::Function& fn, const ir::Cfg& cfg,
+                      const ir::Liveness& live, int gpRegs, int fpRegs);
+
+}  // namespace codegen
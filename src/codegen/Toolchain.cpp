@@ -0,0 +1,98 @@
+/**
+ * @file Toolchain.cpp
+ * @brief Running the system assembler and linker on generated code.
+ */
+#include "Toolchain.hpp"
+
+#include <dlfcn.h>
+#include <sys/wait.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#include "Elf.hpp"
+
+namespace codegen {
+
+std::string runCommand(const std::string& command) {
+  FILE* p = popen((command + " 2>&1").c_str(), "r");
+  if (!p) throw std::runtime_error("Cannot run: " + command);
+  std::string out;
+  char buf[4096];
+  for (size_t n; (n = std::fread(buf, 1, sizeof buf, p)) > 0;)
+    out.append(buf, n);
+  int status = pclose(p);
+  if (status == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    throw std::runtime_error("Command failed: " + command + "\n" + out);
+  return out;
+}
+
+bool haveTool(const std::string& tool) {
+  std::string cmd = "command -v " + tool + " >/dev/null 2>&1";
+  return std::system(cmd.c_str()) == 0;
+}
+
+int llvmVersion(const std::string& tool) {
+  // "LLVM version 14.0.6", possibly behind a vendor name
+  std::string out = runCommand(tool + " --version");
+  size_t at = out.find("LLVM version ");
+  return at == std::string::npos ? 0 : std::atoi(out.c_str() + at + 13);
+}
+
+TempDir::TempDir() {
+  std::string pattern =
+      (std::filesystem::temp_directory_path() / "sc-XXXXXX").string();
+  if (!mkdtemp(pattern.data()))
+    throw std::runtime_error("Cannot create a directory in " + pattern);
+  dir = pattern;
+}
+
+TempDir::~TempDir() {
+  std::error_code ec;
+  std::filesystem::remove_all(dir, ec);
+}
+
+std::string TempDir::write(const std::string& name,
+                           const std::string& text) const {
+  std::string path = file(name);
+  std::ofstream out(path, std::ios::binary);
+  out << text;
+  if (!out) throw std::runtime_error("Cannot write " + path);
+  return path;
+}
+
+SharedLibrary::SharedLibrary(const std::string& path) {
+  handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+  if (!handle) throw std::runtime_error(std::string("dlopen: ") + dlerror());
+}
+
+SharedLibrary::~SharedLibrary() { dlclose(handle); }
+
+void* SharedLibrary::symbol(const std::string& name) const {
+  void* sym = dlsym(handle, name.c_str());
+  if (!sym) throw std::runtime_error("No symbol " + name);
+  return sym;
+}
+
+std::string assembleShared(const TempDir& dir, const std::string& asmText,
+                           const std::string& name) {
+  std::string src = dir.write(name + ".s", asmText);
+  std::string lib = dir.file(name + ".so");
+  runCommand("cc -shared -o '" + lib + "' '" + src + "'");
+  return lib;
+}
+
+std::string linkShared(const TempDir& dir, const Object& obj,
+                       const std::string& name) {
+  std::vector<uint8_t> elf = writeElf(obj);
+  std::string o = dir.write(name + ".o", std::string(elf.begin(), elf.end()));
+  std::string lib = dir.file(name + ".so");
+  runCommand("cc -shared -o '" + lib + "' '" + o + "'");
+  return lib;
+}
+
+}  // namespace codegen
@@ -0,0 +1,101 @@
+/**
+ * @file Toolchain.hpp
+ * @brief Running the system assembler and linker on generated code.
+ */
+#pragma once
+#include <cstdint>
+#include <string>
+
+#include "Assembler.hpp"
+
+namespace codegen {
+
+/**
+ * @brief Signature of the functions the native backends generate.
+ *
+ * The function runs the program on @p frame, the variable storage laid
+ * out by symbols::Frame, and returns 0, or 1 when a check failed or an
+ * integer was divided by zero.
+ */
+using EntryPoint = int (*)(uint8_t* frame);
+
+/**
+ * @brief Run @p command through the shell.
+ * @return Its standard output and error.
+ * @throws std::runtime_error with that output if it exits with non-zero
+ * status.
+ */
+std::string runCommand(const std::string& command);
+
+/// Whether @p tool is an executable on PATH.
+bool haveTool(const std::string& tool);
+
+/**
+ * @brief Major version of LLVM tool @p tool (`llvm-as`, `opt`, `llc`), from
+ * its `--version` output; 0 if it does not say.
+ * @throws std::runtime_error if the tool cannot be run.
+ */
+int llvmVersion(const std::string& tool);
+
+/**
+ * @brief Fresh directory under the system temporary directory, removed
+ * together with its contents on destruction.
+ */
+class TempDir {
+ public:
+  TempDir();
+  ~TempDir();
+  TempDir(const TempDir&) = delete;
+  TempDir& operator=(const TempDir&) = delete;
+
+  const std::string& path() const { return dir; }
+
+  /// Path of @p name inside the directory.
+  std::string file(const std::string& name) const { return dir + "/" + name; }
+
+  /// Write @p text to @p name and return its path.
+  std::string write(const std::string& name, const std::string& text) const;
+
+ private:
+  std::string dir;
+};
+
+/**
+ * @brief Shared object loaded with dlopen() and unloaded on destruction.
+ */
+class SharedLibrary {
+ public:
+  /// @throws std::runtime_error if @p path cannot be loaded.
+  explicit SharedLibrary(const std::string& path);
+  ~SharedLibrary();
+  SharedLibrary(const SharedLibrary&) = delete;
+  SharedLibrary& operator=(const SharedLibrary&) = delete;
+
+  /// @throws std::runtime_error if the library has no such symbol.
+  void* symbol(const std::string& name) const;
+
+  EntryPoint entry(const std::string& name) const {
+    return reinterpret_cast<EntryPoint>(symbol(name));
+  }
+
+ private:
+  void* handle = nullptr;
+};
+
+/**
+ * @brief Assemble @p asmText into a shared object with the system C
+ * compiler driver (`cc -shared`).
+ * @return Path of the shared object inside @p dir.
+ */
+std::string assembleShared(const TempDir& dir, const std::string& asmText,
+                           const std::string& name = "module");
+
+/**
+ * @brief Write @p obj as an ELF object with writeElf() and link it into a
+ * shared object with `cc -shared`, leaving out the system assembler.
+ * @return Path of the shared object inside @p dir.
+ */
+std::string linkShared(const TempDir& dir, const Object& obj,
+                       const std::string& name = "module");
+
+}  // namespace codegen
@@ -0,0 +1,36 @@
+/**
+ * @file CompilerContext.cpp
+ * @brief Lexer, parser and emitter kept warm across the compilations of
+ * many small programs.
+ */
+#include "CompilerContext.hpp"
+
+#include "CEmitter.hpp"
+#include "EmitStatic.hpp"
+
+namespace driver {
+
+CompilerContext::CompilerContext()
+    : input(&buffer),
+      lexer(std::make_shared<lexer::Lexer>(input)),
+      parser(lexer) {}
+
+std::string_view CompilerContext::compile(std::string_view source,
+                                          Target target) {
+  buffer.assign(source);
+  input.clear();
+  lexer->reset();
+  parser.reset();
+  text.clear();
+  sptr<ast::Stmt> root = parser.program();
+  if (target == Target::C) {
+    codegen::COptions options;
+    options.main = true;
+    c = codegen::CEmitter(options).emit(root, parser.layout());
+    return c;
+  }
+  ast::emitStatic(*root, text);
+  return text.code();
+}
+
+}  // namespace driver
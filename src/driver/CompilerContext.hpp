@@ -0,0 +1,70 @@
+/**
+ * @file CompilerContext.hpp
+ * @brief Lexer, parser and emitter kept warm across the compilations of
+ * many small programs.
+ */
+#pragma once
+#include <istream>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <string_view>
+
+#include "Driver.hpp"
+#include "Emitter.h"
+#include "Frame.hpp"
+#include "Lexer.hpp"
+#include "Parser.hpp"
+
+namespace driver {
+
+/**
+ * @brief Compiles one in-memory program after another with the same
+ * Lexer, Parser and TextEmitter.
+ *
+ * Setting those up costs more than compiling a program of a few lines:
+ * the keyword table of the Lexer, the global scope and frame of the
+ * Parser, the output buffer and operand arena of the TextEmitter. A
+ * context builds them once; between programs it rewinds the lexer onto
+ * the next source, clears the tables and empties the buffers, which keep
+ * their memory. The source is read in place, not copied into a stream.
+ *
+ * One context serves one thread at a time; driver::compileAll() keeps one
+ * per thread of the pool.
+ */
+class CompilerContext {
+ public:
+  CompilerContext();
+  CompilerContext(const CompilerContext&) = delete;
+  CompilerContext& operator=(const CompilerContext&) = delete;
+
+  /**
+   * @brief Compile @p source, as driver::compile() does.
+   * @return The text of @p target, valid until the next call.
+   * @throws std::runtime_error on lexical, syntax and type errors; the
+   * context stays usable.
+   */
+  std::string_view compile(std::string_view source,
+                           Target target = Target::Text);
+
+  /// Variable layout of the program compiled last.
+  const symbols::Frame& layout() { return parser.layout(); }
+
+ private:
+  /// Read-only stream buffer over the current source.
+  struct SourceBuf : std::streambuf {
+    void assign(std::string_view s) {
+      char* p = const_cast<char*>(s.data());
+      setg(p, p, p + s.size());
+    }
+  };
+
+  SourceBuf buffer;
+  std::istream input;
+  std::shared_ptr<lexer::Lexer> lexer;
+  parser::Parser parser;
+  emit::TextEmitter text;
+  std::string c;
+};
+
+}  // namespace driver
@@ -0,0 +1,223 @@
+/**
+ * @file Driver.cpp
+ * @brief Batch compilation of source files on a thread pool, behind the
+ * command line of the `main` executable.
+ */
+#include "Driver.hpp"
+
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <ostream>
+#include <stdexcept>
+
+#include "CEmitter.hpp"
+#include "CompilerContext.hpp"
+#include "EmitStatic.hpp"
+#include "Emitter.h"
+#include "Parser.hpp"
+
+namespace fs = std::filesystem;
+
+namespace driver {
+
+namespace {
+
+const char* extension(Target target) {
+  return target == Target::C ? ".c" : ".txt";
+}
+
+std::string trim(const std::string& s) {
+  size_t begin = s.find_first_not_of(" \t\r");
+  if (begin == std::string::npos) return {};
+  size_t end = s.find_last_not_of(" \t\r");
+  return s.substr(begin, end - begin + 1);
+}
+
+/// Read all of @p path into @p text; false when it cannot be read.
+bool readFile(const std::string& path, std::string& text) {
+  std::ifstream in(path, std::ios::binary | std::ios::ate);
+  if (!in) return false;
+  text.resize(static_cast<size_t>(in.tellg()));
+  in.seekg(0);
+  in.read(text.data(), static_cast<std::streamsize>(text.size()));
+  return static_cast<bool>(in);
+}
+
+/// Compile @p input into @p result.output, or say why not.
+void compileFile(const std::string& input, const Options& options,
+                 Result& result) {
+  // one warm context and source buffer per thread of the pool
+  thread_local CompilerContext context;
+  thread_local std::string source;
+  if (!readFile(input, source)) {
+    result.diagnostic = input + ": cannot open";
+    return;
+  }
+  std::string_view text;
+  try {
+    text = context.compile(source, options.target);
+  } catch (const std::exception& e) {
+    result.diagnostic = input + ": " + e.what();
+    return;
+  }
+  std::string path = outputPath(input, options);
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out.write(text.data(), static_cast<std::streamsize>(text.size()));
+  out.close();
+  if (!out) {
+    result.diagnostic = input + ": cannot write " + path;
+    return;
+  }
+  result.output = std::move(path);
+}
+
+const char kUsage[] =
+    "usage: main [-j N] [-t text|c] [-o DIR] [-m MANIFEST]... FILE...\n"
+    "  -j N         compile on N threads (default: one per core)\n"
+    "  -t text|c    output pseudocode (.txt, default) or C (.c)\n"
+    "  -o DIR       write the outputs into DIR instead of next to the "
+    "inputs\n"
+    "  -m MANIFEST  also compile the files MANIFEST lists, one per line\n";
+
+}  // namespace
+
+std::vector<std::string> readManifest(const std::string& path) {
+  std::ifstream in(path);
+  if (!in) throw std::runtime_error("Cannot read manifest " + path);
+  fs::path base = fs::path(path).parent_path();
+  std::vector<std::string> inputs;
+  std::string line;
+  while (std::getline(in, line)) {
+    line = trim(line);
+    if (line.empty() || line[0] == '#') continue;
+    fs::path p(line);
+    inputs.push_back(p.is_relative() ? (base / p).string() : line);
+  }
+  return inputs;
+}
+
+std::string outputPath(const std::string& input, const Options& options) {
+  fs::path p(input);
+  p.replace_extension(extension(options.target));
+  if (!options.outDir.empty()) p = fs::path(options.outDir) / p.filename();
+  return p.string();
+}
+
+std::string compile(std::istream& source, Target target) {
+  parser::Parser p(std::make_shared<lexer::Lexer>(source));
+  sptr<ast::Stmt> root = p.program();
+  if (target == Target::C) {
+    codegen::COptions options;
+    options.main = true;
+    return codegen::CEmitter(options).emit(root, p.layout());
+  }
+  emit::TextEmitter em;
+  ast::emitStatic(*root, em);
+  return em.code();
+}
+
+std::vector<Result> compileAll(const std::vector<std::string>& inputs,
+                               const Options& options,
+                               task::ThreadPool& pool) {
+  std::map<std::string, const std::string*> writers;
+  for (const auto& input : inputs) {
+    auto out = fs::path(outputPath(input, options)).lexically_normal();
+    auto [it, fresh] = writers.emplace(out.string(), &input);
+    if (!fresh)
+      throw std::runtime_error(*it->second + " and " + input +
+                               " would both be written to " + it->first);
+  }
+  for (const auto& input : inputs) {
+    auto it = writers.find(fs::path(input).lexically_normal().string());
+    if (it != writers.end())
+      throw std::runtime_error(*it->second + " would be written over input " +
+                               input);
+  }
+  if (!options.outDir.empty()) {
+    std::error_code ec;
+    fs::create_directories(options.outDir, ec);
+    if (ec)
+      throw std::runtime_error("Cannot create " + options.outDir + ": " +
+                               ec.message());
+  }
+
+  std::vector<Result> results(inputs.size());
+  pool.parallelFor(inputs.size(), [&](size_t k) {
+    results[k].input = inputs[k];
+    compileFile(inputs[k], options, results[k]);
+  });
+  return results;
+}
+
+int run(int argc, const char* const* argv, std::ostream& out,
+        std::ostream& err) {
+  Options options;
+  unsigned threads = task::ThreadPool::defaultWorkers() + 1;
+  std::vector<std::string> inputs;
+  try {
+    for (int k = 1; k < argc; ++k) {
+      std::string arg = argv[k];
+      if (arg == "-h" || arg == "--help") {
+        out << kUsage;
+        return 0;
+      }
+      if (arg.size() < 2 || arg[0] != '-') {
+        inputs.push_back(arg);
+        continue;
+      }
+      if (arg != "-j" && arg != "-t" && arg != "-o" && arg != "-m")
+        throw std::invalid_argument("unknown option " + arg);
+      if (++k == argc) throw std::invalid_argument(arg + " needs a value");
+      std::string value = argv[k];
+      if (arg == "-j") {
+        size_t used = 0;
+        int n = 0;
+        try {
+          n = std::stoi(value, &used);
+        } catch (const std::exception&) {
+        }
+        if (used != value.size() || n < 1)
+          throw std::invalid_argument("bad thread count " + value);
+        threads = static_cast<unsigned>(n);
+      } else if (arg == "-t") {
+        if (value != "text" && value != "c")
+          throw std::invalid_argument("unknown target " + value);
+        options.target = value == "c" ? Target::C : Target::Text;
+      } else if (arg == "-o") {
+        options.outDir = value;
+      } else {
+        auto listed = readManifest(value);
+        inputs.insert(inputs.end(), listed.begin(), listed.end());
+      }
+    }
+    if (inputs.empty()) throw std::invalid_argument("no input files");
+  } catch (const std::invalid_argument& e) {
+    err << "main: " << e.what() << "\n" << kUsage;
+    return 2;
+  } catch (const std::exception& e) {
+    err << "main: " << e.what() << "\n";
+    return 2;
+  }
+
+  std::vector<Result> results;
+  try {
+    task::ThreadPool pool(threads - 1);
+    results = compileAll(inputs, options, pool);
+  } catch (const std::exception& e) {
+    err << "main: " << e.what() << "\n";
+    return 1;
+  }
+  size_t compiled = 0;
+  for (const auto& r : results) {
+    if (r.ok())
+      ++compiled;
+    else
+      err << r.diagnostic << "\n";
+  }
+  out << "compiled " << compiled << " of " << results.size() << " files\n";
+  return compiled == results.size() ? 0 : 1;
+}
+
+}  // namespace driver
@@ -0,0 +1,88 @@
+/**
+ * @file Driver.hpp
+ * @brief Batch compilation of source files on a thread pool, behind the
+ * command line of the `main` executable.
+ */
+#pragma once
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "ThreadPool.hpp"
+
+namespace driver {
+
+/// What a source file is compiled to.
+enum class Target {
+  Text,  ///< C-style pseudocode of emit::TextEmitter, `.txt`
+  C      ///< C99 with a `main` of codegen::CEmitter, `.c`
+};
+
+/**
+ * @brief Options of a batch.
+ */
+struct Options {
+  Target target = Target::Text;
+
+  /// Directory of the outputs; empty puts each next to its input.
+  std::string outDir;
+};
+
+/**
+ * @brief Outcome of one input of a batch.
+ */
+struct Result {
+  std::string input;
+  std::string output;      ///< Path written, empty on failure
+  std::string diagnostic;  ///< `input: message` on failure, else empty
+
+  bool ok() const { return diagnostic.empty(); }
+};
+
+/**
+ * @brief Paths listed in a manifest, one per line.
+ *
+ * Blank lines and lines starting with `#` are skipped, surrounding blanks
+ * trimmed; relative paths are taken relative to the manifest's directory.
+ * @throws std::runtime_error when the manifest cannot be read.
+ */
+std::vector<std::string> readManifest(const std::string& path);
+
+/// Where @p input is written to: its name with the extension of the
+/// target, in Options::outDir or next to it.
+std::string outputPath(const std::string& input, const Options& options);
+
+/**
+ * @brief Compile one program.
+ * @return The text of Options::target.
+ * @throws std::runtime_error on lexical, syntax and type errors.
+ */
+std::string compile(std::istream& source, Target target);
+
+/**
+ * @brief Compile every file of @p inputs on @p pool and write the outputs.
+ *
+ * Each file is one task; the results come back in the order of @p inputs
+ * whatever the order the tasks finished in, so diagnostics printed from
+ * them are the same from run to run.
+ * @throws std::runtime_error before compiling anything when two inputs
+ * would be written to the same output, or an output would overwrite an
+ * input.
+ */
+std::vector<Result> compileAll(const std::vector<std::string>& inputs,
+                               const Options& options,
+                               task::ThreadPool& pool);
+
+/**
+ * @brief The `main` executable:
+ * `main [-j N] [-t text|c] [-o DIR] [-m MANIFEST]... FILE...`.
+ *
+ * Diagnostics go to @p err in input order, a summary line to @p out.
+ * @return 0 when every file compiled, 1 when some did not, 2 on a bad
+ * command line.
+ */
+int run(int argc, const char* const* argv, std::ostream& out,
+        std::ostream& err);
+
+}  // namespace driver
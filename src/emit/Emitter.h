@@ -3,74 +3,234 @@
  Emitter classes
 */
 #pragma once
+#include <algorithm>
+#include <charconv>
+#include <initializer_list>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
-#include "IEmitter.hpp"
+#include "IOperandEmitter.hpp"
+#include "Sink.hpp"
+#include "Token.hpp"
 
 namespace emit {
 /*
   Generation of human-readable text(C-style pseudocode).
-  The methods for expressions return strings with ready-made code.
+  The text of each expression is kept in an arena that is reused from one
+  statement to the next, the statements are written to a Sink as they are
+  emitted. The methods are inline and the class final, so that the walk
+  of ast/EmitStatic.hpp inlines them.
 */
-struct TextEmitter : IEmitter {
+struct TextEmitter final : IOperandEmitter {
+  /// Emit into memory, see code()
+  TextEmitter() : out(&own) {}
+
+  /// Emit into @p out
+  explicit TextEmitter(Sink& out) : out(&out) {}
+
+  TextEmitter(const TextEmitter&) = delete;
+  TextEmitter& operator=(const TextEmitter&) = delete;
+
+  /// Text emitted so far into memory.
+  /// @throws std::runtime_error when emitting into another sink.
+  const std::string& code();
+
+  /// Start over for another program: drop the text emitted into memory
+  /// and the operands of an unfinished statement, keeping the buffers.
+  void clear() {
+    done();
+    if (out == &own) own.clear();
+  }
+
+  /// Text of an operand of the current statement.
+  std::string_view text(Operand op) const {
+    const auto& [start, size] = spans[op.id];
+    return std::string_view(arena.data() + start, size);
+  }
+
   /* Expressions */
 
-  /// \copydoc IEmitter::emitLoadConst
-  std::string emitLoadConst(const sptr<lexer::Token>& value) override;
+  /// \copydoc IOperandEmitter::emitLoadConst
+  Operand emitLoadConst(const lexer::Token& value) override;
 
-  /// \copydoc IEmitter::emitUnaryOp
-  std::string emitUnaryOp(const sptr<lexer::Token>& op,
-                          const std::string& operand) override;
+  /// \copydoc IOperandEmitter::emitUnaryOp
+  Operand emitUnaryOp(const lexer::Token& op, Operand operand) override;
 
-  /// \copydoc IEmitter::emitBinaryOp
-  std::string emitBinaryOp(const std::string& lhs, const sptr<lexer::Token>& op,
-                           const std::string& rhs) override;
+  /// \copydoc IOperandEmitter::emitBinaryOp
+  Operand emitBinaryOp(Operand lhs, const lexer::Token& op,
+                       Operand rhs) override;
 
-  /// \copydoc IEmitter::emitArrayAccess
-  std::string emitArrayAccess(const std::string& arr,
-                              const std::string& idx) override;
+  /// \copydoc IOperandEmitter::emitArrayAccess
+  Operand emitArrayAccess(Operand arr, Operand idx) override;
 
-  /// \copydoc IEmitter::emitTemp
-  std::string emitTemp(int number) override;
+  /// \copydoc IOperandEmitter::emitTemp
+  Operand emitTemp(int number) override;
 
-  /// \copydoc IEmitter::emitIdentifier
-  std::string emitIdentifier(const std::string& name, int offset = 0) override;
+  /// \copydoc IOperandEmitter::emitIdentifier
+  Operand emitIdentifier(std::string_view name, int offset = 0) override;
 
   /*-------------------------------------------------------------------------*/
 
   /* Statements */
-  std::string code;
 
-  /// \copydoc IEmitter::emitIf
-  void emitIf(const std::string& cond,
-              const std::function<void()>& thenBlock) override;
+  /// Print `while` as a guarded `do`-`while`, the shape of a rotated loop:
+  /// one test per iteration, at the bottom.
+  bool rotateLoops = false;
 
-  /// \copydoc IEmitter::emitIfElse
-  void emitIfElse(const std::string& cond,
-                  const std::function<void()>& thenBlock,
-                  const std::function<void()>& elseBlock) override;
+  /// \copydoc IOperandEmitter::emitIf
+  void emitIf(Operand cond, FunctionRef<void()> thenBlock) override;
 
-  /// \copydoc IEmitter::emitWhile
-  void emitWhile(const std::function<std::string()>& condGen,
-                 const std::function<void()>& bodyGen) override;
+  /// \copydoc IOperandEmitter::emitIfElse
+  void emitIfElse(Operand cond, FunctionRef<void()> thenBlock,
+                  FunctionRef<void()> elseBlock) override;
 
-  /// \copydoc IEmitter::emitDoWhile
-  void emitDoWhile(const std::function<void()>& bodyGen,
-                   const std::function<std::string()>& condGen) override;
+  /// \copydoc IOperandEmitter::emitWhile
+  void emitWhile(FunctionRef<Operand()> condGen,
+                 FunctionRef<void()> bodyGen) override;
 
-  /// \copydoc IEmitter::emitBreak
+  /// \copydoc IOperandEmitter::emitDoWhile
+  void emitDoWhile(FunctionRef<void()> bodyGen,
+                   FunctionRef<Operand()> condGen) override;
+
+  /// \copydoc IOperandEmitter::emitBreak
   void emitBreak() override;
 
-  /// \copydoc IEmitter::emitAssign
-  void emitAssign(const std::string& target, const std::string& value) override;
+  /// \copydoc IOperandEmitter::emitAssign
+  void emitAssign(Operand target, Operand value) override;
 
-  /// \copydoc IEmitter::emitArrayAssign
-  void emitArrayAssign(const std::string& arr, const std::string& idx,
-                       const std::string& value) override;
+  /// \copydoc IOperandEmitter::emitArrayAssign
+  void emitArrayAssign(Operand arr, Operand idx, Operand value) override;
 
   /*-------------------------------------------------------------------------*/
+
+ private:
+  StringSink own;
+  Sink* out;
+
+  /// Text of the operands of the current statement
+  std::string arena;
+  std::vector<std::pair<uint32_t, uint32_t>> spans;
+
+  /// Operand whose text is @p parts joined
+  Operand make(Operand::Kind kind,
+               std::initializer_list<std::string_view> parts);
+
+  /// The statement is written, its operands may go
+  void done() {
+    arena.clear();
+    spans.clear();
+  }
 };
 
-// TODO AsmEmitter
-// TODO IRBuilderEmitter (LLVM IR)
+inline Operand TextEmitter::make(
+    Operand::Kind kind, std::initializer_list<std::string_view> parts) {
+  size_t size = 0;
+  for (auto p : parts) size += p.size();
+  size_t start = arena.size();
+  if (start + size > arena.capacity()) {
+    // the parts may point into the arena, so grow into a new one
+    std::string grown;
+    grown.reserve(std::max(2 * arena.capacity(), start + size));
+    grown.append(arena);
+    for (auto p : parts) grown.append(p);
+    arena.swap(grown);
+  } else {
+    for (auto p : parts) arena.append(p);
+  }
+  spans.emplace_back(static_cast<uint32_t>(start), static_cast<uint32_t>(size));
+  return {kind, static_cast<uint32_t>(spans.size() - 1)};
+}
+
+/* Expressions */
+inline Operand TextEmitter::emitLoadConst(const lexer::Token& value) {
+  return make(Operand::Kind::Const, {value.lexeme});
+}
+
+inline Operand TextEmitter::emitUnaryOp(const lexer::Token& op,
+                                        Operand operand) {
+  return make(Operand::Kind::Temp, {op.lexeme, text(operand)});
+}
+
+inline Operand TextEmitter::emitBinaryOp(Operand lhs, const lexer::Token& op,
+                                         Operand rhs) {
+  return make(Operand::Kind::Temp,
+              {text(lhs), " ", op.lexeme, " ", text(rhs)});
+}
+
+inline Operand TextEmitter::emitArrayAccess(Operand arr, Operand idx) {
+  return make(Operand::Kind::Slot, {text(arr), "[", text(idx), "]"});
+}
+
+inline Operand TextEmitter::emitTemp(int number) {
+  char digits[16];
+  auto res = std::to_chars(digits, digits + sizeof digits, number);
+  return make(Operand::Kind::Temp,
+              {"t", std::string_view(digits, res.ptr - digits)});
+}
+
+inline Operand TextEmitter::emitIdentifier(std::string_view name,
+                                           int /*offset*/) {
+  return make(Operand::Kind::Slot, {name});
+}
+/*-------------------------------------------------------------------------*/
+
+/* Statements */
+inline void TextEmitter::emitIf(Operand cond, FunctionRef<void()> thenBlock) {
+  out->format("if ({}) {{\n", text(cond));
+  done();
+  thenBlock();
+  out->put("}\n");
+}
+
+inline void TextEmitter::emitIfElse(Operand cond, FunctionRef<void()> thenBlock,
+                                    FunctionRef<void()> elseBlock) {
+  out->format("if ({}) {{\n", text(cond));
+  done();
+  thenBlock();
+  out->put("} else {\n");
+  elseBlock();
+  out->put("}\n");
+}
+
+inline void TextEmitter::emitWhile(FunctionRef<Operand()> condGen,
+                                   FunctionRef<void()> bodyGen) {
+  if (rotateLoops) {
+    out->format("if ({}) {{\n", text(condGen()));
+    done();
+    emitDoWhile(bodyGen, condGen);
+    out->put("}\n");
+    return;
+  }
+  out->format("while ({}) {{\n", text(condGen()));
+  done();
+  bodyGen();
+  out->put("}\n");
+}
+
+inline void TextEmitter::emitDoWhile(FunctionRef<void()> bodyGen,
+                                     FunctionRef<Operand()> condGen) {
+  out->put("do {\n");
+  bodyGen();
+  out->format("}} while ({});\n", text(condGen()));
+  done();
+}
+
+inline void TextEmitter::emitBreak() { out->put("break;\n"); }
+
+inline void TextEmitter::emitAssign(Operand target, Operand value) {
+  out->format("{} = {};\n", text(target), text(value));
+  done();
+}
+
+inline void TextEmitter::emitArrayAssign(Operand arr, Operand idx,
+                                         Operand value) {
+  out->format("{}[{}] = {};\n", text(arr), text(idx), text(value));
+  done();
+}
+/*-------------------------------------------------------------------------*/
+
+// Native code is generated from the IR, see codegen/AsmEmitter.hpp
+// LLVM IR is written from the typed AST, see codegen/LlvmEmitter.hpp
 }  // namespace emit
@@ -0,0 +1,47 @@
+/**
+ * @file FunctionRef.hpp
+ * @brief Non-owning reference to a callable.
+ */
+#pragma once
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace emit {
+
+template <typename Fn>
+class FunctionRef;
+
+/**
+ * @brief Callable @p F referenced by pointer, two words wide.
+ *
+ * Unlike std::function it never allocates and never copies the callable,
+ * so it must not outlive it: meant for parameters called before the
+ * function taking them returns, such as the blocks of
+ * IOperandEmitter::emitIf.
+ */
+template <typename R, typename... Args>
+class FunctionRef<R(Args...)> {
+ public:
+  template <typename F,
+            typename = std::enable_if_t<
+                !std::is_same_v<std::decay_t<F>, FunctionRef> &&
+                std::is_invocable_r_v<R, F&, Args...>>>
+  FunctionRef(F&& f)  // NOLINT: implicit, like std::function
+      : callable(const_cast<void*>(
+            static_cast<const void*>(std::addressof(f)))),
+        invoke([](void* c, Args... args) -> R {
+          return (*static_cast<std::remove_reference_t<F>*>(c))(
+              std::forward<Args>(args)...);
+        }) {}
+
+  R operator()(Args... args) const {
+    return invoke(callable, std::forward<Args>(args)...);
+  }
+
+ private:
+  void* callable;
+  R (*invoke)(void*, Args...);
+};
+
+}  // namespace emit
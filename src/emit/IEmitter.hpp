@@ -37,6 +37,15 @@ struct IEmitter {
                                    const sptr<lexer::Token>& op,
                                    const std::string& rhs) = 0;
 
+  /// Short-circuit && / ||: @p rhsGen generates the right operand and is
+  /// meant to run only where its value is needed. The default evaluates it
+  /// eagerly and emits a plain binary operator.
+  virtual std::string emitLogicalOp(
+      const std::string& lhs, const sptr<lexer::Token>& op,
+      const std::function<std::string()>& rhsGen) {
+    return emitBinaryOp(lhs, op, rhsGen());
+  }
+
   /// Array access operator
   virtual std::string emitArrayAccess(const std::string& arr,
                                       const std::string& idx) = 0;
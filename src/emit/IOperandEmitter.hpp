@@ -0,0 +1,112 @@
+/**
+ * @file IOperandEmitter.hpp
+ * @brief Emitter interface with operand handles instead of strings.
+ */
+#pragma once
+#include <cstdint>
+#include <string_view>
+
+#include "FunctionRef.hpp"
+
+/* Forward declarations */
+namespace lexer {
+struct Token;
+}  // namespace lexer
+
+namespace emit {
+
+/**
+ * @brief Result of an expression as an emitter hands it back to the AST.
+ *
+ * A plain value: the AST only passes operands from one call of
+ * IOperandEmitter to the next, the emitter decides what @ref id means
+ * (the number of a temporary, the offset of a variable, an index into a
+ * table of its own).
+ */
+struct Operand {
+  enum class Kind : uint8_t {
+    None,   ///< No value
+    Temp,   ///< Computed value or ast::Temp
+    Slot,   ///< Variable or array element
+    Const,  ///< Literal
+  };
+
+  Kind kind = Kind::None;
+  uint32_t id = 0;
+
+  bool operator==(const Operand& o) const {
+    return kind == o.kind && id == o.id;
+  }
+  bool operator!=(const Operand& o) const { return !(*this == o); }
+};
+
+/**
+ * @brief Second generation of IEmitter: expressions return Operand
+ * handles and blocks are FunctionRef, so walking the AST allocates
+ * nothing itself.
+ *
+ * The calls and their order are the ones IEmitter gets, see ast::Expr::emit
+ * and ast::Stmt::emit. Operands stay valid until the statement using them
+ * has been emitted: an emitter may reuse their storage once it starts the
+ * next statement, including the first statement of a block.
+ */
+struct IOperandEmitter {
+  virtual ~IOperandEmitter() = default;
+
+  /* Expressions */
+
+  /// \copydoc IEmitter::emitLoadConst
+  virtual Operand emitLoadConst(const lexer::Token& tok) = 0;
+
+  /// \copydoc IEmitter::emitUnaryOp
+  virtual Operand emitUnaryOp(const lexer::Token& op, Operand operand) = 0;
+
+  /// \copydoc IEmitter::emitBinaryOp
+  virtual Operand emitBinaryOp(Operand lhs, const lexer::Token& op,
+                               Operand rhs) = 0;
+
+  /// \copydoc IEmitter::emitLogicalOp
+  virtual Operand emitLogicalOp(Operand lhs, const lexer::Token& op,
+                                FunctionRef<Operand()> rhsGen) {
+    return emitBinaryOp(lhs, op, rhsGen());
+  }
+
+  /// \copydoc IEmitter::emitArrayAccess
+  virtual Operand emitArrayAccess(Operand arr, Operand idx) = 0;
+
+  /// \copydoc IEmitter::emitTemp
+  virtual Operand emitTemp(int number) = 0;
+
+  /// \copydoc IEmitter::emitIdentifier
+  virtual Operand emitIdentifier(std::string_view name, int offset = 0) = 0;
+
+  /*-------------------------------------------------------------------------*/
+
+  /* Statements */
+
+  /// \copydoc IEmitter::emitIf
+  virtual void emitIf(Operand cond, FunctionRef<void()> thenBlock) = 0;
+
+  /// \copydoc IEmitter::emitIfElse
+  virtual void emitIfElse(Operand cond, FunctionRef<void()> thenBlock,
+                          FunctionRef<void()> elseBlock) = 0;
+
+  /// \copydoc IEmitter::emitWhile
+  virtual void emitWhile(FunctionRef<Operand()> condGen,
+                         FunctionRef<void()> bodyGen) = 0;
+
+  /// \copydoc IEmitter::emitDoWhile
+  virtual void emitDoWhile(FunctionRef<void()> bodyGen,
+                           FunctionRef<Operand()> condGen) = 0;
+
+  /// \copydoc IEmitter::emitBreak
+  virtual void emitBreak() = 0;
+
+  /// \copydoc IEmitter::emitAssign
+  virtual void emitAssign(Operand target, Operand value) = 0;
+
+  /// \copydoc IEmitter::emitArrayAssign
+  virtual void emitArrayAssign(Operand arr, Operand idx, Operand value) = 0;
+  /*-------------------------------------------------------------------------*/
+};
+}  // namespace emit
@@ -0,0 +1,92 @@
+/**
+ * @file Sink.cpp
+ * @brief Buffered output sinks the emitters write text into.
+ */
+#include "Sink.hpp"
+
+#include <unistd.h>
+
+#include <cerrno>
+#include <system_error>
+
+namespace emit {
+
+Sink::Sink(size_t capacity)
+    : buffer(new char[capacity ? capacity : 1]),
+      capacity(capacity ? capacity : 1) {}
+
+void Sink::flush() {
+  if (used == 0) return;
+  size_t n = used;
+  used = 0;
+  write(buffer.get(), n);
+  flushed += n;
+}
+
+void Sink::putSlow(std::string_view s) {
+  flush();
+  if (s.size() >= capacity) {
+    write(s.data(), s.size());
+    flushed += s.size();
+    return;
+  }
+  std::memcpy(buffer.get(), s.data(), s.size());
+  used = s.size();
+}
+
+std::string_view Sink::literal(std::string_view fmt, bool& found) {
+  size_t start = 0;
+  for (size_t k = 0; k < fmt.size(); ++k) {
+    char c = fmt[k];
+    if (c != '{' && c != '}') continue;
+    put(fmt.substr(start, k - start));
+    if (c == '{' && k + 1 < fmt.size() && fmt[k + 1] == '}') {
+      found = true;
+      return fmt.substr(k + 2);
+    }
+    if (k + 1 < fmt.size() && fmt[k + 1] == c) {
+      put(c);
+      start = ++k + 1;
+      continue;
+    }
+    throw std::runtime_error("Unmatched brace in format");
+  }
+  put(fmt.substr(start));
+  found = false;
+  return {};
+}
+
+FdSink::~FdSink() {
+  try {
+    flush();
+  } catch (const std::exception&) {
+    // nowhere to report a failed write from a destructor
+  }
+}
+
+void FdSink::write(const char* data, size_t n) {
+  while (n > 0) {
+    ssize_t w = ::write(fd, data, n);
+    if (w < 0) {
+      if (errno == EINTR) continue;
+      throw std::system_error(errno, std::generic_category(), "write");
+    }
+    data += w;
+    n -= static_cast<size_t>(w);
+  }
+}
+
+StreamSink::~StreamSink() {
+  try {
+    flush();
+  } catch (const std::exception&) {
+    // nowhere to report a failed write from a destructor
+  }
+}
+
+void StreamSink::write(const char* data, size_t n) {
+  os.write(data, static_cast<std::streamsize>(n));
+  if (!os) throw std::runtime_error("Write to output stream failed");
+}
+
+}  // namespace emit
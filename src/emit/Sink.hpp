@@ -0,0 +1,184 @@
+/**
+ * @file Sink.hpp
+ * @brief Buffered output sinks the emitters write text into.
+ */
+#pragma once
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace emit {
+
+/**
+ * @brief Fixed-size buffer in front of an output, see FdSink, StreamSink
+ * and StringSink.
+ *
+ * Text goes into the buffer with no intermediate strings: append() takes
+ * any mix of strings, characters and integers, format() fills `{}`
+ * placeholders (`{{` and `}}` are literal braces). The buffer is handed
+ * to write() when it fills up, on flush() and when the sink is destroyed;
+ * pieces larger than the buffer bypass it.
+ */
+class Sink {
+ public:
+  static constexpr size_t kDefaultCapacity = 64 * 1024;
+
+  explicit Sink(size_t capacity = kDefaultCapacity);
+  virtual ~Sink() = default;
+  Sink(const Sink&) = delete;
+  Sink& operator=(const Sink&) = delete;
+
+  Sink& put(std::string_view s) {
+    if (s.size() <= capacity - used) {
+      std::memcpy(buffer.get() + used, s.data(), s.size());
+      used += s.size();
+    } else {
+      putSlow(s);
+    }
+    return *this;
+  }
+
+  Sink& put(char c) {
+    if (used == capacity) flush();
+    buffer[used++] = c;
+    return *this;
+  }
+
+  template <typename T,
+            typename = std::enable_if_t<std::is_integral_v<T> &&
+                                        !std::is_same_v<T, char> &&
+                                        !std::is_same_v<T, bool>>>
+  Sink& put(T value) {
+    char digits[24];
+    auto res = std::to_chars(digits, digits + sizeof digits, value);
+    return put(std::string_view(digits, res.ptr - digits));
+  }
+
+  /// All of @p args, in order.
+  template <typename... Args>
+  Sink& append(const Args&... args) {
+    (put(args), ...);
+    return *this;
+  }
+
+  /// @p fmt with each `{}` replaced by the next of @p args.
+  /// @throws std::runtime_error when placeholders and arguments differ in
+  /// number; the text before the mismatch is written.
+  template <typename... Args>
+  Sink& format(std::string_view fmt, const Args&... args) {
+    formatNext(fmt, args...);
+    return *this;
+  }
+
+  /// Hand everything buffered to the output.
+  void flush();
+
+  /// Bytes written to the sink so far, buffered or not.
+  uint64_t size() const { return flushed + used; }
+
+ protected:
+  /// Write @p n bytes to the output.
+  virtual void write(const char* data, size_t n) = 0;
+
+  /// Drop what is buffered and start counting size() from zero.
+  void discard() {
+    used = 0;
+    flushed = 0;
+  }
+
+ private:
+  std::unique_ptr<char[]> buffer;
+  size_t capacity;
+  size_t used = 0;
+  uint64_t flushed = 0;
+
+  void putSlow(std::string_view s);
+
+  /// Write @p fmt up to its first placeholder; the rest of @p fmt after
+  /// it, or an empty view with @p found false when there is none.
+  std::string_view literal(std::string_view fmt, bool& found);
+
+  void formatNext(std::string_view fmt) {
+    bool found;
+    literal(fmt, found);
+    if (found) throw std::runtime_error("Too few arguments for format");
+  }
+
+  template <typename T, typename... Rest>
+  void formatNext(std::string_view fmt, const T& first, const Rest&... rest) {
+    bool found;
+    std::string_view tail = literal(fmt, found);
+    if (!found) throw std::runtime_error("Too many arguments for format");
+    put(first);
+    formatNext(tail, rest...);
+  }
+};
+
+/**
+ * @brief Sink writing to a file descriptor, which it does not close.
+ */
+class FdSink : public Sink {
+ public:
+  explicit FdSink(int fd, size_t capacity = kDefaultCapacity)
+      : Sink(capacity), fd(fd) {}
+  ~FdSink() override;
+
+ protected:
+  /// @throws std::runtime_error when write(2) fails.
+  void write(const char* data, size_t n) override;
+
+ private:
+  int fd;
+};
+
+/**
+ * @brief Sink writing to a std::ostream.
+ */
+class StreamSink : public Sink {
+ public:
+  explicit StreamSink(std::ostream& os, size_t capacity = kDefaultCapacity)
+      : Sink(capacity), os(os) {}
+  ~StreamSink() override;
+
+ protected:
+  /// @throws std::runtime_error when the stream goes bad.
+  void write(const char* data, size_t n) override;
+
+ private:
+  std::ostream& os;
+};
+
+/**
+ * @brief Sink collecting everything in memory.
+ */
+class StringSink : public Sink {
+ public:
+  explicit StringSink(size_t capacity = kDefaultCapacity) : Sink(capacity) {}
+
+  /// Everything written so far.
+  const std::string& str() {
+    flush();
+    return text;
+  }
+
+  /// Start over empty, keeping the memory for the next text.
+  void clear() {
+    discard();
+    text.clear();
+  }
+
+ protected:
+  void write(const char* data, size_t n) override { text.append(data, n); }
+
+ private:
+  std::string text;
+};
+
+}  // namespace emit
@@ -0,0 +1,189 @@
+/**
+ * @file Cfg.cpp
+ * @brief Control flow graph, dominators and natural loops of a Function.
+ */
+#include "Cfg.hpp"
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace ir {
+
+Cfg::Cfg(const Function& fn) {
+  const auto& code = fn.code;
+  int n = static_cast<int>(code.size());
+  blockOf.assign(n, -1);
+  if (n == 0) {
+    blocks.emplace_back();
+    return;
+  }
+
+  // Leaders: first instruction, labels, instructions following a jump.
+  std::vector<bool> leader(n, false);
+  leader[0] = true;
+  for (int i = 0; i < n; ++i) {
+    if (code[i].op == Opcode::Label) leader[i] = true;
+    if (code[i].isJump() && i + 1 < n) leader[i + 1] = true;
+  }
+
+  std::unordered_map<int, int> labelBlock;
+  for (int i = 0; i < n; ++i) {
+    if (leader[i]) {
+      if (!blocks.empty()) blocks.back().end = i;
+      blocks.emplace_back();
+      blocks.back().begin = i;
+    }
+    blockOf[i] = static_cast<int>(blocks.size()) - 1;
+    if (code[i].op == Opcode::Label) labelBlock[code[i].label] = blockOf[i];
+  }
+  blocks.back().end = n;
+
+  int nb = static_cast<int>(blocks.size());
+  for (int b = 0; b < nb; ++b) {
+    const Instr& last = code[blocks[b].end - 1];
+    if (last.isJump()) blocks[b].succs.push_back(labelBlock.at(last.label));
+    if (last.op != Opcode::Jump && b + 1 < nb) {
+      if (std::find(blocks[b].succs.begin(), blocks[b].succs.end(), b + 1) ==
+          blocks[b].succs.end())
+        blocks[b].succs.push_back(b + 1);
+    }
+    for (int s : blocks[b].succs) blocks[s].preds.push_back(b);
+  }
+}
+
+std::vector<int> Cfg::reversePostOrder() const {
+  std::vector<int> order;
+  std::vector<char> seen(blocks.size(), 0);
+  // iterative DFS: (block, next successor index)
+  std::vector<std::pair<int, size_t>> stack{{0, 0}};
+  seen[0] = 1;
+  while (!stack.empty()) {
+    auto& [b, i] = stack.back();
+    if (i < blocks[b].succs.size()) {
+      int s = blocks[b].succs[i++];
+      if (!seen[s]) {
+        seen[s] = 1;
+        stack.push_back({s, 0});
+      }
+    } else {
+      order.push_back(b);
+      stack.pop_back();
+    }
+  }
+  std::reverse(order.begin(), order.end());
+  return order;
+}
+
+DominatorTree::DominatorTree(const Cfg& cfg) {
+  int nb = static_cast<int>(cfg.blocks.size());
+  idom.assign(nb, -1);
+  rpoIndex.assign(nb, -1);
+  std::vector<int> rpo = cfg.reversePostOrder();
+  for (size_t i = 0; i < rpo.size(); ++i) rpoIndex[rpo[i]] = static_cast<int>(i);
+
+  auto intersect = [&](int a, int b) {
+    while (a != b) {
+      while (rpoIndex[a] > rpoIndex[b]) a = idom[a];
+      while (rpoIndex[b] > rpoIndex[a]) b = idom[b];
+    }
+    return a;
+  };
+
+  idom[0] = 0;
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (size_t i = 1; i < rpo.size(); ++i) {
+      int b = rpo[i];
+      int newIdom = -1;
+      for (int p : cfg.blocks[b].preds) {
+        if (idom[p] < 0) continue;
+        newIdom = newIdom < 0 ? p : intersect(p, newIdom);
+      }
+      if (newIdom != idom[b]) {
+        idom[b] = newIdom;
+        changed = true;
+      }
+    }
+  }
+  idom[0] = -1;
+}
+
+bool DominatorTree::dominates(int a, int b) const {
+  if (rpoIndex[b] < 0) return false;
+  while (b >= 0) {
+    if (a == b) return true;
+    b = idom[b];
+  }
+  return false;
+}
+
+bool Loop::contains(int block) const {
+  return std::binary_search(blocks.begin(), blocks.end(), block);
+}
+
+LoopInfo::LoopInfo(const Cfg& cfg, const DominatorTree& dom) {
+  int nb = static_cast<int>(cfg.blocks.size());
+  std::unordered_map<int, size_t> byHeader;
+
+  for (int b = 0; b < nb; ++b) {
+    for (int h : cfg.blocks[b].succs) {
+      if (!dom.dominates(h, b)) continue;  // not a back edge
+      auto it = byHeader.find(h);
+      if (it == byHeader.end()) {
+        it = byHeader.emplace(h, loops.size()).first;
+        loops.emplace_back();
+        loops.back().header = h;
+      }
+      Loop& loop = loops[it->second];
+      loop.latches.push_back(b);
+
+      // walk predecessors backwards from the latch up to the header
+      std::vector<char> in(nb, 0);
+      for (int x : loop.blocks) in[x] = 1;
+      in[h] = 1;
+      std::vector<int> work;
+      if (!in[b]) {
+        in[b] = 1;
+        work.push_back(b);
+      }
+      while (!work.empty()) {
+        int x = work.back();
+        work.pop_back();
+        for (int p : cfg.blocks[x].preds)
+          if (!in[p]) {
+            in[p] = 1;
+            work.push_back(p);
+          }
+      }
+      loop.blocks.clear();
+      for (int x = 0; x < nb; ++x)
+        if (in[x]) loop.blocks.push_back(x);
+    }
+  }
+
+  for (Loop& loop : loops)
+    for (int b : loop.blocks)
+      for (int s : cfg.blocks[b].succs)
+        if (!loop.contains(s)) {
+          loop.exits.push_back(b);
+          break;
+        }
+
+  // innermost first: smaller loops cannot contain larger ones
+  std::sort(loops.begin(), loops.end(), [](const Loop& a, const Loop& b) {
+    return a.blocks.size() < b.blocks.size();
+  });
+  for (size_t i = 0; i < loops.size(); ++i) {
+    for (size_t j = i + 1; j < loops.size(); ++j) {
+      if (loops[j].contains(loops[i].header)) {
+        loops[i].parent = static_cast<int>(j);
+        break;
+      }
+    }
+  }
+  for (size_t i = loops.size(); i-- > 0;)
+    if (loops[i].parent >= 0) loops[i].depth = loops[loops[i].parent].depth + 1;
+}
+
+}  // namespace ir
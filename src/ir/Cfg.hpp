@@ -0,0 +1,82 @@
+/**
+ * @file Cfg.hpp
+ * @brief Control flow graph, dominators and natural loops of a Function.
+ */
+#pragma once
+#include <vector>
+
+#include "IR.hpp"
+
+namespace ir {
+
+/**
+ * @brief Maximal straight-line run of instructions `[begin, end)`.
+ */
+struct BasicBlock {
+  int begin = 0;
+  int end = 0;
+  std::vector<int> succs;
+  std::vector<int> preds;
+};
+
+/**
+ * @brief Control flow graph over the instruction list of a Function.
+ *
+ * Blocks are numbered in code order; block 0 is the entry. A block starts
+ * at a label or after a jump. The graph refers to instruction indices, so
+ * it must be rebuilt after the code is edited.
+ */
+struct Cfg {
+  std::vector<BasicBlock> blocks;
+  std::vector<int> blockOf;  ///< instruction index -> block
+
+  explicit Cfg(const Function& fn);
+
+  /// Blocks in reverse post-order from the entry (unreachable ones omitted).
+  std::vector<int> reversePostOrder() const;
+};
+
+/**
+ * @brief Immediate dominators, computed with the Cooper-Harvey-Kennedy
+ * iterative algorithm.
+ */
+struct DominatorTree {
+  std::vector<int> idom;  ///< -1 for the entry and unreachable blocks
+
+  explicit DominatorTree(const Cfg& cfg);
+
+  /// True if block @p a dominates block @p b.
+  bool dominates(int a, int b) const;
+
+ private:
+  std::vector<int> rpoIndex;
+};
+
+/**
+ * @brief A natural loop: header plus every block that reaches a back edge
+ * without passing through the header.
+ */
+struct Loop {
+  int header = 0;
+  std::vector<int> blocks;   ///< Sorted, header included
+  std::vector<int> latches;  ///< Sources of back edges
+  std::vector<int> exits;    ///< Blocks inside with a successor outside
+  int parent = -1;           ///< Innermost enclosing loop
+  int depth = 1;
+
+  bool contains(int block) const;
+};
+
+/**
+ * @brief All natural loops of a Cfg; loops sharing a header are merged.
+ *
+ * Loops are ordered innermost first, so transforming them in order handles
+ * nested loops before the loops around them.
+ */
+struct LoopInfo {
+  std::vector<Loop> loops;
+
+  LoopInfo(const Cfg& cfg, const DominatorTree& dom);
+};
+
+}  // namespace ir
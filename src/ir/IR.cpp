@@ -0,0 +1,222 @@
+/**
+ * @file IR.cpp
+ * @brief Operand helpers and text form of the intermediate representation.
+ */
+#include "IR.hpp"
+
+#include <sstream>
+
+namespace ir {
+
+Operand Operand::constInt(int64_t v, sptr<symbols::Type> t) {
+  Operand o;
+  o.kind = Kind::Const;
+  o.type = std::move(t);
+  o.ival = v;
+  return o;
+}
+
+Operand Operand::constFloat(double v) {
+  Operand o;
+  o.kind = Kind::Const;
+  o.type = symbols::Type::Float;
+  o.fval = v;
+  return o;
+}
+
+Operand Operand::variable(const symbols::Id* id) {
+  Operand o;
+  o.kind = Kind::Var;
+  o.type = id->type;
+  o.var = id;
+  return o;
+}
+
+Operand Operand::temporary(int n, sptr<symbols::Type> t) {
+  Operand o;
+  o.kind = Kind::Temp;
+  o.type = std::move(t);
+  o.temp = n;
+  return o;
+}
+
+bool Operand::same(const Operand& o) const {
+  if (kind != o.kind) return false;
+  switch (kind) {
+    case Kind::None:
+      return true;
+    case Kind::Var:
+      return var == o.var;
+    case Kind::Temp:
+      return temp == o.temp;
+    case Kind::Const:
+      return type == o.type && ival == o.ival && fval == o.fval;
+  }
+  return false;
+}
+
+const char* opcodeName(Opcode op) {
+  switch (op) {
+    case Opcode::Copy: return "copy";
+    case Opcode::Add: return "+";
+    case Opcode::Sub: return "-";
+    case Opcode::Mul: return "*";
+    case Opcode::Div: return "/";
+    case Opcode::Neg: return "-";
+    case Opcode::Not: return "!";
+    case Opcode::Lt: return "<";
+    case Opcode::Le: return "<=";
+    case Opcode::Gt: return ">";
+    case Opcode::Ge: return ">=";
+    case Opcode::Eq: return "==";
+    case Opcode::Ne: return "!=";
+    case Opcode::And: return "&&";
+    case Opcode::Or: return "||";
+    case Opcode::Cvt: return "cvt";
+    case Opcode::Load: return "load";
+    case Opcode::Store: return "store";
+    case Opcode::Check: return "check";
+    case Opcode::VSplat: return "vsplat";
+    case Opcode::VLoad: return "vload";
+    case Opcode::VStore: return "vstore";
+    case Opcode::VAdd: return "v+";
+    case Opcode::VSub: return "v-";
+    case Opcode::VMul: return "v*";
+    case Opcode::VDiv: return "v/";
+    case Opcode::VNeg: return "v-";
+    case Opcode::Label: return "label";
+    case Opcode::Jump: return "goto";
+    case Opcode::JumpIf: return "if";
+    case Opcode::JumpIfNot: return "iffalse";
+    case Opcode::JumpLt: return "<";
+    case Opcode::JumpLe: return "<=";
+    case Opcode::JumpGt: return ">";
+    case Opcode::JumpGe: return ">=";
+    case Opcode::JumpEq: return "==";
+    case Opcode::JumpNe: return "!=";
+  }
+  return "?";
+}
+
+Opcode compareJump(Opcode rel) {
+  return static_cast<Opcode>(static_cast<int>(Opcode::JumpLt) +
+                             static_cast<int>(rel) -
+                             static_cast<int>(Opcode::Lt));
+}
+
+Opcode compareOf(Opcode jump) {
+  return static_cast<Opcode>(static_cast<int>(Opcode::Lt) +
+                             static_cast<int>(jump) -
+                             static_cast<int>(Opcode::JumpLt));
+}
+
+Opcode negate(Opcode rel) {
+  switch (rel) {
+    case Opcode::Lt: return Opcode::Ge;
+    case Opcode::Le: return Opcode::Gt;
+    case Opcode::Gt: return Opcode::Le;
+    case Opcode::Ge: return Opcode::Lt;
+    case Opcode::Eq: return Opcode::Ne;
+    default: return Opcode::Eq;
+  }
+}
+
+int64_t wrap(int64_t v, const sptr<symbols::Type>& t) {
+  if (t == symbols::Type::Bool) return v != 0;
+  if (t == symbols::Type::Char) return static_cast<int8_t>(v);
+  return static_cast<int32_t>(v);
+}
+
+std::string toString(const Operand& o) {
+  switch (o.kind) {
+    case Operand::Kind::None:
+      return "_";
+    case Operand::Kind::Var:
+      return o.var->name;
+    case Operand::Kind::Temp:
+      return "t" + std::to_string(o.temp);
+    case Operand::Kind::Const:
+      if (o.isFloat()) {
+        std::ostringstream ss;
+        ss << o.fval;
+        std::string s = ss.str();
+        if (s.find_first_of(".e") == std::string::npos) s += ".0";
+        return s;
+      }
+      if (o.type == symbols::Type::Bool) return o.ival ? "true" : "false";
+      return std::to_string(o.ival);
+  }
+  return "?";
+}
+
+std::string toString(const Instr& in) {
+  std::string d = toString(in.dst), a = toString(in.a), b = toString(in.b);
+  std::string l = "L" + std::to_string(in.label);
+  switch (in.op) {
+    case Opcode::Copy:
+      return d + " = " + a;
+    case Opcode::Neg:
+    case Opcode::Not:
+      return d + " = " + opcodeName(in.op) + a;
+    case Opcode::Cvt:
+      return d + " = (" + in.dst.type->name + ") " + a;
+    case Opcode::Load:
+      return d + " = " + a + " [ " + b + " ]";
+    case Opcode::Store:
+      return d + " [ " + a + " ] = " + b;
+    case Opcode::Check:
+      return "check 0 <= " + a + " < " + b;
+    case Opcode::VSplat:
+    case Opcode::VNeg:
+      return d + " = " + opcodeName(in.op) + " " + a;
+    case Opcode::VLoad:
+      return d + " = vload " + a + " [ " + b + " ]";
+    case Opcode::VStore:
+      return "vstore " + d + " [ " + a + " ] = " + b;
+    case Opcode::Label:
+      return l + ":";
+    case Opcode::Jump:
+      return "goto " + l;
+    case Opcode::JumpIf:
+      return "if " + a + " goto " + l;
+    case Opcode::JumpIfNot:
+      return "iffalse " + a + " goto " + l;
+    case Opcode::JumpLt:
+    case Opcode::JumpLe:
+    case Opcode::JumpGt:
+    case Opcode::JumpGe:
+    case Opcode::JumpEq:
+    case Opcode::JumpNe:
+      return "if " + a + " " + opcodeName(in.op) + " " + b + " goto " + l;
+    default:
+      return d + " = " + a + " " + opcodeName(in.op) + " " + b;
+  }
+}
+
+std::string toString(const Function& fn) {
+  std::string s;
+  for (const auto& in : fn.code) {
+    if (in.op != Opcode::Label) s += "\t";
+    s += toString(in);
+    s += "\n";
+  }
+  return s;
+}
+
+void uses(const Instr& in, std::vector<const Operand*>& out) {
+  switch (in.op) {
+    case Opcode::Label:
+    case Opcode::Jump:
+      return;
+    case Opcode::Store:
+    case Opcode::VStore:
+      out.push_back(&in.dst);
+      break;
+    default:
+      break;
+  }
+  if (!in.a.isNone()) out.push_back(&in.a);
+  if (!in.b.isNone()) out.push_back(&in.b);
+}
+
+}  // namespace ir
@@ -0,0 +1,170 @@
+/**
+ * @file IR.hpp
+ * @brief Three-address intermediate representation.
+ *
+ * Programs are lowered from the AST into a flat list of three-address
+ * instructions (see Lower.hpp). Operands are constants, variables of the
+ * frame (symbols::Id) or numbered temporaries; control flow uses numbered
+ * labels and jumps, in the style of the Dragon book's intermediate code.
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ASTNode.hpp"
+#include "Frame.hpp"
+#include "Id.hpp"
+#include "Type.hpp"
+#include "sptr.h"
+
+namespace ir {
+
+/**
+ * @brief Instruction opcodes.
+ *
+ * Unless stated otherwise an instruction computes `dst = a op b`.
+ */
+enum class Opcode {
+  Copy,      /**< dst = a */
+  Add,       /**< dst = a + b */
+  Sub,       /**< dst = a - b */
+  Mul,       /**< dst = a * b */
+  Div,       /**< dst = a / b */
+  Neg,       /**< dst = -a */
+  Not,       /**< dst = !a */
+  Lt,        /**< dst = a < b */
+  Le,        /**< dst = a <= b */
+  Gt,        /**< dst = a > b */
+  Ge,        /**< dst = a >= b */
+  Eq,        /**< dst = a == b */
+  Ne,        /**< dst = a != b */
+  And,       /**< dst = a && b, both operands already evaluated */
+  Or,        /**< dst = a || b, both operands already evaluated */
+  Cvt,       /**< dst = (type of dst) a */
+  Load,      /**< dst = a[b], a is an array variable, b a byte offset */
+  Store,     /**< dst[a] = b, dst is an array variable, a a byte offset */
+  Check,     /**< trap unless 0 <= a < b (array index a, dimension size b) */
+  VSplat,    /**< dst = a in every lane */
+  VLoad,     /**< dst = a[b .. b + kLanes elements), b a byte offset */
+  VStore,    /**< dst[a .. a + kLanes elements) = b */
+  VAdd,      /**< dst = a + b, lane by lane */
+  VSub,      /**< dst = a - b, lane by lane */
+  VMul,      /**< dst = a * b, lane by lane */
+  VDiv,      /**< dst = a / b, lane by lane (float only) */
+  VNeg,      /**< dst = -a, lane by lane */
+  Label,     /**< label: */
+  Jump,      /**< goto label */
+  JumpIf,    /**< if a goto label */
+  JumpIfNot, /**< iffalse a goto label */
+  JumpLt,    /**< if a < b goto label */
+  JumpLe,    /**< if a <= b goto label */
+  JumpGt,    /**< if a > b goto label */
+  JumpGe,    /**< if a >= b goto label */
+  JumpEq,    /**< if a == b goto label */
+  JumpNe,    /**< if a != b goto label */
+};
+
+/// Number of opcodes, for tables indexed by Opcode.
+constexpr size_t kOpcodeCount = static_cast<size_t>(Opcode::JumpNe) + 1;
+
+/// Elements held by the temporaries of the vector opcodes (VSplat..VNeg).
+/// Their Operand::type is the element type, int or float.
+constexpr int kLanes = 4;
+
+/**
+ * @brief Instruction operand: constant, frame variable or temporary.
+ */
+struct Operand {
+  enum class Kind : uint8_t { None, Const, Var, Temp };
+
+  Kind kind = Kind::None;
+  sptr<symbols::Type> type;            ///< Value type (array type for arrays)
+  const symbols::Id* var = nullptr;    ///< Kind::Var
+  int temp = 0;                        ///< Kind::Temp
+  int64_t ival = 0;                    ///< Kind::Const, int/char/bool
+  double fval = 0;                     ///< Kind::Const, float
+
+  static Operand constInt(int64_t v, sptr<symbols::Type> t);
+  static Operand constFloat(double v);
+  static Operand variable(const symbols::Id* id);
+  static Operand temporary(int n, sptr<symbols::Type> t);
+
+  bool isNone() const { return kind == Kind::None; }
+  bool isConst() const { return kind == Kind::Const; }
+  bool isVar() const { return kind == Kind::Var; }
+  bool isTemp() const { return kind == Kind::Temp; }
+  bool isFloat() const { return type == symbols::Type::Float; }
+
+  /// Same variable, same temporary or equal constant.
+  bool same(const Operand& o) const;
+};
+
+/**
+ * @brief A single three-address instruction.
+ */
+struct Instr {
+  Opcode op;
+  Operand dst{};            ///< Result; the array of Store and VStore
+  Operand a{};
+  Operand b{};
+  int label = -1;           ///< Label, Jump, JumpIf, JumpIfNot
+  SourceLocation loc{0, 0}; ///< Statement the instruction comes from
+
+  bool isJump() const { return op >= Opcode::Jump; }
+
+  /// `if a rel b goto label`
+  bool isCompareJump() const { return op >= Opcode::JumpLt; }
+
+  /// Works on kLanes elements at once.
+  bool isVector() const { return op >= Opcode::VSplat && op <= Opcode::VNeg; }
+
+  /// Instruction writes @ref dst as a scalar result.
+  bool hasResult() const {
+    return op != Opcode::Store && op != Opcode::Check &&
+           op != Opcode::VStore && op != Opcode::Label && !isJump();
+  }
+};
+
+/**
+ * @brief A lowered program.
+ */
+struct Function {
+  std::vector<Instr> code;  ///< Instructions in execution order
+  symbols::Frame frame;     ///< Variable layout
+  int numTemps = 0;         ///< Temporaries are numbered 1..numTemps
+  int numLabels = 0;        ///< Labels are numbered 1..numLabels
+
+  Operand newTemp(sptr<symbols::Type> t) {
+    return Operand::temporary(++numTemps, std::move(t));
+  }
+  int newLabel() { return ++numLabels; }
+};
+
+/// Mnemonic of an opcode.
+const char* opcodeName(Opcode op);
+
+/// Conditional jump testing relation @p rel (Lt..Ne), and back.
+Opcode compareJump(Opcode rel);
+Opcode compareOf(Opcode jump);
+
+/// Relation that holds exactly when @p rel does not, for ordered operands.
+Opcode negate(Opcode rel);
+
+/// Integer @p v truncated to the width of @p t, as a variable of @p t holds it.
+int64_t wrap(int64_t v, const sptr<symbols::Type>& t);
+
+/// Operand as text: constant value, variable name or `tN`.
+std::string toString(const Operand& o);
+
+/// Instruction as text, without indentation or newline.
+std::string toString(const Instr& in);
+
+/// Whole function, one instruction per line; labels are not indented.
+std::string toString(const Function& fn);
+
+/// Collect the operands read by @p in.
+void uses(const Instr& in, std::vector<const Operand*>& out);
+
+}  // namespace ir
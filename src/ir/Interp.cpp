@@ -0,0 +1,338 @@
+/**
+ * @file Interp.cpp
+ * @brief Reference interpreter for three-address code.
+ */
+#include "Interp.hpp"
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "Array.hpp"
+
+namespace ir {
+namespace {
+
+using symbols::Type;
+
+/// Innermost element type of a (possibly nested) array type.
+sptr<Type> scalarOf(sptr<Type> t) {
+  while (auto arr = std::dynamic_pointer_cast<symbols::Array>(t)) t = arr->of;
+  return t;
+}
+
+}  // namespace
+
+Interpreter::Interpreter(const Function& f) : fn(f) {
+  labels.assign(fn.numLabels + 1, 0);
+  for (size_t i = 0; i < fn.code.size(); ++i) {
+    if (fn.code[i].op == Opcode::Label) labels[fn.code[i].label] = i;
+    hasVectors |= fn.code[i].isVector();
+  }
+}
+
+Interpreter::Value Interpreter::loadAt(int offset,
+                                       const sptr<Type>& t) const {
+  Value v;
+  if (t == Type::Float) {
+    std::memcpy(&v.f, mem + offset, sizeof(double));
+  } else if (t == Type::Int) {
+    int32_t x;
+    std::memcpy(&x, mem + offset, sizeof(x));
+    v.i = x;
+  } else if (t == Type::Char) {
+    v.i = static_cast<int8_t>(mem[offset]);
+  } else {
+    v.i = mem[offset];
+  }
+  return v;
+}
+
+void Interpreter::storeAt(int offset, const sptr<Type>& t, Value v) {
+  if (t == Type::Float) {
+    std::memcpy(mem + offset, &v.f, sizeof(double));
+  } else if (t == Type::Int) {
+    int32_t x = static_cast<int32_t>(v.i);
+    std::memcpy(mem + offset, &x, sizeof(x));
+  } else {
+    mem[offset] = static_cast<uint8_t>(wrap(v.i, t));
+  }
+}
+
+Interpreter::Value Interpreter::read(const Operand& o) const {
+  switch (o.kind) {
+    case Operand::Kind::Const: {
+      Value v;
+      v.i = o.ival;
+      v.f = o.fval;
+      return v;
+    }
+    case Operand::Kind::Temp:
+      return temps[o.temp];
+    case Operand::Kind::Var:
+      return loadAt(o.var->offset, o.type);
+    default:
+      throw std::runtime_error("Read of an empty operand");
+  }
+}
+
+void Interpreter::write(const Operand& o, Value v) {
+  if (!o.isFloat()) v.i = wrap(v.i, o.type);
+  if (o.isTemp())
+    temps[o.temp] = v;
+  else if (o.isVar())
+    storeAt(o.var->offset, o.type, v);
+  else
+    throw std::runtime_error("Write to a non-variable operand");
+}
+
+int Interpreter::element(const Operand& arr, const Value& off,
+                         const sptr<Type>& t, int count) const {
+  if (off.i < 0 || off.i + count * t->width > arr.var->type->width)
+    throw std::runtime_error("Array index out of bounds: " + arr.var->name);
+  return arr.var->offset + static_cast<int>(off.i);
+}
+
+bool Interpreter::compare(Opcode rel, const Operand& a,
+                          const Operand& b) const {
+  Value va = read(a), vb = read(b);
+  bool fl = a.isFloat();
+  double x = fl ? va.f : static_cast<double>(va.i);
+  double y = fl ? vb.f : static_cast<double>(vb.i);
+  switch (rel) {
+    case Opcode::Lt: return x < y;
+    case Opcode::Le: return x <= y;
+    case Opcode::Gt: return x > y;
+    case Opcode::Ge: return x >= y;
+    case Opcode::Eq: return x == y;
+    default: return x != y;
+  }
+}
+
+void Interpreter::vector(const Instr& in) {
+  sptr<Type> t = scalarOf(in.op == Opcode::VStore ? in.b.type : in.dst.type);
+  bool fl = t == Type::Float;
+  switch (in.op) {
+    case Opcode::VSplat:
+      vectors[in.dst.temp].fill(read(in.a));
+      return;
+    case Opcode::VLoad: {
+      int at = element(in.a, read(in.b), t, kLanes);
+      for (int k = 0; k < kLanes; ++k)
+        vectors[in.dst.temp][k] = loadAt(at + k * t->width, t);
+      return;
+    }
+    case Opcode::VStore: {
+      int at = element(in.dst, read(in.a), t, kLanes);
+      const Lanes& v = vectors[in.b.temp];
+      for (int k = 0; k < kLanes; ++k) storeAt(at + k * t->width, t, v[k]);
+      return;
+    }
+    default:
+      break;
+  }
+
+  const Lanes& a = vectors[in.a.temp];
+  const Lanes& b = vectors[in.op == Opcode::VNeg ? in.a.temp : in.b.temp];
+  Lanes r;
+  for (int k = 0; k < kLanes; ++k) {
+    if (fl) {
+      double x = a[k].f, y = b[k].f;
+      switch (in.op) {
+        case Opcode::VAdd: r[k].f = x + y; break;
+        case Opcode::VSub: r[k].f = x - y; break;
+        case Opcode::VMul: r[k].f = x * y; break;
+        case Opcode::VDiv: r[k].f = x / y; break;
+        default: r[k].f = -x; break;
+      }
+    } else {
+      int64_t x = a[k].i, y = b[k].i;
+      switch (in.op) {
+        case Opcode::VAdd: r[k].i = wrap(x + y, t); break;
+        case Opcode::VSub: r[k].i = wrap(x - y, t); break;
+        case Opcode::VMul: r[k].i = wrap(x * y, t); break;
+        case Opcode::VDiv:
+          throw std::runtime_error("Integer vector division");
+        default: r[k].i = wrap(-x, t); break;
+      }
+    }
+  }
+  vectors[in.dst.temp] = r;
+}
+
+void Interpreter::run(uint8_t* frame, uint64_t maxSteps) {
+  mem = frame;
+  temps.assign(fn.numTemps + 1, Value());
+  if (hasVectors) vectors.assign(fn.numTemps + 1, Lanes());
+  executed = 0;
+  branches = 0;
+  taken = 0;
+  profile.fill(0);
+
+  const auto& code = fn.code;
+  size_t pc = 0;
+  while (pc < code.size()) {
+    const Instr& in = code[pc++];
+    if (in.op == Opcode::Label) continue;
+    if (++executed > maxSteps && maxSteps)
+      throw std::runtime_error("Step limit exceeded");
+    ++profile[static_cast<size_t>(in.op)];
+
+    switch (in.op) {
+      case Opcode::Copy:
+        write(in.dst, read(in.a));
+        break;
+      case Opcode::Add:
+      case Opcode::Sub:
+      case Opcode::Mul:
+      case Opcode::Div: {
+        Value a = read(in.a), b = read(in.b), r;
+        if (in.dst.isFloat()) {
+          switch (in.op) {
+            case Opcode::Add: r.f = a.f + b.f; break;
+            case Opcode::Sub: r.f = a.f - b.f; break;
+            case Opcode::Mul: r.f = a.f * b.f; break;
+            default: r.f = a.f / b.f; break;
+          }
+        } else {
+          switch (in.op) {
+            case Opcode::Add: r.i = a.i + b.i; break;
+            case Opcode::Sub: r.i = a.i - b.i; break;
+            case Opcode::Mul: r.i = a.i * b.i; break;
+            default:
+              if (b.i == 0) throw std::runtime_error("Division by zero");
+              r.i = a.i / b.i;
+              break;
+          }
+        }
+        write(in.dst, r);
+        break;
+      }
+      case Opcode::Neg: {
+        Value a = read(in.a), r;
+        r.i = -a.i;
+        r.f = -a.f;
+        write(in.dst, r);
+        break;
+      }
+      case Opcode::Not: {
+        Value r;
+        r.i = !read(in.a).i;
+        write(in.dst, r);
+        break;
+      }
+      case Opcode::Lt:
+      case Opcode::Le:
+      case Opcode::Gt:
+      case Opcode::Ge:
+      case Opcode::Eq:
+      case Opcode::Ne: {
+        Value r;
+        r.i = compare(in.op, in.a, in.b);
+        write(in.dst, r);
+        break;
+      }
+      case Opcode::And:
+      case Opcode::Or: {
+        Value r;
+        bool a = read(in.a).i != 0, b = read(in.b).i != 0;
+        r.i = in.op == Opcode::And ? (a && b) : (a || b);
+        write(in.dst, r);
+        break;
+      }
+      case Opcode::Cvt: {
+        Value a = read(in.a), r;
+        if (in.dst.isFloat())
+          r.f = in.a.isFloat() ? a.f : static_cast<double>(a.i);
+        else
+          r.i = in.a.isFloat() ? static_cast<int64_t>(a.f) : a.i;
+        write(in.dst, r);
+        break;
+      }
+      case Opcode::Load: {
+        sptr<Type> t = scalarOf(in.dst.type);
+        write(in.dst, loadAt(element(in.a, read(in.b), t), t));
+        break;
+      }
+      case Opcode::Store: {
+        sptr<Type> t = scalarOf(in.b.type);
+        Value v = read(in.b);
+        storeAt(element(in.dst, read(in.a), t), t, v);
+        break;
+      }
+      case Opcode::Check: {
+        int64_t i = read(in.a).i;
+        if (i < 0 || i >= read(in.b).i)
+          throw std::runtime_error("Array index out of bounds: " +
+                                   std::to_string(i));
+        break;
+      }
+      case Opcode::VSplat:
+      case Opcode::VLoad:
+      case Opcode::VStore:
+      case Opcode::VAdd:
+      case Opcode::VSub:
+      case Opcode::VMul:
+      case Opcode::VDiv:
+      case Opcode::VNeg:
+        vector(in);
+        break;
+      case Opcode::Jump:
+        ++branches;
+        ++taken;
+        pc = labels[in.label];
+        break;
+      case Opcode::JumpIf:
+      case Opcode::JumpIfNot: {
+        ++branches;
+        bool c = read(in.a).i != 0;
+        if (c == (in.op == Opcode::JumpIf)) {
+          ++taken;
+          pc = labels[in.label];
+        }
+        break;
+      }
+      case Opcode::JumpLt:
+      case Opcode::JumpLe:
+      case Opcode::JumpGt:
+      case Opcode::JumpGe:
+      case Opcode::JumpEq:
+      case Opcode::JumpNe:
+        ++branches;
+        if (compare(compareOf(in.op), in.a, in.b)) {
+          ++taken;
+          pc = labels[in.label];
+        }
+        break;
+      case Opcode::Label:
+        break;
+    }
+  }
+}
+
+std::vector<uint8_t> Interpreter::run(uint64_t maxSteps) {
+  std::vector<uint8_t> frame(fn.frame.size + 1, 0);
+  run(frame.data(), maxSteps);
+  frame.resize(fn.frame.size);
+  return frame;
+}
+
+double readVar(const std::vector<uint8_t>& frame, const symbols::Id& id,
+               int byteOffset, sptr<symbols::Type> t) {
+  if (!t) t = scalarOf(id.type);
+  const uint8_t* p = frame.data() + id.offset + byteOffset;
+  if (t == Type::Float) {
+    double d;
+    std::memcpy(&d, p, sizeof(d));
+    return d;
+  }
+  if (t == Type::Int) {
+    int32_t x;
+    std::memcpy(&x, p, sizeof(x));
+    return x;
+  }
+  if (t == Type::Char) return static_cast<int8_t>(*p);
+  return *p;
+}
+
+}  // namespace ir
@@ -0,0 +1,72 @@
+/**
+ * @file Interp.hpp
+ * @brief Reference interpreter for three-address code.
+ */
+#pragma once
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "IR.hpp"
+
+namespace ir {
+
+/**
+ * @brief Straightforward interpreter for a lowered Function.
+ *
+ * Serves as the semantic reference for the optimization passes: a pass is
+ * correct if the frame left by the interpreter is unchanged. Variables live
+ * in a byte frame at their Id::offset (int as 32-bit, float as double,
+ * bool/char as one byte); temporaries are kept in a separate array, and
+ * the temporaries of vector opcodes in one of kLanes values each.
+ */
+class Interpreter {
+ public:
+  explicit Interpreter(const Function& f);
+
+  /**
+   * @brief Execute the function.
+   * @param frame Variable storage of at least `frame.size` bytes.
+   * @param maxSteps Abort with std::runtime_error after this many
+   * instructions (0 = unlimited).
+   */
+  void run(uint8_t* frame, uint64_t maxSteps = 0);
+
+  /// Convenience overload with a zero-initialized frame.
+  std::vector<uint8_t> run(uint64_t maxSteps = 0);
+
+  uint64_t executed = 0;  ///< Instructions executed by the last run()
+  uint64_t branches = 0;  ///< Jumps executed by the last run()
+  uint64_t taken = 0;     ///< Jumps of those that left the fall-through
+  std::array<uint64_t, kOpcodeCount> profile{};  ///< Executions per opcode
+
+ private:
+  struct Value {
+    int64_t i = 0;
+    double f = 0;
+  };
+
+  using Lanes = std::array<Value, kLanes>;
+
+  const Function& fn;
+  std::vector<size_t> labels;  ///< label number -> instruction index
+  std::vector<Value> temps;
+  std::vector<Lanes> vectors;  ///< Vector temporaries, if the code has any
+  bool hasVectors = false;
+  uint8_t* mem = nullptr;
+
+  Value read(const Operand& o) const;
+  void write(const Operand& o, Value v);
+  Value loadAt(int offset, const sptr<symbols::Type>& t) const;
+  void storeAt(int offset, const sptr<symbols::Type>& t, Value v);
+  bool compare(Opcode rel, const Operand& a, const Operand& b) const;
+  int element(const Operand& arr, const Value& off,
+              const sptr<symbols::Type>& t, int count = 1) const;
+  void vector(const Instr& in);
+};
+
+/// Read a scalar variable from an interpreter frame (for tests and tools).
+double readVar(const std::vector<uint8_t>& frame, const symbols::Id& id,
+               int byteOffset = 0, sptr<symbols::Type> t = nullptr);
+
+}  // namespace ir
@@ -0,0 +1,131 @@
+/**
+ * @file Liveness.cpp
+ * @brief Live temporaries at basic block boundaries.
+ */
+#include "Liveness.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace ir {
+namespace {
+
+/// Fixed-size bit set over the densely numbered temporaries.
+struct Bits {
+  std::vector<uint64_t> w;
+
+  explicit Bits(size_t n = 0) : w((n + 63) / 64, 0) {}
+  void set(size_t i) { w[i / 64] |= uint64_t(1) << (i % 64); }
+  void reset(size_t i) { w[i / 64] &= ~(uint64_t(1) << (i % 64)); }
+  bool test(size_t i) const { return w[i / 64] >> (i % 64) & 1; }
+  void unite(const Bits& o) {
+    for (size_t k = 0; k < w.size(); ++k) w[k] |= o.w[k];
+  }
+};
+
+}  // namespace
+
+Liveness::Liveness(const Function& fn, const Cfg& cfg) {
+  size_t nb = cfg.blocks.size();
+  in.assign(nb, {});
+  out.assign(nb, {});
+
+  // Read before written in the block, and written in it
+  std::vector<std::vector<int>> gen(nb), kill(nb);
+  std::vector<const Operand*> ops;
+  std::vector<int> defined(static_cast<size_t>(fn.numTemps) + 1, -1);
+  for (size_t b = 0; b < nb; ++b) {
+    int mark = static_cast<int>(b);
+    for (int i = cfg.blocks[b].begin; i < cfg.blocks[b].end; ++i) {
+      const Instr& instr = fn.code[i];
+      ops.clear();
+      uses(instr, ops);
+      for (const Operand* o : ops)
+        if (o->isTemp() && defined[o->temp] != mark)
+          gen[b].push_back(o->temp);
+      if (instr.hasResult() && instr.dst.isTemp() &&
+          defined[instr.dst.temp] != mark) {
+        defined[instr.dst.temp] = mark;
+        kill[b].push_back(instr.dst.temp);
+      }
+    }
+  }
+
+  // Dense numbers for the temporaries that can cross a block boundary
+  std::vector<int> dense(static_cast<size_t>(fn.numTemps) + 1, -1);
+  std::vector<int> temps;
+  for (const auto& g : gen)
+    for (int t : g)
+      if (dense[t] < 0) {
+        dense[t] = static_cast<int>(temps.size());
+        temps.push_back(t);
+      }
+  if (temps.empty()) return;
+
+  size_t n = temps.size();
+  std::vector<Bits> liveIn(nb, Bits(n)), liveOut(nb, Bits(n));
+  // Blocks are in code order, so visiting them backwards follows most
+  // edges against their direction and converges in a few rounds.
+  for (bool changed = true; changed;) {
+    changed = false;
+    for (size_t b = nb; b-- > 0;) {
+      Bits live(n);
+      for (int s : cfg.blocks[b].succs) live.unite(liveIn[s]);
+      liveOut[b] = live;
+      for (int t : kill[b])
+        if (dense[t] >= 0) live.reset(dense[t]);
+      for (int t : gen[b]) live.set(dense[t]);
+      if (live.w != liveIn[b].w) {
+        liveIn[b] = std::move(live);
+        changed = true;
+      }
+    }
+  }
+
+  for (size_t b = 0; b < nb; ++b) {
+    for (size_t k = 0; k < n; ++k) {
+      if (liveIn[b].test(k)) in[b].push_back(temps[k]);
+      if (liveOut[b].test(k)) out[b].push_back(temps[k]);
+    }
+    std::sort(in[b].begin(), in[b].end());
+    std::sort(out[b].begin(), out[b].end());
+  }
+}
+
+bool Liveness::liveIn(int block, int temp) const {
+  return std::binary_search(in[block].begin(), in[block].end(), temp);
+}
+
+bool Liveness::liveOut(int block, int temp) const {
+  return std::binary_search(out[block].begin(), out[block].end(), temp);
+}
+
+std::vector<LiveRange> liveRanges(const Function& fn, const Cfg& cfg,
+                                  const Liveness& live) {
+  std::vector<LiveRange> r(static_cast<size_t>(fn.numTemps) + 1);
+  for (int i = 0; i < static_cast<int>(fn.code.size()); ++i) {
+    const Instr& in = fn.code[i];
+    for (const Operand* o : {&in.dst, &in.a, &in.b}) {
+      if (!o->isTemp()) continue;
+      r[o->temp].start = std::min(r[o->temp].start, i);
+      r[o->temp].end = std::max(r[o->temp].end, i);
+    }
+  }
+  if (fn.code.empty()) return r;
+  for (size_t b = 0; b < cfg.blocks.size(); ++b) {
+    int first = cfg.blocks[b].begin, last = cfg.blocks[b].end - 1;
+    for (int t : live.in[b])
+      if (first <= r[t].start) {
+        r[t].start = first;
+        r[t].enters = true;
+      }
+    for (int t : live.out[b])
+      if (last >= r[t].end) {
+        r[t].end = last;
+        r[t].leaves = true;
+      }
+  }
+  return r;
+}
+
+}  // namespace ir
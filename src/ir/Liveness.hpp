@@ -0,0 +1,54 @@
+/**
+ * @file Liveness.hpp
+ * @brief Live temporaries at basic block boundaries.
+ */
+#pragma once
+#include <climits>
+#include <vector>
+
+#include "Cfg.hpp"
+#include "IR.hpp"
+
+namespace ir {
+
+/**
+ * @brief Temporaries live on entry to and on exit from each basic block.
+ *
+ * Solved backwards over the Cfg until nothing changes. Only temporaries
+ * read in some block before being written there can be live across a block
+ * boundary; those are numbered densely for the dataflow, so code where
+ * most temporaries stay inside one statement is cheap to analyze.
+ * Variables live in the frame and are not tracked. Like the Cfg, the
+ * result refers to instruction indices and must be recomputed after the
+ * code is edited.
+ */
+struct Liveness {
+  std::vector<std::vector<int>> in;   ///< block -> temps live on entry, sorted
+  std::vector<std::vector<int>> out;  ///< block -> temps live on exit, sorted
+
+  Liveness(const Function& fn, const Cfg& cfg);
+
+  bool liveIn(int block, int temp) const;
+  bool liveOut(int block, int temp) const;
+};
+
+/**
+ * @brief Code a temporary occupies, as one range of instruction indices.
+ *
+ * The range runs from the first to the last mention of the temporary,
+ * stretched over every block it is live into or out of, so it covers all
+ * points where the value must be kept even when a loop carries it
+ * backwards. A temporary never mentioned has `end < 0`.
+ */
+struct LiveRange {
+  int start = INT_MAX;
+  int end = -1;
+  bool enters = false;  ///< Already live at @ref start (live into its block)
+  bool leaves = false;  ///< Still live after @ref end (live out of its block)
+};
+
+/// Ranges of temporaries 1..numTemps, indexed by temporary number.
+std::vector<LiveRange> liveRanges(const Function& fn, const Cfg& cfg,
+                                  const Liveness& live);
+
+}  // namespace ir
@@ -0,0 +1,545 @@
+/**
+ * @file Lower.cpp
+ * @brief Translation of the AST into three-address code.
+ */
+#include "Lower.hpp"
+
+#include <cstdint>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#include "Array.hpp"
+#include "Expr.hpp"
+#include "Tag.hpp"
+#include "Token.hpp"
+#include "Word.hpp"
+
+namespace ir {
+namespace {
+
+using symbols::Type;
+using lexer::Tag;
+
+class Lowering {
+ public:
+  Lowering(Function& f, const LowerOptions& o) : fn(f), opts(o) {}
+
+  void stmt(const sptr<ast::Stmt>& s) {
+    if (!s) return;
+    loc = s->location;
+
+    if (auto seq = std::dynamic_pointer_cast<ast::Seq>(s)) {
+      // walk the `second` spine iteratively
+      sptr<ast::Stmt> cur = s;
+      for (; seq; seq = std::dynamic_pointer_cast<ast::Seq>(cur)) {
+        stmt(seq->first);
+        cur = seq->second;
+      }
+      stmt(cur);
+    } else if (auto node = std::dynamic_pointer_cast<ast::Set>(s)) {
+      auto target = std::dynamic_pointer_cast<ast::IdExpr>(node->id);
+      if (!target) throw std::runtime_error("Set target is not a variable");
+      Operand dst = Operand::variable(target->sym.get());
+      Operand val = expr(*node->expr);
+      if (val.type != dst.type && !val.isConst())
+        gen(Opcode::Cvt, dst, val);
+      else
+        gen(Opcode::Copy, dst, convert(val, dst.type));
+    } else if (auto node = std::dynamic_pointer_cast<ast::SetElem>(s)) {
+      auto acc = std::dynamic_pointer_cast<ast::Access>(node->arrayAccess);
+      if (!acc) throw std::runtime_error("SetElem target is not an access");
+      Operand arr;
+      Operand off = offset(*acc, arr);
+      Operand val = convert(expr(*node->expr), acc->exprType);
+      gen(Opcode::Store, arr, off, val);
+    } else if (auto node = std::dynamic_pointer_cast<ast::If>(s)) {
+      int after = fn.newLabel();
+      branch(*node->condition, kFall, after);
+      stmt(node->thenStmt);
+      label(after);
+    } else if (auto node = std::dynamic_pointer_cast<ast::Else>(s)) {
+      int elseL = fn.newLabel();
+      int after = fn.newLabel();
+      branch(*node->condition, kFall, elseL);
+      stmt(node->thenStmt);
+      jump(Opcode::Jump, Operand(), after);
+      label(elseL);
+      stmt(node->elseStmt);
+      label(after);
+    } else if (auto node = std::dynamic_pointer_cast<ast::While>(s)) {
+      if (opts.vectorize && !opts.boundsChecks) vectorLoop(*node);
+      int head = fn.newLabel();
+      int exit = fn.newLabel();
+      label(head);
+      branch(*node->condition, kFall, exit);
+      exits.push_back(exit);
+      stmt(node->body);
+      exits.pop_back();
+      loc = node->location;
+      jump(Opcode::Jump, Operand(), head);
+      label(exit);
+    } else if (auto node = std::dynamic_pointer_cast<ast::Do>(s)) {
+      int head = fn.newLabel();
+      int exit = fn.newLabel();
+      label(head);
+      exits.push_back(exit);
+      stmt(node->body);
+      exits.pop_back();
+      loc = node->location;
+      branch(*node->condition, head, kFall);
+      label(exit);
+    } else if (std::dynamic_pointer_cast<ast::Break>(s)) {
+      if (exits.empty()) throw std::runtime_error("break outside of a loop");
+      jump(Opcode::Jump, Operand(), exits.back());
+    } else {
+      throw std::runtime_error("Unsupported statement in lowering");
+    }
+  }
+
+ private:
+  static constexpr int kFall = 0;  ///< "No jump" target of branch()
+
+  Function& fn;
+  const LowerOptions& opts;
+  std::vector<int> exits;                 ///< Exit labels of enclosing loops
+  std::unordered_map<int, Operand> temps; ///< ast::Temp number -> temporary
+  SourceLocation loc{0, 0};
+
+  Operand expr(const ast::Expr& e) {
+    if (auto id = dynamic_cast<const ast::IdExpr*>(&e))
+      return Operand::variable(id->sym.get());
+
+    if (auto c = dynamic_cast<const ast::Constant*>(&e)) {
+      switch (c->value->tag) {
+        case Tag::NUM:
+          return Operand::constInt(std::stoll(c->value->lexeme), Type::Int);
+        case Tag::REAL:
+          return Operand::constFloat(std::stod(c->value->lexeme));
+        case Tag::TRUE_:
+          return Operand::constInt(1, Type::Bool);
+        case Tag::FALSE_:
+          return Operand::constInt(0, Type::Bool);
+        default:
+          throw std::runtime_error("Unsupported constant " +
+                                   c->value->lexeme);
+      }
+    }
+
+    if (auto t = dynamic_cast<const ast::Temp*>(&e)) {
+      auto it = temps.find(t->number);
+      if (it == temps.end())
+        it = temps.emplace(t->number, fn.newTemp(t->exprType)).first;
+      return it->second;
+    }
+
+    if (auto acc = dynamic_cast<const ast::Access*>(&e)) {
+      Operand arr;
+      Operand off = offset(*acc, arr);
+      Operand dst = fn.newTemp(acc->exprType);
+      gen(Opcode::Load, dst, arr, off);
+      return dst;
+    }
+
+    if (auto un = dynamic_cast<const ast::Unary*>(&e)) {
+      Operand a = expr(*un->expr);
+      Opcode op =
+          un->op_tok->tag == Tag::UnaryNOT ? Opcode::Not : Opcode::Neg;
+      Operand dst = fn.newTemp(op == Opcode::Not ? Type::Bool : a.type);
+      gen(op, dst, a);
+      return dst;
+    }
+
+    if (opts.jumpingCode && dynamic_cast<const ast::Logical*>(&e)) {
+      // t = true; branch over t = false
+      Operand dst = fn.newTemp(Type::Bool);
+      int no = fn.newLabel();
+      int after = fn.newLabel();
+      cond(e, kFall, no);
+      gen(Opcode::Copy, dst, Operand::constInt(1, Type::Bool));
+      jump(Opcode::Jump, Operand(), after);
+      label(no);
+      gen(Opcode::Copy, dst, Operand::constInt(0, Type::Bool));
+      label(after);
+      return dst;
+    }
+
+    if (auto op = dynamic_cast<const ast::Op*>(&e)) {
+      Opcode code = binaryOpcode(op->op_tok->tag);
+      Operand a, b;
+      operands(*op, a, b);
+      bool arith = code == Opcode::Add || code == Opcode::Sub ||
+                   code == Opcode::Mul || code == Opcode::Div;
+      Operand dst = fn.newTemp(arith ? a.type : Type::Bool);
+      gen(code, dst, a, b);
+      return dst;
+    }
+
+    throw std::runtime_error("Unsupported expression in lowering");
+  }
+
+  /// Element-wise loop `while (i < n) { a[i] = ...; ...; i = i + 1; }`.
+  struct Elementwise {
+    const symbols::Id* index = nullptr;
+    const ast::Expr* bound = nullptr;
+    std::vector<const ast::SetElem*> stores;
+    std::unordered_map<const ast::Expr*, Operand> splats;
+    std::unordered_map<int, Operand> offsets;  ///< element width -> offset
+  };
+
+  static void flatten(const sptr<ast::Stmt>& s,
+                      std::vector<const ast::Stmt*>& out) {
+    if (auto seq = std::dynamic_pointer_cast<ast::Seq>(s)) {
+      flatten(seq->first, out);
+      flatten(seq->second, out);
+    } else if (s) {
+      out.push_back(s.get());
+    }
+  }
+
+  static bool isVar(const ast::Expr* e, const symbols::Id* v) {
+    auto id = dynamic_cast<const ast::IdExpr*>(e);
+    return id && id->sym.get() == v;
+  }
+
+  /// `a[i]` of a one-dimensional int or float array.
+  static bool isElement(const ast::Expr* e, const Elementwise& loop) {
+    auto acc = dynamic_cast<const ast::Access*>(e);
+    return acc && dynamic_cast<const ast::IdExpr*>(acc->array.get()) &&
+           isVar(acc->index.get(), loop.index) &&
+           (acc->exprType == Type::Int || acc->exprType == Type::Float);
+  }
+
+  /// @p e computes the same function of element i for every i.
+  static bool isLanewise(const ast::Expr& e, const sptr<Type>& t,
+                         const Elementwise& loop) {
+    if (dynamic_cast<const ast::Access*>(&e))
+      return isElement(&e, loop) && e.exprType == t;
+    if (auto c = dynamic_cast<const ast::Constant*>(&e))
+      return c->value->tag == Tag::NUM ||
+             (c->value->tag == Tag::REAL && t == Type::Float);
+    if (auto id = dynamic_cast<const ast::IdExpr*>(&e))
+      return id->sym.get() != loop.index && id->sym->type == t;
+    if (auto un = dynamic_cast<const ast::Unary*>(&e))
+      return un->op_tok->tag != Tag::UnaryNOT && un->exprType == t &&
+             isLanewise(*un->expr, t, loop);
+    if (auto op = dynamic_cast<const ast::Arith*>(&e)) {
+      Tag tag = op->op_tok->tag;
+      // integer division traps, so it stays scalar
+      if (tag == Tag::OP_DIV && t != Type::Float) return false;
+      return op->exprType == t && isLanewise(*op->lhs, t, loop) &&
+             isLanewise(*op->rhs, t, loop);
+    }
+    return false;
+  }
+
+  static bool isElementwise(const ast::While& w, Elementwise& loop) {
+    auto rel = dynamic_cast<const ast::Rel*>(w.condition.get());
+    if (!rel || rel->op_tok->tag != Tag::LESS) return false;
+    auto i = dynamic_cast<const ast::IdExpr*>(rel->lhs.get());
+    if (!i || i->sym->type != Type::Int) return false;
+    loop.index = i->sym.get();
+    loop.bound = rel->rhs.get();
+    auto n = dynamic_cast<const ast::IdExpr*>(loop.bound);
+    auto c = dynamic_cast<const ast::Constant*>(loop.bound);
+    if (!(c && c->value->tag == Tag::NUM) &&
+        !(n && n->sym->type == Type::Int && n->sym.get() != loop.index))
+      return false;
+
+    std::vector<const ast::Stmt*> body;
+    flatten(w.body, body);
+    if (body.size() < 2) return false;
+    auto step = dynamic_cast<const ast::Set*>(body.back());
+    auto next = step ? dynamic_cast<const ast::Arith*>(step->expr.get())
+                     : nullptr;
+    auto one = next ? dynamic_cast<const ast::Constant*>(next->rhs.get())
+                    : nullptr;
+    if (!one || !isVar(step->id.get(), loop.index) ||
+        next->op_tok->tag != Tag::OP_PLUS ||
+        !isVar(next->lhs.get(), loop.index) || one->value->lexeme != "1")
+      return false;
+
+    body.pop_back();
+    for (const ast::Stmt* st : body) {
+      auto set = dynamic_cast<const ast::SetElem*>(st);
+      if (!set || !isElement(set->arrayAccess.get(), loop) ||
+          !isLanewise(*set->expr, set->arrayAccess->exprType, loop))
+        return false;
+      loop.stores.push_back(set);
+    }
+    return true;
+  }
+
+  /// Put the loop-invariant leaves of @p e into vectors.
+  void splat(const ast::Expr& e, const sptr<Type>& t, Elementwise& loop) {
+    if (auto un = dynamic_cast<const ast::Unary*>(&e)) {
+      splat(*un->expr, t, loop);
+    } else if (auto op = dynamic_cast<const ast::Arith*>(&e)) {
+      splat(*op->lhs, t, loop);
+      splat(*op->rhs, t, loop);
+    } else if (!dynamic_cast<const ast::Access*>(&e)) {
+      Operand v = fn.newTemp(t);
+      gen(Opcode::VSplat, v, convert(expr(e), t));
+      loop.splats[&e] = v;
+    }
+  }
+
+  Operand vectorExpr(const ast::Expr& e, const sptr<Type>& t,
+                     Elementwise& loop) {
+    if (auto acc = dynamic_cast<const ast::Access*>(&e)) {
+      auto id = dynamic_cast<const ast::IdExpr*>(acc->array.get());
+      Operand v = fn.newTemp(t);
+      gen(Opcode::VLoad, v, Operand::variable(id->sym.get()),
+          vectorOffset(t, loop));
+      return v;
+    }
+    if (auto un = dynamic_cast<const ast::Unary*>(&e)) {
+      Operand a = vectorExpr(*un->expr, t, loop);
+      Operand v = fn.newTemp(t);
+      gen(Opcode::VNeg, v, a);
+      return v;
+    }
+    if (auto op = dynamic_cast<const ast::Arith*>(&e)) {
+      Operand a = vectorExpr(*op->lhs, t, loop);
+      Operand b = vectorExpr(*op->rhs, t, loop);
+      Opcode code;
+      switch (op->op_tok->tag) {
+        case Tag::OP_PLUS: code = Opcode::VAdd; break;
+        case Tag::OP_MINUS: code = Opcode::VSub; break;
+        case Tag::OP_MUL: code = Opcode::VMul; break;
+        default: code = Opcode::VDiv; break;
+      }
+      Operand v = fn.newTemp(t);
+      gen(code, v, a, b);
+      return v;
+    }
+    return loop.splats.at(&e);
+  }
+
+  /// Byte offset of element i, computed once per width and iteration.
+  Operand vectorOffset(const sptr<Type>& t, Elementwise& loop) {
+    auto it = loop.offsets.find(t->width);
+    if (it != loop.offsets.end()) return it->second;
+    Operand off = fn.newTemp(Type::Int);
+    gen(Opcode::Mul, off, Operand::variable(loop.index),
+        Operand::constInt(t->width, Type::Int));
+    return loop.offsets[t->width] = off;
+  }
+
+  /**
+   * Vector loop in front of an element-wise while loop. It runs while
+   * kLanes more elements remain; the while loop lowered after it then
+   * handles the rest one element at a time.
+   */
+  void vectorLoop(const ast::While& w) {
+    Elementwise loop;
+    if (!isElementwise(w, loop)) return;
+    Operand n = expr(*loop.bound);
+    if (n.isConst() && n.ival - (kLanes - 1) < INT32_MIN) return;
+
+    for (const ast::SetElem* st : loop.stores)
+      splat(*st->expr, st->arrayAccess->exprType, loop);
+    Operand i = Operand::variable(loop.index);
+    int head = fn.newLabel();
+    int exit = fn.newLabel();
+    label(head);
+    if (n.isConst()) {
+      jump(Opcode::JumpGe, i, exit,
+           Operand::constInt(n.ival - (kLanes - 1), Type::Int));
+    } else {
+      // n - i wraps around for far apart values, which only ends the
+      // vector loop early
+      jump(Opcode::JumpGe, i, exit, n);
+      Operand left = fn.newTemp(Type::Int);
+      gen(Opcode::Sub, left, n, i);
+      jump(Opcode::JumpLt, left, exit, Operand::constInt(kLanes, Type::Int));
+    }
+    for (const ast::SetElem* st : loop.stores) {
+      const sptr<Type>& t = st->arrayAccess->exprType;
+      Operand v = vectorExpr(*st->expr, t, loop);
+      auto acc = static_cast<const ast::Access*>(st->arrayAccess.get());
+      auto id = static_cast<const ast::IdExpr*>(acc->array.get());
+      gen(Opcode::VStore, Operand::variable(id->sym.get()),
+          vectorOffset(t, loop), v);
+    }
+    gen(Opcode::Add, i, i, Operand::constInt(kLanes, Type::Int));
+    jump(Opcode::Jump, Operand(), head);
+    label(exit);
+  }
+
+  /// Evaluate both operands of @p op, converted to a common numeric type.
+  void operands(const ast::Op& op, Operand& a, Operand& b) {
+    a = expr(*op.lhs);
+    b = expr(*op.rhs);
+    if (a.type != b.type && a.type->isNumeric() && b.type->isNumeric()) {
+      sptr<Type> t = Type::max(a.type, b.type);
+      a = convert(a, t);
+      b = convert(b, t);
+    }
+  }
+
+  /// Jump to @p t if @p e holds and to @p f otherwise; kFall falls through.
+  void branch(const ast::Expr& e, int t, int f) {
+    if (opts.jumpingCode) return cond(e, t, f);
+    test(expr(e), t, f);
+  }
+
+  /// Jumping code for a condition, after Dragon book section 6.6.
+  void cond(const ast::Expr& e, int t, int f) {
+    if (auto c = dynamic_cast<const ast::Constant*>(&e)) {
+      if (c->value->tag == Tag::TRUE_ || c->value->tag == Tag::FALSE_) {
+        int to = c->value->tag == Tag::TRUE_ ? t : f;
+        if (to != kFall) jump(Opcode::Jump, Operand(), to);
+        return;
+      }
+    }
+
+    if (auto un = dynamic_cast<const ast::Unary*>(&e)) {
+      if (un->op_tok->tag == Tag::UnaryNOT) return cond(*un->expr, f, t);
+    }
+
+    if (auto op = dynamic_cast<const ast::And*>(&e)) {
+      int no = f != kFall ? f : fn.newLabel();
+      cond(*op->lhs, kFall, no);
+      cond(*op->rhs, t, f);
+      if (f == kFall) label(no);
+      return;
+    }
+
+    if (auto op = dynamic_cast<const ast::Or*>(&e)) {
+      int yes = t != kFall ? t : fn.newLabel();
+      cond(*op->lhs, yes, kFall);
+      cond(*op->rhs, t, f);
+      if (t == kFall) label(yes);
+      return;
+    }
+
+    if (auto op = dynamic_cast<const ast::Rel*>(&e)) {
+      Opcode rel = binaryOpcode(op->op_tok->tag);
+      Operand a, b;
+      operands(*op, a, b);
+      if (t != kFall) {
+        jump(compareJump(rel), a, t, b);
+        if (f != kFall) jump(Opcode::Jump, Operand(), f);
+      } else if (f != kFall) {
+        // !(x < y) is not x >= y when a float operand is NaN
+        bool ordered = rel == Opcode::Eq || rel == Opcode::Ne || !a.isFloat();
+        if (ordered) {
+          jump(compareJump(negate(rel)), a, f, b);
+        } else {
+          Operand c = fn.newTemp(Type::Bool);
+          gen(rel, c, a, b);
+          jump(Opcode::JumpIfNot, c, f);
+        }
+      }
+      return;
+    }
+
+    test(expr(e), t, f);
+  }
+
+  /// Branch on a bool value.
+  void test(const Operand& c, int t, int f) {
+    if (t != kFall) {
+      jump(Opcode::JumpIf, c, t);
+      if (f != kFall) jump(Opcode::Jump, Operand(), f);
+    } else if (f != kFall) {
+      jump(Opcode::JumpIfNot, c, f);
+    }
+  }
+
+  /// Byte offset of an element access; sets @p arr to the array variable.
+  Operand offset(const ast::Access& acc, Operand& arr) {
+    Operand outer;
+    if (auto inner = dynamic_cast<const ast::Access*>(acc.array.get())) {
+      outer = offset(*inner, arr);
+    } else if (auto id = dynamic_cast<const ast::IdExpr*>(acc.array.get())) {
+      arr = Operand::variable(id->sym.get());
+    } else {
+      throw std::runtime_error("Indexed expression is not an array");
+    }
+
+    Operand idx = convert(expr(*acc.index), Type::Int);
+    if (opts.boundsChecks) {
+      auto arrType =
+          std::dynamic_pointer_cast<symbols::Array>(acc.array->exprType);
+      if (!arrType)
+        throw std::runtime_error("Indexed expression is not an array");
+      gen(Opcode::Check, Operand(), idx,
+          Operand::constInt(arrType->size, Type::Int));
+    }
+    Operand part = fn.newTemp(Type::Int);
+    gen(Opcode::Mul, part, idx,
+        Operand::constInt(acc.exprType->width, Type::Int));
+    if (outer.isNone()) return part;
+    Operand sum = fn.newTemp(Type::Int);
+    gen(Opcode::Add, sum, outer, part);
+    return sum;
+  }
+
+  /// Convert @p v to @p to, folding constants.
+  Operand convert(Operand v, const sptr<Type>& to) {
+    if (v.type == to) return v;
+    if (v.isConst()) {
+      if (to == Type::Float)
+        return Operand::constFloat(static_cast<double>(v.ival));
+      int64_t i = v.isFloat() ? static_cast<int64_t>(v.fval) : v.ival;
+      return Operand::constInt(wrap(i, to), to);
+    }
+    Operand dst = fn.newTemp(to);
+    gen(Opcode::Cvt, dst, v);
+    return dst;
+  }
+
+  static Opcode binaryOpcode(Tag tag) {
+    switch (tag) {
+      case Tag::OP_PLUS: return Opcode::Add;
+      case Tag::OP_MINUS: return Opcode::Sub;
+      case Tag::OP_MUL: return Opcode::Mul;
+      case Tag::OP_DIV: return Opcode::Div;
+      case Tag::LESS: return Opcode::Lt;
+      case Tag::LE: return Opcode::Le;
+      case Tag::GREATER: return Opcode::Gt;
+      case Tag::GE: return Opcode::Ge;
+      case Tag::EQ: return Opcode::Eq;
+      case Tag::NE: return Opcode::Ne;
+      case Tag::AND: return Opcode::And;
+      case Tag::OR: return Opcode::Or;
+      default:
+        throw std::runtime_error("Unsupported operator in lowering");
+    }
+  }
+
+  void gen(Opcode op, Operand dst, Operand a = Operand(),
+           Operand b = Operand()) {
+    Instr in{op, std::move(dst), std::move(a), std::move(b)};
+    in.loc = loc;
+    fn.code.push_back(std::move(in));
+  }
+
+  void jump(Opcode op, Operand a, int target, Operand b = Operand()) {
+    Instr in{op, Operand(), std::move(a), std::move(b)};
+    in.label = target;
+    in.loc = loc;
+    fn.code.push_back(std::move(in));
+  }
+
+  void label(int l) {
+    Instr in{Opcode::Label};
+    in.label = l;
+    in.loc = loc;
+    fn.code.push_back(std::move(in));
+  }
+};
+
+}  // namespace
+
+Function lower(const sptr<ast::Stmt>& root, const symbols::Frame& frame,
+               const LowerOptions& options) {
+  Function fn;
+  fn.frame = frame;
+  Lowering(fn, options).stmt(root);
+  return fn;
+}
+
+}  // namespace ir
@@ -0,0 +1,65 @@
+/**
+ * @file Lower.hpp
+ * @brief Translation of the AST into three-address code.
+ */
+#pragma once
+#include "Frame.hpp"
+#include "IR.hpp"
+#include "Stmt.h"
+#include "sptr.h"
+
+namespace ir {
+
+/**
+ * @brief Options of lower().
+ */
+struct LowerOptions {
+  /**
+   * Conditions compile to jumping code: relational operators branch
+   * directly (`if a < b goto L`), `&&` and `||` skip their right operand
+   * once the result is known and `!` swaps the targets. When false, a
+   * condition is computed into a bool temporary and tested, and both
+   * operands of `&&`/`||` are always evaluated.
+   */
+  bool jumpingCode = true;
+
+  /**
+   * Every array index is checked against its dimension before use
+   * (`check 0 <= i < 8`). See opt::eliminateBoundsChecks() for removing
+   * the checks that cannot fail.
+   */
+  bool boundsChecks = false;
+
+  /**
+   * Element-wise loops `while (i < n) { a[i] = b[i] + c[i]; i = i + 1; }`
+   * get a vector loop in front of them that handles kLanes elements per
+   * iteration with the vector opcodes; the loop itself then runs the
+   * remaining iterations as the scalar epilogue. The body may hold several
+   * such stores of int or float elements, all indexed by the loop
+   * variable, over `+ - *` (and `/` for float) of elements, constants and
+   * variables. Ignored together with boundsChecks.
+   */
+  bool vectorize = false;
+};
+
+/**
+ * @brief Lower a program into three-address code.
+ *
+ * Every operator gets a fresh temporary, array accesses compute a byte
+ * offset (`index * element width`, summed over the dimensions) and loops
+ * are top-tested:
+ *
+ *     L1: if i >= n goto L2
+ *         ...body...
+ *         goto L1
+ *     L2:
+ *
+ * @param root Program root produced by parser::Parser::program().
+ * @param frame Variable layout of the program.
+ * @param options Code generation options.
+ * @return Lowered function; throws std::runtime_error on unsupported nodes.
+ */
+Function lower(const sptr<ast::Stmt>& root, const symbols::Frame& frame,
+               const LowerOptions& options = {});
+
+}  // namespace ir
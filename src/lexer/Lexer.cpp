@@ -10,8 +10,17 @@
 
 namespace lexer {
 
-Lexer::Lexer(std::istream& in) : input(in), loc{1, 0} {
-  // Register reserved keywords
+Lexer::Lexer(std::istream& in) : input(in), loc{1, 0} { reserveKeywords(); }
+
+void Lexer::reset() {
+  loc = {1, 0};
+  if (words.size() > kMaxWords) {
+    words.clear();
+    reserveKeywords();
+  }
+}
+
+void Lexer::reserveKeywords() {
   reserve(std::make_shared<Word>("if", Tag::IF));
   reserve(std::make_shared<Word>("else", Tag::ELSE));
   reserve(std::make_shared<Word>("while", Tag::WHILE));
@@ -29,6 +29,19 @@ struct Lexer : public ILexer {
    */
   explicit Lexer(std::istream& in);
 
+  /// Identifiers kept by reset() before the table is cut back to the
+  /// keywords.
+  static constexpr size_t kMaxWords = 4096;
+
+  /**
+   * @brief Start over at line 1 of the input, for the next program read
+   * from the same stream.
+   *
+   * The identifiers seen so far stay in the keyword table, as they would
+   * within one program, unless there are more than kMaxWords.
+   */
+  void reset();
+
   /**
    * @brief Registers a keyword.
    * @param w Word object.
@@ -51,6 +64,10 @@ struct Lexer : public ILexer {
 
   /// @copydoc ILexer::line()
   int line() const override { return loc.line; }
+
+ private:
+  /// Registers the reserved words.
+  void reserveKeywords();
 };
 
 }  // namespace lexer
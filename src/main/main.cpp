@@ -1,13 +1,12 @@
 ﻿/*!
 \file main.cpp
-\brief Creates Lexer, Parser, runs program(), transfer AST to code generator.
+\brief Command line of the compiler, see driver::run().
 
 */
+#include <iostream>
 
-int main() {
-  /*
-    Lexer lex = new Lexer();
-    Parser parse = new Parser(lex);
-    parse.program();
-  */
-}
\ No newline at end of file
+#include "Driver.hpp"
+
+int main(int argc, char** argv) {
+  return driver::run(argc, argv, std::cout, std::cerr);
+}
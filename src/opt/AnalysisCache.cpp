@@ -0,0 +1,37 @@
+/**
+ * @file AnalysisCache.cpp
+ * @brief Analyses of a function kept between passes.
+ */
+#include "AnalysisCache.hpp"
+
+namespace opt {
+
+const ir::Cfg& AnalysisCache::cfg() {
+  request(cfg_);
+  return get(cfg_, fn);
+}
+
+const ir::DominatorTree& AnalysisCache::dominators() {
+  request(dom_);
+  return get(dom_, get(cfg_, fn));
+}
+
+const ir::LoopInfo& AnalysisCache::loops() {
+  request(loops_);
+  const ir::Cfg& g = get(cfg_, fn);
+  return get(loops_, g, get(dom_, g));
+}
+
+const ir::Liveness& AnalysisCache::liveness() {
+  request(live_);
+  return get(live_, fn, get(cfg_, fn));
+}
+
+void AnalysisCache::invalidate() {
+  cfg_.value.reset();
+  dom_.value.reset();
+  loops_.value.reset();
+  live_.value.reset();
+}
+
+}  // namespace opt
@@ -0,0 +1,75 @@
+/**
+ * @file AnalysisCache.hpp
+ * @brief Analyses of a function kept between passes.
+ */
+#pragma once
+#include <memory>
+
+#include "Cfg.hpp"
+#include "IR.hpp"
+#include "Liveness.hpp"
+
+namespace opt {
+
+/**
+ * @brief Analyses of one Function, computed on first use and kept until
+ * the code changes.
+ *
+ * The analyses refer to instruction indices, so anything that edits the
+ * code must call invalidate(). Passes taking a cache do so themselves, and
+ * a pass that makes no change leaves the analyses it built for the next
+ * one. Dependent analyses are built on demand: asking for loops builds the
+ * Cfg and dominators first.
+ */
+class AnalysisCache {
+ public:
+  explicit AnalysisCache(const ir::Function& fn) : fn(fn) {}
+
+  const ir::Cfg& cfg();
+  const ir::DominatorTree& dominators();
+  const ir::LoopInfo& loops();
+  const ir::Liveness& liveness();
+
+  /// Drop everything computed so far.
+  void invalidate();
+
+  /// Requests from now on come from the next pass.
+  void nextPass() { ++pass; }
+
+  int built = 0;   ///< Analyses computed, accumulated
+  int reused = 0;  ///< Requests answered with an earlier pass's analysis
+
+ private:
+  /// A cached analysis and the pass that built it.
+  template <class T>
+  struct Slot {
+    std::unique_ptr<T> value;
+    int pass = 0;
+  };
+
+  const ir::Function& fn;
+  int pass = 0;
+  Slot<ir::Cfg> cfg_;
+  Slot<ir::DominatorTree> dom_;
+  Slot<ir::LoopInfo> loops_;
+  Slot<ir::Liveness> live_;
+
+  /// The analysis in @p s, built from @p args if there is none.
+  template <class T, class... Args>
+  const T& get(Slot<T>& s, const Args&... args) {
+    if (!s.value) {
+      ++built;
+      s.value = std::make_unique<T>(args...);
+      s.pass = pass;
+    }
+    return *s.value;
+  }
+
+  /// Count a request for @p s answered with an earlier pass's analysis.
+  template <class T>
+  void request(const Slot<T>& s) {
+    if (s.value && s.pass < pass) ++reused;
+  }
+};
+
+}  // namespace opt
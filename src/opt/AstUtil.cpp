@@ -0,0 +1,104 @@
+/**
+ * @file AstUtil.cpp
+ * @brief Small queries over the AST shared by the optimization passes.
+ */
+#include "AstUtil.hpp"
+
+namespace opt {
+
+void collectUses(const sptr<ast::Expr>& e, IdSet& out) {
+  if (!e) return;
+  if (auto id = std::dynamic_pointer_cast<ast::IdExpr>(e)) {
+    out.insert(id->sym.get());
+  } else if (auto op = std::dynamic_pointer_cast<ast::Op>(e)) {
+    collectUses(op->lhs, out);
+    collectUses(op->rhs, out);
+  } else if (auto un = std::dynamic_pointer_cast<ast::Unary>(e)) {
+    collectUses(un->expr, out);
+  } else if (auto acc = std::dynamic_pointer_cast<ast::Access>(e)) {
+    collectUses(acc->array, out);
+    collectUses(acc->index, out);
+  }
+}
+
+void collectRefs(const sptr<ast::Stmt>& s, IdSet& out) {
+  if (!s) return;
+  if (auto seq = std::dynamic_pointer_cast<ast::Seq>(s)) {
+    sptr<ast::Stmt> cur = s;
+    for (; seq; seq = std::dynamic_pointer_cast<ast::Seq>(cur)) {
+      collectRefs(seq->first, out);
+      cur = seq->second;
+    }
+    collectRefs(cur, out);
+  } else if (auto node = std::dynamic_pointer_cast<ast::If>(s)) {
+    collectUses(node->condition, out);
+    collectRefs(node->thenStmt, out);
+  } else if (auto node = std::dynamic_pointer_cast<ast::Else>(s)) {
+    collectUses(node->condition, out);
+    collectRefs(node->thenStmt, out);
+    collectRefs(node->elseStmt, out);
+  } else if (auto node = std::dynamic_pointer_cast<ast::While>(s)) {
+    collectUses(node->condition, out);
+    collectRefs(node->body, out);
+  } else if (auto node = std::dynamic_pointer_cast<ast::Do>(s)) {
+    collectRefs(node->body, out);
+    collectUses(node->condition, out);
+  } else if (auto node = std::dynamic_pointer_cast<ast::Set>(s)) {
+    collectUses(node->id, out);
+    collectUses(node->expr, out);
+  } else if (auto node = std::dynamic_pointer_cast<ast::SetElem>(s)) {
+    collectUses(node->arrayAccess, out);
+    collectUses(node->expr, out);
+  }
+}
+
+const symbols::Id* baseVar(const ast::Expr& e) {
+  const ast::Expr* cur = &e;
+  while (auto acc = dynamic_cast<const ast::Access*>(cur)) cur = acc->array.get();
+  if (auto id = dynamic_cast<const ast::IdExpr*>(cur)) return id->sym.get();
+  return nullptr;
+}
+
+std::vector<sptr<ast::Stmt>*> seqItems(sptr<ast::Stmt>& s) {
+  std::vector<sptr<ast::Stmt>*> items;
+  sptr<ast::Stmt>* cur = &s;
+  while (auto seq = std::dynamic_pointer_cast<ast::Seq>(*cur)) {
+    items.push_back(&seq->first);
+    cur = &seq->second;
+  }
+  items.push_back(cur);
+  return items;
+}
+
+bool isEmpty(const sptr<ast::Stmt>& s) {
+  sptr<ast::Stmt> cur = s;
+  while (auto seq = std::dynamic_pointer_cast<ast::Seq>(cur)) {
+    if (!isEmpty(seq->first)) return false;
+    cur = seq->second;
+  }
+  return !cur;
+}
+
+int countStmts(const sptr<ast::Stmt>& s) {
+  if (!s) return 0;
+  if (auto seq = std::dynamic_pointer_cast<ast::Seq>(s)) {
+    int n = 0;
+    sptr<ast::Stmt> cur = s;
+    for (; seq; seq = std::dynamic_pointer_cast<ast::Seq>(cur)) {
+      n += countStmts(seq->first);
+      cur = seq->second;
+    }
+    return n + countStmts(cur);
+  }
+  if (auto node = std::dynamic_pointer_cast<ast::If>(s))
+    return 1 + countStmts(node->thenStmt);
+  if (auto node = std::dynamic_pointer_cast<ast::Else>(s))
+    return 1 + countStmts(node->thenStmt) + countStmts(node->elseStmt);
+  if (auto node = std::dynamic_pointer_cast<ast::While>(s))
+    return 1 + countStmts(node->body);
+  if (auto node = std::dynamic_pointer_cast<ast::Do>(s))
+    return 1 + countStmts(node->body);
+  return 1;
+}
+
+}  // namespace opt
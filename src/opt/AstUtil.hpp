@@ -0,0 +1,54 @@
+/**
+ * @file AstUtil.hpp
+ * @brief Small queries over the AST shared by the optimization passes.
+ */
+#pragma once
+#include <unordered_set>
+#include <vector>
+
+#include "Expr.hpp"
+#include "Id.hpp"
+#include "Stmt.h"
+#include "sptr.h"
+
+namespace opt {
+
+/// Set of variables, keyed by descriptor identity.
+using IdSet = std::unordered_set<const symbols::Id*>;
+
+/**
+ * @brief Add every variable read by @p e to @p out.
+ */
+void collectUses(const sptr<ast::Expr>& e, IdSet& out);
+
+/**
+ * @brief Add every variable mentioned anywhere in @p s to @p out.
+ */
+void collectRefs(const sptr<ast::Stmt>& s, IdSet& out);
+
+/**
+ * @brief Array variable at the root of an Access chain (a in a[i][j]).
+ * @return Descriptor, or nullptr if the root is not a named variable.
+ */
+const symbols::Id* baseVar(const ast::Expr& e);
+
+/**
+ * @brief Flatten a chain of Seq nodes into the slots holding its elements.
+ *
+ * Nested Seqs reached through `first` are kept as single elements; only the
+ * `second` spine is unrolled, so long statement lists are walked without
+ * recursion.
+ */
+std::vector<sptr<ast::Stmt>*> seqItems(sptr<ast::Stmt>& s);
+
+/**
+ * @brief True if @p s contains no statement other than empty Seqs.
+ */
+bool isEmpty(const sptr<ast::Stmt>& s);
+
+/**
+ * @brief Number of statements in @p s, not counting Seq nodes.
+ */
+int countStmts(const sptr<ast::Stmt>& s);
+
+}  // namespace opt
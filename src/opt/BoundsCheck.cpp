@@ -0,0 +1,432 @@
+/**
+ * @file BoundsCheck.cpp
+ * @brief Removal of array bounds checks that cannot fail.
+ */
+#include "BoundsCheck.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+#include "Cfg.hpp"
+#include "IrUtil.hpp"
+
+namespace opt {
+namespace {
+
+using ir::Instr;
+using ir::Opcode;
+using ir::Operand;
+using symbols::Type;
+
+constexpr int64_t kMin = std::numeric_limits<int32_t>::min();
+constexpr int64_t kMax = std::numeric_limits<int32_t>::max();
+
+/// Closed interval of possible values.
+struct Range {
+  int64_t lo = kMin;
+  int64_t hi = kMax;
+
+  bool empty() const { return lo > hi; }
+  bool operator==(const Range& o) const { return lo == o.lo && hi == o.hi; }
+  bool operator!=(const Range& o) const { return !(*this == o); }
+};
+
+bool tracked(const sptr<Type>& t) {
+  return t == Type::Int || t == Type::Char || t == Type::Bool;
+}
+
+Range typeRange(const sptr<Type>& t) {
+  if (t == Type::Bool) return {0, 1};
+  if (t == Type::Char) return {-128, 127};
+  return {kMin, kMax};
+}
+
+/// Values outside the type wrap around, so anything may result.
+Range fit(Range r, const sptr<Type>& t) {
+  Range tr = typeRange(t);
+  return r.lo < tr.lo || r.hi > tr.hi ? tr : r;
+}
+
+Range join(const Range& a, const Range& b) {
+  return {std::min(a.lo, b.lo), std::max(a.hi, b.hi)};
+}
+
+/// Ranges of the tracked variables and temporaries at a program point.
+struct State {
+  bool reached = false;
+  std::vector<Range> vals;  ///< slot -> range
+};
+
+class RangeAnalysis {
+ public:
+  /// Only operands a check's range depends on get a slot: check operands,
+  /// the operands of instructions defining a slot and the other side of
+  /// comparisons that narrow one.
+  RangeAnalysis(const ir::Function& f, const ir::Cfg& c)
+      : fn(f), cfg(c), tempSlots(fn.numTemps + 1, -1) {
+    entry.reached = true;
+    for (const Instr& in : fn.code)
+      if (in.op == Opcode::Check) {
+        track(in.a);
+        track(in.b);
+      }
+    bool grew = !entry.vals.empty();
+    while (grew) {
+      grew = false;
+      for (const Instr& in : fn.code) {
+        bool feeds = in.isCompareJump()
+                         ? slot(in.a) >= 0 || slot(in.b) >= 0
+                         : in.hasResult() && slot(in.dst) >= 0;
+        if (!feeds) continue;
+        grew |= track(in.a);
+        grew |= track(in.b);
+      }
+    }
+  }
+
+  std::vector<State> in;  ///< block -> state at its start
+
+  void solve() {
+    int nb = static_cast<int>(cfg.blocks.size());
+    in.assign(nb, State());
+    std::vector<int> rpo = cfg.reversePostOrder();
+    std::vector<int> order(nb, nb);
+    for (size_t i = 0; i < rpo.size(); ++i) order[rpo[i]] = static_cast<int>(i);
+
+    // Ascending phase, widening on retreating edges.
+    in[0] = entry;
+    std::vector<std::pair<int, State>> outs;
+    bool changed = true;
+    while (changed) {
+      changed = false;
+      for (int b : rpo) {
+        if (!in[b].reached) continue;
+        edges(b, in[b], outs);
+        for (auto& [s, st] : outs)
+          changed |= merge(in[s], st, order[s] <= order[b]);
+      }
+    }
+
+    // Descending phase recovers bounds lost to widening.
+    for (int round = 0; round < 3; ++round) {
+      for (int b : rpo) {
+        State next = b == 0 ? entry : State();
+        for (int p : cfg.blocks[b].preds) {
+          if (!in[p].reached) continue;
+          edges(p, in[p], outs);
+          for (auto& [s, st] : outs)
+            if (s == b) merge(next, st, false);
+        }
+        in[b] = std::move(next);
+      }
+    }
+  }
+
+  Range get(const State& st, const Operand& o) const {
+    if (o.isConst()) {
+      if (o.isFloat()) return Range();
+      return {o.ival, o.ival};
+    }
+    int s = slot(o);
+    if (s >= 0) return st.vals[s];
+    return o.type && tracked(o.type) ? typeRange(o.type) : Range();
+  }
+
+  /// Transfer function of a non-jump instruction.
+  void step(State& st, const Instr& in) const {
+    if (in.op == Opcode::Check) {
+      int s = slot(in.a);
+      if (s < 0) return;
+      Range r = st.vals[s];
+      r.lo = std::max<int64_t>(r.lo, 0);
+      r.hi = std::min(r.hi, get(st, in.b).hi - 1);
+      if (r.empty())
+        st.reached = false;
+      else
+        st.vals[s] = r;
+      return;
+    }
+    if (!in.hasResult()) return;
+    int s = slot(in.dst);
+    if (s >= 0) st.vals[s] = fit(compute(st, in), in.dst.type);
+  }
+
+ private:
+  const ir::Function& fn;
+  const ir::Cfg& cfg;
+  std::unordered_map<const symbols::Id*, int> varSlots;
+  std::vector<int> tempSlots;  ///< temp -> slot, -1 if not tracked
+  State entry;
+
+  int slot(const Operand& o) const {
+    if (o.isTemp()) return tempSlots[o.temp];
+    if (o.isVar()) {
+      auto it = varSlots.find(o.var);
+      return it == varSlots.end() ? -1 : it->second;
+    }
+    return -1;
+  }
+
+  /// Give @p o a slot; true if it had none. Variables start at zero.
+  bool track(const Operand& o) {
+    if (!(o.isTemp() || o.isVar()) || !tracked(o.type) || slot(o) >= 0)
+      return false;
+    int s = static_cast<int>(entry.vals.size());
+    if (o.isTemp())
+      tempSlots[o.temp] = s;
+    else
+      varSlots.emplace(o.var, s);
+    entry.vals.push_back(o.isVar() ? Range{0, 0} : Range());
+    return true;
+  }
+
+  Range compute(const State& st, const Instr& in) const {
+    Range a = get(st, in.a), b = get(st, in.b);
+    switch (in.op) {
+      case Opcode::Copy:
+        return a;
+      case Opcode::Cvt:
+        return in.a.isFloat() ? typeRange(in.dst.type) : a;
+      case Opcode::Add:
+        return {a.lo + b.lo, a.hi + b.hi};
+      case Opcode::Sub:
+        return {a.lo - b.hi, a.hi - b.lo};
+      case Opcode::Mul: {
+        int64_t p[] = {a.lo * b.lo, a.lo * b.hi, a.hi * b.lo, a.hi * b.hi};
+        return {*std::min_element(p, p + 4), *std::max_element(p, p + 4)};
+      }
+      case Opcode::Div: {
+        if (b.lo <= 0 && b.hi >= 0) return typeRange(in.dst.type);
+        int64_t p[] = {a.lo / b.lo, a.lo / b.hi, a.hi / b.lo, a.hi / b.hi};
+        return {*std::min_element(p, p + 4), *std::max_element(p, p + 4)};
+      }
+      case Opcode::Neg:
+        return {-a.hi, -a.lo};
+      case Opcode::Not:
+      case Opcode::Lt:
+      case Opcode::Le:
+      case Opcode::Gt:
+      case Opcode::Ge:
+      case Opcode::Eq:
+      case Opcode::Ne:
+      case Opcode::And:
+      case Opcode::Or:
+        return {0, 1};
+      default:
+        return typeRange(in.dst.type);
+    }
+  }
+
+  /// States flowing out of block @p b along each successor edge.
+  void edges(int b, const State& start,
+             std::vector<std::pair<int, State>>& out) const {
+    out.clear();
+    const ir::BasicBlock& bb = cfg.blocks[b];
+    State st = start;
+    for (int i = bb.begin; i < bb.end; ++i) {
+      if (!st.reached) return;
+      if (!fn.code[i].isJump()) step(st, fn.code[i]);
+    }
+    if (!st.reached) return;
+
+    const Instr& last = fn.code[bb.end - 1];
+    if (!last.isJump()) {
+      if (!bb.succs.empty()) out.emplace_back(bb.succs[0], st);
+      return;
+    }
+    int taken = bb.succs[0];
+    if (last.op == Opcode::Jump) {
+      out.emplace_back(taken, st);
+      return;
+    }
+    int fall = b + 1 < static_cast<int>(cfg.blocks.size()) ? b + 1 : -1;
+    State yes = st, no = st;
+    if (last.isCompareJump() && !last.a.isFloat() && !last.b.isFloat()) {
+      Opcode rel = ir::compareOf(last.op);
+      refine(yes, rel, last.a, last.b);
+      refine(no, ir::negate(rel), last.a, last.b);
+    }
+    if (yes.reached) out.emplace_back(taken, std::move(yes));
+    if (fall >= 0 && no.reached) out.emplace_back(fall, std::move(no));
+  }
+
+  /// Narrow the operands of `a rel b` assuming the relation holds.
+  void refine(State& st, Opcode rel, const Operand& a, const Operand& b) const {
+    Range x = get(st, a), y = get(st, b);
+    switch (rel) {
+      case Opcode::Lt:
+        x.hi = std::min(x.hi, y.hi - 1);
+        y.lo = std::max(y.lo, x.lo + 1);
+        break;
+      case Opcode::Le:
+        x.hi = std::min(x.hi, y.hi);
+        y.lo = std::max(y.lo, x.lo);
+        break;
+      case Opcode::Gt:
+        x.lo = std::max(x.lo, y.lo + 1);
+        y.hi = std::min(y.hi, x.hi - 1);
+        break;
+      case Opcode::Ge:
+        x.lo = std::max(x.lo, y.lo);
+        y.hi = std::min(y.hi, x.hi);
+        break;
+      case Opcode::Eq:
+        x.lo = y.lo = std::max(x.lo, y.lo);
+        x.hi = y.hi = std::min(x.hi, y.hi);
+        break;
+      default:  // Ne: only an excluded end point helps
+        if (y.lo == y.hi) {
+          if (x.lo == y.lo) ++x.lo;
+          if (x.hi == y.lo) --x.hi;
+        }
+        if (x.lo == x.hi) {
+          if (y.lo == x.lo) ++y.lo;
+          if (y.hi == x.lo) --y.hi;
+        }
+        break;
+    }
+    if (x.empty() || y.empty()) {
+      st.reached = false;
+      return;
+    }
+    if (int s = slot(a); s >= 0) st.vals[s] = x;
+    if (int s = slot(b); s >= 0) st.vals[s] = y;
+  }
+
+  /// Join @p from into @p into; true if @p into changed.
+  static bool merge(State& into, const State& from, bool widen) {
+    if (!from.reached) return false;
+    if (!into.reached) {
+      into = from;
+      return true;
+    }
+    bool changed = false;
+    for (size_t i = 0; i < into.vals.size(); ++i) {
+      Range old = into.vals[i];
+      Range r = join(old, from.vals[i]);
+      if (widen) {
+        if (r.lo < old.lo) r.lo = kMin;
+        if (r.hi > old.hi) r.hi = kMax;
+      }
+      if (r != old) {
+        into.vals[i] = r;
+        changed = true;
+      }
+    }
+    return changed;
+  }
+};
+
+/// Remove the checks the range analysis proves; returns how many.
+int removeProven(ir::Function& fn, AnalysisCache& cache,
+                 BoundsStats& stats) {
+  const ir::Cfg& cfg = cache.cfg();
+  RangeAnalysis ranges(fn, cfg);
+  ranges.solve();
+
+  std::vector<char> drop(fn.code.size(), 0);
+  int removed = 0;
+  for (size_t b = 0; b < cfg.blocks.size(); ++b) {
+    State st = ranges.in[b];
+    for (int i = cfg.blocks[b].begin; i < cfg.blocks[b].end; ++i) {
+      const Instr& in = fn.code[i];
+      if (in.op == Opcode::Check) {
+        ++stats.checks;
+        if (st.reached) {
+          Range idx = ranges.get(st, in.a);
+          Range size = ranges.get(st, in.b);
+          if (idx.lo >= 0 && idx.hi < size.lo) {
+            drop[i] = 1;
+            ++removed;
+          }
+        }
+      }
+      if (st.reached && !in.isJump()) ranges.step(st, in);
+    }
+  }
+
+  if (removed) {
+    std::vector<Instr> out;
+    out.reserve(fn.code.size() - removed);
+    for (size_t i = 0; i < fn.code.size(); ++i)
+      if (!drop[i]) out.push_back(std::move(fn.code[i]));
+    fn.code = std::move(out);
+    cache.invalidate();
+  }
+  stats.eliminated += removed;
+  return removed;
+}
+
+/// Hoist invariant checks out of every loop that has any, one loop per
+/// nest; false if none has.
+bool hoistOnce(ir::Function& fn, AnalysisCache& cache, BoundsStats& stats) {
+  const ir::Cfg& cfg = cache.cfg();
+  const ir::DominatorTree& dom = cache.dominators();
+  const ir::LoopInfo& li = cache.loops();
+  TempDefs defs(fn);
+
+  LoopEdit edit(fn, cfg);
+  bool any = false;
+  for (const ir::Loop& loop : li.loops) {
+    if (edit.overlaps(loop)) continue;
+    std::unordered_set<const symbols::Id*> written;
+    for (int b : loop.blocks)
+      for (int i = cfg.blocks[b].begin; i < cfg.blocks[b].end; ++i)
+        if (fn.code[i].hasResult() && fn.code[i].dst.isVar())
+          written.insert(fn.code[i].dst.var);
+
+    auto invariant = [&](const Operand& o) {
+      if (o.isConst()) return true;
+      if (o.isVar()) return !written.count(o.var);
+      if (!defs.single(o)) return false;
+      int b = cfg.blockOf[defs.index[o.temp]];
+      return !loop.contains(b) && dom.dominates(b, loop.header);
+    };
+
+    std::vector<Instr> hoist;
+    for (int b : loop.blocks) {
+      bool always = true;
+      for (int e : loop.exits) always &= dom.dominates(b, e);
+      for (int l : loop.latches) always &= dom.dominates(b, l);
+      if (!always) continue;
+      for (int i = cfg.blocks[b].begin; i < cfg.blocks[b].end; ++i) {
+        const Instr& in = fn.code[i];
+        if (in.op != Opcode::Check || !invariant(in.a) || !invariant(in.b))
+          continue;
+        hoist.push_back(in);
+        edit.drop[i] = 1;
+      }
+    }
+    if (hoist.empty()) continue;
+    stats.hoisted += static_cast<int>(hoist.size());
+    edit.preheader[loop.header] = std::move(hoist);
+    edit.claim(loop);
+    any = true;
+  }
+  if (!any) return false;
+  applyLoopEdit(fn, cfg, li, edit);
+  cache.invalidate();
+  return true;
+}
+
+}  // namespace
+
+bool eliminateBoundsChecks(ir::Function& fn, BoundsStats* stats) {
+  AnalysisCache cache(fn);
+  return eliminateBoundsChecks(fn, cache, stats);
+}
+
+bool eliminateBoundsChecks(ir::Function& fn, AnalysisCache& cache,
+                           BoundsStats* stats) {
+  BoundsStats local;
+  BoundsStats& st = stats ? *stats : local;
+  bool any = removeProven(fn, cache, st) > 0;
+  while (hoistOnce(fn, cache, st)) any = true;
+  return any;
+}
+
+}  // namespace opt
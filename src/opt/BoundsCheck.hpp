@@ -0,0 +1,48 @@
+/**
+ * @file BoundsCheck.hpp
+ * @brief Removal of array bounds checks that cannot fail.
+ */
+#pragma once
+#include "AnalysisCache.hpp"
+#include "IR.hpp"
+
+namespace opt {
+
+/**
+ * @brief Counters collected by eliminateBoundsChecks().
+ */
+struct BoundsStats {
+  int checks = 0;      /**< Check instructions found */
+  int eliminated = 0;  /**< Checks proven to pass and removed */
+  int hoisted = 0;     /**< Checks moved out of a loop */
+};
+
+/**
+ * @brief Remove provably redundant bounds checks and hoist invariant ones.
+ *
+ * Runs an interval analysis over the int, char and bool variables and
+ * temporaries of @p fn. Conditional jumps narrow the ranges of their
+ * operands on each edge and loop headers are widened, then narrowed again,
+ * so induction variables get the bounds of their loop test: in
+ * `while (i < 8) a[i] = ...` the index is known to lie in [0, 7]. A passed
+ * check also narrows its index for the code that follows. Variables start
+ * at zero, like the interpreter's frame.
+ *
+ * A check whose index range lies within the dimension is removed. A check
+ * of a loop-invariant index that runs on every iteration (same rule as
+ * hoistLoopInvariants() uses for instructions that can trap) moves into
+ * the loop preheader. Checks of indices bounded only by values unknown at
+ * compile time stay where they are.
+ *
+ * @param fn Function lowered with ir::LowerOptions::boundsChecks.
+ * @param stats Optional counters, accumulated into.
+ * @return True if any check was removed or moved.
+ */
+bool eliminateBoundsChecks(ir::Function& fn, BoundsStats* stats = nullptr);
+
+/// eliminateBoundsChecks() using the analyses in @p cache, which is invalidated
+/// when the code changes.
+bool eliminateBoundsChecks(ir::Function& fn, AnalysisCache& cache,
+                           BoundsStats* stats = nullptr);
+
+}  // namespace opt
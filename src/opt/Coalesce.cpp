@@ -0,0 +1,259 @@
+/**
+ * @file Coalesce.cpp
+ * @brief Copy propagation and coalescing of temporaries.
+ */
+#include "Coalesce.hpp"
+
+#include <algorithm>
+#include <map>
+#include <utility>
+
+#include "IrUtil.hpp"
+
+namespace opt {
+namespace {
+
+using ir::Instr;
+using ir::Opcode;
+using ir::Operand;
+
+/// Temporary written by @p in, or 0.
+int defOf(const Instr& in) {
+  return in.hasResult() && in.dst.isTemp() ? in.dst.temp : 0;
+}
+
+bool reads(const Instr& in, const Operand& o) {
+  std::vector<const Operand*> ops;
+  ir::uses(in, ops);
+  for (const Operand* u : ops)
+    if (u->same(o)) return true;
+  return false;
+}
+
+bool mayTrap(const Instr& in) {
+  switch (in.op) {
+    case Opcode::Div:
+    case Opcode::VDiv:
+    case Opcode::Load:
+    case Opcode::VLoad:
+    case Opcode::Check:
+      return true;
+    default:
+      return false;
+  }
+}
+
+/// Replace reads of single-assignment copies by the copied value.
+int forward(ir::Function& fn, const ir::Cfg& cfg, const TempDefs& defs) {
+  int replaced = 0;
+  auto copyOf = [&](const Instr& in) {
+    return in.op == Opcode::Copy && defs.single(in.dst) &&
+           in.dst.type == in.a.type;
+  };
+
+  // Constants and single-assignment temporaries hold anywhere after the
+  // copy, which precedes every read of its destination.
+  std::vector<Operand> value(fn.numTemps + 1);
+  for (const Instr& in : fn.code) {
+    if (!copyOf(in) || !(in.a.isConst() || defs.single(in.a))) continue;
+    value[in.dst.temp] =
+        in.a.isTemp() && !value[in.a.temp].isNone() ? value[in.a.temp] : in.a;
+  }
+  for (Instr& in : fn.code) {
+    if (in.op == Opcode::Label || in.op == Opcode::Jump) continue;
+    for (Operand* o : {&in.a, &in.b})
+      if (o->isTemp() && !value[o->temp].isNone()) {
+        *o = value[o->temp];
+        ++replaced;
+      }
+  }
+
+  // Variables only until they are written, within one block
+  std::vector<Operand> var(fn.numTemps + 1);
+  std::vector<int> held;
+  for (const ir::BasicBlock& bb : cfg.blocks) {
+    for (int t : held) var[t] = Operand();
+    held.clear();
+    for (int i = bb.begin; i < bb.end; ++i) {
+      Instr& in = fn.code[i];
+      if (in.op != Opcode::Label && in.op != Opcode::Jump)
+        for (Operand* o : {&in.a, &in.b})
+          if (o->isTemp() && !var[o->temp].isNone()) {
+            *o = var[o->temp];
+            ++replaced;
+          }
+      if (in.hasResult() && in.dst.isVar())
+        for (int t : held)
+          if (var[t].var == in.dst.var) var[t] = Operand();
+      if (copyOf(in) && in.a.isVar()) {
+        var[in.dst.temp] = in.a;
+        held.push_back(in.dst.temp);
+      }
+    }
+  }
+  return replaced;
+}
+
+/// Write results straight into the destination of their only reader.
+int retarget(ir::Function& fn, const ir::Cfg& cfg, const TempDefs& defs) {
+  std::vector<int> readers(fn.numTemps + 1, 0);
+  std::vector<const Operand*> ops;
+  for (const Instr& in : fn.code) {
+    ops.clear();
+    ir::uses(in, ops);
+    for (const Operand* o : ops)
+      if (o->isTemp()) ++readers[o->temp];
+  }
+
+  int done = 0;
+  std::vector<char> drop(fn.code.size(), 0);
+  for (int u = 0; u < static_cast<int>(fn.code.size()); ++u) {
+    const Instr& cp = fn.code[u];
+    if (cp.op != Opcode::Copy || !defs.single(cp.a) ||
+        readers[cp.a.temp] != 1 || cp.dst.same(cp.a))
+      continue;
+    int d = defs.index[cp.a.temp];
+    Instr& def = fn.code[d];
+    if (d >= u || cfg.blockOf[d] != cfg.blockOf[u] || def.isVector() ||
+        def.dst.type != cp.dst.type)
+      continue;
+    bool clear = true;
+    for (int k = d + 1; k < u && clear; ++k) {
+      const Instr& in = fn.code[k];
+      if (drop[k]) continue;
+      clear = !reads(in, cp.dst) &&
+              !(in.hasResult() && in.dst.same(cp.dst)) &&
+              !(cp.dst.isVar() && mayTrap(in));
+    }
+    if (!clear) continue;
+    def.dst = cp.dst;
+    drop[u] = 1;
+    ++done;
+  }
+  if (!done) return 0;
+  std::vector<Instr> out;
+  out.reserve(fn.code.size());
+  for (size_t i = 0; i < fn.code.size(); ++i)
+    if (!drop[i]) out.push_back(std::move(fn.code[i]));
+  fn.code = std::move(out);
+  return done;
+}
+
+}  // namespace
+
+TempFootprint tempFootprint(const ir::Function& fn) {
+  std::vector<int> width(fn.numTemps + 1, -1);
+  for (const Instr& in : fn.code)
+    for (const Operand* o : {&in.dst, &in.a, &in.b}) {
+      if (!o->isTemp()) continue;
+      int w = o->type ? o->type->width : 0;
+      if (o == &in.dst && in.isVector() && in.hasResult()) w *= ir::kLanes;
+      width[o->temp] = std::max(width[o->temp], w);
+    }
+  TempFootprint f;
+  for (int w : width)
+    if (w >= 0) {
+      ++f.temps;
+      f.bytes += w;
+    }
+  return f;
+}
+
+bool propagateCopies(ir::Function& fn, CoalesceStats* stats) {
+  CoalesceStats local;
+  CoalesceStats& st = stats ? *stats : local;
+  bool any = false;
+  for (bool changed = true; changed;) {
+    ir::Cfg cfg(fn);
+    int f = forward(fn, cfg, TempDefs(fn));
+    int r = retarget(fn, cfg, TempDefs(fn));
+    int dead = removeDeadTemps(fn);
+    st.propagated += f;
+    st.retargeted += r;
+    changed = f || r || dead;
+    any = any || changed;
+  }
+  return any;
+}
+
+bool coalesceTemps(ir::Function& fn, CoalesceStats* stats) {
+  ir::Cfg cfg(fn);
+  ir::Liveness live(fn, cfg);
+  return coalesceTemps(fn, cfg, live, stats);
+}
+
+bool coalesceTemps(ir::Function& fn, const ir::Cfg& cfg,
+                   const ir::Liveness& live, CoalesceStats* stats) {
+  CoalesceStats local;
+  CoalesceStats& st = stats ? *stats : local;
+  TempFootprint before = tempFootprint(fn);
+  st.tempsBefore += before.temps;
+  st.bytesBefore += before.bytes;
+
+  int nt = fn.numTemps + 1;
+  std::vector<ir::LiveRange> range = ir::liveRanges(fn, cfg, live);
+  std::vector<char> vec(nt, 0);
+  std::vector<const symbols::Type*> type(nt, nullptr);
+  for (const Instr& in : fn.code)
+    for (const Operand* o : {&in.dst, &in.a, &in.b}) {
+      if (!o->isTemp()) continue;
+      type[o->temp] = o->type.get();
+      if (o == &in.dst && in.isVector() && in.hasResult()) vec[o->temp] = 1;
+    }
+
+  std::vector<int> order;
+  for (int t = 1; t < nt; ++t)
+    if (range[t].end >= 0) order.push_back(t);
+  std::sort(order.begin(), order.end(), [&](int a, int b) {
+    return std::make_pair(range[a].start, a) <
+           std::make_pair(range[b].start, b);
+  });
+
+  using Class = std::pair<const symbols::Type*, char>;
+  std::map<Class, std::vector<int>> free;
+  std::multimap<int, int> active;  // end -> temp
+  std::vector<int> slot(nt, -1);
+  int slots = 0;
+  for (int t : order) {
+    int s = range[t].start;
+    while (!active.empty() && active.begin()->first < s) {
+      int u = active.begin()->second;
+      free[{type[u], vec[u]}].push_back(slot[u]);
+      active.erase(active.begin());
+    }
+    Class key{type[t], vec[t]};
+    std::vector<int>& avail = free[key];
+    if (!avail.empty()) {
+      slot[t] = avail.back();
+      avail.pop_back();
+    } else {
+      // Take over from a temporary whose last read is the defining
+      // instruction itself, unless either is live across that point
+      const Instr& in = fn.code[s];
+      if (!range[t].enters && defOf(in) == t && !reads(in, in.dst)) {
+        auto ends = active.equal_range(s);
+        for (auto it = ends.first; it != ends.second; ++it) {
+          int u = it->second;
+          if (range[u].leaves || Class{type[u], vec[u]} != key) continue;
+          slot[t] = slot[u];
+          active.erase(it);
+          break;
+        }
+      }
+      if (slot[t] < 0) slot[t] = slots++;
+    }
+    active.emplace(range[t].end, t);
+  }
+
+  for (Instr& in : fn.code)
+    for (Operand* o : {&in.dst, &in.a, &in.b})
+      if (o->isTemp()) o->temp = slot[o->temp] + 1;
+  fn.numTemps = slots;
+
+  TempFootprint after = tempFootprint(fn);
+  st.tempsAfter += after.temps;
+  st.bytesAfter += after.bytes;
+  return after.temps < before.temps;
+}
+
+}  // namespace opt
@@ -0,0 +1,81 @@
+/**
+ * @file Coalesce.hpp
+ * @brief Copy propagation and coalescing of temporaries.
+ */
+#pragma once
+#include "Cfg.hpp"
+#include "IR.hpp"
+#include "Liveness.hpp"
+
+namespace opt {
+
+/**
+ * @brief Counters collected by propagateCopies() and coalesceTemps().
+ */
+struct CoalesceStats {
+  int propagated = 0;  /**< Reads replaced by the value a copy moved */
+  int retargeted = 0;  /**< `t = a op b; x = t` turned into `x = a op b` */
+  int tempsBefore = 0; /**< Distinct temporaries before coalescing */
+  int tempsAfter = 0;  /**< Distinct temporaries after coalescing */
+  int bytesBefore = 0; /**< Temporary slot bytes before coalescing */
+  int bytesAfter = 0;  /**< Temporary slot bytes after coalescing */
+};
+
+/**
+ * @brief Distinct temporaries of a function and the frame bytes they need.
+ *
+ * A temporary takes a slot as wide as its type, kLanes of them for the
+ * results of vector instructions.
+ */
+struct TempFootprint {
+  int temps = 0;
+  int bytes = 0;
+};
+
+TempFootprint tempFootprint(const ir::Function& fn);
+
+/**
+ * @brief Forward copies into their readers and results into their copies.
+ *
+ * A single-assignment temporary `t = v` is replaced by `v` wherever it is
+ * read when `v` is a constant or another single-assignment temporary; when
+ * `v` is a variable, only reads in the same block with no write of the
+ * variable in between are replaced. In the other direction,
+ * `t = a op b; ... x = t` becomes `x = a op b` when `t` is read only by
+ * the copy, in the same block, and `x` is neither read nor written in
+ * between. Copies left without readers are removed, so lowering's
+ * `t1 = x; t2 = t1 + 1; y = t2` becomes `y = x + 1`.
+ *
+ * @param fn Function to transform.
+ * @param stats Optional counters, accumulated into.
+ * @return True if the code changed.
+ */
+bool propagateCopies(ir::Function& fn, CoalesceStats* stats = nullptr);
+
+/**
+ * @brief Renumber temporaries so those never live at once share a number.
+ *
+ * Live ranges come from Liveness: a temporary occupies the code from its
+ * first to its last mention, stretched over every block it is live into or
+ * out of. A linear scan over the ranges in code order hands out numbers,
+ * reusing one as soon as its range has ended, and only between temporaries
+ * of the same type and shape, so a number still names a slot of one fixed
+ * width. A temporary last read by the instruction that defines another may
+ * pass its number on, since operands are read before the result is
+ * written. Function::numTemps becomes the number of slots needed.
+ *
+ * Coalesced temporaries are assigned more than once, which the passes
+ * relying on single-assignment temporaries (LICM, strength reduction,
+ * unrolling) no longer recognize, so this goes last.
+ *
+ * @param fn Function to transform.
+ * @param stats Optional counters, accumulated into.
+ * @return True if the number of temporaries went down.
+ */
+bool coalesceTemps(ir::Function& fn, CoalesceStats* stats = nullptr);
+
+/// coalesceTemps() with the analyses of @p fn already at hand.
+bool coalesceTemps(ir::Function& fn, const ir::Cfg& cfg,
+                   const ir::Liveness& live, CoalesceStats* stats = nullptr);
+
+}  // namespace opt
@@ -0,0 +1,200 @@
+/**
+ * @file DeadCode.cpp
+ * @brief Dead store, unreachable code and unused variable elimination.
+ */
+#include "DeadCode.hpp"
+
+#include "AstUtil.hpp"
+#include "Expr.hpp"
+
+namespace opt {
+namespace {
+
+/// True if @p s never completes normally (every path ends in break).
+/// Statements following such a statement in a Seq are removed.
+bool dropUnreachable(sptr<ast::Stmt>& s, DeadCodeStats& stats) {
+  if (!s) return false;
+  if (std::dynamic_pointer_cast<ast::Break>(s)) return true;
+
+  if (std::dynamic_pointer_cast<ast::Seq>(s)) {
+    auto items = seqItems(s);
+    for (size_t i = 0; i < items.size(); ++i) {
+      if (!dropUnreachable(*items[i], stats)) continue;
+      for (size_t j = i + 1; j < items.size(); ++j) {
+        stats.unreachableRemoved += countStmts(*items[j]);
+        *items[j] = nullptr;
+      }
+      return true;
+    }
+    return false;
+  }
+  if (auto node = std::dynamic_pointer_cast<ast::If>(s)) {
+    dropUnreachable(node->thenStmt, stats);
+    return false;
+  }
+  if (auto node = std::dynamic_pointer_cast<ast::Else>(s)) {
+    bool t = dropUnreachable(node->thenStmt, stats);
+    bool e = dropUnreachable(node->elseStmt, stats);
+    return t && e;
+  }
+  if (auto node = std::dynamic_pointer_cast<ast::While>(s)) {
+    dropUnreachable(node->body, stats);
+    return false;
+  }
+  if (auto node = std::dynamic_pointer_cast<ast::Do>(s)) {
+    dropUnreachable(node->body, stats);
+    return false;
+  }
+  return false;
+}
+
+/// An empty Seq in place of @p child if it was removed: the parent is
+/// kept, and its emit() needs every child.
+void keepChild(sptr<ast::Stmt>& child, const SourceLocation& loc) {
+  if (!child) child = std::make_shared<ast::Seq>(loc, nullptr, nullptr);
+}
+
+/// Backward liveness over the structured AST.
+struct Liveness {
+  DeadCodeStats& stats;
+
+  /**
+   * Live-in of @p s given its live-out @p out and the live-out @p brk of the
+   * innermost enclosing loop. With @p rewrite set, dead stores are removed
+   * from @p s; loops only rewrite once their fixpoint is reached.
+   */
+  IdSet visit(sptr<ast::Stmt>& s, const IdSet& out, const IdSet& brk,
+              bool rewrite) {
+    if (!s) return out;
+
+    if (std::dynamic_pointer_cast<ast::Seq>(s)) {
+      auto items = seqItems(s);
+      IdSet live = out;
+      for (auto it = items.rbegin(); it != items.rend(); ++it)
+        live = visit(**it, live, brk, rewrite);
+      return live;
+    }
+
+    if (std::dynamic_pointer_cast<ast::Break>(s)) return brk;
+
+    if (auto node = std::dynamic_pointer_cast<ast::Set>(s)) {
+      auto target = std::dynamic_pointer_cast<ast::IdExpr>(node->id);
+      IdSet in = out;
+      if (target) {
+        if (!out.count(target->sym.get())) return dead(s, out, rewrite);
+        in.erase(target->sym.get());
+      } else {
+        collectUses(node->id, in);
+      }
+      collectUses(node->expr, in);
+      return in;
+    }
+
+    if (auto node = std::dynamic_pointer_cast<ast::SetElem>(s)) {
+      // A store to one element never kills the whole array.
+      const symbols::Id* arr = baseVar(*node->arrayAccess);
+      if (arr && !out.count(arr)) return dead(s, out, rewrite);
+      IdSet in = out;
+      collectUses(node->arrayAccess, in);
+      collectUses(node->expr, in);
+      return in;
+    }
+
+    if (auto node = std::dynamic_pointer_cast<ast::If>(s)) {
+      IdSet in = visit(node->thenStmt, out, brk, rewrite);
+      in.insert(out.begin(), out.end());
+      collectUses(node->condition, in);
+      if (rewrite && isEmpty(node->thenStmt)) s = nullptr;
+      return in;
+    }
+
+    if (auto node = std::dynamic_pointer_cast<ast::Else>(s)) {
+      IdSet in = visit(node->thenStmt, out, brk, rewrite);
+      IdSet inElse = visit(node->elseStmt, out, brk, rewrite);
+      in.insert(inElse.begin(), inElse.end());
+      collectUses(node->condition, in);
+      if (!rewrite) return in;
+      if (isEmpty(node->thenStmt) && isEmpty(node->elseStmt)) {
+        s = nullptr;
+      } else {
+        keepChild(node->thenStmt, node->location);
+        keepChild(node->elseStmt, node->location);
+      }
+      return in;
+    }
+
+    if (auto node = std::dynamic_pointer_cast<ast::While>(s)) {
+      // head = cond uses + exit (out) + body entry; body exits to head
+      IdSet head = out;
+      collectUses(node->condition, head);
+      for (;;) {
+        IdSet next = visit(node->body, head, out, false);
+        next.insert(head.begin(), head.end());
+        if (next == head) break;
+        head = std::move(next);
+      }
+      if (rewrite) {
+        visit(node->body, head, out, true);
+        keepChild(node->body, node->location);
+      }
+      return head;
+    }
+
+    if (auto node = std::dynamic_pointer_cast<ast::Do>(s)) {
+      // body exits to the condition, which goes back to the body or out
+      IdSet tail = out;
+      collectUses(node->condition, tail);
+      IdSet entry;
+      for (;;) {
+        entry = visit(node->body, tail, out, false);
+        IdSet next = tail;
+        next.insert(entry.begin(), entry.end());
+        if (next == tail) break;
+        tail = std::move(next);
+      }
+      if (rewrite) {
+        visit(node->body, tail, out, true);
+        keepChild(node->body, node->location);
+      }
+      return entry;
+    }
+
+    return out;
+  }
+
+  IdSet dead(sptr<ast::Stmt>& s, const IdSet& out, bool rewrite) {
+    if (rewrite) {
+      ++stats.storesRemoved;
+      s = nullptr;
+    }
+    return out;
+  }
+};
+
+}  // namespace
+
+sptr<ast::Stmt> eliminateDeadCode(sptr<ast::Stmt> root, symbols::Frame& frame,
+                                  DeadCodeStats* stats) {
+  DeadCodeStats local;
+  DeadCodeStats& st = stats ? *stats : local;
+  SourceLocation loc = root ? root->location : SourceLocation{0, 0};
+
+  dropUnreachable(root, st);
+
+  IdSet exitLive;
+  for (size_t i = 0; i < frame.globals; ++i)
+    exitLive.insert(frame.vars[i].get());
+  Liveness{st}.visit(root, exitLive, exitLive, true);
+
+  IdSet refs;
+  collectRefs(root, refs);
+  size_t before = frame.vars.size();
+  st.bytesSaved +=
+      frame.compact([&](const symbols::Id& id) { return refs.count(&id) > 0; });
+  st.varsRemoved += static_cast<int>(before - frame.vars.size());
+
+  if (!root) root = std::make_shared<ast::Seq>(loc, nullptr, nullptr);
+  return root;
+}
+
+}  // namespace opt
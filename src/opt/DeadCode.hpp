@@ -0,0 +1,42 @@
+/**
+ * @file DeadCode.hpp
+ * @brief Dead store, unreachable code and unused variable elimination.
+ */
+#pragma once
+#include "Frame.hpp"
+#include "Stmt.h"
+#include "sptr.h"
+
+namespace opt {
+
+/**
+ * @brief Counters collected by eliminateDeadCode().
+ */
+struct DeadCodeStats {
+  int storesRemoved = 0;      /**< Set/SetElem whose value is never read */
+  int unreachableRemoved = 0; /**< Statements following a break */
+  int varsRemoved = 0;        /**< Variables left without any reference */
+  int bytesSaved = 0;         /**< Frame bytes reclaimed from the layout */
+};
+
+/**
+ * @brief Remove dead stores, code after `break` and unused variables.
+ *
+ * Liveness is computed backwards over the structured AST. Variables of the
+ * outermost block are live at program exit, since their final values are
+ * the result of the program; all other variables are dead once it ends.
+ * Expressions have no side effects, so a store whose target is not live is
+ * dropped together with its right-hand side.
+ *
+ * Variables that are no longer mentioned anywhere are removed from
+ * @p frame and the remaining slots are repacked.
+ *
+ * @param root Program root; nodes are rewritten in place.
+ * @param frame Variable layout produced by the parser.
+ * @param stats Optional counters, accumulated into.
+ * @return New program root (never nullptr).
+ */
+sptr<ast::Stmt> eliminateDeadCode(sptr<ast::Stmt> root, symbols::Frame& frame,
+                                  DeadCodeStats* stats = nullptr);
+
+}  // namespace opt
@@ -0,0 +1,179 @@
+/**
+ * @file IrUtil.cpp
+ * @brief Helpers shared by the passes working on three-address code.
+ */
+#include "IrUtil.hpp"
+
+namespace opt {
+
+using ir::Instr;
+using ir::Opcode;
+using ir::Operand;
+
+TempDefs::TempDefs(const ir::Function& fn)
+    : count(fn.numTemps + 1, 0), index(fn.numTemps + 1, -1) {
+  for (size_t i = 0; i < fn.code.size(); ++i) {
+    const Instr& in = fn.code[i];
+    if (in.hasResult() && in.dst.isTemp()) {
+      ++count[in.dst.temp];
+      index[in.dst.temp] = static_cast<int>(i);
+    }
+  }
+}
+
+RefCounts::RefCounts(const ir::Function& fn)
+    : temps(fn.numTemps + 1, 0), jumps(fn.numLabels + 1, 0) {
+  for (const Instr& in : fn.code) {
+    for (const Operand* o : {&in.dst, &in.a, &in.b})
+      if (o->isTemp()) ++temps[o->temp];
+    if (in.isJump()) ++jumps[in.label];
+  }
+}
+
+int64_t inductionStep(const Instr& in, const symbols::Id* v) {
+  auto isV = [&](const Operand& o) { return o.isVar() && o.var == v; };
+  auto isInt = [](const Operand& o) {
+    return o.isConst() && o.type == symbols::Type::Int;
+  };
+  if (in.op == Opcode::Add) {
+    if (isV(in.a) && isInt(in.b)) return in.b.ival;
+    if (isInt(in.a) && isV(in.b)) return in.a.ival;
+  } else if (in.op == Opcode::Sub && isV(in.a) && isInt(in.b)) {
+    return -in.b.ival;
+  }
+  return 0;
+}
+
+bool invertJump(const Instr& in, Instr& out) {
+  out = in;
+  if (in.op == Opcode::JumpIf) {
+    out.op = Opcode::JumpIfNot;
+    return true;
+  }
+  if (in.op == Opcode::JumpIfNot) {
+    out.op = Opcode::JumpIf;
+    return true;
+  }
+  Opcode rel = ir::compareOf(in.op);
+  if (in.a.isFloat() && rel != Opcode::Eq && rel != Opcode::Ne) return false;
+  out.op = ir::compareJump(ir::negate(rel));
+  return true;
+}
+
+bool LoopEdit::overlaps(const ir::Loop& loop) const {
+  for (int b : loop.blocks)
+    if (claimed[b]) return true;
+  return false;
+}
+
+void LoopEdit::claim(const ir::Loop& loop) {
+  for (int b : loop.blocks) claimed[b] = 1;
+}
+
+int applyLoopEdit(ir::Function& fn, const ir::Cfg& cfg, const ir::LoopInfo& li,
+                  const LoopEdit& edit) {
+  struct Header {
+    const ir::Loop* loop;
+    const std::vector<Instr>* code;  ///< Preheader instructions
+    int label;                       ///< Label of the header
+    int pre = -1;                    ///< Preheader label, if one is needed
+  };
+  std::unordered_map<int, Header> heads;   // header instruction -> header
+  std::unordered_map<int, int> headAt;     // header label -> instruction
+  size_t extra = 0;
+  for (const ir::Loop& loop : li.loops) {
+    auto p = edit.preheader.find(loop.header);
+    if (p == edit.preheader.end() || p->second.empty()) continue;
+    int head = cfg.blocks[loop.header].begin;
+    heads.emplace(head, Header{&loop, &p->second, fn.code[head].label});
+    headAt.emplace(fn.code[head].label, head);
+    extra += p->second.size() + 2;
+  }
+
+  // Header a jump enters from outside its loop, if any.
+  auto entered = [&](const Instr& in, int i) -> Header* {
+    if (!in.isJump()) return nullptr;
+    auto h = headAt.find(in.label);
+    if (h == headAt.end()) return nullptr;
+    Header& hd = heads.at(h->second);
+    return hd.loop->contains(cfg.blockOf[i]) ? nullptr : &hd;
+  };
+  std::vector<char> needed(fn.code.size(), 0);
+  for (int i = 0; i < static_cast<int>(fn.code.size()); ++i)
+    if (Header* hd = entered(fn.code[i], i))
+      needed[cfg.blocks[hd->loop->header].begin] = 1;
+  int created = 0;
+  for (const ir::Loop& loop : li.loops) {
+    int head = cfg.blocks[loop.header].begin;
+    auto h = heads.find(head);
+    if (h != heads.end() && needed[head]) {
+      h->second.pre = fn.newLabel();
+      ++created;
+    }
+  }
+
+  std::vector<Instr> out;
+  out.reserve(fn.code.size() + extra);
+  for (int i = 0; i < static_cast<int>(fn.code.size()); ++i) {
+    auto h = heads.find(i);
+    if (h != heads.end()) {
+      const Header& hd = h->second;
+      if (i > 0 && hd.loop->contains(cfg.blockOf[i - 1]) &&
+          fn.code[i - 1].op != Opcode::Jump) {
+        Instr j{Opcode::Jump};
+        j.label = hd.label;
+        j.loc = fn.code[i - 1].loc;
+        out.push_back(j);
+      }
+      if (hd.pre >= 0) {
+        Instr l{Opcode::Label};
+        l.label = hd.pre;
+        l.loc = fn.code[i].loc;
+        out.push_back(l);
+      }
+      out.insert(out.end(), hd.code->begin(), hd.code->end());
+    }
+
+    if (!edit.drop[i]) {
+      auto r = edit.replace.find(i);
+      Instr in = r != edit.replace.end() ? r->second : fn.code[i];
+      Header* hd = entered(in, i);
+      if (hd && hd->pre >= 0) in.label = hd->pre;
+      out.push_back(std::move(in));
+    }
+
+    auto a = edit.after.find(i);
+    if (a != edit.after.end())
+      out.insert(out.end(), a->second.begin(), a->second.end());
+  }
+  fn.code = std::move(out);
+  return created;
+}
+
+int removeDeadTemps(ir::Function& fn) {
+  int removed = 0;
+  for (;;) {
+    std::vector<int> reads(fn.numTemps + 1, 0);
+    std::vector<const ir::Operand*> ops;
+    for (const Instr& in : fn.code) {
+      ops.clear();
+      ir::uses(in, ops);
+      for (const ir::Operand* o : ops)
+        if (o->isTemp()) ++reads[o->temp];
+    }
+
+    size_t before = fn.code.size();
+    std::vector<Instr> out;
+    out.reserve(before);
+    for (Instr& in : fn.code) {
+      if (in.hasResult() && in.dst.isTemp() && reads[in.dst.temp] == 0)
+        continue;
+      out.push_back(std::move(in));
+    }
+    fn.code = std::move(out);
+    if (fn.code.size() == before) return removed;
+    removed += static_cast<int>(before - fn.code.size());
+  }
+}
+
+}  // namespace opt
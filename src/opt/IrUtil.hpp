@@ -0,0 +1,103 @@
+/**
+ * @file IrUtil.hpp
+ * @brief Helpers shared by the passes working on three-address code.
+ */
+#pragma once
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "Cfg.hpp"
+#include "IR.hpp"
+
+namespace opt {
+
+/**
+ * @brief Definition sites of temporaries.
+ */
+struct TempDefs {
+  std::vector<int> count;  ///< temp -> number of definitions
+  std::vector<int> index;  ///< temp -> last defining instruction
+
+  explicit TempDefs(const ir::Function& fn);
+
+  bool single(const ir::Operand& o) const {
+    return o.isTemp() && count[o.temp] == 1;
+  }
+};
+
+/**
+ * @brief How often temporaries and labels are referenced.
+ */
+struct RefCounts {
+  std::vector<int> temps;  ///< temp -> operands naming it
+  std::vector<int> jumps;  ///< label -> jumps to it
+
+  explicit RefCounts(const ir::Function& fn);
+};
+
+/**
+ * @brief Step of `dst = v + c`, `dst = c + v` or `dst = v - c`.
+ * @return The signed int constant added to @p v, or 0 for any other shape.
+ */
+int64_t inductionStep(const ir::Instr& in, const symbols::Id* v);
+
+/**
+ * @brief Conditional jump taken exactly when @p in is not.
+ *
+ * Ordered float comparisons are not inverted, since `!(x < y)` is not
+ * `x >= y` when an operand is NaN.
+ *
+ * @param in A conditional jump.
+ * @param out Receives @p in with the opposite condition.
+ * @return False if no exact inverse exists.
+ */
+bool invertJump(const ir::Instr& in, ir::Instr& out);
+
+/**
+ * @brief Edits to apply to the loops of a function in a single rewrite.
+ *
+ * Indices refer to the code the edits were planned on. Loops that share a
+ * block are not edited together: once a loop is claimed, the loops around
+ * it wait for a later rewrite, planned on the edited code.
+ */
+struct LoopEdit {
+  /// header block -> instructions placed in front of the header
+  std::unordered_map<int, std::vector<ir::Instr>> preheader;
+  std::vector<char> drop;  ///< instruction index -> remove
+  std::unordered_map<int, ir::Instr> replace;
+  std::unordered_map<int, std::vector<ir::Instr>> after;
+
+  LoopEdit(const ir::Function& fn, const ir::Cfg& cfg)
+      : drop(fn.code.size(), 0), claimed(cfg.blocks.size(), 0) {}
+
+  /// A block of @p loop belongs to a loop already claimed.
+  bool overlaps(const ir::Loop& loop) const;
+
+  /// Reserve the blocks of @p loop for its edits.
+  void claim(const ir::Loop& loop);
+
+ private:
+  std::vector<char> claimed;  ///< block -> part of a claimed loop
+};
+
+/**
+ * @brief Rewrite @p fn with @p edit applied to the loops of @p li.
+ *
+ * Preheader instructions are inserted right before the header label. Jumps
+ * from outside the loop to the header are redirected to a new preheader
+ * label, and a loop block laid out just before the header gets an explicit
+ * jump so it does not fall through into the preheader.
+ *
+ * @return Number of preheader labels created.
+ */
+int applyLoopEdit(ir::Function& fn, const ir::Cfg& cfg, const ir::LoopInfo& li,
+                  const LoopEdit& edit);
+
+/**
+ * @brief Remove pure instructions whose temporary result is never read.
+ * @return Number of instructions removed.
+ */
+int removeDeadTemps(ir::Function& fn);
+
+}  // namespace opt
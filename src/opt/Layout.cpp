@@ -0,0 +1,310 @@
+/**
+ * @file Layout.cpp
+ * @brief Loop rotation, static branch probabilities and block layout.
+ */
+#include "Layout.hpp"
+
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+#include "IrUtil.hpp"
+
+namespace opt {
+namespace {
+
+using ir::Instr;
+using ir::Opcode;
+using ir::Operand;
+
+constexpr double kLikely = 0.9;    ///< Back edges, staying in a loop
+constexpr double kEqual = 0.3;     ///< `==` holding
+constexpr double kColdRatio = 0.2; ///< Of the immediate dominator
+constexpr int kMaxHeader = 12;     ///< Header instructions copied by rotation
+
+bool isCondJump(const Instr& in) {
+  return in.isJump() && in.op != Opcode::Jump;
+}
+
+/// Plan the rotation of one loop into @p edit and set @p bodyLabel to its
+/// new header; false if the loop does not have the expected shape.
+bool rotate(ir::Function& fn, const ir::Cfg& cfg, const RefCounts& refs,
+            const ir::Loop& loop, LoopEdit& edit, int& bodyLabel) {
+  const ir::BasicBlock& head = cfg.blocks[loop.header];
+  const Instr& top = fn.code[head.begin];
+  const Instr& test = fn.code[head.end - 1];
+  if (top.op != Opcode::Label || !isCondJump(test) ||
+      head.end - head.begin - 2 > kMaxHeader)
+    return false;
+  int body = loop.header + 1;
+  if (loop.contains(head.succs[0]) || !loop.contains(body) ||
+      loop.latches.size() != 1)
+    return false;
+  int back = cfg.blocks[loop.latches[0]].end - 1;
+  if (fn.code[back].op != Opcode::Jump) return false;
+  Instr cont;
+  if (!invertJump(test, cont)) return false;
+
+  // Temporaries of the test that nothing else reads get fresh names in the
+  // copy, keeping them single-assignment.
+  std::unordered_map<int, int> inHead;
+  for (int i = head.begin; i < head.end; ++i)
+    for (const Operand* o : {&fn.code[i].dst, &fn.code[i].a, &fn.code[i].b})
+      if (o->isTemp()) ++inHead[o->temp];
+  std::unordered_map<int, Operand> renamed;
+  auto rename = [&](Operand& o) {
+    if (!o.isTemp() || inHead[o.temp] != refs.temps[o.temp]) return;
+    auto it = renamed.find(o.temp);
+    if (it == renamed.end())
+      it = renamed.emplace(o.temp, fn.newTemp(o.type)).first;
+    o = it->second;
+  };
+
+  int bodyBegin = cfg.blocks[body].begin;
+  bool hasLabel = fn.code[bodyBegin].op == Opcode::Label;
+  bodyLabel = hasLabel ? fn.code[bodyBegin].label : fn.newLabel();
+  int exitLabel = test.label;
+  if (!hasLabel) {
+    Instr l{Opcode::Label};
+    l.label = bodyLabel;
+    l.loc = fn.code[bodyBegin].loc;
+    edit.after[bodyBegin - 1].push_back(l);
+  }
+  // Nothing but the back edge jumps to the header label, and that jump goes
+  // to the body now; dropping the label joins the guard to the code before.
+  int backToTop = fn.code[back].label == top.label;
+  if (refs.jumps[top.label] == backToTop) edit.drop[head.begin] = 1;
+
+  std::vector<Instr>& out = edit.after[back];
+  edit.drop[back] = 1;
+  for (int h = head.begin + 1; h < head.end - 1; ++h) {
+    Instr in = fn.code[h];
+    rename(in.dst);
+    rename(in.a);
+    rename(in.b);
+    out.push_back(std::move(in));
+  }
+  Instr j = cont;
+  rename(j.a);
+  rename(j.b);
+  j.label = bodyLabel;
+  j.loc = fn.code[back].loc;
+  out.push_back(j);
+  // the back edge did not fall through; leaving the loop now does
+  bool exitNext = back + 1 < static_cast<int>(fn.code.size()) &&
+                  fn.code[back + 1].op == Opcode::Label &&
+                  fn.code[back + 1].label == exitLabel;
+  if (!exitNext) {
+    Instr g{Opcode::Jump};
+    g.label = exitLabel;
+    g.loc = j.loc;
+    out.push_back(g);
+  }
+  return true;
+}
+
+}  // namespace
+
+BranchWeights::BranchWeights(const ir::Function& fn, const ir::Cfg& cfg,
+                             const ir::DominatorTree& dom,
+                             const ir::LoopInfo& loops) {
+  int nb = static_cast<int>(cfg.blocks.size());
+  taken.assign(nb, -1);
+  freq.assign(nb, 0);
+  cold.assign(nb, 0);
+  if (fn.code.empty()) return;
+
+  // Loops come innermost first, so the first one holding a block is its
+  // innermost loop.
+  std::vector<int> inner(nb, -1);
+  for (size_t l = 0; l < loops.loops.size(); ++l)
+    for (int b : loops.loops[l].blocks)
+      if (inner[b] < 0) inner[b] = static_cast<int>(l);
+
+  auto backEdge = [&](int from, int to) {
+    for (const ir::Loop& l : loops.loops)
+      if (l.header == to && l.contains(from)) return true;
+    return false;
+  };
+  auto leaves = [&](int from, int to) {
+    return inner[from] >= 0 && !loops.loops[inner[from]].contains(to);
+  };
+
+  for (int b = 0; b < nb; ++b) {
+    const Instr& last = fn.code[cfg.blocks[b].end - 1];
+    if (!isCondJump(last) || cfg.blocks[b].succs.size() < 2) continue;
+    int t = cfg.blocks[b].succs[0];
+    int f = b + 1;
+    double p = 0.5;
+    if (backEdge(b, t))
+      p = kLikely;
+    else if (backEdge(b, f))
+      p = 1 - kLikely;
+    else if (leaves(b, t) != leaves(b, f))
+      p = leaves(b, t) ? 1 - kLikely : kLikely;
+    else if (last.op == Opcode::JumpEq)
+      p = kEqual;
+    else if (last.op == Opcode::JumpNe)
+      p = 1 - kEqual;
+    taken[b] = p;
+  }
+
+  std::vector<char> header(nb, 0);
+  for (const ir::Loop& l : loops.loops) header[l.header] = 1;
+  freq[0] = 1;
+  for (int b : cfg.reversePostOrder()) {
+    if (b != 0) {
+      double in = 0;
+      for (int p : cfg.blocks[b].preds)
+        if (!backEdge(p, b)) in += freq[p] * edge(cfg, p, b);
+      freq[b] = in;
+    }
+    // a loop runs 1 / (1 - p) times when it goes on with probability p
+    if (header[b]) freq[b] /= 1 - kLikely;
+  }
+
+  for (int b = 1; b < nb; ++b)
+    cold[b] = dom.idom[b] < 0 || freq[b] < kColdRatio * freq[dom.idom[b]];
+}
+
+double BranchWeights::edge(const ir::Cfg& cfg, int b, int s) const {
+  const auto& succs = cfg.blocks[b].succs;
+  if (taken[b] < 0 || succs.size() < 2) return 1;
+  return s == succs[0] ? taken[b] : 1 - taken[b];
+}
+
+bool rotateLoops(ir::Function& fn, LayoutStats* stats) {
+  AnalysisCache cache(fn);
+  return rotateLoops(fn, cache, stats);
+}
+
+bool rotateLoops(ir::Function& fn, AnalysisCache& cache, LayoutStats* stats) {
+  LayoutStats local;
+  LayoutStats& st = stats ? *stats : local;
+  std::unordered_set<int> seen;  // header labels, old and new
+  bool any = false;
+  for (;;) {
+    bool changed = false;
+    const ir::Cfg& cfg = cache.cfg();
+    const ir::LoopInfo& li = cache.loops();
+    RefCounts refs(fn);
+    // one loop per nest, the loops around it wait for the next round
+    LoopEdit edit(fn, cfg);
+    for (const ir::Loop& loop : li.loops) {
+      if (edit.overlaps(loop)) continue;
+      const Instr& top = fn.code[cfg.blocks[loop.header].begin];
+      if (top.op == Opcode::Label && !seen.insert(top.label).second) continue;
+      int body;
+      if (!rotate(fn, cfg, refs, loop, edit, body)) continue;
+      seen.insert(body);
+      edit.claim(loop);
+      ++st.rotated;
+      any = changed = true;
+    }
+    if (!changed) return any;
+    applyLoopEdit(fn, cfg, li, edit);
+    cache.invalidate();
+  }
+}
+
+bool layoutBlocks(ir::Function& fn, LayoutStats* stats) {
+  ir::Cfg cfg(fn);
+  ir::DominatorTree dom(cfg);
+  ir::LoopInfo li(cfg, dom);
+  return layoutBlocks(fn, cfg, dom, li, stats);
+}
+
+bool layoutBlocks(ir::Function& fn, const ir::Cfg& cfg,
+                  const ir::DominatorTree& dom, const ir::LoopInfo& li,
+                  LayoutStats* stats) {
+  if (fn.code.empty()) return false;
+  LayoutStats local;
+  LayoutStats& st = stats ? *stats : local;
+  BranchWeights w(fn, cfg, dom, li);
+  int nb = static_cast<int>(cfg.blocks.size());
+
+  // Hot blocks keep their order, so the likely side of every branch that
+  // already fell through still does; cold ones go last.
+  std::vector<int> order;
+  for (int b = 0; b < nb; ++b)
+    if (!w.cold[b]) order.push_back(b);
+  for (int b = 0; b < nb; ++b)
+    if (w.cold[b]) order.push_back(b);
+  st.cold += static_cast<int>(std::count(w.cold.begin(), w.cold.end(), 1));
+
+  // Fix up the end of every block for its new successor in the layout.
+  // Block nb stands for the end of the code.
+  std::vector<int> labelOf(nb + 1, -1);
+  for (int b = 0; b < nb; ++b) {
+    const Instr& first = fn.code[cfg.blocks[b].begin];
+    if (first.op == Opcode::Label) labelOf[b] = first.label;
+  }
+  auto target = [&](int b) {
+    if (labelOf[b] < 0) labelOf[b] = fn.newLabel();
+    return labelOf[b];
+  };
+  std::vector<char> drop(nb, 0);
+  std::vector<Instr> last(nb);
+  std::vector<int> jumpTo(nb, -1);
+  bool changed = false;
+  for (int k = 0; k < nb; ++k) {
+    int b = order[k];
+    int next = k + 1 < nb ? order[k + 1] : nb;
+    const Instr& in = fn.code[cfg.blocks[b].end - 1];
+    last[b] = in;
+    int fall = b + 1;
+    if (in.op == Opcode::Jump) {
+      if (cfg.blocks[b].succs[0] == next) {
+        drop[b] = 1;
+        ++st.removed;
+        changed = true;
+      }
+      continue;
+    }
+    if (fall == next) continue;
+    changed = true;
+    Instr inv;
+    if (isCondJump(in) && cfg.blocks[b].succs[0] == next && fall < nb &&
+        invertJump(in, inv)) {
+      inv.label = target(fall);
+      last[b] = inv;
+      ++st.inverted;
+      continue;
+    }
+    jumpTo[b] = fall;
+    target(fall);
+    ++st.added;
+  }
+  if (!changed) return false;
+
+  std::vector<Instr> out;
+  out.reserve(fn.code.size() + nb);
+  for (int b : order) {
+    const ir::BasicBlock& bb = cfg.blocks[b];
+    if (labelOf[b] >= 0 && fn.code[bb.begin].op != Opcode::Label) {
+      Instr l{Opcode::Label};
+      l.label = labelOf[b];
+      l.loc = fn.code[bb.begin].loc;
+      out.push_back(l);
+    }
+    for (int i = bb.begin; i + 1 < bb.end; ++i) out.push_back(fn.code[i]);
+    if (!drop[b]) out.push_back(last[b]);
+    if (jumpTo[b] >= 0) {
+      Instr j{Opcode::Jump};
+      j.label = labelOf[jumpTo[b]];
+      j.loc = last[b].loc;
+      out.push_back(j);
+    }
+  }
+  if (labelOf[nb] >= 0) {
+    Instr l{Opcode::Label};
+    l.label = labelOf[nb];
+    l.loc = fn.code.back().loc;
+    out.push_back(l);
+  }
+  fn.code = std::move(out);
+  return true;
+}
+
+}  // namespace opt
@@ -0,0 +1,97 @@
+/**
+ * @file Layout.hpp
+ * @brief Loop rotation, static branch probabilities and block layout.
+ */
+#pragma once
+#include <vector>
+
+#include "AnalysisCache.hpp"
+#include "Cfg.hpp"
+#include "IR.hpp"
+
+namespace opt {
+
+/**
+ * @brief Counters collected by rotateLoops() and layoutBlocks().
+ */
+struct LayoutStats {
+  int rotated = 0;   /**< Loops turned into guarded bottom-tested loops */
+  int inverted = 0;  /**< Conditional jumps inverted to fall through */
+  int removed = 0;   /**< Jumps to the next block removed */
+  int added = 0;     /**< Jumps added for fall-through that moved away */
+  int cold = 0;      /**< Blocks moved behind the hot code */
+};
+
+/**
+ * @brief Static estimate of branch probabilities and block frequencies.
+ *
+ * Conditional jumps get the first matching heuristic, after Ball and
+ * Larus: back edges are likely, edges leaving a loop (the exit test or a
+ * `break`) are unlikely, and `==` tends to fail. Frequencies are propagated
+ * in reverse post-order with loop headers scaled by the expected trip
+ * count of a loop taking its back edge with the likely probability. A
+ * block is cold if it runs far less often than its immediate dominator,
+ * or never.
+ */
+struct BranchWeights {
+  std::vector<double> taken;  ///< block -> probability its jump is taken
+  std::vector<double> freq;   ///< block -> executions per run of the code
+  std::vector<char> cold;     ///< block -> rarely or never run
+
+  BranchWeights(const ir::Function& fn, const ir::Cfg& cfg,
+                const ir::DominatorTree& dom, const ir::LoopInfo& loops);
+
+  /// Probability that block @p b continues with successor @p s.
+  double edge(const ir::Cfg& cfg, int b, int s) const;
+};
+
+/**
+ * @brief Turn top-tested loops into guarded bottom-tested loops.
+ *
+ * A loop whose header block ends in the exit test, and whose only back
+ * edge is an unconditional jump to the header, gets a copy of the header
+ * code and the inverted test in place of that jump:
+ *
+ *     L1: if i >= n goto L2              if i >= n goto L2
+ *         body                 =>    L3: body
+ *         goto L1                        if i < n goto L3
+ *     L2:                            L2:
+ *
+ * The original header stays in front of the loop as its guard, so each
+ * iteration runs one conditional jump instead of two jumps. Headers longer
+ * than a few instructions and tests that cannot be inverted exactly are
+ * left alone.
+ *
+ * @param fn Function to transform.
+ * @param stats Optional counters, accumulated into.
+ * @return True if any loop was rotated.
+ */
+bool rotateLoops(ir::Function& fn, LayoutStats* stats = nullptr);
+
+/// rotateLoops() using the analyses in @p cache, which is invalidated
+/// when the code changes.
+bool rotateLoops(ir::Function& fn, AnalysisCache& cache,
+                 LayoutStats* stats = nullptr);
+
+/**
+ * @brief Move cold blocks behind the hot code.
+ *
+ * Blocks that BranchWeights marks cold, such as the paths through `break`
+ * and code that never runs, go after all other code, so the hot blocks
+ * fall through into each other. Jumps to the block that now follows are
+ * removed, conditional jumps are inverted when their target was placed
+ * next, and fall-through to a block placed elsewhere becomes an explicit
+ * jump.
+ *
+ * @param fn Function to transform.
+ * @param stats Optional counters, accumulated into.
+ * @return True if the code changed.
+ */
+bool layoutBlocks(ir::Function& fn, LayoutStats* stats = nullptr);
+
+/// layoutBlocks() with the analyses of @p fn already at hand.
+bool layoutBlocks(ir::Function& fn, const ir::Cfg& cfg,
+                  const ir::DominatorTree& dom, const ir::LoopInfo& loops,
+                  LayoutStats* stats = nullptr);
+
+}  // namespace opt
@@ -0,0 +1,130 @@
+/**
+ * @file Licm.cpp
+ * @brief Loop-invariant code motion on three-address code.
+ */
+#include "Licm.hpp"
+
+#include <unordered_set>
+
+#include "Cfg.hpp"
+#include "IrUtil.hpp"
+
+namespace opt {
+namespace {
+
+using ir::Instr;
+using ir::Opcode;
+using ir::Operand;
+
+bool hoistable(const Instr& in) {
+  return in.hasResult();
+}
+
+bool mayTrap(const Instr& in) {
+  return in.op == Opcode::Load || in.op == Opcode::VLoad ||
+         (in.op == Opcode::Div && !in.dst.isFloat());
+}
+
+class Licm {
+ public:
+  explicit Licm(ir::Function& f) : fn(f) {}
+
+  /// Hoist from every loop that has invariants, one loop per nest; false
+  /// if none has.
+  bool runOnce(AnalysisCache& cache, LicmStats& stats) {
+    const ir::Cfg& cfg = cache.cfg();
+    const ir::DominatorTree& dom = cache.dominators();
+    const ir::LoopInfo& li = cache.loops();
+    TempDefs defs(fn);
+
+    LoopEdit edit(fn, cfg);
+    bool any = false;
+    for (const ir::Loop& loop : li.loops) {
+      if (edit.overlaps(loop)) continue;
+      std::vector<int> hoist = invariants(cfg, dom, defs, loop);
+      if (hoist.empty()) continue;
+
+      std::vector<Instr>& pre = edit.preheader[loop.header];
+      for (int h : hoist) {
+        pre.push_back(fn.code[h]);
+        edit.drop[h] = 1;
+      }
+      edit.claim(loop);
+      stats.hoisted += static_cast<int>(hoist.size());
+      any = true;
+    }
+    if (!any) return false;
+    stats.preheaders += applyLoopEdit(fn, cfg, li, edit);
+    cache.invalidate();
+    return true;
+  }
+
+ private:
+  ir::Function& fn;
+
+  std::vector<int> invariants(const ir::Cfg& cfg, const ir::DominatorTree& dom,
+                              const TempDefs& defs, const ir::Loop& loop) {
+    std::unordered_set<const symbols::Id*> written;
+    std::vector<int> body;
+    for (int b : loop.blocks)
+      for (int i = cfg.blocks[b].begin; i < cfg.blocks[b].end; ++i) {
+        body.push_back(i);
+        const Instr& in = fn.code[i];
+        if (in.op == Opcode::Store || in.op == Opcode::VStore ||
+            (in.hasResult() && in.dst.isVar()))
+          written.insert(in.dst.var);
+      }
+
+    std::vector<char> inv(fn.code.size(), 0);
+    auto operandInvariant = [&](const Operand& o) {
+      if (o.isNone() || o.isConst()) return true;
+      if (o.isVar()) return !written.count(o.var);
+      if (!defs.single(o)) return false;
+      int d = defs.index[o.temp];
+      return inv[d] || !loop.contains(cfg.blockOf[d]);
+    };
+
+    bool changed = true;
+    while (changed) {
+      changed = false;
+      for (int i : body) {
+        const Instr& in = fn.code[i];
+        if (inv[i] || !hoistable(in) || !defs.single(in.dst)) continue;
+        if (!operandInvariant(in.a) || !operandInvariant(in.b)) continue;
+        if (mayTrap(in)) {
+          bool always = true;
+          for (int e : loop.exits) always &= dom.dominates(cfg.blockOf[i], e);
+          for (int l : loop.latches)
+            always &= dom.dominates(cfg.blockOf[i], l);
+          if (!always) continue;
+        }
+        inv[i] = 1;
+        changed = true;
+      }
+    }
+
+    std::vector<int> hoist;
+    for (int i : body)
+      if (inv[i]) hoist.push_back(i);
+    return hoist;
+  }
+};
+
+}  // namespace
+
+bool hoistLoopInvariants(ir::Function& fn, LicmStats* stats) {
+  AnalysisCache cache(fn);
+  return hoistLoopInvariants(fn, cache, stats);
+}
+
+bool hoistLoopInvariants(ir::Function& fn, AnalysisCache& cache,
+                         LicmStats* stats) {
+  LicmStats local;
+  LicmStats& st = stats ? *stats : local;
+  Licm licm(fn);
+  bool any = false;
+  while (licm.runOnce(cache, st)) any = true;
+  return any;
+}
+
+}  // namespace opt
@@ -0,0 +1,43 @@
+/**
+ * @file Licm.hpp
+ * @brief Loop-invariant code motion on three-address code.
+ */
+#pragma once
+#include "AnalysisCache.hpp"
+#include "IR.hpp"
+
+namespace opt {
+
+/**
+ * @brief Counters collected by hoistLoopInvariants().
+ */
+struct LicmStats {
+  int hoisted = 0;     /**< Instructions moved out of a loop */
+  int preheaders = 0;  /**< Preheader labels created */
+};
+
+/**
+ * @brief Move loop-invariant computations into loop preheaders.
+ *
+ * Natural loops are processed innermost first, so a computation that is
+ * invariant in several nested loops ends up in front of the outermost one.
+ * An instruction is hoisted when it defines a single-assignment temporary
+ * from constants, variables not written in the loop and other invariant
+ * temporaries. Loads are invariant only if no Store in the loop writes the
+ * same array. Instructions that can trap (integer division, loads) are
+ * hoisted only from blocks that dominate every loop exit and latch, so
+ * loops left early through `break` or a failing condition never execute
+ * them speculatively.
+ *
+ * @param fn Function to transform.
+ * @param stats Optional counters, accumulated into.
+ * @return True if anything was hoisted.
+ */
+bool hoistLoopInvariants(ir::Function& fn, LicmStats* stats = nullptr);
+
+/// hoistLoopInvariants() using the analyses in @p cache, which is invalidated
+/// when the code changes.
+bool hoistLoopInvariants(ir::Function& fn, AnalysisCache& cache,
+                         LicmStats* stats = nullptr);
+
+}  // namespace opt
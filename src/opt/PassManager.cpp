@@ -0,0 +1,207 @@
+/**
+ * @file PassManager.cpp
+ * @brief Named passes over three-address code, run as a configurable
+ * pipeline with cached analyses and per-pass statistics.
+ */
+#include "PassManager.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <sstream>
+#include <stdexcept>
+
+#include "BoundsCheck.hpp"
+#include "Coalesce.hpp"
+#include "IrUtil.hpp"
+#include "Layout.hpp"
+#include "Licm.hpp"
+#include "Peephole.hpp"
+#include "StrengthReduce.hpp"
+#include "Unroll.hpp"
+
+namespace opt {
+
+namespace {
+
+bool runCfg(ir::Function&, AnalysisCache& c) { return c.cfg(), false; }
+bool runDomtree(ir::Function&, AnalysisCache& c) {
+  return c.dominators(), false;
+}
+bool runLoops(ir::Function&, AnalysisCache& c) { return c.loops(), false; }
+bool runLiveness(ir::Function&, AnalysisCache& c) {
+  return c.liveness(), false;
+}
+
+bool runRotate(ir::Function& fn, AnalysisCache& c) {
+  return rotateLoops(fn, c);
+}
+bool runLicm(ir::Function& fn, AnalysisCache& c) {
+  return hoistLoopInvariants(fn, c);
+}
+bool runStrength(ir::Function& fn, AnalysisCache& c) {
+  return reduceStrength(fn, c);
+}
+bool runBounds(ir::Function& fn, AnalysisCache& c) {
+  return eliminateBoundsChecks(fn, c);
+}
+bool runUnroll(ir::Function& fn, AnalysisCache& c) {
+  return unrollLoops(fn, c);
+}
+
+/// The pass edited the code, so the analyses no longer hold.
+bool invalidateIf(bool edited, AnalysisCache& c) {
+  if (edited) c.invalidate();
+  return edited;
+}
+
+bool runPeephole(ir::Function& fn, AnalysisCache& c) {
+  Peephole ph;
+  ph.run(fn);
+  for (uint64_t h : ph.hits)
+    if (h) return invalidateIf(true, c);
+  return false;
+}
+bool runCopyprop(ir::Function& fn, AnalysisCache& c) {
+  return invalidateIf(propagateCopies(fn), c);
+}
+bool runDce(ir::Function& fn, AnalysisCache& c) {
+  return invalidateIf(removeDeadTemps(fn) > 0, c);
+}
+bool runCoalesce(ir::Function& fn, AnalysisCache& c) {
+  // renumbering leaves the blocks as they are, but not the liveness
+  return invalidateIf(coalesceTemps(fn, c.cfg(), c.liveness()), c);
+}
+bool runLayout(ir::Function& fn, AnalysisCache& c) {
+  return invalidateIf(layoutBlocks(fn, c.cfg(), c.dominators(), c.loops()), c);
+}
+
+}  // namespace
+
+const char* const kDefaultPipeline =
+    "rotate,licm,strength,bounds,unroll,peephole,copyprop,coalesce,layout";
+
+const std::vector<Pass>& passRegistry() {
+  static const std::vector<Pass> passes = {
+      {"cfg", "Control flow graph (analysis)", runCfg},
+      {"domtree", "Dominator tree (analysis)", runDomtree},
+      {"loops", "Natural loops (analysis)", runLoops},
+      {"liveness", "Live temporaries (analysis)", runLiveness},
+      {"rotate", "Rotate while loops into guarded do-while loops", runRotate},
+      {"licm", "Hoist loop-invariant code", runLicm},
+      {"strength", "Strength-reduce induction variable offsets", runStrength},
+      {"bounds", "Remove or hoist provable bounds checks", runBounds},
+      {"unroll", "Unroll loops with a constant trip count", runUnroll},
+      {"peephole", "Table-driven peephole rules", runPeephole},
+      {"copyprop", "Propagate copies through temporaries", runCopyprop},
+      {"dce", "Remove unread temporaries", runDce},
+      {"coalesce", "Share temporaries that are never live together",
+       runCoalesce},
+      {"layout", "Move cold blocks behind the hot code", runLayout},
+  };
+  return passes;
+}
+
+std::vector<Pass> parsePipeline(const std::string& pipeline) {
+  std::vector<Pass> out;
+  std::stringstream ss(pipeline);
+  std::string name;
+  while (std::getline(ss, name, ',')) {
+    if (name.empty()) continue;
+    bool found = false;
+    for (const Pass& p : passRegistry())
+      if (name == p.name) {
+        out.push_back(p);
+        found = true;
+      }
+    if (!found) throw std::runtime_error("Unknown pass: " + name);
+  }
+  return out;
+}
+
+PassManager::PassManager(const std::string& pipeline)
+    : PassManager(parsePipeline(pipeline)) {}
+
+PassManager::PassManager(std::vector<Pass> passes)
+    : pipeline(std::move(passes)), stats(pipeline.size()) {
+  for (size_t i = 0; i < pipeline.size(); ++i) stats[i].name = pipeline[i].name;
+}
+
+bool PassManager::run(ir::Function& fn) {
+  AnalysisCache cache(fn);
+  bool any = false;
+  for (size_t i = 0; i < pipeline.size(); ++i) {
+    PassRecord& r = stats[i];
+    r.instrsBefore += static_cast<int64_t>(fn.code.size());
+    cache.nextPass();
+    int built = cache.built, reused = cache.reused;
+    AllocTotals a0 = allocCounter ? allocCounter() : AllocTotals();
+    auto t0 = std::chrono::steady_clock::now();
+
+    bool changed = pipeline[i].run(fn, cache);
+
+    auto t1 = std::chrono::steady_clock::now();
+    AllocTotals a1 = allocCounter ? allocCounter() : AllocTotals();
+    r.seconds += std::chrono::duration<double>(t1 - t0).count();
+    r.allocs += a1.count - a0.count;
+    r.allocBytes += a1.bytes - a0.bytes;
+    r.built += cache.built - built;
+    r.reused += cache.reused - reused;
+    r.instrsAfter += static_cast<int64_t>(fn.code.size());
+    r.temps += fn.numTemps;
+    ++r.runs;
+    if (changed) {
+      ++r.changed;
+      any = true;
+    }
+  }
+  return any;
+}
+
+std::string PassManager::report() const {
+  PassRecord total;
+  total.name = "Total";
+  for (const PassRecord& r : stats) {
+    total.seconds += r.seconds;
+    total.allocs += r.allocs;
+    total.allocBytes += r.allocBytes;
+    total.built += r.built;
+    total.reused += r.reused;
+  }
+  if (!stats.empty()) {
+    total.instrsBefore = stats.front().instrsBefore;
+    total.instrsAfter = stats.back().instrsAfter;
+    total.temps = stats.back().temps;
+  }
+
+  std::string out;
+  char line[160];
+  const char* rule =
+      "===-------------------------------------------------------------"
+      "-----------===\n";
+  out += rule;
+  out += "                      ... Pass execution timing report ...\n";
+  out += rule;
+  std::snprintf(line, sizeof line, "  Total Execution Time: %.4f seconds\n\n",
+                total.seconds);
+  out += line;
+  std::snprintf(line, sizeof line,
+                "   ---Wall Time---   --Allocs--  ---Bytes---  "
+                "---Instrs (before -> after)---  Temps  Built/Cached  Name\n");
+  out += line;
+  auto row = [&](const PassRecord& r) {
+    double share = total.seconds > 0 ? 100 * r.seconds / total.seconds : 0;
+    std::snprintf(line, sizeof line,
+                  "   %8.4f (%5.1f%%) %11llu %12llu  %14lld -> %-12lld %6lld"
+                  "  %5d/%-6d  %s\n",
+                  r.seconds, share, (unsigned long long)r.allocs,
+                  (unsigned long long)r.allocBytes, (long long)r.instrsBefore,
+                  (long long)r.instrsAfter, (long long)r.temps, r.built,
+                  r.reused, r.name.c_str());
+    out += line;
+  };
+  for (const PassRecord& r : stats) row(r);
+  row(total);
+  return out;
+}
+
+}  // namespace opt
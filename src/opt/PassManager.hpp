@@ -0,0 +1,120 @@
+/**
+ * @file PassManager.hpp
+ * @brief Named passes over three-address code, run as a configurable
+ * pipeline with cached analyses and per-pass statistics.
+ */
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "AnalysisCache.hpp"
+#include "IR.hpp"
+
+namespace opt {
+
+/**
+ * @brief A pass the pipeline can name.
+ */
+struct Pass {
+  const char* name;         ///< Used in pipeline strings and reports
+  const char* description;  ///< One line for help output
+
+  /**
+   * @brief Run over @p fn.
+   * @param cache Analyses of @p fn as it is on entry; invalidated by the
+   *        pass when it changes the code.
+   * @return True if the code changed.
+   */
+  bool (*run)(ir::Function& fn, AnalysisCache& cache);
+};
+
+/**
+ * @brief All built-in passes.
+ *
+ * Analyses (`cfg`, `domtree`, `loops`, `liveness`) only fill the cache;
+ * transforms are `rotate`, `licm`, `strength`, `bounds`, `unroll`,
+ * `peephole`, `copyprop`, `dce`, `coalesce` and `layout`.
+ */
+const std::vector<Pass>& passRegistry();
+
+/// Pipeline used when none is given; transforms that need single
+/// assignment come before the ones that undo it.
+extern const char* const kDefaultPipeline;
+
+/**
+ * @brief Passes by name.
+ * @param pipeline Comma-separated pass names; a name may repeat.
+ * @throws std::runtime_error for an unknown name.
+ */
+std::vector<Pass> parsePipeline(const std::string& pipeline);
+
+/// Heap allocations made so far on the calling thread.
+struct AllocTotals {
+  uint64_t count = 0;  ///< Calls to operator new
+  uint64_t bytes = 0;  ///< Bytes requested by them
+};
+
+/**
+ * @brief Measurements of one pipeline entry, accumulated over run() calls.
+ */
+struct PassRecord {
+  std::string name;
+  int runs = 0;
+  int changed = 0;           ///< Runs that changed the code
+  double seconds = 0;        ///< Wall time
+  uint64_t allocs = 0;       ///< Heap allocations, see countAllocs()
+  uint64_t allocBytes = 0;
+  int64_t instrsBefore = 0;  ///< Instructions on entry, summed over runs
+  int64_t instrsAfter = 0;   ///< Instructions on exit, summed over runs
+  int64_t temps = 0;         ///< Function::numTemps on exit, summed
+  int built = 0;             ///< Analyses the pass had to compute
+  int reused = 0;            ///< Analyses it got from the cache
+};
+
+/**
+ * @brief Runs a pipeline of passes over functions and records what each
+ * pass costs.
+ */
+class PassManager {
+ public:
+  /// @throws std::runtime_error for an unknown pass name.
+  explicit PassManager(const std::string& pipeline = kDefaultPipeline);
+  explicit PassManager(std::vector<Pass> passes);
+
+  /**
+   * @brief Run every pass in order over @p fn.
+   * @return True if any pass changed the code.
+   */
+  bool run(ir::Function& fn);
+
+  const std::vector<Pass>& passes() const { return pipeline; }
+
+  /**
+   * @brief Record the heap allocations of each pass with @p counter.
+   *
+   * The library does not replace the allocator; a program that links a
+   * counting one passes the function reading its totals. Without a
+   * counter the allocation columns stay zero.
+   */
+  void countAllocs(AllocTotals (*counter)()) { allocCounter = counter; }
+
+  /// One per pipeline entry, in pipeline order.
+  const std::vector<PassRecord>& records() const { return stats; }
+
+  /**
+   * @brief `-time-passes` style table of the records.
+   *
+   * One row per pipeline entry with wall time and its share of the total,
+   * allocations, instructions before and after, temporaries and analysis
+   * cache use, followed by a total row.
+   */
+  std::string report() const;
+
+ private:
+  std::vector<Pass> pipeline;
+  std::vector<PassRecord> stats;
+  AllocTotals (*allocCounter)() = nullptr;
+};
+
+}  // namespace opt
@@ -0,0 +1,284 @@
+/**
+ * @file Peephole.cpp
+ * @brief Table-driven peephole optimizer over three-address code.
+ */
+#include "Peephole.hpp"
+
+#include <sstream>
+#include <stdexcept>
+
+#include "IrUtil.hpp"
+
+namespace opt {
+namespace {
+
+using ir::Instr;
+using ir::Opcode;
+using ir::Operand;
+using symbols::Type;
+
+bool isCompare(Opcode op) { return op >= Opcode::Lt && op <= Opcode::Ne; }
+
+bool isCondJump(const Instr& in) {
+  return in.isJump() && in.op != Opcode::Jump;
+}
+
+/// Only read by the next instruction.
+bool singleRead(const Operand& t, const std::vector<int>& reads) {
+  return t.isTemp() && reads[t.temp] == 1;
+}
+
+/// Operand reading what `x = v` leaves in an @p x of type @p t: @p v when
+/// it already has that type, an int constant narrowed to it, or none.
+Operand stored(const Operand& v, const sptr<Type>& t) {
+  if (v.isConst() && !v.isFloat() && t != Type::Float)
+    return Operand::constInt(ir::wrap(v.ival, t), t);
+  return v.type == t ? v : Operand();
+}
+
+/* Rules */
+
+/// x = x
+bool redundantMove(const Instr* in, const std::vector<int>&,
+                   std::vector<Instr>&) {
+  return in[0].op == Opcode::Copy && in[0].dst.same(in[0].a);
+}
+
+/// t = 2 * 4  =>  t = 8
+bool foldConstants(const Instr* in, const std::vector<int>&,
+                   std::vector<Instr>& out) {
+  const Instr& op = in[0];
+  if (op.op < Opcode::Add || op.op > Opcode::Div || op.dst.type != Type::Int)
+    return false;
+  if (!op.a.isConst() || !op.b.isConst() || op.a.isFloat() || op.b.isFloat())
+    return false;
+  int64_t a = op.a.ival, b = op.b.ival, r;
+  switch (op.op) {
+    case Opcode::Add: r = a + b; break;
+    case Opcode::Sub: r = a - b; break;
+    case Opcode::Mul: r = a * b; break;
+    default:
+      if (b == 0) return false;  // keep the trap
+      r = a / b;
+      break;
+  }
+  Instr c{Opcode::Copy, op.dst,
+          Operand::constInt(static_cast<int32_t>(r), Type::Int)};
+  c.loc = op.loc;
+  out.push_back(c);
+  return true;
+}
+
+/// t = v; ... t ...  =>  ... v ...
+bool forwardCopy(const Instr* in, const std::vector<int>& reads,
+                 std::vector<Instr>& out) {
+  if (in[0].op != Opcode::Copy || !singleRead(in[0].dst, reads) ||
+      in[1].op == Opcode::Label)
+    return false;
+  Operand v = stored(in[0].a, in[0].dst.type);
+  if (v.isNone()) return false;
+  Instr next = in[1];
+  bool hit = false;
+  for (Operand* o : {&next.a, &next.b})
+    if (o->same(in[0].dst)) {
+      *o = v;
+      hit = true;
+    }
+  if (!hit) return false;
+  out.push_back(next);
+  return true;
+}
+
+/// t = a op b; x = t  =>  x = a op b
+bool foldTemp(const Instr* in, const std::vector<int>& reads,
+              std::vector<Instr>& out) {
+  if (!in[0].hasResult() || !singleRead(in[0].dst, reads)) return false;
+  if (in[1].op != Opcode::Copy || !in[1].a.same(in[0].dst) ||
+      in[1].dst.type != in[0].dst.type)
+    return false;
+  out.push_back(in[0]);
+  out.back().dst = in[1].dst;
+  return true;
+}
+
+/// x = v; ... x ...  =>  x = v; ... v ...
+bool storeReload(const Instr* in, const std::vector<int>&,
+                 std::vector<Instr>& out) {
+  const Instr& st = in[0];
+  if (st.op != Opcode::Copy || !st.dst.isVar() || st.a.same(st.dst))
+    return false;
+  Operand v = stored(st.a, st.dst.type);
+  if (v.isNone()) return false;
+  Instr next = in[1];
+  bool hit = false;
+  for (Operand* o : {&next.a, &next.b})
+    if (o->same(st.dst)) {
+      *o = v;
+      hit = true;
+    }
+  if (!hit || next.op == Opcode::Label) return false;
+  out.push_back(st);
+  out.push_back(next);
+  return true;
+}
+
+/// a[i] = v; t = a[i]  =>  a[i] = v; t = v
+bool storeReloadElement(const Instr* in, const std::vector<int>&,
+                        std::vector<Instr>& out) {
+  if (in[0].op != Opcode::Store || in[1].op != Opcode::Load) return false;
+  if (!in[1].a.same(in[0].dst) || !in[1].b.same(in[0].a)) return false;
+  Operand v = stored(in[0].b, in[1].dst.type);
+  if (v.isNone()) return false;
+  out.push_back(in[0]);
+  out.push_back(Instr{Opcode::Copy, in[1].dst, v});
+  out.back().loc = in[1].loc;
+  return true;
+}
+
+/// t = a < b; if t goto L  =>  if a < b goto L
+bool boolBranch(const Instr* in, const std::vector<int>& reads,
+                std::vector<Instr>& out) {
+  if (!isCompare(in[0].op) || !singleRead(in[0].dst, reads)) return false;
+  const Instr& j = in[1];
+  if ((j.op != Opcode::JumpIf && j.op != Opcode::JumpIfNot) ||
+      !j.a.same(in[0].dst))
+    return false;
+  Instr br{ir::compareJump(in[0].op), Operand(), in[0].a, in[0].b};
+  br.label = j.label;
+  br.loc = j.loc;
+  if (j.op == Opcode::JumpIfNot) {
+    Instr neg;
+    if (!invertJump(br, neg)) return false;
+    br = neg;
+  }
+  out.push_back(br);
+  return true;
+}
+
+/// t = a - b; if t == 0 goto L  =>  if a == b goto L
+bool compareZeroAfterSub(const Instr* in, const std::vector<int>& reads,
+                         std::vector<Instr>& out) {
+  const Instr& sub = in[0];
+  const Instr& j = in[1];
+  if (sub.op != Opcode::Sub || sub.dst.isFloat() ||
+      !singleRead(sub.dst, reads))
+    return false;
+  if (j.op != Opcode::JumpEq && j.op != Opcode::JumpNe) return false;
+  auto zero = [](const Operand& o) { return o.isConst() && o.ival == 0; };
+  // a - b == 0 exactly when a == b, also with 32-bit wrap-around
+  if (!((j.a.same(sub.dst) && zero(j.b)) || (j.b.same(sub.dst) && zero(j.a))))
+    return false;
+  Instr br = j;
+  br.a = sub.a;
+  br.b = sub.b;
+  out.push_back(br);
+  return true;
+}
+
+/// goto L; L:  =>  L:
+bool jumpToNext(const Instr* in, const std::vector<int>&,
+                std::vector<Instr>& out) {
+  if (!in[0].isJump() || in[1].op != Opcode::Label ||
+      in[0].label != in[1].label)
+    return false;
+  out.push_back(in[1]);
+  return true;
+}
+
+/// if c goto L1; goto L2; L1:  =>  iffalse c goto L2; L1:
+bool branchOverJump(const Instr* in, const std::vector<int>&,
+                    std::vector<Instr>& out) {
+  if (!isCondJump(in[0]) || in[1].op != Opcode::Jump ||
+      in[2].op != Opcode::Label || in[0].label != in[2].label)
+    return false;
+  Instr br;
+  if (!invertJump(in[0], br)) return false;
+  br.label = in[1].label;
+  out.push_back(br);
+  out.push_back(in[2]);
+  return true;
+}
+
+void countReads(const Instr& in, std::vector<int>& reads, int delta) {
+  auto add = [&](const Operand& o) {
+    if (o.isTemp()) reads[o.temp] += delta;
+  };
+  if (in.op == Opcode::Label || in.op == Opcode::Jump) return;
+  add(in.a);
+  add(in.b);
+}
+
+}  // namespace
+
+const std::vector<PeepholeRule>& peepholeRules() {
+  static const std::vector<PeepholeRule> rules = {
+      {"redundant-move", 1, redundantMove},
+      {"fold-constants", 1, foldConstants},
+      {"forward-copy", 2, forwardCopy},
+      {"fold-temp", 2, foldTemp},
+      {"store-reload", 2, storeReload},
+      {"store-reload-element", 2, storeReloadElement},
+      {"bool-branch", 2, boolBranch},
+      {"cmp-zero-after-sub", 2, compareZeroAfterSub},
+      {"jump-to-next", 2, jumpToNext},
+      {"branch-over-jump", 3, branchOverJump},
+  };
+  return rules;
+}
+
+std::vector<PeepholeRule> selectPeepholeRules(const std::string& names) {
+  if (names == "all") return peepholeRules();
+  std::vector<PeepholeRule> out;
+  std::stringstream ss(names);
+  std::string name;
+  while (std::getline(ss, name, ',')) {
+    if (name.empty()) continue;
+    bool found = false;
+    for (const PeepholeRule& r : peepholeRules())
+      if (name == r.name) {
+        out.push_back(r);
+        found = true;
+      }
+    if (!found) throw std::runtime_error("Unknown peephole rule: " + name);
+  }
+  return out;
+}
+
+Peephole::Peephole(std::vector<PeepholeRule> rules)
+    : hits(rules.size(), 0), table(std::move(rules)) {}
+
+int Peephole::run(ir::Function& fn) {
+  std::vector<int> reads(fn.numTemps + 1, 0);
+  for (const Instr& in : fn.code) countReads(in, reads, 1);
+
+  size_t before = fn.code.size();
+  std::vector<Instr> out;
+  out.reserve(before);
+  std::vector<Instr> repl;
+  for (Instr& next : fn.code) {
+    out.push_back(std::move(next));
+    bool changed = true;
+    while (changed) {
+      changed = false;
+      for (size_t r = 0; r < table.size(); ++r) {
+        size_t k = static_cast<size_t>(table[r].window);
+        if (out.size() < k) continue;
+        const Instr* w = out.data() + (out.size() - k);
+        repl.clear();
+        if (!table[r].rewrite(w, reads, repl)) continue;
+
+        for (size_t i = 0; i < k; ++i) countReads(w[i], reads, -1);
+        for (const Instr& in : repl) countReads(in, reads, 1);
+        out.resize(out.size() - k);
+        for (Instr& in : repl) out.push_back(std::move(in));
+        ++hits[r];
+        changed = true;
+        break;
+      }
+    }
+  }
+  fn.code = std::move(out);
+  return static_cast<int>(before - fn.code.size());
+}
+
+}  // namespace opt
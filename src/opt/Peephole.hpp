@@ -0,0 +1,70 @@
+/**
+ * @file Peephole.hpp
+ * @brief Table-driven peephole optimizer over three-address code.
+ */
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "IR.hpp"
+
+namespace opt {
+
+/**
+ * @brief One rewrite pattern over a window of adjacent instructions.
+ */
+struct PeepholeRule {
+  const char* name;  ///< Used to select rules and to report hits
+  int window;        ///< Number of instructions matched
+
+  /**
+   * @brief Match `in[0 .. window)`.
+   * @param in Adjacent instructions.
+   * @param reads temp -> number of instructions reading it.
+   * @param out Replacement for the window, filled on a match.
+   * @return True on a match.
+   */
+  bool (*rewrite)(const ir::Instr* in, const std::vector<int>& reads,
+                  std::vector<ir::Instr>& out);
+};
+
+/// All built-in rules, in the order they are tried.
+const std::vector<PeepholeRule>& peepholeRules();
+
+/**
+ * @brief Built-in rules by name.
+ * @param names Comma-separated rule names, or "all".
+ * @throws std::runtime_error for an unknown name.
+ */
+std::vector<PeepholeRule> selectPeepholeRules(const std::string& names);
+
+/**
+ * @brief Sliding-window peephole pass.
+ *
+ * Instructions are pushed one at a time onto an output list; after every
+ * push the rules are tried on the tail of the list, first match wins, until
+ * none applies. A rewrite can therefore enable further matches with the
+ * instructions before it. Labels are never matched by the arithmetic rules,
+ * so windows do not span basic blocks.
+ */
+class Peephole {
+ public:
+  explicit Peephole(std::vector<PeepholeRule> rules = peepholeRules());
+
+  /**
+   * @brief Rewrite @p fn until no rule matches.
+   * @return Number of instructions removed.
+   */
+  int run(ir::Function& fn);
+
+  const std::vector<PeepholeRule>& rules() const { return table; }
+
+  /// rule index -> number of rewrites, accumulated over run() calls.
+  std::vector<uint64_t> hits;
+
+ private:
+  std::vector<PeepholeRule> table;
+};
+
+}  // namespace opt
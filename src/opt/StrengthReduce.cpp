@@ -0,0 +1,297 @@
+/**
+ * @file StrengthReduce.cpp
+ * @brief Induction variable strength reduction on three-address code.
+ */
+#include "StrengthReduce.hpp"
+
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+#include "Cfg.hpp"
+#include "IrUtil.hpp"
+
+namespace opt {
+namespace {
+
+using ir::Instr;
+using ir::Opcode;
+using ir::Operand;
+using symbols::Type;
+
+/// `iv * scale` followed by additions/subtractions of invariant operands.
+struct Linear {
+  const symbols::Id* iv = nullptr;
+  int64_t scale = 0;
+  std::vector<std::pair<Opcode, Operand>> addends;
+
+  bool same(const Linear& o) const {
+    if (iv != o.iv || scale != o.scale || addends.size() != o.addends.size())
+      return false;
+    for (size_t i = 0; i < addends.size(); ++i)
+      if (addends[i].first != o.addends[i].first ||
+          !addends[i].second.same(o.addends[i].second))
+        return false;
+    return true;
+  }
+};
+
+/// A derived temporary: its form and the derived operand it was built from.
+struct Derived {
+  Linear form;
+  int def = -1;   ///< Defining instruction
+  int from = 0;   ///< Derived temporary used by the definition (0 = none)
+};
+
+struct Induction {
+  int update = -1;  ///< The only instruction writing the variable in the loop
+  int64_t step = 0;
+};
+
+bool isIntConst(const Operand& o) {
+  return o.isConst() && o.type == Type::Int;
+}
+
+/// Instructions reading each temporary, in code order.
+class TempReaders {
+ public:
+  explicit TempReaders(const ir::Function& fn) : start(fn.numTemps + 2, 0) {
+    std::vector<const Operand*> ops;
+    auto each = [&](auto&& f) {
+      for (size_t j = 0; j < fn.code.size(); ++j) {
+        ops.clear();
+        ir::uses(fn.code[j], ops);
+        for (const Operand* o : ops)
+          if (o->isTemp()) f(o->temp, static_cast<int>(j));
+      }
+    };
+    each([&](int t, int) { ++start[t + 1]; });
+    for (size_t t = 1; t < start.size(); ++t) start[t] += start[t - 1];
+    at.resize(start.back());
+    std::vector<int> next(start.begin(), start.end() - 1);
+    each([&](int t, int j) { at[next[t]++] = j; });
+  }
+
+  const int* begin(int t) const { return at.data() + start[t]; }
+  const int* end(int t) const { return at.data() + start[t + 1]; }
+
+ private:
+  std::vector<int> start;  ///< temp -> first reader in @ref at
+  std::vector<int> at;
+};
+
+class Reducer {
+ public:
+  explicit Reducer(ir::Function& f) : fn(f) {}
+
+  /// Reduce every loop that has derived expressions, innermost first and
+  /// one loop per nest; false if none has.
+  bool runOnce(AnalysisCache& cache, StrengthStats& stats) {
+    const ir::Cfg& cfg = cache.cfg();
+    const ir::DominatorTree& dom = cache.dominators();
+    const ir::LoopInfo& li = cache.loops();
+    TempDefs defs(fn);
+    TempReaders readers(fn);
+
+    LoopEdit edit(fn, cfg);
+    bool any = false;
+    for (const ir::Loop& loop : li.loops) {
+      if (edit.overlaps(loop) ||
+          !reduce(cfg, dom, defs, readers, loop, edit, stats))
+        continue;
+      edit.claim(loop);
+      any = true;
+    }
+    if (!any) return false;
+    applyLoopEdit(fn, cfg, li, edit);
+    cache.invalidate();
+    return true;
+  }
+
+ private:
+  ir::Function& fn;
+
+  /// Plan the reduction of @p loop into @p edit; false if there is none.
+  bool reduce(const ir::Cfg& cfg, const ir::DominatorTree& dom,
+              const TempDefs& defs, const TempReaders& readers,
+              const ir::Loop& loop, LoopEdit& edit, StrengthStats& stats) {
+    std::vector<int> body;
+    std::unordered_map<const symbols::Id*, std::vector<int>> writes;
+    for (int b : loop.blocks)
+      for (int i = cfg.blocks[b].begin; i < cfg.blocks[b].end; ++i) {
+        body.push_back(i);
+        const Instr& in = fn.code[i];
+        if (in.hasResult() && in.dst.isVar()) writes[in.dst.var].push_back(i);
+      }
+    std::sort(body.begin(), body.end());
+
+    // Basic induction variables
+    std::unordered_map<const symbols::Id*, Induction> ivs;
+    for (const auto& [v, sites] : writes) {
+      if (sites.size() != 1 || v->type != Type::Int) continue;
+      const Instr& in = fn.code[sites[0]];
+      int64_t step = inductionStep(in, v);
+      if (!step && in.op == Opcode::Copy && defs.single(in.a)) {
+        int d = defs.index[in.a.temp];
+        if (loop.contains(cfg.blockOf[d]))
+          step = inductionStep(fn.code[d], v);
+      }
+      if (step) ivs[v] = Induction{sites[0], step};
+    }
+    if (ivs.empty()) return false;
+
+    auto invariant = [&](const Operand& o) {
+      if (o.isConst()) return true;
+      if (o.isVar()) return !writes.count(o.var);
+      if (!defs.single(o)) return false;
+      int b = cfg.blockOf[defs.index[o.temp]];
+      return !loop.contains(b) && dom.dominates(b, loop.header);
+    };
+
+    // Derived temporaries, in code order so operands are classified first
+    std::unordered_map<int, Derived> derived;
+    for (int i : body) {
+      const Instr& in = fn.code[i];
+      if (!defs.single(in.dst) || in.dst.type != Type::Int) continue;
+
+      if (in.op == Opcode::Mul) {
+        const Operand* v = &in.a;
+        const Operand* k = &in.b;
+        if (isIntConst(*v)) std::swap(v, k);
+        if (!v->isVar() || !ivs.count(v->var) || !isIntConst(*k)) continue;
+        Derived d;
+        d.form.iv = v->var;
+        d.form.scale = k->ival;
+        d.def = i;
+        derived[in.dst.temp] = std::move(d);
+      } else if (in.op == Opcode::Add || in.op == Opcode::Sub) {
+        const Operand* e = &in.a;
+        const Operand* x = &in.b;
+        if (in.op == Opcode::Add && !(e->isTemp() && derived.count(e->temp)))
+          std::swap(e, x);
+        if (!e->isTemp() || !derived.count(e->temp) || !invariant(*x))
+          continue;
+        const Derived& base = derived[e->temp];
+        // the operand must still describe the current value of the variable
+        int u = ivs[base.form.iv].update;
+        if (cfg.blockOf[base.def] != cfg.blockOf[i] ||
+            (base.def < u && u < i))
+          continue;
+        Derived d;
+        d.form = base.form;
+        d.form.addends.emplace_back(in.op, *x);
+        d.def = i;
+        d.from = e->temp;
+        derived[in.dst.temp] = std::move(d);
+      }
+    }
+    if (derived.empty()) return false;
+
+    // Roots: derived temporaries read by something other than the next
+    // link of a derivation chain.
+    std::unordered_set<int> roots;
+    for (const auto& [t, d] : derived)
+      for (const int* j = readers.begin(t); j != readers.end(t); ++j) {
+        const Instr& r = fn.code[*j];
+        auto link = r.hasResult() && r.dst.isTemp() ? derived.find(r.dst.temp)
+                                                    : derived.end();
+        if (link == derived.end() || link->second.def != *j ||
+            link->second.from != t) {
+          roots.insert(t);
+          break;
+        }
+      }
+    if (roots.empty()) return false;
+
+    struct Family {
+      Linear form;
+      Operand running;
+    };
+    std::vector<Family> families;
+    for (int i : body) {
+      const Instr& in = fn.code[i];
+      if (!in.hasResult() || !in.dst.isTemp() || !roots.count(in.dst.temp))
+        continue;
+      const Linear& form = derived[in.dst.temp].form;
+      auto fam = std::find_if(families.begin(), families.end(),
+                              [&](const Family& f) { return f.form.same(form); });
+      if (fam == families.end()) {
+        families.push_back(Family{form, fn.newTemp(Type::Int)});
+        fam = families.end() - 1;
+      }
+      ++stats.reduced;
+
+      // Readers later in the same block, before the variable is advanced,
+      // can read the running temporary directly.
+      int u = ivs[form.iv].update;
+      const int* rb = readers.begin(in.dst.temp);
+      const int* re = readers.end(in.dst.temp);
+      bool local = std::all_of(rb, re, [&](int j) {
+        return j > i && cfg.blockOf[j] == cfg.blockOf[i] && !(i < u && u < j);
+      });
+      if (!local) {
+        Instr copy{Opcode::Copy, in.dst, fam->running};
+        copy.loc = in.loc;
+        edit.replace[i] = copy;
+        continue;
+      }
+      edit.drop[i] = 1;
+      for (const int* j = rb; j != re; ++j) {
+        auto it = edit.replace.emplace(*j, fn.code[*j]).first;
+        for (Operand* o : {&it->second.a, &it->second.b})
+          if (o->isTemp() && o->temp == in.dst.temp) *o = fam->running;
+      }
+    }
+
+    std::unordered_set<const symbols::Id*> used;
+    for (const Family& f : families) {
+      const Operand& s = f.running;
+      const Induction& iv = ivs[f.form.iv];
+      SourceLocation loc = fn.code[cfg.blocks[loop.header].begin].loc;
+      Operand v = Operand::variable(f.form.iv);
+
+      Instr init{Opcode::Mul, s, v, Operand::constInt(f.form.scale, Type::Int)};
+      if (f.form.scale == 1) init = Instr{Opcode::Copy, s, v};
+      init.loc = loc;
+      edit.preheader[loop.header].push_back(init);
+      for (const auto& [op, x] : f.form.addends) {
+        Instr add{op, s, s, x};
+        add.loc = loc;
+        edit.preheader[loop.header].push_back(add);
+      }
+
+      int64_t delta = iv.step * f.form.scale;
+      Instr next{delta < 0 ? Opcode::Sub : Opcode::Add, s, s,
+                 Operand::constInt(delta < 0 ? -delta : delta, Type::Int)};
+      next.loc = fn.code[iv.update].loc;
+      edit.after[iv.update].push_back(next);
+      used.insert(f.form.iv);
+    }
+    stats.inductionVars += static_cast<int>(used.size());
+    return true;
+  }
+};
+
+}  // namespace
+
+bool reduceStrength(ir::Function& fn, StrengthStats* stats) {
+  AnalysisCache cache(fn);
+  return reduceStrength(fn, cache, stats);
+}
+
+bool reduceStrength(ir::Function& fn, AnalysisCache& cache,
+                    StrengthStats* stats) {
+  StrengthStats local;
+  StrengthStats& st = stats ? *stats : local;
+  Reducer reducer(fn);
+  bool any = false;
+  while (reducer.runOnce(cache, st)) any = true;
+  if (!any) return false;
+  int removed = removeDeadTemps(fn);
+  if (removed) cache.invalidate();
+  st.removed += removed;
+  return true;
+}
+
+}  // namespace opt
@@ -0,0 +1,47 @@
+/**
+ * @file StrengthReduce.hpp
+ * @brief Induction variable strength reduction on three-address code.
+ */
+#pragma once
+#include "AnalysisCache.hpp"
+#include "IR.hpp"
+
+namespace opt {
+
+/**
+ * @brief Counters collected by reduceStrength().
+ */
+struct StrengthStats {
+  int inductionVars = 0;  /**< Basic induction variables used */
+  int reduced = 0;        /**< Derived expressions replaced by a copy */
+  int removed = 0;        /**< Instructions left dead and removed */
+};
+
+/**
+ * @brief Replace multiplications by loop induction variables with additions.
+ *
+ * A basic induction variable is an int variable whose only definition in a
+ * loop is `v = v ± c` (directly or through a temporary) for a constant c.
+ * Temporaries computed as `v * k` for a constant k, possibly followed by
+ * additions of loop-invariant values, are derived from it; array offsets
+ * such as `a[i][j]` lower to exactly this shape. Each distinct derived
+ * expression gets a running temporary that is initialized in the loop
+ * preheader and advanced by `c * k` right after the update of v, and the
+ * derived temporaries become copies of it. Instructions left without uses
+ * are removed afterwards.
+ *
+ * Loops are processed innermost first. Run after hoistLoopInvariants() so
+ * that invariant parts of an offset live outside the loop.
+ *
+ * @param fn Function to transform.
+ * @param stats Optional counters, accumulated into.
+ * @return True if anything was reduced.
+ */
+bool reduceStrength(ir::Function& fn, StrengthStats* stats = nullptr);
+
+/// reduceStrength() using the analyses in @p cache, which is invalidated
+/// when the code changes.
+bool reduceStrength(ir::Function& fn, AnalysisCache& cache,
+                    StrengthStats* stats = nullptr);
+
+}  // namespace opt
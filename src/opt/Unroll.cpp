@@ -0,0 +1,355 @@
+/**
+ * @file Unroll.cpp
+ * @brief Unrolling of loops with a compile-time trip count.
+ */
+#include "Unroll.hpp"
+
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+#include "Cfg.hpp"
+#include "IrUtil.hpp"
+
+namespace opt {
+namespace {
+
+using ir::Instr;
+using ir::Opcode;
+using ir::Operand;
+using symbols::Type;
+
+/// A loop laid out as one contiguous range of code.
+struct Counted {
+  int begin = 0;        ///< Header label
+  int end = 0;          ///< One past the back edge
+  int test = 0;         ///< Conditional jump deciding whether to go on
+  bool bottom = false;  ///< `do` loop: the test is the back edge
+  int64_t trips = 0;    ///< Times the body runs
+};
+
+/// Relation with its operands exchanged: `a rel b` is `b swapped(rel) a`.
+Opcode swapped(Opcode rel) {
+  switch (rel) {
+    case Opcode::Lt: return Opcode::Gt;
+    case Opcode::Le: return Opcode::Ge;
+    case Opcode::Gt: return Opcode::Lt;
+    case Opcode::Ge: return Opcode::Le;
+    default: return rel;
+  }
+}
+
+/**
+ * Number of leading values of i0, i0 + s, i0 + 2s, ... for which `i rel n`
+ * holds, or -1 if they do not stop before leaving the int range.
+ */
+int64_t tripCount(Opcode rel, int64_t i0, int64_t s, int64_t n) {
+  int64_t trips = -1;
+  switch (rel) {
+    case Opcode::Lt:
+      if (i0 >= n) trips = 0;
+      else if (s > 0) trips = (n - i0 + s - 1) / s;
+      break;
+    case Opcode::Le:
+      if (i0 > n) trips = 0;
+      else if (s > 0) trips = (n - i0) / s + 1;
+      break;
+    case Opcode::Gt:
+      if (i0 <= n) trips = 0;
+      else if (s < 0) trips = (i0 - n - s - 1) / -s;
+      break;
+    case Opcode::Ge:
+      if (i0 < n) trips = 0;
+      else if (s < 0) trips = (i0 - n) / -s + 1;
+      break;
+    case Opcode::Ne:
+      if ((n - i0) % s == 0 && (n - i0) / s >= 0) trips = (n - i0) / s;
+      break;
+    case Opcode::Eq:
+      trips = i0 == n ? 1 : 0;
+      break;
+    default:
+      break;
+  }
+  if (trips < 0) return -1;
+  int64_t last = i0 + trips * s;
+  return last < INT32_MIN || last > INT32_MAX ? -1 : trips;
+}
+
+class Unroller {
+ public:
+  Unroller(ir::Function& f, const UnrollOptions& o) : fn(f), opts(o) {}
+
+  /// Unroll every loop that qualifies, one loop per nest; false if none
+  /// does.
+  bool runOnce(AnalysisCache& cache, UnrollStats& stats) {
+    const ir::Cfg& cfg = cache.cfg();
+    const ir::DominatorTree& dom = cache.dominators();
+    const ir::LoopInfo& li = cache.loops();
+    TempDefs defs(fn);
+    RefCounts refs(fn);
+    inLoop.assign(fn.numTemps + 1, 0);
+
+    LoopEdit edit(fn, cfg);
+    bool any = false;
+    for (const ir::Loop& loop : li.loops) {
+      if (edit.overlaps(loop)) continue;
+      // a partially unrolled loop keeps its header and must not be redone
+      if (!seen.insert(fn.code[cfg.blocks[loop.header].begin].label).second)
+        continue;
+      Counted c;
+      if (!analyze(cfg, dom, defs, refs, loop, c)) continue;
+      ++stats.counted;
+      if (!unroll(c, refs, edit, stats)) continue;
+      edit.claim(loop);
+      any = true;
+    }
+    if (!any) return false;
+    applyLoopEdit(fn, cfg, li, edit);
+    cache.invalidate();
+    return true;
+  }
+
+ private:
+  ir::Function& fn;
+  const UnrollOptions& opts;
+  std::unordered_set<int> seen;  ///< Header labels already looked at
+
+  // Per unrolled loop
+  std::vector<int> inLoop;               ///< temp -> references in the loop
+  const RefCounts* refCounts = nullptr;  ///< Of the whole code
+  std::unordered_set<int> labels;        ///< Labels placed inside the loop
+
+  /// Temporary @p t is only referenced in the loop being unrolled.
+  bool local(int t) const { return inLoop[t] == refCounts->temps[t]; }
+
+  /// Value of @p v on entry to @p at, if a constant copy in the code that
+  /// falls through to it sets it; conditional jumps on the way, like the
+  /// guard of a rotated loop, only leave. The frame starts zeroed.
+  bool constantBefore(int at, const symbols::Id* v, int64_t& value) const {
+    for (int i = at - 1; i >= 0; --i) {
+      const Instr& in = fn.code[i];
+      if (in.op == Opcode::Label || in.op == Opcode::Jump) return false;
+      if (!in.hasResult() || !in.dst.isVar() || in.dst.var != v) continue;
+      if (in.op != Opcode::Copy || !in.a.isConst()) return false;
+      value = in.a.ival;
+      return true;
+    }
+    value = 0;
+    return true;
+  }
+
+  bool analyze(const ir::Cfg& cfg, const ir::DominatorTree& dom,
+               const TempDefs& defs, const RefCounts& refs,
+               const ir::Loop& loop, Counted& c) {
+    const std::vector<int>& bs = loop.blocks;
+    for (size_t k = 0; k < bs.size(); ++k)
+      if (bs[k] != loop.header + static_cast<int>(k)) return false;
+    int last = bs.back();
+    if (loop.latches.size() != 1 || loop.latches[0] != last ||
+        loop.exits.size() != 1)
+      return false;
+
+    c.begin = cfg.blocks[loop.header].begin;
+    c.end = cfg.blocks[last].end;
+    const Instr& head = fn.code[c.begin];
+    const Instr& back = fn.code[c.end - 1];
+    if (head.op != Opcode::Label || back.label != head.label ||
+        (c.begin > 0 && fn.code[c.begin - 1].op == Opcode::Jump))
+      return false;
+    // entered only by falling into the header
+    if (refs.jumps[head.label] != 1) return false;
+
+    c.bottom = back.op != Opcode::Jump;
+    c.test = c.bottom ? c.end - 1 : cfg.blocks[loop.header].end - 1;
+    const Instr& test = fn.code[c.test];
+    int testBlock = cfg.blockOf[c.test];
+    if (loop.exits[0] != testBlock || !test.isJump() ||
+        test.op == Opcode::Jump)
+      return false;
+    if (!c.bottom && loop.contains(cfg.blocks[testBlock].succs[0]))
+      return false;
+
+    // Relation under which the loop goes on
+    Opcode rel;
+    Operand x, y;
+    if (test.isCompareJump()) {
+      rel = ir::compareOf(test.op);
+      x = test.a;
+      y = test.b;
+    } else {
+      if (!defs.single(test.a)) return false;
+      int d = defs.index[test.a.temp];
+      const Instr& cmp = fn.code[d];
+      if (cmp.op < Opcode::Lt || cmp.op > Opcode::Ne ||
+          cfg.blockOf[d] != testBlock)
+        return false;
+      rel = cmp.op;
+      x = cmp.a;
+      y = cmp.b;
+      if (test.op == Opcode::JumpIfNot) rel = ir::negate(rel);
+    }
+    if (x.type != Type::Int || y.type != Type::Int) return false;
+    if (!c.bottom) rel = ir::negate(rel);
+
+    std::unordered_map<const symbols::Id*, std::vector<int>> writes;
+    for (int i = c.begin; i < c.end; ++i) {
+      const Instr& in = fn.code[i];
+      if (in.hasResult() && in.dst.isVar()) writes[in.dst.var].push_back(i);
+    }
+    auto counter = [&](const Operand& o) {
+      return o.isVar() && writes.count(o.var) && writes[o.var].size() == 1;
+    };
+    if (!counter(x)) {
+      std::swap(x, y);
+      rel = swapped(rel);
+    }
+    if (!counter(x)) return false;
+
+    // Advanced once per iteration, before a bottom test and after a top one
+    int u = writes[x.var][0];
+    int64_t step = inductionStep(fn.code[u], x.var);
+    if (!step && fn.code[u].op == Opcode::Copy && defs.single(fn.code[u].a)) {
+      int d = defs.index[fn.code[u].a.temp];
+      if (d >= c.begin && d < c.end) step = inductionStep(fn.code[d], x.var);
+    }
+    if (!step || !dom.dominates(cfg.blockOf[u], last) ||
+        (!c.bottom && u < c.test))
+      return false;
+
+    int64_t i0, n;
+    if (y.isConst()) {
+      n = y.ival;
+    } else if (!y.isVar() || writes.count(y.var) ||
+               !constantBefore(c.begin, y.var, n)) {
+      return false;
+    }
+    if (!constantBefore(c.begin, x.var, i0)) return false;
+
+    // A bottom test first sees the value after one step
+    c.trips = c.bottom ? tripCount(rel, i0 + step, step, n)
+                       : tripCount(rel, i0, step, n);
+    if (c.trips < 0) return false;
+    if (c.bottom) ++c.trips;
+    return true;
+  }
+
+  /// Append a copy of the instructions @p idx with fresh local names.
+  void copy(const std::vector<int>& idx, std::vector<Instr>& out) {
+    std::unordered_map<int, Operand> temps;
+    std::unordered_map<int, int> renamed;
+    auto rename = [&](Operand& o) {
+      if (!o.isTemp() || !local(o.temp)) return;
+      auto it = temps.find(o.temp);
+      if (it == temps.end())
+        it = temps.emplace(o.temp, fn.newTemp(o.type)).first;
+      o = it->second;
+    };
+    for (int i : idx) {
+      Instr in = fn.code[i];
+      rename(in.dst);
+      rename(in.a);
+      rename(in.b);
+      if (labels.count(in.label)) {
+        auto it = renamed.find(in.label);
+        if (it == renamed.end())
+          it = renamed.emplace(in.label, fn.newLabel()).first;
+        in.label = it->second;
+      }
+      out.push_back(std::move(in));
+    }
+  }
+
+  /// Plan the unrolling of @p c into @p edit; false if it is too large.
+  bool unroll(const Counted& c, const RefCounts& counts, LoopEdit& edit,
+              UnrollStats& stats) {
+    // One iteration: everything but the header label, test and back edge
+    std::vector<int> iter;
+    for (int i = c.begin + 1; i < c.end - 1; ++i)
+      if (i != c.test) iter.push_back(i);
+    // Evaluated for the test of a top-tested loop
+    std::vector<int> pre;
+    for (int i = c.begin + 1; i < c.test && !c.bottom; ++i) pre.push_back(i);
+
+    int64_t size = static_cast<int64_t>(iter.size());
+    bool full = c.trips * size + static_cast<int64_t>(pre.size()) <=
+                opts.maxFullSize;
+    int64_t f = opts.factor;
+    if (!full && (f < 2 || c.trips < f || size * f > opts.maxPartialSize))
+      return false;
+
+    refCounts = &counts;
+    labels.clear();
+    auto count = [&](int delta) {
+      for (int i = c.begin + 1; i < c.end; ++i)
+        for (const Operand* o : {&fn.code[i].dst, &fn.code[i].a,
+                                 &fn.code[i].b})
+          if (o->isTemp()) inLoop[o->temp] += delta;
+    };
+    count(1);
+    for (int i = c.begin + 1; i < c.end; ++i)
+      if (fn.code[i].op == Opcode::Label) labels.insert(fn.code[i].label);
+
+    // The loop's code is replaced by `out`.
+    for (int i = c.begin; i < c.end; ++i) edit.drop[i] = 1;
+    std::vector<Instr>& out = edit.after[c.end - 1];
+    const Instr& test = fn.code[c.test];
+    if (full) {
+      for (int64_t k = 0; k < c.trips; ++k) copy(iter, out);
+      if (!c.bottom) {
+        // the final test can still trap, and then leaves
+        copy(pre, out);
+        size_t next = static_cast<size_t>(c.end);
+        if (next == fn.code.size() || fn.code[next].op != Opcode::Label ||
+            fn.code[next].label != test.label) {
+          Instr j{Opcode::Jump};
+          j.label = test.label;
+          j.loc = test.loc;
+          out.push_back(j);
+        }
+      }
+      ++stats.full;
+    } else {
+      // Peel the remainder so the loop runs a multiple of f times
+      for (int64_t k = 0; k < c.trips % f; ++k) copy(iter, out);
+      out.push_back(fn.code[c.begin]);
+      if (c.bottom) {
+        for (int64_t k = 0; k + 1 < f; ++k) copy(iter, out);
+        std::vector<int> latch = iter;
+        latch.push_back(c.test);
+        copy(latch, out);
+      } else {
+        std::vector<int> head = iter;
+        head.insert(head.begin() + static_cast<long>(pre.size()), c.test);
+        copy(head, out);
+        for (int64_t k = 0; k + 1 < f; ++k) copy(iter, out);
+        out.push_back(fn.code[c.end - 1]);
+      }
+      ++stats.partial;
+    }
+    count(-1);
+    return true;
+  }
+};
+
+}  // namespace
+
+bool unrollLoops(ir::Function& fn, const UnrollOptions& options,
+                 UnrollStats* stats) {
+  AnalysisCache cache(fn);
+  return unrollLoops(fn, cache, options, stats);
+}
+
+bool unrollLoops(ir::Function& fn, AnalysisCache& cache,
+                 const UnrollOptions& options, UnrollStats* stats) {
+  UnrollStats local;
+  UnrollStats& st = stats ? *stats : local;
+  Unroller unroller(fn, options);
+  bool any = false;
+  while (unroller.runOnce(cache, st)) any = true;
+  if (any && removeDeadTemps(fn) > 0) cache.invalidate();
+  return any;
+}
+
+}  // namespace opt
@@ -0,0 +1,63 @@
+/**
+ * @file Unroll.hpp
+ * @brief Unrolling of loops with a compile-time trip count.
+ */
+#pragma once
+#include "AnalysisCache.hpp"
+#include "IR.hpp"
+
+namespace opt {
+
+/**
+ * @brief Size limits of unrollLoops().
+ */
+struct UnrollOptions {
+  int maxFullSize = 128;    /**< Largest fully unrolled loop, in instructions */
+  int factor = 4;           /**< Body copies per partially unrolled iteration */
+  int maxPartialSize = 96;  /**< Largest partially unrolled body */
+};
+
+/**
+ * @brief Counters collected by unrollLoops().
+ */
+struct UnrollStats {
+  int counted = 0;  /**< Loops with a trip count known at compile time */
+  int full = 0;     /**< Loops replaced by straight-line copies */
+  int partial = 0;  /**< Loops unrolled by UnrollOptions::factor */
+};
+
+/**
+ * @brief Unroll loops whose trip count is known at compile time.
+ *
+ * Handles the loops lowered from `while` (test at the top, `goto` back
+ * from the end) and `do` (test at the bottom) whose only exit is that test,
+ * which compares an int variable against a constant or against a variable
+ * not written in the loop. The variable must be advanced by a constant
+ * exactly once per iteration, and both it and the bound must be set to
+ * constants in the straight-line code that falls into the loop, so
+ * `i = 0; while (i < 16) ...` runs 16 times. Loops that would wrap around
+ * the int range are left alone.
+ *
+ * A loop whose copies fit in UnrollOptions::maxFullSize instructions is
+ * replaced by that many copies of its body. Otherwise, if UnrollOptions::
+ * factor copies of the body fit in maxPartialSize, the body is repeated
+ * factor times per iteration with the tests in between dropped; the
+ * `trips % factor` remaining iterations are peeled in front of the loop,
+ * so the original test stays exact. Labels and temporaries local to the
+ * loop are renamed in every copy.
+ *
+ * @param fn Function to transform.
+ * @param options Size limits.
+ * @param stats Optional counters, accumulated into.
+ * @return True if any loop was unrolled.
+ */
+bool unrollLoops(ir::Function& fn, const UnrollOptions& options = {},
+                 UnrollStats* stats = nullptr);
+
+/// unrollLoops() using the analyses in @p cache, which is invalidated
+/// when the code changes.
+bool unrollLoops(ir::Function& fn, AnalysisCache& cache,
+                 const UnrollOptions& options = {},
+                 UnrollStats* stats = nullptr);
+
+}  // namespace opt
@@ -1,6 +1,7 @@
 #include "Parser.hpp"
 
 #include <stdexcept>
+#include <vector>
 
 namespace parser {
 
@@ -29,37 +30,63 @@ void Parser::match(char ch) {
 }
 
 // Parse the whole program
-void Parser::program() { block(); }
+sptr<ast::Stmt> Parser::program() { return block(); }
+
+void Parser::reset() {
+  // back out of the blocks a failed program() left open
+  while (top->prev) top = top->prev;
+  top->table.clear();
+  frame.vars.clear();
+  frame.globals = 0;
+  frame.size = 0;
+  depth = 0;
+  loops = 0;
+  move();
+}
 
 // Parse a block
-void* Parser::block() {
+sptr<ast::Stmt> Parser::block() {
+  SourceLocation loc = look->loc;
   match('{');
   sptr<symbols::Env> savedEnv = top;
   top = std::make_shared<symbols::Env>(top);
-  decls();
-  stmts();
+  ++depth;
+  sptr<ast::Stmt> init = decls();
+  sptr<ast::Stmt> body = stmts();
+  --depth;
   match('}');
   top = savedEnv;
-  return nullptr;
+  if (init && body) return std::make_shared<ast::Seq>(loc, init, body);
+  if (init || body) return init ? init : body;
+  return std::make_shared<ast::Seq>(loc, nullptr, nullptr);
 }
 
 // Parse variable declarations
-void Parser::decls() {
+sptr<ast::Stmt> Parser::decls() {
+  std::vector<sptr<ast::Stmt>> init;
   while (look->tag == lexer::Tag::BASIC) {
     sptr<symbols::Type> p = type();
     sptr<lexer::Token> tok = look;  // save token
     match(lexer::Tag::ID);
 
-    auto id = std::make_shared<symbols::Id>(tok->lexeme, p, bytesUsed);
+    auto id = frame.allocate(tok->lexeme, p);
     top->put(tok->lexeme, id);
-    bytesUsed += p->width;
+    if (depth == 1) frame.globals = frame.vars.size();
 
     if (look->tag == lexer::Tag::ASSIGN) {
+      SourceLocation loc = look->loc;
       move();
-      sptr<ast::Expr> initExpr = assign();  // save init expr if needed
+      sptr<ast::Expr> initExpr = orExpr();
+      init.push_back(makeSet(
+          loc, std::make_shared<ast::IdExpr>(tok->loc, id), initExpr));
     }
     match(';');
   }
+
+  sptr<ast::Stmt> s;
+  for (auto it = init.rbegin(); it != init.rend(); ++it)
+    s = s ? std::make_shared<ast::Seq>((*it)->location, *it, s) : *it;
+  return s;
 }
 
 // Parse a type
@@ -86,22 +113,106 @@ sptr<symbols::Type> Parser::dims(sptr<symbols::Type> p) {
 }
 
 // Parse multiple statements
-void Parser::stmts() {
-  while (look->tag != sym('}') && look->tag != lexer::Tag::END) stmt();
+sptr<ast::Stmt> Parser::stmts() {
+  // Collect first, then fold into a right-leaning Seq chain, so long
+  // statement lists do not recurse once per statement while parsing.
+  std::vector<sptr<ast::Stmt>> list;
+  while (look->tag != sym('}') && look->tag != lexer::Tag::END)
+    list.push_back(stmt());
+
+  sptr<ast::Stmt> s;
+  for (auto it = list.rbegin(); it != list.rend(); ++it)
+    s = s ? std::make_shared<ast::Seq>((*it)->location, *it, s) : *it;
+  return s;
 }
 
 // Parse a single statement
-void Parser::stmt() {
-  if (look->tag == sym('{')) {
-    block();
-  } else if (look->tag == lexer::Tag::ID) {
-    sptr<ast::Expr> e = assign();
+sptr<ast::Stmt> Parser::stmt() {
+  using lexer::Tag;
+  SourceLocation loc = look->loc;
+
+  if (look->tag == sym(';')) {
+    move();
+    return std::make_shared<ast::Seq>(loc, nullptr, nullptr);
+  }
+
+  if (look->tag == sym('{')) return block();
+
+  if (look->tag == Tag::IF) {
+    match(Tag::IF);
+    match('(');
+    sptr<ast::Expr> cond = orExpr();
+    match(')');
+    sptr<ast::Stmt> thenStmt = stmt();
+    if (look->tag != Tag::ELSE)
+      return std::make_shared<ast::If>(loc, cond, thenStmt);
+    match(Tag::ELSE);
+    sptr<ast::Stmt> elseStmt = stmt();
+    return std::make_shared<ast::Else>(loc, cond, thenStmt, elseStmt);
+  }
+
+  if (look->tag == Tag::WHILE) {
+    match(Tag::WHILE);
+    match('(');
+    sptr<ast::Expr> cond = orExpr();
+    match(')');
+    ++loops;
+    sptr<ast::Stmt> body = stmt();
+    --loops;
+    return std::make_shared<ast::While>(loc, cond, body);
+  }
+
+  if (look->tag == Tag::DO) {
+    match(Tag::DO);
+    ++loops;
+    sptr<ast::Stmt> body = stmt();
+    --loops;
+    match(Tag::WHILE);
+    match('(');
+    sptr<ast::Expr> cond = orExpr();
+    match(')');
     match(';');
-  } else {
-    std::string str = "Unknown statement start: " + look->toString();
-    SourceLocation loc = look->loc;
-    error(str, loc);
+    return std::make_shared<ast::Do>(loc, body, cond);
   }
+
+  if (look->tag == Tag::BREAK) {
+    match(Tag::BREAK);
+    match(';');
+    if (loops == 0) error("Unenclosed break", loc);
+    return std::make_shared<ast::Break>(loc);
+  }
+
+  if (look->tag == Tag::ID) return assignStmt();
+
+  std::string str = "Unknown statement start: " + look->toString();
+  error(str, loc);
+}
+
+// Assignment statement
+sptr<ast::Stmt> Parser::assignStmt() {
+  sptr<ast::Expr> target = factor();
+  SourceLocation loc = look->loc;
+  match(lexer::Tag::ASSIGN);
+  sptr<ast::Expr> value = orExpr();
+  match(';');
+  return makeSet(loc, target, value);
+}
+
+// Build Set / SetElem
+sptr<ast::Stmt> Parser::makeSet(SourceLocation loc, sptr<ast::Expr> target,
+                                sptr<ast::Expr> value) {
+  const auto& lt = target->exprType;
+  const auto& rt = value->exprType;
+  bool ok = lt && rt &&
+            (lt == rt || (lt->isNumeric() && rt->isNumeric())) &&
+            !std::dynamic_pointer_cast<symbols::Array>(lt);
+  if (!ok) error("Type error in assignment", loc);
+
+  if (std::dynamic_pointer_cast<ast::Access>(target))
+    return std::make_shared<ast::SetElem>(loc, target, value);
+  if (std::dynamic_pointer_cast<ast::IdExpr>(target))
+    return std::make_shared<ast::Set>(loc, target, value);
+  error("Invalid assignment target", loc);
 }
 
 // Assignment expression
@@ -193,7 +304,8 @@ sptr<ast::Expr> Parser::term() {
 
 // Unary
 sptr<ast::Expr> Parser::unary() {
-  if (look->tag == lexer::Tag::MINUS || look->tag == lexer::Tag::UnaryNOT) {
+  if (look->tag == lexer::Tag::MINUS || look->tag == lexer::Tag::OP_MINUS ||
+      look->tag == lexer::Tag::UnaryNOT) {
     sptr<lexer::Token> tok = look;
     SourceLocation loc = tok->loc;
     move();
@@ -236,13 +348,17 @@ sptr<ast::Expr> Parser::factor() {
     auto varNode = std::make_shared<ast::IdExpr>(
         loc, std::static_pointer_cast<symbols::Id>(entry));
 
-    if (look->tag == sym('[')) {
+    // a[i][j] is parsed as (a[i])[j]
+    sptr<ast::Expr> node = varNode;
+    while (look->tag == sym('[')) {
       move();
       sptr<ast::Expr> indexExpr = assign();
       match(']');
-      return std::make_shared<ast::Access>(loc, varNode, indexExpr);
+      if (!std::dynamic_pointer_cast<symbols::Array>(node->exprType))
+        error("Indexing a non-array: " + name, loc);
+      node = std::make_shared<ast::Access>(loc, node, indexExpr);
     }
-    return varNode;
+    return node;
   }
 
   if (look->tag == sym('(')) {
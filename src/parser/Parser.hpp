@@ -19,8 +19,10 @@
 #include "Array.hpp"
 #include "Env.hpp"
 #include "Expr.hpp"
+#include "Frame.hpp"
 #include "Id.hpp"
 #include "Lexer.hpp"
+#include "Stmt.h"
 #include "Type.hpp"
 #include "TypeToken.hpp"
 
@@ -37,21 +39,38 @@ class Parser {
    * @brief Construct a new Parser instance.
    * @param l Shared pointer to the Lexer that provides tokens.
    */
-  Parser::Parser(const std::shared_ptr<lexer::Lexer>& l)
-      : lex(l), top(std::make_shared<symbols::Env>()), bytesUsed(0) {
+  Parser(const std::shared_ptr<lexer::Lexer>& l)
+      : lex(l), top(std::make_shared<symbols::Env>()) {
     move();
   }
 
   /**
    * @brief Entry point for parsing. Parses a complete program.
+   * @return Root statement of the program.
    */
-  void program();
+  sptr<ast::Stmt> program();
+
+  /**
+   * @brief Get ready to parse the next program from the lexer, which the
+   * caller has reset; the tables keep their memory.
+   *
+   * Also recovers from a program() that threw. layout() of the previous
+   * program is cleared.
+   */
+  void reset();
+
+  /**
+   * @brief Variable layout built by decls().
+   */
+  symbols::Frame& layout() { return frame; }
 
  private:
   sptr<lexer::Lexer> lex;   ///< The associated lexer instance
   sptr<lexer::Token> look;  ///< Lookahead token
   sptr<symbols::Env> top;   ///< Current symbol table environment
-  int bytesUsed;            ///< Accumulated memory usage for variables
+  symbols::Frame frame;     ///< Variable slots and accumulated frame size
+  int depth = 0;            ///< Nesting level of the current block
+  int loops = 0;            ///< Number of enclosing loops (for break)
 
   // === Basic methods ===
 
@@ -78,14 +97,15 @@ class Parser {
   /**
    * @brief Parse a code block: '{' declarations statements '}' with its own
    * scope.
-   * @return nullptr (placeholder for integration with code generation).
+   * @return Initializers of the declarations followed by the statements.
    */
-  void* block();
+  sptr<ast::Stmt> block();
 
   /**
    * @brief Parse variable declarations (with optional initialization).
+   * @return Assignments for the initialized declarations, or nullptr.
    */
-  void decls();
+  sptr<ast::Stmt> decls();
 
   /**
    * @brief Parse a type specification (primitive or array).
@@ -102,13 +122,25 @@ class Parser {
 
   /**
    * @brief Parse a sequence of statements until '}' or EOF.
+   * @return Right-leaning chain of Seq nodes, or nullptr if empty.
    */
-  void stmts();
+  sptr<ast::Stmt> stmts();
 
   /**
    * @brief Parse a single statement.
    */
-  void stmt();
+  sptr<ast::Stmt> stmt();
+
+  /**
+   * @brief Parse `lvalue = expr;` into a Set or SetElem node.
+   */
+  sptr<ast::Stmt> assignStmt();
+
+  /**
+   * @brief Build the assignment of @p value to @p target, checking types.
+   */
+  sptr<ast::Stmt> makeSet(SourceLocation loc, sptr<ast::Expr> target,
+                          sptr<ast::Expr> value);
 
   // === Expressions ===
 
@@ -165,6 +197,6 @@ class Parser {
  * @param s String containing error message.
  * @param loc Location where the error occurred at.
  */
-void error(const std::string& s, const SourceLocation& loc);
+[[noreturn]] void error(const std::string& s, const SourceLocation& loc);
 
 }  // namespace parser
@@ -0,0 +1,82 @@
+/**
+ * @file Frame.hpp
+ * @brief Flat variable layout of a program.
+ */
+#pragma once
+#include <string>
+#include <vector>
+
+#include "Id.hpp"
+#include "Type.hpp"
+#include "sptr.h"
+
+namespace symbols {
+
+/**
+ * @brief Flat variable layout of a program.
+ *
+ * Every declared variable gets its own slot and slots are never reused
+ * between scopes, so all variables live in one contiguous block of
+ * @ref size bytes addressed by Id::offset.
+ */
+struct Frame {
+  /** Declared variables in declaration (and offset) order. */
+  std::vector<sptr<Id>> vars;
+
+  /** Number of leading entries of @ref vars declared in the outermost block.
+   *  Their final values are the observable result of a program. */
+  size_t globals = 0;
+
+  /** Total frame size in bytes. */
+  int size = 0;
+
+  /**
+   * @brief Allocate a slot for a new variable at the end of the frame.
+   * @param name Variable name.
+   * @param t Variable type.
+   * @return Descriptor of the new variable.
+   */
+  sptr<Id> allocate(const std::string& name, sptr<Type> t) {
+    auto id = std::make_shared<Id>(name, t, size);
+    size += t->width;
+    vars.push_back(id);
+    return id;
+  }
+
+  /**
+   * @brief Check whether a variable belongs to the outermost block.
+   */
+  bool isGlobal(const Id* id) const {
+    for (size_t i = 0; i < globals; ++i)
+      if (vars[i].get() == id) return true;
+    return false;
+  }
+
+  /**
+   * @brief Drop the variables rejected by @p keep and repack the rest.
+   *
+   * Offsets of the remaining variables are reassigned in declaration order.
+   *
+   * @param keep Predicate called with each `const Id&`.
+   * @return Number of bytes reclaimed.
+   */
+  template <typename Pred>
+  int compact(Pred keep) {
+    int oldSize = size;
+    std::vector<sptr<Id>> kept;
+    size_t keptGlobals = 0;
+    size = 0;
+    for (size_t i = 0; i < vars.size(); ++i) {
+      if (!keep(*vars[i])) continue;
+      vars[i]->offset = size;
+      size += vars[i]->type->width;
+      if (i < globals) ++keptGlobals;
+      kept.push_back(vars[i]);
+    }
+    vars = std::move(kept);
+    globals = keptGlobals;
+    return oldSize - size;
+  }
+};
+
+}  // namespace symbols
@@ -0,0 +1,142 @@
+/**
+ * @file ThreadPool.cpp
+ * @brief Work-stealing thread pool running independent pieces of a
+ * compilation concurrently.
+ */
+#include "ThreadPool.hpp"
+
+#include <exception>
+
+namespace task {
+
+namespace {
+/// Pool and worker index of the calling thread, if it is a worker.
+thread_local const ThreadPool* currentPool = nullptr;
+thread_local size_t currentWorker = 0;
+}  // namespace
+
+ThreadPool::ThreadPool(unsigned count) {
+  for (unsigned k = 0; k < count; ++k)
+    workers.push_back(std::make_unique<Worker>());
+  threads.reserve(count);
+  for (unsigned k = 0; k < count; ++k)
+    threads.emplace_back([this, k] { work(k); });
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(sleepMutex);
+    stopping = true;
+  }
+  wake.notify_all();
+  for (auto& t : threads) t.join();
+}
+
+unsigned ThreadPool::defaultWorkers() {
+  unsigned hw = std::thread::hardware_concurrency();
+  return hw > 1 ? hw - 1 : 0;
+}
+
+void ThreadPool::push(std::vector<Task>& tasks) {
+  size_t n = workers.size();
+  // counted before they can be taken, so runOne() never takes the count
+  // below zero; until they are in, a woken worker just looks again
+  queued.fetch_add(tasks.size());
+  if (currentPool == this) {
+    // a task's subtasks stay on its worker until stolen
+    Worker& w = *workers[currentWorker];
+    std::lock_guard<std::mutex> lock(w.mutex);
+    for (auto& t : tasks) w.tasks.push_back(std::move(t));
+  } else {
+    // dealt out in turn, one lock per deque
+    size_t first = nextWorker.fetch_add(1, std::memory_order_relaxed);
+    for (size_t k = 0; k < n && k < tasks.size(); ++k) {
+      Worker& w = *workers[(first + k) % n];
+      std::lock_guard<std::mutex> lock(w.mutex);
+      for (size_t i = k; i < tasks.size(); i += n)
+        w.tasks.push_back(std::move(tasks[i]));
+    }
+  }
+  // taking the lock orders the increment before a sleeper's check
+  { std::lock_guard<std::mutex> lock(sleepMutex); }
+  if (tasks.size() == 1)
+    wake.notify_one();
+  else
+    wake.notify_all();
+}
+
+bool ThreadPool::runOne(size_t self) {
+  Task task;
+  size_t n = workers.size();
+  for (size_t k = 0; k < n && !task; ++k) {
+    size_t victim = (self + k) % n;
+    Worker& w = *workers[victim];
+    std::lock_guard<std::mutex> lock(w.mutex);
+    if (w.tasks.empty()) continue;
+    // own tasks newest first, stolen ones oldest first
+    if (victim == self) {
+      task = std::move(w.tasks.back());
+      w.tasks.pop_back();
+    } else {
+      task = std::move(w.tasks.front());
+      w.tasks.pop_front();
+    }
+  }
+  if (!task) return false;
+  queued.fetch_sub(1);
+  task();
+  return true;
+}
+
+void ThreadPool::work(size_t self) {
+  currentPool = this;
+  currentWorker = self;
+  for (;;) {
+    if (runOne(self)) continue;
+    std::unique_lock<std::mutex> lock(sleepMutex);
+    wake.wait(lock, [&] { return stopping || queued.load() > 0; });
+    if (stopping && queued.load() == 0) return;
+  }
+}
+
+void ThreadPool::parallelFor(size_t n, const std::function<void(size_t)>& fn) {
+  if (workers.empty() || n <= 1) {
+    for (size_t k = 0; k < n; ++k) fn(k);
+    return;
+  }
+
+  std::atomic<size_t> left{n};
+  std::mutex doneMutex;
+  std::condition_variable done;
+  std::exception_ptr error;
+
+  std::vector<Task> tasks;
+  tasks.reserve(n);
+  for (size_t k = 0; k < n; ++k) {
+    tasks.push_back([&, k] {
+      try {
+        fn(k);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(doneMutex);
+        if (!error) error = std::current_exception();
+      }
+      // under the lock, so the caller cannot see zero and return before
+      // the notification is out
+      std::lock_guard<std::mutex> lock(doneMutex);
+      if (left.fetch_sub(1) == 1) done.notify_all();
+    });
+  }
+  push(tasks);
+
+  size_t self = currentPool == this ? currentWorker : workers.size();
+  while (left.load() > 0) {
+    if (runOne(self)) continue;
+    // the rest is running elsewhere
+    std::unique_lock<std::mutex> lock(doneMutex);
+    done.wait(lock, [&] { return left.load() == 0; });
+  }
+  std::lock_guard<std::mutex> lock(doneMutex);
+  if (error) std::rethrow_exception(error);
+}
+
+}  // namespace task
@@ -0,0 +1,86 @@
+/**
+ * @file ThreadPool.hpp
+ * @brief Work-stealing thread pool running independent pieces of a
+ * compilation concurrently.
+ */
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace task {
+
+/**
+ * @brief Fixed set of worker threads, each with its own deque of tasks.
+ *
+ * A worker takes its newest task first and, when its deque is empty,
+ * steals the oldest task of another worker, so uneven tasks even out
+ * without a shared queue everybody contends on. Tasks submitted from
+ * outside the pool are dealt to the workers in turn; a task submitting
+ * more tasks pushes them on its own worker's deque.
+ *
+ * parallelFor() is the way in: the calling thread runs tasks too while it
+ * waits, which makes nested calls from inside a task safe and a pool of
+ * zero workers a serial loop.
+ */
+class ThreadPool {
+ public:
+  /// Start @p workers threads; zero runs everything on the caller.
+  explicit ThreadPool(unsigned workers = defaultWorkers());
+
+  /// Waits for the queued tasks, then joins the workers.
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  /// One worker per hardware thread but the caller's.
+  static unsigned defaultWorkers();
+
+  /// Number of worker threads.
+  unsigned size() const { return static_cast<unsigned>(threads.size()); }
+
+  /**
+   * @brief Call @p fn(k) for every k in [0, @p n), each on some thread of
+   * the pool or the caller, and return when all calls have returned.
+   *
+   * @throws the first exception one of the calls threw, once all of them
+   * are done; the calls after it still run.
+   */
+  void parallelFor(size_t n, const std::function<void(size_t)>& fn);
+
+ private:
+  using Task = std::function<void()>;
+
+  struct Worker {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::vector<std::thread> threads;
+
+  /// Tasks queued, or about to be, and not yet taken by a thread.
+  std::atomic<size_t> queued{0};
+  std::atomic<size_t> nextWorker{0};
+  std::mutex sleepMutex;
+  std::condition_variable wake;
+  bool stopping = false;
+
+  /// Queue all of @p tasks, which are moved from.
+  void push(std::vector<Task>& tasks);
+
+  /// Take a task, from worker @p self's deque first, and run it; false when
+  /// every deque is empty. @p self is workers.size() for the caller.
+  bool runOne(size_t self);
+
+  void work(size_t self);
+};
+
+}  // namespace task
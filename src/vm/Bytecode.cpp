@@ -0,0 +1,333 @@
+/**
+ * @file Bytecode.cpp
+ * @brief Register-based bytecode compiled from three-address code.
+ */
+#include "Bytecode.hpp"
+
+#include <cctype>
+#include <map>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+#include "Array.hpp"
+
+namespace vm {
+namespace {
+
+using ir::Opcode;
+using ir::Operand;
+using ir::wrap;
+using symbols::Type;
+
+/// Innermost element type of a (possibly nested) array type.
+sptr<Type> scalarOf(sptr<Type> t) {
+  while (auto arr = std::dynamic_pointer_cast<symbols::Array>(t)) t = arr->of;
+  return t;
+}
+
+Scalar scalar(const sptr<Type>& t) {
+  if (t == Type::Float) return Scalar::Float;
+  if (t == Type::Char) return Scalar::Char;
+  if (t == Type::Bool) return Scalar::Bool;
+  return Scalar::Int;
+}
+
+class Compiler {
+ public:
+  explicit Compiler(const ir::Function& f) : fn(f) {}
+
+  Program run() {
+    prog.frameSize = fn.frame.size;
+    for (const auto& var : fn.frame.vars) {
+      if (std::dynamic_pointer_cast<symbols::Array>(var->type)) continue;
+      uint32_t r = newRegister();
+      vars[var.get()] = r;
+      prog.vars.push_back({r, var->offset, scalar(var->type)});
+    }
+    firstTemp = static_cast<uint32_t>(prog.registers.size());
+    prog.registers.resize(firstTemp + fn.numTemps);
+    prog.firstConstant = static_cast<uint32_t>(prog.registers.size());
+
+    labels.assign(fn.numLabels + 1, -1);
+    for (const ir::Instr& in : fn.code) instr(in);
+    emit(Op::Halt);
+    for (auto [at, label] : fixups) {
+      if (labels[label] < 0)
+        throw std::runtime_error("Jump to undefined label L" +
+                                 std::to_string(label));
+      prog.code[at] = static_cast<uint32_t>(labels[label]);
+    }
+    return std::move(prog);
+  }
+
+ private:
+  const ir::Function& fn;
+  Program prog;
+  uint32_t firstTemp = 0;
+  std::unordered_map<const symbols::Id*, uint32_t> vars;
+  /// Constant registers by float flag and bit pattern
+  std::map<std::pair<bool, int64_t>, uint32_t> constants;
+  std::vector<int> labels;                   ///< label -> word index
+  std::vector<std::pair<size_t, int>> fixups; ///< target word, label
+
+  uint32_t newRegister() {
+    prog.registers.push_back(Slot{0});
+    return static_cast<uint32_t>(prog.registers.size() - 1);
+  }
+
+  /// Register holding constant @p o; integers keep their untruncated value,
+  /// as ir::Interpreter reads them.
+  uint32_t constant(const Operand& o) {
+    if (!o.isConst()) return 0;
+    Slot s;
+    if (o.isFloat())
+      s.f = o.fval;
+    else
+      s.i = o.ival;
+    auto key = std::make_pair(o.isFloat(), s.i);
+    auto it = constants.find(key);
+    if (it != constants.end()) return it->second;
+    uint32_t r = newRegister();
+    prog.registers[r] = s;
+    constants.emplace(key, r);
+    return r;
+  }
+
+  uint32_t reg(const Operand& o) {
+    switch (o.kind) {
+      case Operand::Kind::Const:
+        return constant(o);
+      case Operand::Kind::Temp:
+        return firstTemp + o.temp - 1;
+      case Operand::Kind::Var: {
+        auto it = vars.find(o.var);
+        if (it == vars.end())
+          throw std::runtime_error("Variable " + o.var->name +
+                                   " is not a scalar of the frame");
+        return it->second;
+      }
+      default:
+        throw std::runtime_error("Empty operand in bytecode compilation");
+    }
+  }
+
+  void emit(Op op, std::initializer_list<uint32_t> operands = {}) {
+    prog.code.push_back(static_cast<uint32_t>(op));
+    prog.code.insert(prog.code.end(), operands);
+    ++prog.instructions;
+  }
+
+  /// Jump with operands @p operands followed by the target of @p label.
+  void jump(Op op, int label, std::initializer_list<uint32_t> operands = {}) {
+    emit(op, operands);
+    prog.code.push_back(0);
+    fixups.emplace_back(prog.code.size() - 1, label);
+  }
+
+  /// Narrow an integer result to the type of @p dst.
+  void narrow(const Operand& dst) {
+    if (dst.type == Type::Char) emit(Op::WrapC, {reg(dst)});
+  }
+
+  /// Load or store: value register, offset register, base, width.
+  void memory(Op op, uint32_t value, const Operand& arr, const Operand& off) {
+    if (!arr.isVar())
+      throw std::runtime_error("Indexed operand is not an array variable");
+    emit(op, {value, reg(off), static_cast<uint32_t>(arr.var->offset),
+              static_cast<uint32_t>(arr.var->type->width)});
+  }
+
+  static Op typed(Opcode op, bool fl) {
+    switch (op) {
+      case Opcode::Add: return fl ? Op::AddF : Op::AddI;
+      case Opcode::Sub: return fl ? Op::SubF : Op::SubI;
+      case Opcode::Mul: return fl ? Op::MulF : Op::MulI;
+      case Opcode::Div: return fl ? Op::DivF : Op::DivI;
+      case Opcode::Lt: return fl ? Op::LtF : Op::LtI;
+      case Opcode::Le: return fl ? Op::LeF : Op::LeI;
+      case Opcode::Gt: return fl ? Op::GtF : Op::GtI;
+      case Opcode::Ge: return fl ? Op::GeF : Op::GeI;
+      case Opcode::Eq: return fl ? Op::EqF : Op::EqI;
+      case Opcode::Ne: return fl ? Op::NeF : Op::NeI;
+      case Opcode::JumpLt: return fl ? Op::JLtF : Op::JLtI;
+      case Opcode::JumpLe: return fl ? Op::JLeF : Op::JLeI;
+      case Opcode::JumpGt: return fl ? Op::JGtF : Op::JGtI;
+      case Opcode::JumpGe: return fl ? Op::JGeF : Op::JGeI;
+      case Opcode::JumpEq: return fl ? Op::JEqF : Op::JEqI;
+      default: return fl ? Op::JNeF : Op::JNeI;
+    }
+  }
+
+  /// dst = a, converted to the type of dst.
+  void convert(const Operand& dst, const Operand& a) {
+    uint32_t d = reg(dst);
+    if (a.isConst()) {
+      Operand c = dst.isFloat()
+                      ? Operand::constFloat(a.isFloat()
+                                                ? a.fval
+                                                : static_cast<double>(a.ival))
+                      : Operand::constInt(
+                            wrap(a.isFloat() ? static_cast<int64_t>(a.fval)
+                                             : a.ival,
+                                 dst.type),
+                            dst.type);
+      emit(Op::Mov, {d, constant(c)});
+      return;
+    }
+    uint32_t s = reg(a);
+    if (dst.isFloat()) {
+      emit(a.isFloat() ? Op::Mov : Op::I2F, {d, s});
+      return;
+    }
+    if (a.isFloat()) {
+      emit(Op::F2I, {d, s});
+      s = d;
+    }
+    if (dst.type == Type::Char)
+      emit(Op::ToC, {d, s});
+    else if (dst.type == Type::Bool)
+      emit(Op::ToB, {d, s});
+    else if (s != d)
+      emit(Op::Mov, {d, s});
+  }
+
+  void instr(const ir::Instr& in) {
+    switch (in.op) {
+      case Opcode::Copy:
+        // constants are folded to the type of dst; registers already are
+        if (in.a.isConst() || in.a.type != in.dst.type)
+          convert(in.dst, in.a);
+        else if (!in.a.same(in.dst))
+          emit(Op::Mov, {reg(in.dst), reg(in.a)});
+        return;
+      case Opcode::Cvt:
+        convert(in.dst, in.a);
+        return;
+      case Opcode::Add:
+      case Opcode::Sub:
+      case Opcode::Mul:
+      case Opcode::Div:
+        emit(typed(in.op, in.dst.isFloat()),
+             {reg(in.dst), reg(in.a), reg(in.b)});
+        narrow(in.dst);
+        return;
+      case Opcode::Neg:
+        emit(in.dst.isFloat() ? Op::NegF : Op::NegI, {reg(in.dst), reg(in.a)});
+        narrow(in.dst);
+        return;
+      case Opcode::Not:
+        emit(Op::Not, {reg(in.dst), reg(in.a)});
+        return;
+      case Opcode::Lt:
+      case Opcode::Le:
+      case Opcode::Gt:
+      case Opcode::Ge:
+      case Opcode::Eq:
+      case Opcode::Ne:
+        emit(typed(in.op, in.a.isFloat()), {reg(in.dst), reg(in.a), reg(in.b)});
+        return;
+      case Opcode::And:
+      case Opcode::Or:
+        emit(in.op == Opcode::And ? Op::And : Op::Or,
+             {reg(in.dst), reg(in.a), reg(in.b)});
+        return;
+      case Opcode::Load: {
+        sptr<Type> t = scalarOf(in.dst.type);
+        Op op = t == Type::Float  ? Op::LdF
+                : t == Type::Char ? Op::LdC
+                : t == Type::Bool ? Op::LdB
+                                  : Op::LdI;
+        memory(op, reg(in.dst), in.a, in.b);
+        return;
+      }
+      case Opcode::Store: {
+        sptr<Type> t = scalarOf(in.b.type);
+        Op op = t == Type::Float ? Op::StF : t == Type::Int ? Op::StI : Op::StB;
+        uint32_t v = reg(in.b);
+        if (t == Type::Bool && in.b.isConst())
+          v = constant(Operand::constInt(in.b.ival != 0, t));
+        memory(op, v, in.dst, in.a);
+        return;
+      }
+      case Opcode::Check:
+        emit(Op::Check, {reg(in.a), reg(in.b)});
+        return;
+      case Opcode::Label:
+        labels[in.label] = static_cast<int>(prog.code.size());
+        return;
+      case Opcode::Jump:
+        jump(Op::Jmp, in.label);
+        return;
+      case Opcode::JumpIf:
+      case Opcode::JumpIfNot:
+        jump(in.op == Opcode::JumpIf ? Op::Jt : Op::Jf, in.label, {reg(in.a)});
+        return;
+      case Opcode::JumpLt:
+      case Opcode::JumpLe:
+      case Opcode::JumpGt:
+      case Opcode::JumpGe:
+      case Opcode::JumpEq:
+      case Opcode::JumpNe:
+        jump(typed(in.op, in.a.isFloat()), in.label, {reg(in.a), reg(in.b)});
+        return;
+      default:
+        throw std::runtime_error(std::string("Unsupported instruction in "
+                                             "bytecode compilation: ") +
+                                 ir::opcodeName(in.op));
+    }
+  }
+};
+
+}  // namespace
+
+const char* opName(Op op) {
+  switch (op) {
+#define SC_VM_NAME(name, ...) \
+  case Op::name:              \
+    return #name;
+    SC_VM_OPCODES(SC_VM_NAME)
+    SC_VM_PAIRS(SC_VM_NAME)
+    SC_VM_TRIPLES(SC_VM_NAME)
+#undef SC_VM_NAME
+  }
+  return "?";
+}
+
+Program compile(const ir::Function& fn) { return Compiler(fn).run(); }
+
+std::string toString(const Program& prog, size_t pc) {
+  Parts p = parts(static_cast<Op>(prog.code[pc]));
+  std::string out;
+  for (int part = 0; part < p.count; ++part) {
+    Op op = p.ops[part];
+    if (part > 0) out += "; ";
+    std::string name = opName(op);
+    for (char& c : name) c = static_cast<char>(std::tolower(c));
+    out += name;
+    int words = opWords(op);
+    for (int k = 1; k < words; ++k) {
+      uint32_t w = prog.code[pc + k];
+      out += k == 1 ? " " : ", ";
+      if (isJump(op) && k == words - 1)
+        out += "@" + std::to_string(w);
+      else if (isImmediate(op, k))
+        out += std::to_string(static_cast<int32_t>(w));
+      else
+        out += "r" + std::to_string(w);
+    }
+    pc += words;
+  }
+  // superinstructions print as their parts, in braces
+  return p.count > 1 ? "{" + out + "}" : out;
+}
+
+std::string toString(const Program& prog) {
+  std::string out;
+  for (size_t pc = 0; pc < prog.code.size();
+       pc += opWords(static_cast<Op>(prog.code[pc])))
+    out += std::to_string(pc) + "\t" + toString(prog, pc) + "\n";
+  return out;
+}
+
+}  // namespace vm
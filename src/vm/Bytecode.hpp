@@ -0,0 +1,255 @@
+/**
+ * @file Bytecode.hpp
+ * @brief Register-based bytecode compiled from three-address code.
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "IR.hpp"
+
+namespace vm {
+
+/**
+ * @brief Opcodes as X(name, words): every instruction is its opcode word
+ * followed by words - 1 operand words.
+ *
+ * Operands come in the order of the comments. d, a and b are register
+ * numbers and t is a jump target, a word index into Program::code. Loads
+ * and stores take a value register, a register off holding a byte offset,
+ * and the frame offset base and byte size width of the array; they trap
+ * unless the element lies inside the array. Integer results are truncated
+ * to 32 bits, WrapC then narrows them to char.
+ *
+ * The K forms take an int32 immediate k in place of register b; compile()
+ * never emits them, quicken() rewrites to them (see Rewrite.hpp).
+ */
+#define SC_VM_OPCODES(X)                                       \
+  X(Halt, 1)   /* return                                    */ \
+  X(Mov, 3)    /* d = a                                     */ \
+  X(AddI, 4)   /* d = a + b                                 */ \
+  X(SubI, 4)   /* d = a - b                                 */ \
+  X(MulI, 4)   /* d = a * b                                 */ \
+  X(DivI, 4)   /* d = a / b, traps on zero                  */ \
+  X(NegI, 3)   /* d = -a                                    */ \
+  X(AddIK, 4)  /* d = a + k                                 */ \
+  X(SubIK, 4)  /* d = a - k                                 */ \
+  X(MulIK, 4)  /* d = a * k                                 */ \
+  X(AddF, 4)   /* d = a + b                                 */ \
+  X(SubF, 4)   /* d = a - b                                 */ \
+  X(MulF, 4)   /* d = a * b                                 */ \
+  X(DivF, 4)   /* d = a / b                                 */ \
+  X(NegF, 3)   /* d = -a                                    */ \
+  X(WrapC, 2)  /* d = (char)d                               */ \
+  X(Not, 3)    /* d = !a                                    */ \
+  X(And, 4)    /* d = a && b                                */ \
+  X(Or, 4)     /* d = a || b                                */ \
+  X(LtI, 4)    /* d = a < b                                 */ \
+  X(LeI, 4)    /* d = a <= b                                */ \
+  X(GtI, 4)    /* d = a > b                                 */ \
+  X(GeI, 4)    /* d = a >= b                                */ \
+  X(EqI, 4)    /* d = a == b                                */ \
+  X(NeI, 4)    /* d = a != b                                */ \
+  X(LtF, 4)    /* d = a < b                                 */ \
+  X(LeF, 4)    /* d = a <= b                                */ \
+  X(GtF, 4)    /* d = a > b                                 */ \
+  X(GeF, 4)    /* d = a >= b                                */ \
+  X(EqF, 4)    /* d = a == b                                */ \
+  X(NeF, 4)    /* d = a != b                                */ \
+  X(I2F, 3)    /* d = (float)a                              */ \
+  X(F2I, 3)    /* d = (int)a                                */ \
+  X(ToC, 3)    /* d = (char)a                               */ \
+  X(ToB, 3)    /* d = a != 0                                */ \
+  X(LdI, 5)    /* d = int at base + off; d off base width   */ \
+  X(LdF, 5)    /* d = float at base + off                   */ \
+  X(LdC, 5)    /* d = char at base + off                    */ \
+  X(LdB, 5)    /* d = bool at base + off                    */ \
+  X(StI, 5)    /* int at base + off = a; a off base width   */ \
+  X(StF, 5)    /* float at base + off = a                   */ \
+  X(StB, 5)    /* char or bool at base + off = a            */ \
+  X(Check, 3)  /* trap unless 0 <= a < b                    */ \
+  X(Jmp, 2)    /* goto t                                    */ \
+  X(Jt, 3)     /* if a goto t                               */ \
+  X(Jf, 3)     /* if !a goto t                              */ \
+  X(JLtI, 4)   /* if a < b goto t                           */ \
+  X(JLeI, 4)   /* if a <= b goto t                          */ \
+  X(JGtI, 4)   /* if a > b goto t                           */ \
+  X(JGeI, 4)   /* if a >= b goto t                          */ \
+  X(JEqI, 4)   /* if a == b goto t                          */ \
+  X(JNeI, 4)   /* if a != b goto t                          */ \
+  X(JLtIK, 4)  /* if a < k goto t                           */ \
+  X(JLeIK, 4)  /* if a <= k goto t                          */ \
+  X(JGtIK, 4)  /* if a > k goto t                           */ \
+  X(JGeIK, 4)  /* if a >= k goto t                          */ \
+  X(JEqIK, 4)  /* if a == k goto t                          */ \
+  X(JNeIK, 4)  /* if a != k goto t                          */ \
+  X(JLtF, 4)   /* if a < b goto t                           */ \
+  X(JLeF, 4)   /* if a <= b goto t                          */ \
+  X(JGtF, 4)   /* if a > b goto t                           */ \
+  X(JGeF, 4)   /* if a >= b goto t                          */ \
+  X(JEqF, 4)   /* if a == b goto t                          */ \
+  X(JNeF, 4)   /* if a != b goto t                          */
+
+/**
+ * @brief Superinstructions as X(name, A, B) and X(name, A, B, C).
+ *
+ * A superinstruction runs the sequence of its parts with a single dispatch.
+ * fuse() overwrites only the opcode word of the first part, so the
+ * instruction keeps the operands of every part in order and its length is
+ * their sum; the opcode words of the later parts stay, and a jump into the
+ * middle of the sequence still finds an ordinary instruction. Only the last
+ * part may be a jump.
+ *
+ * The list holds the most frequent sequences of bench_vm, profiled after
+ * quicken(); fuse() picks those a given program runs.
+ */
+#define SC_VM_PAIRS(X)               \
+  X(AddIAddIK, AddI, AddIK)          \
+  X(AddIKAddI, AddIK, AddI)          \
+  X(AddIKAddIK, AddIK, AddIK)        \
+  X(AddIKJLtI, AddIK, JLtI)          \
+  X(AddIKJLtIK, AddIK, JLtIK)        \
+  X(AddIJLtIK, AddI, JLtIK)          \
+  X(AddIKLdF, AddIK, LdF)            \
+  X(LdFMulF, LdF, MulF)              \
+  X(MulFAddF, MulF, AddF)            \
+  X(MulIKStB, MulIK, StB)            \
+  X(MovJNeIK, Mov, JNeIK)            \
+  X(LdBJt, LdB, Jt)                  \
+  X(LdIJLeIK, LdI, JLeIK)            \
+  X(LdIJGeIK, LdI, JGeIK)
+#define SC_VM_TRIPLES(X)               \
+  X(AddIAddIKAddI, AddI, AddIK, AddI)  \
+  X(AddIAddIKJLtI, AddI, AddIK, JLtI)  \
+  X(LdFLdFMulF, LdF, LdF, MulF)        \
+  X(MulFAddFAddIK, MulF, AddF, AddIK)  \
+  X(StBAddIJLtIK, StB, AddI, JLtIK)    \
+  X(DivIMulISubI, DivI, MulI, SubI)    \
+  X(MovMovJNeIK, Mov, Mov, JNeIK)
+
+/// Bytecode opcodes, see SC_VM_OPCODES and SC_VM_PAIRS.
+enum class Op : uint32_t {
+#define SC_VM_ENUM(name, ...) name,
+  SC_VM_OPCODES(SC_VM_ENUM) SC_VM_PAIRS(SC_VM_ENUM) SC_VM_TRIPLES(SC_VM_ENUM)
+#undef SC_VM_ENUM
+};
+
+/// Number of opcodes, for tables indexed by Op.
+#define SC_VM_ONE(...) +1
+constexpr size_t kOpCount = 0 SC_VM_OPCODES(SC_VM_ONE) SC_VM_PAIRS(SC_VM_ONE)
+    SC_VM_TRIPLES(SC_VM_ONE);
+#undef SC_VM_ONE
+
+/// The instructions a superinstruction runs; an opcode of SC_VM_OPCODES
+/// is its own single part.
+struct Parts {
+  Op ops[3];
+  int count;
+};
+
+constexpr Parts parts(Op op) {
+  switch (op) {
+#define SC_VM_PAIR(name, a, b) \
+  case Op::name:               \
+    return {{Op::a, Op::b, Op::a}, 2};
+#define SC_VM_TRIPLE(name, a, b, c) \
+  case Op::name:                    \
+    return {{Op::a, Op::b, Op::c}, 3};
+    SC_VM_PAIRS(SC_VM_PAIR)
+    SC_VM_TRIPLES(SC_VM_TRIPLE)
+#undef SC_VM_TRIPLE
+#undef SC_VM_PAIR
+    default:
+      return {{op, op, op}, 1};
+  }
+}
+
+/// Instruction length in words, opcode included.
+constexpr int opWords(Op op) {
+  switch (op) {
+#define SC_VM_WORDS(name, words) \
+  case Op::name:                 \
+    return words;
+    SC_VM_OPCODES(SC_VM_WORDS)
+#undef SC_VM_WORDS
+    default: {
+      Parts p = parts(op);
+      int words = 0;
+      for (int k = 0; k < p.count; ++k) words += opWords(p.ops[k]);
+      return words;
+    }
+  }
+}
+
+/// Whether an instruction may jump; for a superinstruction, its last part.
+constexpr bool isJump(Op op) {
+  Parts p = parts(op);
+  Op last = p.ops[p.count - 1];
+  return last >= Op::Jmp && last <= Op::JNeF;
+}
+
+/// Whether operand word @p k of a single instruction is an immediate
+/// rather than a register number or jump target.
+constexpr bool isImmediate(Op op, int k) {
+  if (op >= Op::LdI && op <= Op::StB) return k >= 3;
+  if (op >= Op::AddIK && op <= Op::MulIK) return k == 3;
+  if (op >= Op::JLtIK && op <= Op::JNeIK) return k == 2;
+  return false;
+}
+
+/// Mnemonic of an opcode.
+const char* opName(Op op);
+
+/// A register: every value fits in 64 bits.
+union Slot {
+  int64_t i;
+  double f;
+};
+
+/// How a scalar variable is stored in the frame.
+enum class Scalar : uint8_t { Int, Float, Char, Bool };
+
+/// A scalar variable kept in a register while the program runs.
+struct VarReg {
+  uint32_t reg;
+  int offset;  ///< Id::offset in the frame
+  Scalar kind;
+};
+
+/**
+ * @brief A compiled program.
+ *
+ * Registers hold scalar variables, temporaries and constants; @ref
+ * registers has their values on entry, so constants cost nothing at run
+ * time. Arrays stay in the byte frame, addressed by their Id::offset.
+ */
+struct Program {
+  std::vector<uint32_t> code;  ///< Instructions, ending with Halt
+  std::vector<Slot> registers; ///< Initial register file
+  std::vector<VarReg> vars;    ///< Copied in from the frame and back out
+  int frameSize = 0;           ///< symbols::Frame::size of the program
+  int instructions = 0;        ///< Instructions in @ref code
+  uint32_t firstConstant = 0;  ///< Registers from here on hold constants
+};
+
+/**
+ * @brief Compile a lowered function to bytecode.
+ *
+ * Every three-address instruction becomes one bytecode instruction, plus
+ * WrapC after char arithmetic; labels disappear. Typed opcodes are chosen
+ * from the operand types, so the interpreter never looks at a type.
+ *
+ * @throws std::runtime_error on vector instructions; lower without
+ * ir::LowerOptions::vectorize.
+ */
+Program compile(const ir::Function& fn);
+
+/// Instruction at word @p pc as text, e.g. `addi r4, r1, r2`.
+std::string toString(const Program& prog, size_t pc);
+
+/// Whole program, one instruction per line prefixed by its word index.
+std::string toString(const Program& prog);
+
+}  // namespace vm
@@ -0,0 +1,144 @@
+/**
+ * @file Rewrite.cpp
+ * @brief In-place bytecode rewrites: quickening and superinstructions.
+ */
+#include "Rewrite.hpp"
+
+#include <algorithm>
+
+namespace vm {
+namespace {
+
+/// Whether register @p reg holds an int constant that fits in int32.
+bool smallConstant(const Program& prog, uint32_t reg) {
+  if (reg < prog.firstConstant) return false;
+  int64_t v = prog.registers[reg].i;
+  return v == static_cast<int32_t>(v);
+}
+
+/// The K form of an int operation or compare-and-jump, or Halt.
+Op withImmediate(Op op) {
+  switch (op) {
+    case Op::AddI: return Op::AddIK;
+    case Op::SubI: return Op::SubIK;
+    case Op::MulI: return Op::MulIK;
+    case Op::JLtI: return Op::JLtIK;
+    case Op::JLeI: return Op::JLeIK;
+    case Op::JGtI: return Op::JGtIK;
+    case Op::JGeI: return Op::JGeIK;
+    case Op::JEqI: return Op::JEqIK;
+    case Op::JNeI: return Op::JNeIK;
+    default: return Op::Halt;
+  }
+}
+
+/// Compare-and-jump with its operands swapped: k < a is a > k.
+Op mirrored(Op op) {
+  switch (op) {
+    case Op::JLtI: return Op::JGtI;
+    case Op::JLeI: return Op::JGeI;
+    case Op::JGtI: return Op::JLtI;
+    case Op::JGeI: return Op::JLeI;
+    default: return op;
+  }
+}
+
+/// Dispatches a superinstruction saved in @p profile.
+uint64_t saved(const Profile& profile, Op super) {
+  Parts p = parts(super);
+  const auto& counts = p.count == 2 ? profile.pairs : profile.triples;
+  auto it = counts.find(p.count == 2
+                            ? Profile::key(p.ops[0], p.ops[1])
+                            : Profile::key(p.ops[0], p.ops[1], p.ops[2]));
+  return it == counts.end() ? 0 : it->second * (p.count - 1);
+}
+
+/// Whether the instructions at @p pc are the parts of @p super.
+bool matches(const Program& prog, size_t pc, Op super) {
+  Parts p = parts(super);
+  for (int k = 0; k < p.count; ++k) {
+    if (pc >= prog.code.size() || static_cast<Op>(prog.code[pc]) != p.ops[k])
+      return false;
+    pc += opWords(p.ops[k]);
+  }
+  return true;
+}
+
+}  // namespace
+
+int quicken(Program& prog) {
+  int rewritten = 0;
+  for (size_t pc = 0; pc < prog.code.size();
+       pc += opWords(static_cast<Op>(prog.code[pc]))) {
+    Op op = static_cast<Op>(prog.code[pc]);
+    Op quick = withImmediate(op);
+    if (quick == Op::Halt) continue;
+    bool jump = isJump(op);
+    // the operands a and b: words 2 and 3, or 1 and 2 of a jump
+    uint32_t* a = &prog.code[pc + (jump ? 1 : 2)];
+    uint32_t* b = a + 1;
+    if (!smallConstant(prog, *b)) {
+      if (!smallConstant(prog, *a) || op == Op::SubI) continue;
+      std::swap(*a, *b);
+      quick = withImmediate(mirrored(op));
+    }
+    *b = static_cast<uint32_t>(prog.registers[*b].i);
+    prog.code[pc] = static_cast<uint32_t>(quick);
+    ++rewritten;
+  }
+  return rewritten;
+}
+
+std::vector<Sequence> hottest(const Profile& profile, int length, size_t n) {
+  std::vector<Sequence> out;
+  auto op = [](uint32_t key, int k) {
+    for (int i = 2; i > k; --i) key /= kOpCount;
+    return static_cast<Op>(key % kOpCount);
+  };
+  if (length == 1) {
+    for (size_t k = 0; k < kOpCount; ++k)
+      if (profile.ops[k])
+        out.push_back({{static_cast<Op>(k)}, profile.ops[k]});
+  } else {
+    for (const auto& [key, count] :
+         length == 2 ? profile.pairs : profile.triples) {
+      Sequence s{{op(key, 0), op(key, 1)}, count};
+      if (length == 3) s.ops.push_back(op(key, 2));
+      out.push_back(std::move(s));
+    }
+  }
+  std::sort(out.begin(), out.end(), [](const Sequence& x, const Sequence& y) {
+    return x.count != y.count ? x.count > y.count : x.ops < y.ops;
+  });
+  if (out.size() > n) out.resize(n);
+  return out;
+}
+
+FuseStats fuse(Program& prog, const Profile& profile, size_t limit) {
+  FuseStats stats;
+  std::vector<std::pair<uint64_t, Op>> ranked;
+  for (size_t k = 0; k < kOpCount; ++k) {
+    Op super = static_cast<Op>(k);
+    if (parts(super).count == 1) continue;
+    if (uint64_t s = saved(profile, super)) ranked.emplace_back(s, super);
+  }
+  std::sort(ranked.begin(), ranked.end(),
+            [](const auto& x, const auto& y) { return x.first > y.first; });
+  for (size_t k = 0; k < ranked.size() && k < limit; ++k)
+    stats.chosen.push_back(ranked[k].second);
+
+  for (size_t pc = 0; pc < prog.code.size();) {
+    Op op = static_cast<Op>(prog.code[pc]);
+    for (Op super : stats.chosen) {
+      if (!matches(prog, pc, super)) continue;
+      prog.code[pc] = static_cast<uint32_t>(super);
+      ++(parts(super).count == 2 ? stats.pairs : stats.triples);
+      op = super;
+      break;
+    }
+    pc += opWords(op);
+  }
+  return stats;
+}
+
+}  // namespace vm
@@ -0,0 +1,58 @@
+/**
+ * @file Rewrite.hpp
+ * @brief In-place bytecode rewrites: quickening and superinstructions.
+ *
+ * Both rewrites keep every instruction at its word index, so jump targets
+ * stay valid and they can be applied to a Program in any order, once.
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Bytecode.hpp"
+#include "Vm.hpp"
+
+namespace vm {
+
+/**
+ * @brief Replace int constant operands by immediates.
+ *
+ * AddI, SubI and MulI with a constant second operand (or, for AddI and
+ * MulI, first operand) become AddIK, SubIK and MulIK; int compare-and-jump
+ * against a constant becomes the JxxIK form, mirrored if the constant is
+ * on the left. Constants that do not fit in int32 stay in registers.
+ *
+ * @return Number of instructions rewritten.
+ */
+int quicken(Program& prog);
+
+/// A sequence of opcodes and how often it ran, see hottest().
+struct Sequence {
+  std::vector<Op> ops;
+  uint64_t count = 0;
+};
+
+/// The @p n most frequent sequences of @p length 1, 2 or 3 in @p profile.
+std::vector<Sequence> hottest(const Profile& profile, int length, size_t n);
+
+/// What fuse() did.
+struct FuseStats {
+  std::vector<Op> chosen; ///< Superinstructions enabled, hottest first
+  int pairs = 0;          ///< Pair superinstructions written
+  int triples = 0;        ///< Triple superinstructions written
+};
+
+/**
+ * @brief Fuse instruction sequences into superinstructions.
+ *
+ * Of the superinstructions in SC_VM_PAIRS and SC_VM_TRIPLES, the
+ * @p limit ones whose sequence saved most dispatches in @p profile are
+ * enabled; those that never ran are not. The code is then scanned once,
+ * and every enabled sequence found, preferring the hottest, has its first
+ * opcode word replaced. @p profile should come from a run of the same
+ * program, quickened as it is now but not yet fused.
+ */
+FuseStats fuse(Program& prog, const Profile& profile, size_t limit = kOpCount);
+
+}  // namespace vm
@@ -0,0 +1,347 @@
+/**
+ * @file Vm.cpp
+ * @brief Interpreter for register-based bytecode.
+ */
+#include "Vm.hpp"
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#if defined(__GNUC__) && !defined(SC_VM_NO_COMPUTED_GOTO)
+#define SC_VM_THREADED 1
+#else
+#define SC_VM_THREADED 0
+#endif
+
+namespace vm {
+
+bool haveThreadedDispatch() { return SC_VM_THREADED; }
+
+namespace {
+
+#if defined(__GNUC__)
+#define SC_VM_INLINE __attribute__((always_inline)) inline
+#else
+#define SC_VM_INLINE inline
+#endif
+
+/// How a step() ended.
+enum class Status { Ok, DivideByZero, OutOfBounds };
+
+int32_t i32(uint32_t x) { return static_cast<int32_t>(x); }
+uint32_t u32(int64_t x) { return static_cast<uint32_t>(x); }
+
+/// Element of @p bytes at the byte offset in register o[2] of the array at
+/// o[3] of o[4] bytes, or null with @p bad set to the offset.
+SC_VM_INLINE uint8_t* element(const uint32_t* o, const Slot* r,
+                              uint8_t* frame, int bytes, int64_t& bad) {
+  int64_t off = r[o[2]].i;
+  if (off < 0 || off + bytes > o[4]) {
+    bad = off;
+    return nullptr;
+  }
+  return frame + o[3] + off;
+}
+
+/**
+ * Execute the instruction @p op at @p o, which does not jump. All
+ * instructions and the parts of every superinstruction share these
+ * bodies. int arithmetic is done in uint32_t: the low 32 bits wrap
+ * without overflow.
+ */
+template <Op op>
+SC_VM_INLINE Status step(const uint32_t* o, Slot* r, uint8_t* frame,
+                         int64_t& bad) {
+  if constexpr (op == Op::Mov) {
+    r[o[1]] = r[o[2]];
+  } else if constexpr (op == Op::AddI) {
+    r[o[1]].i = i32(u32(r[o[2]].i) + u32(r[o[3]].i));
+  } else if constexpr (op == Op::SubI) {
+    r[o[1]].i = i32(u32(r[o[2]].i) - u32(r[o[3]].i));
+  } else if constexpr (op == Op::MulI) {
+    r[o[1]].i = i32(u32(r[o[2]].i) * u32(r[o[3]].i));
+  } else if constexpr (op == Op::DivI) {
+    int64_t b = r[o[3]].i;
+    if (b == 0) return Status::DivideByZero;
+    r[o[1]].i = i32(u32(r[o[2]].i / b));
+  } else if constexpr (op == Op::NegI) {
+    r[o[1]].i = i32(0u - u32(r[o[2]].i));
+  } else if constexpr (op == Op::AddIK) {
+    r[o[1]].i = i32(u32(r[o[2]].i) + o[3]);
+  } else if constexpr (op == Op::SubIK) {
+    r[o[1]].i = i32(u32(r[o[2]].i) - o[3]);
+  } else if constexpr (op == Op::MulIK) {
+    r[o[1]].i = i32(u32(r[o[2]].i) * o[3]);
+  } else if constexpr (op == Op::AddF) {
+    r[o[1]].f = r[o[2]].f + r[o[3]].f;
+  } else if constexpr (op == Op::SubF) {
+    r[o[1]].f = r[o[2]].f - r[o[3]].f;
+  } else if constexpr (op == Op::MulF) {
+    r[o[1]].f = r[o[2]].f * r[o[3]].f;
+  } else if constexpr (op == Op::DivF) {
+    r[o[1]].f = r[o[2]].f / r[o[3]].f;
+  } else if constexpr (op == Op::NegF) {
+    r[o[1]].f = -r[o[2]].f;
+  } else if constexpr (op == Op::WrapC) {
+    r[o[1]].i = static_cast<int8_t>(r[o[1]].i);
+  } else if constexpr (op == Op::Not) {
+    r[o[1]].i = r[o[2]].i == 0;
+  } else if constexpr (op == Op::And) {
+    r[o[1]].i = r[o[2]].i != 0 && r[o[3]].i != 0;
+  } else if constexpr (op == Op::Or) {
+    r[o[1]].i = r[o[2]].i != 0 || r[o[3]].i != 0;
+  } else if constexpr (op == Op::LtI) {
+    r[o[1]].i = r[o[2]].i < r[o[3]].i;
+  } else if constexpr (op == Op::LeI) {
+    r[o[1]].i = r[o[2]].i <= r[o[3]].i;
+  } else if constexpr (op == Op::GtI) {
+    r[o[1]].i = r[o[2]].i > r[o[3]].i;
+  } else if constexpr (op == Op::GeI) {
+    r[o[1]].i = r[o[2]].i >= r[o[3]].i;
+  } else if constexpr (op == Op::EqI) {
+    r[o[1]].i = r[o[2]].i == r[o[3]].i;
+  } else if constexpr (op == Op::NeI) {
+    r[o[1]].i = r[o[2]].i != r[o[3]].i;
+  } else if constexpr (op == Op::LtF) {
+    r[o[1]].i = r[o[2]].f < r[o[3]].f;
+  } else if constexpr (op == Op::LeF) {
+    r[o[1]].i = r[o[2]].f <= r[o[3]].f;
+  } else if constexpr (op == Op::GtF) {
+    r[o[1]].i = r[o[2]].f > r[o[3]].f;
+  } else if constexpr (op == Op::GeF) {
+    r[o[1]].i = r[o[2]].f >= r[o[3]].f;
+  } else if constexpr (op == Op::EqF) {
+    r[o[1]].i = r[o[2]].f == r[o[3]].f;
+  } else if constexpr (op == Op::NeF) {
+    r[o[1]].i = r[o[2]].f != r[o[3]].f;
+  } else if constexpr (op == Op::I2F) {
+    r[o[1]].f = static_cast<double>(r[o[2]].i);
+  } else if constexpr (op == Op::F2I) {
+    r[o[1]].i = i32(u32(static_cast<int64_t>(r[o[2]].f)));
+  } else if constexpr (op == Op::ToC) {
+    r[o[1]].i = static_cast<int8_t>(r[o[2]].i);
+  } else if constexpr (op == Op::ToB) {
+    r[o[1]].i = r[o[2]].i != 0;
+  } else if constexpr (op >= Op::LdI && op <= Op::StB) {
+    constexpr int bytes = op == Op::LdI || op == Op::StI   ? 4
+                          : op == Op::LdF || op == Op::StF ? 8
+                                                           : 1;
+    uint8_t* p = element(o, r, frame, bytes, bad);
+    if (!p) return Status::OutOfBounds;
+    if constexpr (op == Op::LdI) {
+      int32_t x;
+      std::memcpy(&x, p, sizeof x);
+      r[o[1]].i = x;
+    } else if constexpr (op == Op::LdF) {
+      std::memcpy(&r[o[1]].f, p, sizeof(double));
+    } else if constexpr (op == Op::LdC) {
+      r[o[1]].i = static_cast<int8_t>(*p);
+    } else if constexpr (op == Op::LdB) {
+      r[o[1]].i = *p;
+    } else if constexpr (op == Op::StI) {
+      int32_t x = i32(u32(r[o[1]].i));
+      std::memcpy(p, &x, sizeof x);
+    } else if constexpr (op == Op::StF) {
+      std::memcpy(p, &r[o[1]].f, sizeof(double));
+    } else {
+      *p = static_cast<uint8_t>(r[o[1]].i);
+    }
+  } else if constexpr (op == Op::Check) {
+    if (r[o[1]].i < 0 || r[o[1]].i >= r[o[2]].i) {
+      bad = r[o[1]].i;
+      return Status::OutOfBounds;
+    }
+  } else {
+    static_assert(op == Op::Check, "step() of a jump or Halt");
+  }
+  return Status::Ok;
+}
+
+/// Whether the jump @p op at @p o is taken.
+template <Op op>
+SC_VM_INLINE bool taken(const uint32_t* o, const Slot* r) {
+  if constexpr (op == Op::Jmp) return true;
+  else if constexpr (op == Op::Jt) return r[o[1]].i != 0;
+  else if constexpr (op == Op::Jf) return r[o[1]].i == 0;
+  else if constexpr (op == Op::JLtI) return r[o[1]].i < r[o[2]].i;
+  else if constexpr (op == Op::JLeI) return r[o[1]].i <= r[o[2]].i;
+  else if constexpr (op == Op::JGtI) return r[o[1]].i > r[o[2]].i;
+  else if constexpr (op == Op::JGeI) return r[o[1]].i >= r[o[2]].i;
+  else if constexpr (op == Op::JEqI) return r[o[1]].i == r[o[2]].i;
+  else if constexpr (op == Op::JNeI) return r[o[1]].i != r[o[2]].i;
+  else if constexpr (op == Op::JLtIK) return r[o[1]].i < i32(o[2]);
+  else if constexpr (op == Op::JLeIK) return r[o[1]].i <= i32(o[2]);
+  else if constexpr (op == Op::JGtIK) return r[o[1]].i > i32(o[2]);
+  else if constexpr (op == Op::JGeIK) return r[o[1]].i >= i32(o[2]);
+  else if constexpr (op == Op::JEqIK) return r[o[1]].i == i32(o[2]);
+  else if constexpr (op == Op::JNeIK) return r[o[1]].i != i32(o[2]);
+  else if constexpr (op == Op::JLtF) return r[o[1]].f < r[o[2]].f;
+  else if constexpr (op == Op::JLeF) return r[o[1]].f <= r[o[2]].f;
+  else if constexpr (op == Op::JGtF) return r[o[1]].f > r[o[2]].f;
+  else if constexpr (op == Op::JGeF) return r[o[1]].f >= r[o[2]].f;
+  else if constexpr (op == Op::JEqF) return r[o[1]].f == r[o[2]].f;
+  else return r[o[1]].f != r[o[2]].f;
+}
+
+}  // namespace
+
+template <bool Threaded, bool Profiling>
+void Vm::execute(uint8_t* frame) {
+  const uint32_t* const code = prog.code.data();
+  const uint32_t* pc = code;
+  Slot* const r = regs.data();
+  uint64_t n = 0;
+  Status status = Status::Ok;
+  // previous two instructions, Halt once the sequence is broken by a jump
+  Op prev = Op::Halt, prev2 = Op::Halt;
+
+#if SC_VM_THREADED
+  static const void* const table[] = {
+#define SC_VM_LABEL(name, ...) &&op_##name,
+      SC_VM_OPCODES(SC_VM_LABEL) SC_VM_PAIRS(SC_VM_LABEL)
+          SC_VM_TRIPLES(SC_VM_LABEL)
+#undef SC_VM_LABEL
+  };
+#define DISPATCH()                         \
+  do {                                     \
+    if constexpr (Threaded && !Profiling)  \
+      goto* table[*pc];                    \
+    else                                   \
+      goto dispatch;                       \
+  } while (0)
+#define CASE(name) \
+  case Op::name:   \
+  op_##name:
+#else
+#define DISPATCH() goto dispatch
+#define CASE(name) case Op::name:
+#endif
+
+// Run part k of the instruction at pc, advancing o past it; a jump can
+// only be the last part and sets o to its target when taken.
+#define PART(ps, k)                                                      \
+  if constexpr ((k) < ps.count) {                                        \
+    constexpr Op part = ps.ops[k];                                       \
+    if constexpr (part == Op::Halt) {                                    \
+      goto done;                                                         \
+    } else if constexpr (isJump(part)) {                                 \
+      o = taken<part>(o, r) ? code + o[opWords(part) - 1]                \
+                            : o + opWords(part);                         \
+    } else {                                                             \
+      status = step<part>(o, r, frame, badIndex);                        \
+      if (status != Status::Ok) goto done;                               \
+      o += opWords(part);                                                \
+    }                                                                    \
+  }
+#define HANDLER(name, ...)                  \
+  CASE(name) {                              \
+    constexpr Parts ps = parts(Op::name);   \
+    const uint32_t* o = pc;                 \
+    ++n;                                    \
+    PART(ps, 0) PART(ps, 1) PART(ps, 2)     \
+    pc = o;                                 \
+    DISPATCH();                             \
+  }
+
+  // enter through the switch in every build, the handlers DISPATCH() on
+  goto dispatch;
+dispatch:
+  if constexpr (Profiling) {
+    Op op = static_cast<Op>(*pc);
+    ++profile->ops[static_cast<size_t>(op)];
+    if (prev != Op::Halt) {
+      ++profile->pairs[Profile::key(prev, op)];
+      if (prev2 != Op::Halt) ++profile->triples[Profile::key(prev2, prev, op)];
+    }
+    prev2 = prev;
+    prev = isJump(op) ? Op::Halt : op;
+    if (prev == Op::Halt) prev2 = Op::Halt;
+  }
+  switch (static_cast<Op>(*pc)) {
+    SC_VM_OPCODES(HANDLER) SC_VM_PAIRS(HANDLER) SC_VM_TRIPLES(HANDLER)
+  }
+  throw std::runtime_error("Invalid opcode " + std::to_string(*pc));
+
+done:
+  dispatched = n;
+  switch (status) {
+    case Status::Ok: exit = Exit::Halt; break;
+    case Status::DivideByZero: exit = Exit::DivideByZero; break;
+    case Status::OutOfBounds: exit = Exit::OutOfBounds; break;
+  }
+#undef HANDLER
+#undef PART
+#undef CASE
+#undef DISPATCH
+}
+
+void Vm::enter(const uint8_t* frame) {
+  regs = prog.registers;
+  for (const VarReg& v : prog.vars) {
+    const uint8_t* p = frame + v.offset;
+    Slot& s = regs[v.reg];
+    switch (v.kind) {
+      case Scalar::Int: {
+        int32_t x;
+        std::memcpy(&x, p, sizeof x);
+        s.i = x;
+        break;
+      }
+      case Scalar::Float: std::memcpy(&s.f, p, sizeof s.f); break;
+      case Scalar::Char: s.i = static_cast<int8_t>(*p); break;
+      case Scalar::Bool: s.i = *p; break;
+    }
+  }
+}
+
+void Vm::leave(uint8_t* frame) {
+  for (const VarReg& v : prog.vars) {
+    uint8_t* p = frame + v.offset;
+    const Slot& s = regs[v.reg];
+    switch (v.kind) {
+      case Scalar::Int: {
+        int32_t x = static_cast<int32_t>(s.i);
+        std::memcpy(p, &x, sizeof x);
+        break;
+      }
+      case Scalar::Float: std::memcpy(p, &s.f, sizeof s.f); break;
+      default: *p = static_cast<uint8_t>(s.i); break;
+    }
+  }
+
+  switch (exit) {
+    case Exit::Halt:
+      return;
+    case Exit::DivideByZero:
+      throw std::runtime_error("Division by zero");
+    case Exit::OutOfBounds:
+      throw std::runtime_error("Array index out of bounds: " +
+                               std::to_string(badIndex));
+  }
+}
+
+void Vm::run(uint8_t* frame, Dispatch dispatch) {
+  enter(frame);
+  if (SC_VM_THREADED && dispatch == Dispatch::Threaded)
+    execute<true, false>(frame);
+  else
+    execute<false, false>(frame);
+  leave(frame);
+}
+
+void Vm::run(uint8_t* frame, Profile& prof) {
+  enter(frame);
+  profile = &prof;
+  execute<false, true>(frame);
+  profile = nullptr;
+  leave(frame);
+}
+
+std::vector<uint8_t> Vm::run(Dispatch dispatch) {
+  std::vector<uint8_t> frame(prog.frameSize, 0);
+  run(frame.data(), dispatch);
+  return frame;
+}
+
+}  // namespace vm
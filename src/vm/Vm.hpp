@@ -0,0 +1,91 @@
+/**
+ * @file Vm.hpp
+ * @brief Interpreter for register-based bytecode.
+ */
+#pragma once
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "Bytecode.hpp"
+
+namespace vm {
+
+/// How the interpreter finds the code of the next instruction.
+enum class Dispatch {
+  Switch,  ///< One `switch` in a loop, portable C++
+  Threaded ///< Computed goto through a table of label addresses
+};
+
+/// Whether this build has Dispatch::Threaded; without GNU C label values
+/// (or with SC_VM_NO_COMPUTED_GOTO defined) it falls back to Switch.
+bool haveThreadedDispatch();
+
+/**
+ * @brief Dynamic opcode counts of profiled runs, see Vm::run(uint8_t*,
+ * Profile&).
+ *
+ * A pair or triple is a sequence of instructions executed one after the
+ * other in straight-line code: every one but the last falls through to the
+ * next, so the sequence lies in consecutive words and fuse() can turn it
+ * into a superinstruction. Counts accumulate over runs.
+ */
+struct Profile {
+  std::array<uint64_t, kOpCount> ops{};           ///< Executions per opcode
+  std::unordered_map<uint32_t, uint64_t> pairs;   ///< By key() of 2 ops
+  std::unordered_map<uint32_t, uint64_t> triples; ///< By key() of 3 ops
+
+  /// Key of the sequence a, b (, c) in @ref pairs or @ref triples.
+  static uint32_t key(Op a, Op b, Op c = Op::Halt) {
+    return (static_cast<uint32_t>(a) * kOpCount + static_cast<uint32_t>(b)) *
+               kOpCount +
+           static_cast<uint32_t>(c);
+  }
+};
+
+/**
+ * @brief Runs a compiled Program on a byte frame.
+ *
+ * The frame has the layout of symbols::Frame, as for ir::Interpreter, and
+ * is left with the same bytes. Scalar variables are loaded into their
+ * registers on entry and stored back on exit, also when the program traps;
+ * arrays are read and written in place. A failed check, an out-of-range
+ * element or an integer division by zero throws std::runtime_error like
+ * the reference interpreter does.
+ */
+class Vm {
+ public:
+  explicit Vm(const Program& p) : prog(p) {}
+
+  /// Execute on @p frame, which holds at least Program::frameSize bytes.
+  void run(uint8_t* frame, Dispatch dispatch = Dispatch::Threaded);
+
+  /// Convenience overload with a zero-initialized frame.
+  std::vector<uint8_t> run(Dispatch dispatch = Dispatch::Threaded);
+
+  /// Execute with switch dispatch, adding opcode counts to @p profile.
+  void run(uint8_t* frame, Profile& profile);
+
+  uint64_t dispatched = 0;  ///< Instructions executed by the last run()
+
+ private:
+  /// Why execute() stopped.
+  enum class Exit { Halt, DivideByZero, OutOfBounds };
+
+  const Program& prog;
+  std::vector<Slot> regs;
+  Exit exit = Exit::Halt;
+  int64_t badIndex = 0;  ///< Index or byte offset of Exit::OutOfBounds
+
+  Profile* profile = nullptr;
+
+  /// Registers from the Program, scalar variables from @p frame.
+  void enter(const uint8_t* frame);
+  /// Store scalar variables to @p frame; throw if execute() trapped.
+  void leave(uint8_t* frame);
+  template <bool Threaded, bool Profiling>
+  void execute(uint8_t* frame);
+};
+
+}  // namespace vm
@@ -0,0 +1,33 @@
+/**
+ * @file AllocCounter.cpp
+ * @brief Counting replacements of the global operator new and delete.
+ */
+#include "AllocCounter.hpp"
+
+#include <cstdlib>
+#include <new>
+
+namespace {
+thread_local uint64_t allocCount = 0;
+thread_local uint64_t allocBytes = 0;
+
+void* allocate(std::size_t size) {
+  ++allocCount;
+  allocBytes += size;
+  if (void* p = std::malloc(size ? size : 1)) return p;
+  throw std::bad_alloc();
+}
+}  // namespace
+
+void* operator new(std::size_t size) { return allocate(size); }
+void* operator new[](std::size_t size) { return allocate(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+namespace testutil {
+
+AllocCounts allocCounts() { return {allocCount, allocBytes}; }
+
+}  // namespace testutil
@@ -0,0 +1,28 @@
+/**
+ * @file AllocCounter.hpp
+ * @brief Counts of heap allocations, for the tests and benchmarks.
+ */
+#pragma once
+#include <cstdint>
+
+namespace testutil {
+
+/**
+ * @brief Allocations made through the global operator new.
+ *
+ * Linking AllocCounter.cpp replaces the global operator new and delete
+ * with versions that count calls and requested bytes per thread before
+ * forwarding to malloc and free. Differences of two snapshots taken on the
+ * same thread give the allocations made in between. Only the tests and
+ * benchmarks link the alloccounter library, so the compiler itself keeps
+ * the standard allocator.
+ */
+struct AllocCounts {
+  uint64_t count = 0;  ///< Calls to operator new
+  uint64_t bytes = 0;  ///< Bytes requested by them
+};
+
+/// Totals for the calling thread since it started.
+AllocCounts allocCounts();
+
+}  // namespace testutil
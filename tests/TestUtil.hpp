@@ -0,0 +1,66 @@
+/**
+ * @file TestUtil.hpp
+ * @brief Helpers shared by the unit tests and the benchmarks: reading the
+ * corpus, parsing a source and printing an AST.
+ *
+ * CORPUS_DIR is defined by the test and benchmark targets.
+ */
+#pragma once
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Emitter.h"
+#include "Frame.hpp"
+#include "Parser.hpp"
+#include "Stmt.h"
+
+namespace testutil {
+
+/// Programs in tests/corpus.
+inline const std::vector<std::string> corpus = {
+    "sum.sc",   "matmul.sc",  "search.sc", "bubble.sc",
+    "sieve.sc", "scratch.sc", "nested.sc", "conds.sc"};
+
+/// Parsed program together with its variable layout.
+struct Program {
+  sptr<ast::Stmt> root;
+  symbols::Frame frame;
+};
+
+/// Contents of the file at @p path, empty if it cannot be read.
+inline std::string readFile(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  std::stringstream ss;
+  ss << in.rdbuf();
+  return ss.str();
+}
+
+/// Source of the corpus program @p name.
+inline std::string readCorpus(const std::string& name) {
+  return readFile(std::string(CORPUS_DIR) + "/" + name);
+}
+
+/// @throws std::runtime_error on errors in @p src.
+inline Program parse(const std::string& src) {
+  std::istringstream in(src);
+  parser::Parser p(std::make_shared<lexer::Lexer>(in));
+  Program prog;
+  prog.root = p.program();
+  prog.frame = p.layout();
+  return prog;
+}
+
+inline Program parseCorpus(const std::string& name) {
+  return parse(readCorpus(name));
+}
+
+/// What emit::TextEmitter prints for @p s.
+inline std::string text(const sptr<ast::Stmt>& s) {
+  emit::TextEmitter em;
+  s->emit(em);
+  return em.code();
+}
+
+}  // namespace testutil
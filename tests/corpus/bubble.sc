@@ -0,0 +1,24 @@
+{
+  int[32] v;
+  int i; int j; int tmp; int n;
+  bool swapped;
+  n = 32;
+  i = 0;
+  while (i < n) {
+    v[i] = (i * 13) - (i * 13) / 32 * 32;
+    i = i + 1;
+  }
+  do {
+    swapped = false;
+    j = 0;
+    while (j < n - 1) {
+      if (v[j] > v[j + 1]) {
+        tmp = v[j];
+        v[j] = v[j + 1];
+        v[j + 1] = tmp;
+        swapped = true;
+      }
+      j = j + 1;
+    }
+  } while (swapped);
+}
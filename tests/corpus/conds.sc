@@ -0,0 +1,21 @@
+{
+  int count; int found; int[64] a; int i; int n; int key; bool inside;
+  i = 0;
+  while (i < 64) { a[i] = i * 37 - (i / 7) * 50; i = i + 1; }
+  n = 0;
+  while (n < 20) {
+    i = 0;
+    while (i < 64) {
+      if (a[i] > 10 && a[i] < 500 || a[i] == 0) count = count + 1;
+      if (!(a[i] >= 100) && i != n) count = count + 2;
+      inside = a[i] > 0 && a[i] < 100;
+      if (inside) count = count + 3;
+      i = i + 1;
+    }
+    key = a[n * 3];
+    i = 0;
+    while (i < 64 && a[i] != key) i = i + 1;
+    if (i < 64) found = found + 1;
+    n = n + 1;
+  }
+}
@@ -0,0 +1,34 @@
+{
+  float[8][8] x;
+  float[8][8] y;
+  float[8][8] z;
+  int i; int j; int k;
+  float acc;
+  float scale;
+  scale = 0.5;
+  i = 0;
+  while (i < 8) {
+    j = 0;
+    while (j < 8) {
+      x[i][j] = i + j * scale;
+      y[i][j] = i - j;
+      j = j + 1;
+    }
+    i = i + 1;
+  }
+  i = 0;
+  while (i < 8) {
+    j = 0;
+    while (j < 8) {
+      acc = 0.0;
+      k = 0;
+      while (k < 8) {
+        acc = acc + x[i][k] * y[k][j];
+        k = k + 1;
+      }
+      z[i][j] = acc;
+      j = j + 1;
+    }
+    i = i + 1;
+  }
+}
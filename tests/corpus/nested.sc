@@ -0,0 +1,33 @@
+{
+  int[16][16] grid;
+  int[16] row;
+  int i; int j; int n;
+  int base; int scale; int total;
+  n = 16;
+  base = 3;
+  scale = 7;
+  i = 0;
+  do {
+    row[i] = i * i;
+    i = i + 1;
+  } while (i < n);
+  i = 0;
+  while (i < n) {
+    j = 0;
+    do {
+      grid[i][j] = row[i] * scale + base * scale + j;
+      j = j + 1;
+    } while (j < n);
+    i = i + 1;
+  }
+  total = 0;
+  i = 0;
+  while (i < n) {
+    j = 0;
+    while (j < n - 1) {
+      total = total + grid[i][j] * (base + scale) / (n / 2);
+      j = j + 1;
+    }
+    i = i + 1;
+  }
+}
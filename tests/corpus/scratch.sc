@@ -0,0 +1,26 @@
+{
+  int x; int y; int z;
+  float f;
+  int[16] buf;
+  x = 1;
+  y = 2;
+  x = y + 3;
+  {
+    int t; int u; float g;
+    t = x * 2;
+    u = t + 1;
+    t = u * u;
+    g = 1.5;
+    y = t - u;
+  }
+  z = 0;
+  while (z < 10) {
+    int w;
+    w = z * z;
+    buf[z] = z;
+    z = z + 1;
+    if (z > 100) { break; z = 0; }
+  }
+  f = 2.0;
+  f = f * 3.0;
+}
@@ -0,0 +1,25 @@
+{
+  int[100] data;
+  int i;
+  int key;
+  int found;
+  bool hit;
+  i = 0;
+  while (i < 100) {
+    data[i] = (i * 37 + 11) - (i * 37 + 11) / 100 * 100;
+    i = i + 1;
+  }
+  key = 42;
+  found = -1;
+  hit = false;
+  i = 0;
+  while (i < 100) {
+    if (data[i] == key) {
+      found = i;
+      hit = true;
+      break;
+      i = i + 1000;
+    }
+    i = i + 1;
+  }
+}
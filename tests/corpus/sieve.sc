@@ -0,0 +1,20 @@
+{
+  bool[200] composite;
+  int i; int j;
+  int count;
+  i = 0;
+  while (i < 200) { composite[i] = false; i = i + 1; }
+  count = 0;
+  i = 2;
+  while (i < 200) {
+    if (!composite[i]) {
+      count = count + 1;
+      j = i * i;
+      while (j < 200) {
+        composite[j] = true;
+        j = j + i;
+      }
+    }
+    i = i + 1;
+  }
+}
@@ -0,0 +1,20 @@
+{
+  int[64] a;
+  int i;
+  int n;
+  int sum;
+  int unused;
+  i = 0;
+  n = 64;
+  while (i < n) {
+    a[i] = i * 3 - 7;
+    i = i + 1;
+  }
+  sum = 0;
+  sum = 1;
+  i = 0;
+  while (i < n) {
+    sum = sum + a[i];
+    i = i + 1;
+  }
+}
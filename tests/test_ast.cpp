@@ -1,8 +1,10 @@
 #include <gtest/gtest.h>
 
 #include "Array.hpp"
+#include "EmitStatic.hpp"
 #include "Expr.hpp"
 #include "IEmitter.hpp"
+#include "IOperandEmitter.hpp"
 #include "Stmt.h"
 #include "Token.hpp"
 #include "Type.hpp"
@@ -19,10 +21,90 @@ struct DummyExpr : public Expr {
     exprType = t;
   }
   std::string emit(emit::IEmitter&) const override { return name; }
+  emit::Operand emit(emit::IOperandEmitter& out) const override {
+    return out.emitIdentifier(name);
+  }
+};
+
+// Mock IOperandEmitter: operands index the texts of the expressions
+struct MockEmitter : public emit::IOperandEmitter {
+  using Operand = emit::Operand;
+  using Kind = Operand::Kind;
+
+  std::vector<std::string> texts;
+
+  const std::string& str(Operand op) const { return texts.at(op.id); }
+
+  Operand make(Kind kind, std::string text) {
+    texts.push_back(std::move(text));
+    return {kind, static_cast<uint32_t>(texts.size() - 1)};
+  }
+
+  /* Expressions */
+  Operand emitBinaryOp(Operand l, const lexer::Token& op,
+                       Operand r) override {
+    return make(Kind::Temp,
+                "(" + str(l) + " " + op.lexeme + " " + str(r) + ")");
+  }
+  Operand emitUnaryOp(const lexer::Token& op, Operand e) override {
+    return make(Kind::Temp, "(" + op.lexeme + str(e) + ")");
+  }
+  Operand emitLoadConst(const lexer::Token& v) override {
+    return make(Kind::Const, v.lexeme);
+  }
+  Operand emitTemp(int n) override {
+    return make(Kind::Temp, "t" + std::to_string(n));
+  }
+  Operand emitArrayAccess(Operand a, Operand i) override {
+    return make(Kind::Slot, str(a) + "[" + str(i) + "]");
+  }
+  Operand emitIdentifier(std::string_view name,
+                         int /*offset*/) override {
+    return make(Kind::Slot, std::string(name));
+  }
+
+  // --- Statements ---
+  std::vector<std::string> log;
+
+  void emitIf(Operand cond, emit::FunctionRef<void()> thenBlock) override {
+    log.push_back("If(" + str(cond) + ")");
+    thenBlock();
+  }
+
+  void emitIfElse(Operand cond, emit::FunctionRef<void()> thenBlock,
+                  emit::FunctionRef<void()> elseBlock) override {
+    log.push_back("IfElse(" + str(cond) + ")");
+    thenBlock();
+    elseBlock();
+  }
+
+  void emitWhile(emit::FunctionRef<Operand()> condGen,
+                 emit::FunctionRef<void()> bodyGen) override {
+    log.push_back("While(" + str(condGen()) + ")");
+    bodyGen();
+  }
+
+  void emitDoWhile(emit::FunctionRef<void()> bodyGen,
+                   emit::FunctionRef<Operand()> condGen) override {
+    log.push_back("DoWhile(" + str(condGen()) + ")");
+    bodyGen();
+  }
+
+  void emitBreak() override { log.push_back("Break"); }
+
+  void emitAssign(Operand target, Operand value) override {
+    log.push_back("Assign(" + str(target) + "," + str(value) + ")");
+  }
+
+  void emitArrayAssign(Operand arr, Operand idx, Operand value) override {
+    log.push_back("ArrayAssign(" + str(arr) + "," + str(idx) + "," +
+                  str(value) + ")");
+  }
+  /*-------------------------------------------------------------------------*/
 };
 
-// Mock IEmitter
-struct MockEmitter : public emit::IEmitter {
+// Mock IEmitter, the string-based interface
+struct StringMockEmitter : public emit::IEmitter {
   /* Expressions */
   std::string emitBinaryOp(const std::string& l, const sptr<lexer::Token>& op,
                            const std::string& r) override {
@@ -40,7 +122,8 @@ struct MockEmitter : public emit::IEmitter {
                               const std::string& i) override {
     return a + "[" + i + "]";
   }
-  std::string emitIdentifier(const std::string& name, int offset) {
+  std::string emitIdentifier(const std::string& name,
+                             int /*offset*/) override {
     return name;
   }
 
@@ -94,7 +177,8 @@ TEST(ConstantTests, IntLiteralHasIntType) {
   EXPECT_EQ(c.exprType, Type::Int);
 
   MockEmitter em;
-  EXPECT_EQ(c.emit(em), "42");
+  EXPECT_EQ(em.str(c.emit(em)), "42");
+  EXPECT_EQ(c.emit(em).kind, emit::Operand::Kind::Const);
 }
 
 TEST(ConstantTests, BoolLiteralHasBoolType) {
@@ -103,7 +187,7 @@ TEST(ConstantTests, BoolLiteralHasBoolType) {
   EXPECT_EQ(c.exprType, Type::Bool);
 
   MockEmitter em;
-  EXPECT_EQ(c.emit(em), "true");
+  EXPECT_EQ(em.str(c.emit(em)), "true");
 }
 
 TEST(ArithTests, IntPlusFloatGivesFloatAndEmit) {
@@ -115,7 +199,7 @@ TEST(ArithTests, IntPlusFloatGivesFloatAndEmit) {
   EXPECT_EQ(add.exprType, Type::Float);
 
   MockEmitter em;
-  EXPECT_EQ(add.emit(em), "(x + y)");
+  EXPECT_EQ(em.str(add.emit(em)), "(x + y)");
 }
 
 TEST(LogicalTests, BoolAndBoolGivesBool) {
@@ -127,7 +211,24 @@ TEST(LogicalTests, BoolAndBoolGivesBool) {
   EXPECT_EQ(andNode.exprType, Type::Bool);
 
   MockEmitter em;
-  EXPECT_EQ(andNode.emit(em), "(b1 && b2)");
+  EXPECT_EQ(em.str(andNode.emit(em)), "(b1 && b2)");
+}
+
+TEST(LogicalTests, RightOperandIsGeneratedByTheEmitter) {
+  struct LazyEmitter : MockEmitter {
+    Operand emitLogicalOp(Operand l, const lexer::Token& op,
+                          emit::FunctionRef<Operand()> rhsGen) override {
+      Operand r = rhsGen();
+      return make(Kind::Temp, "(" + str(l) + " " + op.lexeme + " [" + str(r) +
+                                  "])");
+    }
+  };
+  auto b1 = std::make_shared<DummyExpr>("b1", Type::Bool);
+  auto b2 = std::make_shared<DummyExpr>("b2", Type::Bool);
+  Or orNode({1, 1}, std::make_shared<Token>(Tag::OR, "||"), b1, b2);
+
+  LazyEmitter em;
+  EXPECT_EQ(em.str(orNode.emit(em)), "(b1 || [b2])");
 }
 
 TEST(UnaryTests, NotExpressionIsBool) {
@@ -138,7 +239,7 @@ TEST(UnaryTests, NotExpressionIsBool) {
   EXPECT_EQ(notNode.exprType, Type::Bool);
 
   MockEmitter em;
-  EXPECT_EQ(notNode.emit(em), "(!flag)");
+  EXPECT_EQ(em.str(notNode.emit(em)), "(!flag)");
 }
 
 TEST(TempTests, TempEmit) {
@@ -146,7 +247,7 @@ TEST(TempTests, TempEmit) {
   EXPECT_EQ(t.exprType, Type::Int);
 
   MockEmitter em;
-  EXPECT_EQ(t.emit(em), "t7");
+  EXPECT_EQ(em.str(t.emit(em)), "t7");
 }
 
 TEST(AccessTests, ArrayElementTypeAndEmit) {
@@ -158,7 +259,8 @@ TEST(AccessTests, ArrayElementTypeAndEmit) {
   EXPECT_EQ(acc.exprType, Type::Int);
 
   MockEmitter em;
-  EXPECT_EQ(acc.emit(em), "arr[i]");
+  EXPECT_EQ(em.str(acc.emit(em)), "arr[i]");
+  EXPECT_EQ(acc.emit(em).kind, emit::Operand::Kind::Slot);
 }
 
 /* Statements Tests */
@@ -237,11 +339,90 @@ TEST(StmtTests, SetCallsEmitAssign) {
 
 TEST(StmtTests, SetElemCallsEmitArrayAssign) {
   MockEmitter em;
-  auto arrAccess = std::make_shared<DummyExpr>("arr[0]", Type::Int);
+  auto arr = std::make_shared<DummyExpr>(
+      "arr", std::make_shared<symbols::Array>(4, Type::Int));
+  auto idx = std::make_shared<DummyExpr>("0", Type::Int);
+  auto arrAccess = std::make_shared<Access>(SourceLocation{1, 1}, arr, idx);
   auto value = std::make_shared<DummyExpr>("99", Type::Int);
   ast::SetElem node({1, 1}, arrAccess, value);
 
   node.emit(em);
 
-  EXPECT_EQ(em.log, std::vector<std::string>{"ArrayAssign(arr[0],,99)"});
-}
\ No newline at end of file
+  EXPECT_EQ(em.log, std::vector<std::string>{"ArrayAssign(arr,0,99)"});
+}
+
+TEST(StmtTests, SetElemSplitsTheLastIndexOfNestedAccess) {
+  MockEmitter em;
+  auto inner = std::make_shared<symbols::Array>(3, Type::Int);
+  auto arr = std::make_shared<DummyExpr>(
+      "m", std::make_shared<symbols::Array>(2, inner));
+  auto row = std::make_shared<Access>(
+      SourceLocation{1, 1}, arr, std::make_shared<DummyExpr>("i", Type::Int));
+  auto elem = std::make_shared<Access>(
+      SourceLocation{1, 1}, row, std::make_shared<DummyExpr>("j", Type::Int));
+  ast::SetElem node({1, 1}, elem, std::make_shared<DummyExpr>("7", Type::Int));
+
+  node.emit(em);
+
+  EXPECT_EQ(em.log, std::vector<std::string>{"ArrayAssign(m[i],j,7)"});
+  MockEmitter statically;
+  ast::emitStatic(node, statically);
+  EXPECT_EQ(statically.log, em.log);
+  EXPECT_THROW(
+      ast::emitStatic(ast::SetElem({1, 1},
+                                   std::make_shared<DummyExpr>("x", Type::Int),
+                                   elem),
+                      statically),
+      std::runtime_error);
+  EXPECT_THROW(
+      ast::SetElem({1, 1}, std::make_shared<DummyExpr>("x", Type::Int), elem)
+          .emit(em),
+      std::runtime_error);
+}
+
+TEST(StmtTests, StringAndOperandInterfacesGetTheSameCalls) {
+  auto i = std::make_shared<DummyExpr>("i", Type::Int);
+  auto b = std::make_shared<DummyExpr>("b", Type::Bool);
+  auto a = std::make_shared<DummyExpr>(
+      "a", std::make_shared<symbols::Array>(4, Type::Int));
+  auto one = std::make_shared<Constant>(SourceLocation{1, 1},
+                                        std::make_shared<Word>("1", Tag::NUM));
+  auto plus = std::make_shared<Token>(Tag::OP_PLUS, "+");
+  auto less = std::make_shared<Token>(Tag::LESS, "<");
+  auto sum = std::make_shared<Arith>(SourceLocation{1, 1}, plus, i, one);
+  auto cond = std::make_shared<And>(
+      SourceLocation{1, 1}, std::make_shared<Token>(Tag::AND, "&&"),
+      std::make_shared<Less>(SourceLocation{1, 1}, less, i, one), b);
+  auto elem = std::make_shared<Access>(SourceLocation{1, 1}, a, sum);
+  auto body = std::make_shared<Seq>(
+      SourceLocation{1, 1},
+      std::make_shared<SetElem>(SourceLocation{1, 1}, elem, sum),
+      std::make_shared<Else>(
+          SourceLocation{1, 1}, b,
+          std::make_shared<Break>(SourceLocation{1, 1}),
+          std::make_shared<Set>(SourceLocation{1, 1}, i, elem)));
+  Seq program(SourceLocation{1, 1},
+              std::make_shared<While>(SourceLocation{1, 1}, cond, body),
+              std::make_shared<Do>(
+                  SourceLocation{1, 1},
+                  std::make_shared<Set>(SourceLocation{1, 1},
+                                        std::make_shared<Temp>(
+                                            SourceLocation{1, 1}, 3, Type::Int),
+                                        sum),
+                  b));
+
+  StringMockEmitter strings;
+  MockEmitter operands;
+  MockEmitter statically;
+  program.emit(strings);
+  program.emit(operands);
+  ast::emitStatic(program, statically);  // DummyExpr through its emit()
+  EXPECT_EQ(operands.log, strings.log);
+  EXPECT_EQ(statically.log, strings.log);
+  EXPECT_EQ(operands.log,
+            (std::vector<std::string>{"While(((i < 1) && b))",
+                                      "ArrayAssign(a,(i + 1),(i + 1))",
+                                      "IfElse(b)", "Break",
+                                      "Assign(i,a[(i + 1)])",
+                                      "DoWhile(b)", "Assign(t3,(i + 1))"}));
+}
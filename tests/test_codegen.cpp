@@ -0,0 +1,810 @@
+#include <gtest/gtest.h>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include "AsmEmitter.hpp"
+#include "Assembler.hpp"
+#include "CEmitter.hpp"
+#include "Cfg.hpp"
+#include "Elf.hpp"
+#include "Interp.hpp"
+#include "Jit.hpp"
+#include "Liveness.hpp"
+#include "LlvmEmitter.hpp"
+#include "Lower.hpp"
+#include "Parser.hpp"
+#include "PassManager.hpp"
+#include "PerfMap.hpp"
+#include "RegAlloc.hpp"
+#include "TestUtil.hpp"
+#include "Toolchain.hpp"
+
+using namespace codegen;
+
+using testutil::corpus;
+using testutil::parse;
+using testutil::Program;
+using testutil::readCorpus;
+
+namespace {
+ir::Function compile(const std::string& src,
+                     const ir::LowerOptions& options = {}) {
+  auto prog = parse(src);
+  return ir::lower(prog.root, prog.frame, options);
+}
+
+struct NativeRun {
+  int status = 0;
+  std::vector<uint8_t> frame;
+};
+
+/// Assemble @p fn into a shared object and run it on a zeroed frame.
+NativeRun runNative(const ir::Function& fn, AsmOptions options = {},
+                    AsmStats* stats = nullptr) {
+  AsmEmitter em(options);
+  std::string text = em.emit(fn);
+  if (stats) *stats = em.stats;
+  TempDir dir;
+  SharedLibrary lib(assembleShared(dir, text));
+  NativeRun r;
+  r.frame.assign(fn.frame.size + 1, 0);
+  r.status = lib.entry(options.symbol)(r.frame.data());
+  r.frame.resize(fn.frame.size);
+  return r;
+}
+
+/// Native code leaves the same bytes in the frame as the interpreter.
+void expectSameAsInterpreter(const ir::Function& fn, AsmOptions options = {},
+                             const std::string& what = "") {
+  ir::Interpreter interp(fn);
+  std::vector<uint8_t> expected = interp.run(10000000);
+  NativeRun r = runNative(fn, options);
+  EXPECT_EQ(r.status, 0) << what;
+  EXPECT_EQ(r.frame, expected) << what;
+}
+
+#define REQUIRE_TOOLCHAIN() \
+  if (!haveTool("cc")) GTEST_SKIP() << "no C compiler driver on PATH"
+
+#define REQUIRE_LLVM(tool) \
+  if (!haveTool(tool)) GTEST_SKIP() << "no " tool " on PATH"
+
+/// Run @p fn compiled in-process on a zeroed frame.
+NativeRun runJit(const ir::Function& fn, AsmOptions options = {}) {
+  JitModule mod(fn, options);
+  NativeRun r;
+  r.frame.assign(fn.frame.size + 1, 0);
+  r.status = mod.entry(options.symbol)(r.frame.data());
+  r.frame.resize(fn.frame.size);
+  return r;
+}
+
+/// Bytes of `.text` as GNU as assembles @p text.
+std::string gnuText(const std::string& text) {
+  TempDir dir;
+  std::string s = dir.write("a.s", text);
+  runCommand("as -o '" + dir.file("a.o") + "' '" + s + "' && objcopy -O " +
+             "binary -j .text '" + dir.file("a.o") + "' '" +
+             dir.file("a.bin") + "'");
+  return testutil::readFile(dir.file("a.bin"));
+}
+
+/// Options for the installed LLVM, which may predate opaque pointers.
+LlvmOptions llvmOptions() {
+  LlvmOptions options;
+  options.opaquePointers = llvmVersion("llc") >= 15;
+  return options;
+}
+
+/// Compile a module with `llc` (after @p passes of `opt`, if any), link it
+/// into a shared object and run it on a zeroed frame.
+NativeRun runLlvm(const Program& prog, LlvmOptions options = llvmOptions(),
+                  const std::string& passes = "") {
+  TempDir dir;
+  std::string ll = dir.write("module.ll", LlvmEmitter(options).emit(
+                                              prog.root, prog.frame));
+  if (!passes.empty()) {
+    runCommand("opt -S " + passes + " -o '" +
+               dir.file("opt.ll") + "' '" + ll + "'");
+    ll = dir.file("opt.ll");
+  }
+  std::string obj = dir.file("module.o");
+  runCommand("llc -relocation-model=pic -filetype=obj -o '" +
+             obj + "' '" + ll + "'");
+  std::string so = dir.file("module.so");
+  runCommand("cc -shared -o '" + so + "' '" + obj + "'");
+  SharedLibrary lib(so);
+  NativeRun r;
+  r.frame.assign(prog.frame.size + 1, 0);
+  r.status = lib.entry(options.symbol)(r.frame.data());
+  r.frame.resize(prog.frame.size);
+  return r;
+}
+
+/// Compile the C unit of @p prog with `cc -O2` into a shared object and run
+/// it on a zeroed frame.
+NativeRun runC(const Program& prog, COptions options = {}) {
+  TempDir dir;
+  std::string c =
+      dir.write("unit.c", CEmitter(options).emit(prog.root, prog.frame));
+  std::string so = dir.file("unit.so");
+  runCommand("cc -O2 -shared -fPIC -o '" + so + "' '" + c + "'");
+  SharedLibrary lib(so);
+  NativeRun r;
+  r.frame.assign(prog.frame.size + 1, 0);
+  r.status = lib.entry(options.symbol)(r.frame.data());
+  r.frame.resize(prog.frame.size);
+  return r;
+}
+}  // namespace
+
+TEST(RegAllocTest, SpillsWhenRegistersRunOut) {
+  auto fn = compile(
+      "{ int a; int b; int c; int d; int e;"
+      "  a = (a + 1) * ((b + 2) * ((c + 3) * ((d + 4) * (e + 5)))); }");
+  ir::Cfg cfg(fn);
+  ir::Liveness live(fn, cfg);
+  Allocation all = linearScan(fn, cfg, live, 16, 16);
+  EXPECT_EQ(all.spilled, 0);
+  EXPECT_EQ(all.inRegisters, fn.numTemps);
+
+  Allocation few = linearScan(fn, cfg, live, 2, 2);
+  EXPECT_GT(few.spilled, 0);
+  EXPECT_LE(few.gpUsed, 2);
+  EXPECT_EQ(few.spilled + few.inRegisters, fn.numTemps);
+  EXPECT_EQ(few.stackBytes % 16, 0);
+  // temporaries live at the same point never share a register
+  auto ranges = ir::liveRanges(fn, cfg, live);
+  for (int s = 1; s <= fn.numTemps; ++s) {
+    for (int t = s + 1; t <= fn.numTemps; ++t) {
+      if (few.reg[s] >= 0 && few.reg[s] == few.reg[t]) {
+        EXPECT_TRUE(ranges[s].end < ranges[t].start ||
+                    ranges[t].end < ranges[s].start);
+      }
+    }
+  }
+}
+
+TEST(AsmEmitterTest, CorpusMatchesInterpreter) {
+  REQUIRE_TOOLCHAIN();
+  for (const auto& name : corpus) {
+    auto fn = compile(readCorpus(name));
+    expectSameAsInterpreter(fn, {}, name);
+
+    AsmOptions stack;
+    stack.allocateRegisters = false;
+    expectSameAsInterpreter(fn, stack, std::string(name) + " spilled");
+
+    opt::PassManager().run(fn);
+    expectSameAsInterpreter(fn, {}, std::string(name) + " optimized");
+
+    ir::LowerOptions lo;
+    lo.vectorize = true;
+    lo.jumpingCode = false;
+    expectSameAsInterpreter(compile(readCorpus(name), lo), {},
+                            std::string(name) + " vectorized");
+  }
+}
+
+TEST(AsmEmitterTest, ScalarSemantics) {
+  REQUIRE_TOOLCHAIN();
+  auto fn = compile(
+      "{ char c; bool b; int i; int q; float f; float g; float z; bool lt;"
+      "  bool eq; int[4] a; float[4] x; char[4] s;"
+      "  c = 100; c = c + c; i = 0 - 7; q = i / 2; b = i < q;"
+      "  f = 0.0; z = -f; g = i; g = g / 4.0; i = g; lt = g < f;"
+      "  eq = g == g; a[3] = q; x[1] = g * 2.0; s[2] = c;"
+      "  if (!(q >= 0) && c != 0) i = i * 3; }");
+  expectSameAsInterpreter(fn);
+  ir::Interpreter interp(fn);
+  auto frame = interp.run();
+  EXPECT_EQ(ir::readVar(frame, *fn.frame.vars[0]), -56);  // c wrapped
+}
+
+TEST(AsmEmitterTest, FailedChecksAndDivisionReturnOne) {
+  REQUIRE_TOOLCHAIN();
+  ir::LowerOptions checked;
+  checked.boundsChecks = true;
+  auto fn = compile("{ int[4] a; int i; i = 4; a[i] = 1; }", checked);
+  EXPECT_EQ(runNative(fn).status, 1);
+  fn = compile("{ int[4] a; int i; i = 0 - 1; a[i] = 1; }", checked);
+  EXPECT_EQ(runNative(fn).status, 1);
+  fn = compile("{ int[4] a; int i; i = 3; a[i] = 1; }", checked);
+  EXPECT_EQ(runNative(fn).status, 0);
+  fn = compile("{ int i; int j; i = 5 / j; }");
+  EXPECT_EQ(runNative(fn).status, 1);
+}
+
+TEST(AsmEmitterTest, KeepsTemporariesInRegisters) {
+  REQUIRE_TOOLCHAIN();
+  auto fn = compile(readCorpus("matmul.sc"));
+  AsmStats regs, stack;
+  AsmOptions noRegs;
+  noRegs.allocateRegisters = false;
+  runNative(fn, {}, &regs);
+  runNative(fn, noRegs, &stack);
+  EXPECT_EQ(regs.temps, fn.numTemps);
+  EXPECT_EQ(regs.inRegisters, fn.numTemps);
+  EXPECT_EQ(regs.spilled, 0);
+  EXPECT_EQ(stack.spilled, fn.numTemps);
+  EXPECT_LT(regs.instrs, stack.instrs);
+
+  // more values live at once than registers: spills, same result
+  std::string src = "{ int[40] a; int s; int i; i = 0;"
+                    " while (i < 40) { a[i] = i * 3 - 7; i = i + 1; }"
+                    " s = ";
+  for (int k = 0; k < 30; ++k)
+    src += "(a[" + std::to_string(k) + "] + ";
+  src += "1";
+  for (int k = 0; k < 30; ++k) src += ")";
+  src += "; }";
+  fn = compile(src);
+  AsmStats pressure;
+  runNative(fn, {}, &pressure);
+  EXPECT_GT(pressure.spilled, 0);
+  expectSameAsInterpreter(fn);
+}
+
+TEST(AsmEmitterTest, LinksIntoProgramWithMain) {
+  REQUIRE_TOOLCHAIN();
+  AsmOptions options;
+  options.main = true;
+  TempDir dir;
+  std::pair<const char*, int> programs[] = {
+      {"{ int[8] a; int i; while (i < 8) { a[i] = i; i = i + 1; } }", 0},
+      {"{ int i; int j; i = 1 / j; }", 1},
+  };
+  for (const auto& [src, expected] : programs) {
+    std::string s = dir.write("prog.s", AsmEmitter(options).emit(compile(src)));
+    runCommand("cc -o '" + dir.file("prog") + "' '" + s + "'");
+    int status = std::system(("'" + dir.file("prog") + "'").c_str());
+    EXPECT_EQ(WEXITSTATUS(status), expected) << src;
+  }
+}
+
+TEST(AssemblerTest, EncodesLikeGnuAs) {
+  if (!haveTool("as") || !haveTool("objcopy"))
+    GTEST_SKIP() << "no as and objcopy on PATH";
+  // everything AsmEmitter writes but jumps and calls, which GNU as shortens
+  // to 8-bit displacements; %rip references are left zero by both
+  auto withoutBranches = [](const std::string& text) {
+    std::istringstream in(text);
+    std::string line, out;
+    while (std::getline(in, line))
+      if (line.compare(0, 2, "\tj") && line.compare(0, 5, "\tcall") &&
+          line != "1:")
+        out += line + "\n";
+    return out;
+  };
+  ir::LowerOptions vec;
+  vec.vectorize = true;
+  vec.jumpingCode = false;
+  for (const auto& name : corpus) {
+    for (int mode = 0; mode < 4; ++mode) {
+      auto fn = compile(readCorpus(name), mode == 3 ? vec : ir::LowerOptions{});
+      if (mode == 2) opt::PassManager().run(fn);
+      AsmOptions options;
+      options.allocateRegisters = mode != 1;
+      options.main = true;
+      std::string text = withoutBranches(AsmEmitter(options).emit(fn));
+      Object obj = assemble(text);
+      ASSERT_EQ(obj.sections[0].name, ".text");
+      std::string ours(obj.sections[0].bytes.begin(),
+                       obj.sections[0].bytes.end());
+      EXPECT_EQ(ours, gnuText(text)) << name << " mode " << mode;
+    }
+  }
+}
+
+TEST(AssemblerTest, LabelsSymbolsAndRelocations) {
+  Object obj = assemble(
+      "\t.text\n\t.globl\tf\n\t.type\tf, @function\nf:\n"
+      "\tjmp\t1f\n"
+      "1:\n\tmovsd\t.Lc(%rip), %xmm0\n"
+      "\tjne\t1b\n\tcall\texternal\n\tret\n"
+      "\t.size\tf, .-f\n"
+      "\t.section\t.rodata\n\t.balign\t8\n.Lc:\n\t.quad\t4607182418800017408\n");
+  ASSERT_EQ(obj.sections.size(), 2u);
+  const std::vector<uint8_t>& text = obj.sections[0].bytes;
+  // jmp to the next instruction, jne back 15 bytes to it
+  std::vector<uint8_t> jmp = {0xe9, 0, 0, 0, 0};
+  EXPECT_EQ(std::vector<uint8_t>(text.begin(), text.begin() + 5), jmp);
+  std::vector<uint8_t> jne = {0x0f, 0x85, 0xf2, 0xff, 0xff, 0xff};
+  EXPECT_EQ(std::vector<uint8_t>(text.begin() + 13, text.begin() + 19), jne);
+  EXPECT_EQ(text.back(), 0xc3);
+
+  const Symbol* f = obj.find("f");
+  ASSERT_NE(f, nullptr);
+  EXPECT_TRUE(f->global);
+  EXPECT_TRUE(f->function);
+  EXPECT_EQ(f->size, text.size());
+  EXPECT_EQ(obj.find(".Lc")->section, 1);
+  EXPECT_EQ(obj.sections[1].align, 8);
+  EXPECT_EQ(obj.sections[1].bytes.size(), 8u);
+
+  // the constant in the other section and the undefined call remain
+  ASSERT_EQ(obj.relocations.size(), 2u);
+  EXPECT_EQ(obj.relocations[0].symbol, ".Lc");
+  EXPECT_EQ(obj.relocations[0].offset, 9u);
+  EXPECT_EQ(obj.relocations[0].addend, -4);
+  EXPECT_EQ(obj.relocations[1].symbol, "external");
+
+  EXPECT_THROW(assemble("\tcpuid\n"), std::runtime_error);
+  EXPECT_THROW(assemble("\tmovl\t(%eax), %ecx\n"), std::runtime_error);
+  EXPECT_THROW(assemble("\tjmp\t.Lnowhere\n"), std::runtime_error);
+  EXPECT_THROW(JitModule{obj}, std::runtime_error);  // no symbol external
+}
+
+TEST(JitTest, CorpusMatchesInterpreter) {
+  ir::LowerOptions checked;
+  checked.boundsChecks = true;
+  ir::LowerOptions vec;
+  vec.vectorize = true;
+  vec.jumpingCode = false;
+  AsmOptions stack;
+  stack.allocateRegisters = false;
+  for (const auto& name : corpus) {
+    auto fn = compile(readCorpus(name));
+    std::vector<uint8_t> expected = ir::Interpreter(fn).run(10000000);
+    for (const AsmOptions& options : {AsmOptions{}, stack}) {
+      NativeRun r = runJit(fn, options);
+      EXPECT_EQ(r.status, 0) << name;
+      EXPECT_EQ(r.frame, expected) << name;
+    }
+    opt::PassManager().run(fn);
+    EXPECT_EQ(runJit(fn).frame, expected) << name << " optimized";
+    EXPECT_EQ(runJit(compile(readCorpus(name), checked)).frame, expected)
+        << name << " checked";
+    EXPECT_EQ(runJit(compile(readCorpus(name), vec)).frame, expected)
+        << name << " vectorized";
+  }
+}
+
+TEST(JitTest, FrameAndStatusReachTheHost) {
+  auto fn = compile(
+      "{ char c; int i; int q; float f; float g; bool b; int[4] a;"
+      "  c = 100; c = c + c; i = 0 - 7; q = i / 2; f = i; g = -f / 4.0;"
+      "  b = g > 1.5 && g < 2.0; a[3] = q; }");
+  JitModule mod(fn);
+  EXPECT_GT(mod.size(), 0u);
+  std::vector<uint8_t> frame(fn.frame.size, 0);
+  EXPECT_EQ(mod.entry("sc_main")(frame.data()), 0);
+  EXPECT_EQ(frame, ir::Interpreter(fn).run());
+  EXPECT_EQ(ir::readVar(frame, *fn.frame.vars[0]), -56);
+  EXPECT_EQ(ir::readVar(frame, *fn.frame.vars[2]), -3);
+  // a second call runs on whatever the frame holds
+  EXPECT_EQ(mod.entry("sc_main")(frame.data()), 0);
+
+  ir::LowerOptions checked;
+  checked.boundsChecks = true;
+  EXPECT_EQ(runJit(compile("{ int[4] a; int i; i = 4; a[i] = 1; }", checked))
+                .status,
+            1);
+  EXPECT_EQ(runJit(compile("{ int i; int j; i = 5 / j; }")).status, 1);
+  EXPECT_THROW(mod.symbol("main"), std::runtime_error);
+}
+
+TEST(AssemblerTest, LineDirectivesFollowStatements) {
+  auto fn = compile("{ int i; int s;\n  i = 3;\n  while (i > 0) {\n"
+                    "    s = s + i; i = i - 1; } }");
+  AsmOptions options;
+  options.sourceFile = "prog.sc";
+  std::string text = AsmEmitter(options).emit(fn);
+  EXPECT_NE(text.find("\t.file\t1 \"prog.sc\"\n"), std::string::npos);
+  EXPECT_NE(text.find("\t.loc\t1 2 "), std::string::npos);
+  EXPECT_EQ(AsmEmitter().emit(fn).find(".loc"), std::string::npos);
+
+  Object obj = assemble(text);
+  EXPECT_EQ(obj.sourceFile, "prog.sc");
+  std::vector<int> lines;
+  for (const LineEntry& e : obj.lines) {
+    EXPECT_EQ(e.section, 0);
+    EXPECT_LE(e.offset, obj.sections[0].bytes.size());
+    lines.push_back(e.line);
+  }
+  for (int line : {2, 3, 4})
+    EXPECT_NE(std::find(lines.begin(), lines.end(), line), lines.end())
+        << line;
+  // line information adds no code, and GNU as takes it too
+  EXPECT_EQ(assemble(AsmEmitter().emit(fn)).sections[0].bytes,
+            obj.sections[0].bytes);
+  EXPECT_THROW(assemble("\t.loc\t2 1 1\n"), std::runtime_error);
+  if (haveTool("as")) {
+    EXPECT_NO_THROW(gnuText(text));
+  }
+}
+
+TEST(PerfMapTest, RegionsCoverFunctionsByStatement) {
+  auto fn = compile("{ int i; int s;\n  i = 3;\n  while (i > 0) {\n"
+                    "    s = s + i; i = i - 1; } }");
+  AsmOptions options;
+  options.sourceFile = "prog.sc";
+  JitModule mod(fn, options);
+  ASSERT_EQ(mod.functions().size(), 1u);
+  const JitFunction& f = mod.functions()[0];
+  EXPECT_EQ(f.name, "sc_main");
+  EXPECT_EQ(f.start, mod.symbol("sc_main"));
+  EXPECT_FALSE(mod.lines().empty());
+
+  TempDir dir;
+  std::string path = dir.file("perf.map");
+  {
+    PerfMap map(path);
+    map.add(mod);
+    map.add(mod.symbol("sc_main"), 1, "again");
+  }
+  std::ifstream in(path);
+  std::string line;
+  uintptr_t at = reinterpret_cast<uintptr_t>(f.start);
+  std::vector<std::string> names;
+  bool single = false;
+  while (std::getline(in, line)) {
+    std::istringstream fields(line);
+    uintptr_t start = 0;
+    size_t size = 0;
+    fields >> std::hex >> start >> size;
+    std::string name;
+    std::getline(fields >> std::ws, name);
+    if (name == "again") {
+      single = start == reinterpret_cast<uintptr_t>(f.start) && size == 1;
+      break;
+    }
+    EXPECT_EQ(start, at) << line;  // contiguous, in order
+    EXPECT_GT(size, 0u) << line;
+    at = start + size;
+    names.push_back(name);
+  }
+  EXPECT_TRUE(single);
+  EXPECT_EQ(at, reinterpret_cast<uintptr_t>(f.start) + f.size);
+  ASSERT_GE(names.size(), 3u);
+  for (const char* want :
+       {"sc_main prog.sc:2:", "sc_main prog.sc:3:", "sc_main prog.sc:4:"})
+    EXPECT_NE(std::find_if(names.begin(), names.end(),
+                           [&](const std::string& n) {
+                             return n.compare(0, std::strlen(want), want) == 0;
+                           }),
+              names.end())
+        << want;
+  EXPECT_THROW(PerfMap(dir.file("missing/perf.map")), std::runtime_error);
+}
+
+TEST(PerfMapTest, JitDumpHasDebugInfoThenCodeLoads) {
+  auto fn = compile("{ int i;\n  i = 1;\n  i = i + 2; }");
+  AsmOptions options;
+  options.sourceFile = "prog.sc";
+  JitModule mod(fn, options);
+  const JitFunction& f = mod.functions().at(0);
+
+  TempDir dir;
+  std::string path = dir.file("jit.dump");
+  JitDump(path).add(mod);
+  std::string bytes = testutil::readFile(path);
+  auto u32 = [&](size_t at) {
+    uint32_t v;
+    std::memcpy(&v, bytes.data() + at, sizeof v);
+    return v;
+  };
+  auto u64 = [&](size_t at) {
+    uint64_t v;
+    std::memcpy(&v, bytes.data() + at, sizeof v);
+    return v;
+  };
+  ASSERT_GE(bytes.size(), 40u);
+  EXPECT_EQ(u32(0), 0x4A695444u);  // magic
+  EXPECT_EQ(u32(4), 1u);           // version
+  EXPECT_EQ(u32(8), 40u);          // header size
+  EXPECT_EQ(u32(12), 62u);         // EM_X86_64
+  EXPECT_EQ(u32(20), static_cast<uint32_t>(getpid()));
+
+  std::vector<uint32_t> ids;
+  for (size_t at = 40; at + 16 <= bytes.size(); at += u32(at + 4)) {
+    ids.push_back(u32(at));
+    if (u32(at) == 2) {  // JIT_CODE_DEBUG_INFO
+      EXPECT_EQ(u64(at + 16), reinterpret_cast<uint64_t>(f.start));
+      uint64_t entries = u64(at + 24);
+      ASSERT_EQ(entries, 2u);
+      size_t e = at + 32;
+      EXPECT_EQ(u32(e + 8), 2u);  // line of `i = 1;`
+      EXPECT_EQ(bytes.substr(e + 16, 8), std::string("prog.sc\0", 8));
+      EXPECT_EQ(u32(e + 24 + 8), 3u);
+    } else if (u32(at) == 0) {  // JIT_CODE_LOAD
+      EXPECT_EQ(u64(at + 24), reinterpret_cast<uint64_t>(f.start));
+      EXPECT_EQ(u64(at + 40), f.size);
+      EXPECT_EQ(bytes.substr(at + 56, 8), std::string("sc_main\0", 8));
+      EXPECT_EQ(bytes.substr(at + 64, f.size),
+                std::string(reinterpret_cast<const char*>(f.start), f.size));
+    }
+  }
+  EXPECT_EQ(ids, (std::vector<uint32_t>{2, 0, 3}));  // ... JIT_CODE_CLOSE
+}
+
+TEST(ElfTest, CorpusLinksAndMatchesInterpreter) {
+  REQUIRE_TOOLCHAIN();
+  AsmOptions stack;
+  stack.allocateRegisters = false;
+  for (const auto& name : corpus) {
+    auto fn = compile(readCorpus(name));
+    std::vector<uint8_t> expected = ir::Interpreter(fn).run(10000000);
+    opt::PassManager().run(fn);
+    for (const AsmOptions& options : {AsmOptions{}, stack}) {
+      TempDir dir;
+      SharedLibrary lib(
+          linkShared(dir, assemble(AsmEmitter(options).emit(fn))));
+      std::vector<uint8_t> frame(fn.frame.size + 1, 0);
+      EXPECT_EQ(lib.entry("sc_main")(frame.data()), 0) << name;
+      frame.resize(fn.frame.size);
+      EXPECT_EQ(frame, expected) << name;
+    }
+  }
+}
+
+TEST(ElfTest, SymbolsSectionsAndRelocationsForTheLinker) {
+  Object obj = assemble(
+      "\t.text\n\t.globl\tf\n\t.type\tf, @function\nf:\n"
+      "\tmovsd\t.Lc(%rip), %xmm0\n\tcall\texternal\n\tret\n"
+      "\t.size\tf, .-f\n"
+      "\t.section\t.rodata\n\t.balign\t8\n\t.quad\t0\n.Lc:\n"
+      "\t.quad\t4607182418800017408\n"
+      "\t.section\t.note.GNU-stack,\"\",@progbits\n");
+  std::vector<uint8_t> elf = writeElf(obj);
+  ASSERT_GE(elf.size(), 64u);
+  EXPECT_EQ(std::string(elf.begin(), elf.begin() + 4), "\x7f" "ELF");
+  EXPECT_EQ(elf[4], 2);   // ELFCLASS64
+  EXPECT_EQ(elf[16], 1);  // ET_REL
+  EXPECT_EQ(elf[18], 62);  // EM_X86_64
+
+  if (!haveTool("readelf")) GTEST_SKIP() << "no readelf on PATH";
+  TempDir dir;
+  std::string o = dir.write("f.o", std::string(elf.begin(), elf.end()));
+  std::string sections = runCommand("readelf -SW '" + o + "'");
+  EXPECT_NE(sections.find(".rela.text"), std::string::npos);
+  EXPECT_NE(sections.find(".note.GNU-stack"), std::string::npos);
+  std::string relocs = runCommand("readelf -rW '" + o + "'");
+  // .Lc, 8 bytes into .rodata, against the section symbol
+  EXPECT_NE(relocs.find("R_X86_64_PC32"), std::string::npos) << relocs;
+  EXPECT_NE(relocs.find(".rodata + 4"), std::string::npos) << relocs;
+  EXPECT_NE(relocs.find("R_X86_64_PLT32"), std::string::npos) << relocs;
+  EXPECT_NE(relocs.find("external - 4"), std::string::npos) << relocs;
+  std::string syms = runCommand("readelf -sW '" + o + "'");
+  EXPECT_NE(syms.find("FUNC    GLOBAL DEFAULT    1 f"), std::string::npos)
+      << syms;
+  EXPECT_NE(syms.find("UND external"), std::string::npos) << syms;
+  EXPECT_EQ(syms.find(".Lc"), std::string::npos) << syms;
+}
+
+TEST(ElfTest, LinksIntoProgramWithMain) {
+  REQUIRE_TOOLCHAIN();
+  auto fn = compile("{ int[10] a; int i; while (i < 10) { a[i] = i; i = i + 1; }"
+                    "  i = 10 / a[0]; }");
+  AsmOptions options;
+  options.main = true;
+  TempDir dir;
+  std::vector<uint8_t> elf = writeElf(assemble(AsmEmitter(options).emit(fn)));
+  std::string o = dir.write("prog.o", std::string(elf.begin(), elf.end()));
+  std::string exe = dir.file("prog");
+  runCommand("cc -o '" + exe + "' '" + o + "'");
+  int status = std::system(("'" + exe + "'").c_str());
+  ASSERT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(WEXITSTATUS(status), 1);  // divided by zero
+}
+
+TEST(LlvmEmitterTest, SlotsAccessesAndTypedArithmetic) {
+  Program prog = parse(
+      "{ int i; float f; char c; bool b; int[3][4] a;"
+      "  f = i + 0.5; c = c * c; a[i][2] = i / 3; b = f < 1.0 && !b; }");
+  std::string ll = LlvmEmitter().emit(prog.root, prog.frame);
+  EXPECT_NE(ll.find("define i32 @sc_main(ptr %frame)"), std::string::npos);
+  EXPECT_NE(ll.find("%i.0 = alloca i32"), std::string::npos);
+  EXPECT_NE(ll.find("%f.1 = alloca double"), std::string::npos);
+  EXPECT_NE(ll.find("%b.3 = alloca i8"), std::string::npos);
+  EXPECT_NE(ll.find("%a.4 = alloca [3 x [4 x i32]]"), std::string::npos);
+  EXPECT_NE(ll.find("sitofp i32"), std::string::npos);
+  EXPECT_NE(ll.find("fadd double"), std::string::npos);
+  EXPECT_NE(ll.find("mul i8"), std::string::npos);
+  EXPECT_NE(ll.find("sdiv i64"), std::string::npos);
+  EXPECT_NE(ll.find("fcmp olt double"), std::string::npos);
+  EXPECT_NE(ll.find("phi i1"), std::string::npos);
+  EXPECT_NE(ll.find("getelementptr inbounds [3 x [4 x i32]], ptr %a.4, i64 0"),
+            std::string::npos);
+  EXPECT_EQ(ll.find("icmp uge"), std::string::npos);
+
+  LlvmOptions checked;
+  checked.boundsChecks = true;
+  ll = LlvmEmitter(checked).emit(prog.root, prog.frame);
+  EXPECT_NE(ll.find("icmp uge i32"), std::string::npos);
+}
+
+TEST(LlvmEmitterTest, CorpusAssembles) {
+  REQUIRE_LLVM("llvm-as");
+  REQUIRE_LLVM("llc");
+  TempDir dir;
+  for (const auto& name : corpus) {
+    Program prog = parse(readCorpus(name));
+    for (bool checks : {false, true}) {
+      LlvmOptions options = llvmOptions();
+      options.boundsChecks = checks;
+      std::string ll = dir.write(
+          "module.ll", LlvmEmitter(options).emit(prog.root, prog.frame));
+      EXPECT_NO_THROW(runCommand("llvm-as -o /dev/null '" + ll + "'"))
+          << name;
+    }
+  }
+}
+
+TEST(LlvmEmitterTest, CorpusMatchesInterpreter) {
+  REQUIRE_TOOLCHAIN();
+  REQUIRE_LLVM("llc");
+  for (const auto& name : corpus) {
+    Program prog = parse(readCorpus(name));
+    ir::Function fn = ir::lower(prog.root, prog.frame);
+    ir::Interpreter interp(fn);
+    std::vector<uint8_t> expected = interp.run(10000000);
+
+    NativeRun r = runLlvm(prog);
+    EXPECT_EQ(r.status, 0) << name;
+    EXPECT_EQ(r.frame, expected) << name;
+    if (!haveTool("opt")) continue;
+    r = runLlvm(prog, llvmOptions(), "-O3");
+    EXPECT_EQ(r.status, 0) << name << " -O3";
+    EXPECT_EQ(r.frame, expected) << name << " -O3";
+  }
+}
+
+TEST(LlvmEmitterTest, ScalarSemantics) {
+  REQUIRE_TOOLCHAIN();
+  REQUIRE_LLVM("llc");
+  Program prog = parse(
+      "{ char c; bool b; int i; int q; float f; float g; float z; bool lt;"
+      "  bool eq; int[4] a; float[4] x; char[4] s; int m;"
+      "  c = 100; c = c + c; i = 0 - 7; q = i / 2; b = i < q;"
+      "  f = 0.0; z = -f; g = i; g = g / 4.0; i = g; lt = g < f;"
+      "  eq = g == g; a[3] = q; x[1] = g * 2.0; s[2] = c;"
+      "  m = 0 - 2147483647 - 1; m = m / (0 - 1);"
+      "  if (!(q >= 0) && c != 0) i = i * 3;"
+      "  do { q = q + 1; if (q > 5) break; } while (true); }");
+  ir::Function fn = ir::lower(prog.root, prog.frame);
+  ir::Interpreter interp(fn);
+  std::vector<uint8_t> expected = interp.run();
+  EXPECT_EQ(runLlvm(prog).frame, expected);
+  EXPECT_EQ(runLlvm(prog, llvmOptions(), "-O3").frame, expected);
+}
+
+TEST(LlvmEmitterTest, FailedChecksAndDivisionReturnOne) {
+  REQUIRE_TOOLCHAIN();
+  REQUIRE_LLVM("llc");
+  LlvmOptions checked = llvmOptions();
+  checked.boundsChecks = true;
+  std::pair<const char*, int> programs[] = {
+      {"{ int[4] a; int i; i = 4; a[i] = 1; }", 1},
+      {"{ int[4] a; int i; i = 0 - 1; a[i] = 1; }", 1},
+      {"{ int[4][2] a; int i; i = 2; a[1][i] = 1; }", 1},
+      {"{ int[4] a; int i; i = 3; a[i] = 1; }", 0},
+      {"{ int i; int j; i = 7; i = 5 / j; }", 1},
+  };
+  for (const auto& [src, expected] : programs) {
+    NativeRun r = runLlvm(parse(src), checked);
+    EXPECT_EQ(r.status, expected) << src;
+  }
+  // the frame keeps what was stored before the trap
+  NativeRun r = runLlvm(parse("{ int i; int j; i = 7; i = 5 / j; }"));
+  EXPECT_EQ(r.frame[0], 7);
+}
+
+TEST(CEmitterTest, DeclarationsAndTypedArithmetic) {
+  Program prog = parse(
+      "{ int i; float f; char c; bool b; int[3][4] a;"
+      "  f = i + 0.5; c = c * c; a[i][2] = i / 3; b = f < 1.0 && !b; }");
+  std::string c = CEmitter().emit(prog.root, prog.frame);
+  EXPECT_NE(c.find("int sc_main(uint8_t* frame) {"), std::string::npos);
+  EXPECT_NE(c.find("int32_t i_0;"), std::string::npos);
+  EXPECT_NE(c.find("double f_1;"), std::string::npos);
+  EXPECT_NE(c.find("int8_t c_2;"), std::string::npos);
+  EXPECT_NE(c.find("uint8_t b_3;"), std::string::npos);
+  EXPECT_NE(c.find("int32_t a_4[3][4];"), std::string::npos);
+  EXPECT_NE(c.find("memcpy(a_4, frame + "), std::string::npos);
+  EXPECT_NE(c.find("(double)i_0"), std::string::npos);
+  EXPECT_NE(c.find("(int8_t)((uint32_t)c_2 * (uint32_t)c_2)"),
+            std::string::npos);
+  EXPECT_NE(c.find("(int64_t)i_0 / (int64_t)3"), std::string::npos);
+  EXPECT_NE(c.find("a_4[i_0][2] = "), std::string::npos);
+  EXPECT_EQ(c.find("int main"), std::string::npos);
+  EXPECT_EQ(c.find(">= 3u"), std::string::npos);
+
+  COptions checked;
+  checked.boundsChecks = true;
+  c = CEmitter(checked).emit(prog.root, prog.frame);
+  EXPECT_NE(c.find("if ((uint32_t)i_0 >= 3u) goto trap;"), std::string::npos);
+  EXPECT_NE(c.find("if ((uint32_t)2 >= 4u) goto trap;"), std::string::npos);
+}
+
+TEST(CEmitterTest, CorpusMatchesInterpreter) {
+  REQUIRE_TOOLCHAIN();
+  for (const auto& name : corpus) {
+    Program prog = parse(readCorpus(name));
+    for (bool checks : {false, true}) {
+      ir::LowerOptions lower;
+      lower.boundsChecks = checks;
+      ir::Function fn = ir::lower(prog.root, prog.frame, lower);
+      ir::Interpreter interp(fn);
+      std::vector<uint8_t> expected = interp.run(10000000);
+
+      COptions options;
+      options.boundsChecks = checks;
+      NativeRun r = runC(prog, options);
+      EXPECT_EQ(r.status, 0) << name;
+      EXPECT_EQ(r.frame, expected) << name << (checks ? " checked" : "");
+    }
+  }
+}
+
+TEST(CEmitterTest, ScalarSemantics) {
+  REQUIRE_TOOLCHAIN();
+  Program prog = parse(
+      "{ char c; bool b; int i; int q; float f; float g; float z; bool lt;"
+      "  bool eq; int[4] a; float[4] x; char[4] s; int m;"
+      "  c = 100; c = c + c; i = 0 - 7; q = i / 2; b = i < q;"
+      "  f = 0.0; z = -f; g = i; g = g / 4.0; i = g; lt = g < f;"
+      "  eq = g == g; a[3] = q; x[1] = g * 2.0; s[2] = c;"
+      "  m = 0 - 2147483647 - 1; m = m / (0 - 1);"
+      "  if (!(q >= 0) && c != 0) i = i * 3;"
+      "  while (q < 3 || b) { q = q + 1; b = false; }"
+      "  do { q = q + 1; if (q > 5) break; } while (true); }");
+  ir::Function fn = ir::lower(prog.root, prog.frame);
+  ir::Interpreter interp(fn);
+  std::vector<uint8_t> expected = interp.run();
+  EXPECT_EQ(runC(prog).frame, expected);
+}
+
+TEST(CEmitterTest, FailedChecksAndDivisionReturnOne) {
+  REQUIRE_TOOLCHAIN();
+  COptions checked;
+  checked.boundsChecks = true;
+  std::pair<const char*, int> programs[] = {
+      {"{ int[4] a; int i; i = 4; a[i] = 1; }", 1},
+      {"{ int[4] a; int i; i = 0 - 1; a[i] = 1; }", 1},
+      {"{ int[4][2] a; int i; i = 2; a[1][i] = 1; }", 1},
+      {"{ int[4] a; int i; i = 3; a[i] = 1; }", 0},
+      {"{ int i; int j; i = 7; i = 5 / j; }", 1},
+  };
+  for (const auto& [src, expected] : programs) {
+    NativeRun r = runC(parse(src), checked);
+    EXPECT_EQ(r.status, expected) << src;
+  }
+  // the frame keeps what was stored before the trap
+  NativeRun r = runC(parse("{ int i; int j; i = 7; i = 5 / j; }"));
+  EXPECT_EQ(r.frame[0], 7);
+}
+
+TEST(CEmitterTest, MainPrintsFinalValues) {
+  REQUIRE_TOOLCHAIN();
+  Program prog = parse(
+      "{ int i; float f; bool b; char[3] s; int[2][2] m;"
+      "  i = 6 * 7; f = 0.25; b = i > 40; s[1] = 0 - 3; m[1][0] = i;"
+      "  { int hidden; hidden = 5; } }");
+  COptions options;
+  options.main = true;
+  TempDir dir;
+  std::string c = dir.write("unit.c", CEmitter(options).emit(prog.root,
+                                                             prog.frame));
+  std::string exe = dir.file("unit");
+  runCommand("cc -O2 -o '" + exe + "' '" + c + "'");
+  std::string out = dir.file("out.txt");
+  int status = std::system(("'" + exe + "' > '" + out + "'").c_str());
+  ASSERT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(WEXITSTATUS(status), 0);
+  EXPECT_EQ(testutil::readFile(out),
+            "i = 42\nf = 0.25\nb = 1\ns = 0 -3 0\nm = 0 0 42 0\n");
+
+  prog = parse("{ int i; int j; i = 7; i = 5 / j; }");
+  c = dir.write("trap.c", CEmitter(options).emit(prog.root, prog.frame));
+  runCommand("cc -O2 -o '" + exe + "' '" + c + "'");
+  status = std::system(("'" + exe + "' > '" + out + "'").c_str());
+  ASSERT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(WEXITSTATUS(status), 1);
+}
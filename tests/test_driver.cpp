@@ -0,0 +1,208 @@
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include "CompilerContext.hpp"
+#include "Driver.hpp"
+#include "TestUtil.hpp"
+
+namespace fs = std::filesystem;
+using testutil::readFile;
+
+namespace {
+
+/// Fresh directory removed at the end of the test.
+struct TempDir {
+  fs::path path;
+
+  TempDir() {
+    path = fs::temp_directory_path() /
+           ("driver-test-" + std::to_string(getpid()) + "-" +
+            ::testing::UnitTest::GetInstance()->current_test_info()->name());
+    fs::remove_all(path);
+    fs::create_directories(path);
+  }
+  ~TempDir() { fs::remove_all(path); }
+
+  std::string write(const std::string& name, const std::string& text) const {
+    std::ofstream(path / name) << text;
+    return (path / name).string();
+  }
+};
+
+int run(std::vector<std::string> args, std::string& out, std::string& err) {
+  std::vector<const char*> argv{"main"};
+  for (const auto& a : args) argv.push_back(a.c_str());
+  std::ostringstream o, e;
+  int status = driver::run(static_cast<int>(argv.size()), argv.data(), o, e);
+  out = o.str();
+  err = e.str();
+  return status;
+}
+
+}  // namespace
+
+TEST(DriverTest, CompilesToTextAndC) {
+  std::istringstream a("{ int x; x = 1 + 2; }");
+  EXPECT_EQ(driver::compile(a, driver::Target::Text), "x = 1 + 2;\n");
+  std::istringstream b("{ int x; x = 1 + 2; }");
+  std::string c = driver::compile(b, driver::Target::C);
+  EXPECT_NE(c.find("int sc_main(uint8_t* frame)"), std::string::npos);
+  EXPECT_NE(c.find("int main("), std::string::npos);
+  std::istringstream bad("{ int x; x = ; }");
+  EXPECT_THROW(driver::compile(bad, driver::Target::Text), std::runtime_error);
+}
+
+TEST(DriverTest, ManifestPathsAreRelativeToIt) {
+  TempDir dir;
+  std::string manifest = dir.write(
+      "list.txt", "# programs\n  a.sc \n\nsub/b.sc\r\n/abs/c.sc\n");
+  auto inputs = driver::readManifest(manifest);
+  ASSERT_EQ(inputs.size(), 3u);
+  EXPECT_EQ(inputs[0], (dir.path / "a.sc").string());
+  EXPECT_EQ(inputs[1], (dir.path / "sub/b.sc").string());
+  EXPECT_EQ(inputs[2], "/abs/c.sc");
+  EXPECT_THROW(driver::readManifest((dir.path / "none").string()),
+               std::runtime_error);
+}
+
+TEST(DriverTest, OutputsAndDiagnosticsDoNotDependOnThreads) {
+  TempDir dir;
+  std::vector<std::string> inputs;
+  for (int k = 0; k < 60; ++k) {
+    std::string name = "p" + std::to_string(k) + ".sc";
+    std::string src = k % 7 == 3 ? "{ int x; x = y; }"
+                                 : "{ int i; while (i < " + std::to_string(k) +
+                                       ") i = i + 1; }";
+    inputs.push_back(dir.write(name, src));
+  }
+  inputs.push_back((dir.path / "missing.sc").string());
+
+  std::vector<std::string> expected;
+  for (unsigned workers : {0u, 1u, 3u, 7u}) {
+    driver::Options options;
+    options.outDir = (dir.path / ("out" + std::to_string(workers))).string();
+    task::ThreadPool pool(workers);
+    auto results = driver::compileAll(inputs, options, pool);
+    ASSERT_EQ(results.size(), inputs.size());
+    std::vector<std::string> seen;
+    for (size_t k = 0; k < results.size(); ++k) {
+      const auto& r = results[k];
+      EXPECT_EQ(r.input, inputs[k]);
+      seen.push_back(r.ok() ? readFile(r.output) : r.diagnostic);
+    }
+    if (expected.empty())
+      expected = seen;
+    else
+      EXPECT_EQ(seen, expected) << workers << " workers";
+  }
+  EXPECT_EQ(expected[1], "while (i < 1) {\ni = i + 1;\n}\n");
+  EXPECT_EQ(expected[3].rfind(inputs[3] + ": Line 1", 0), 0u) << expected[3];
+  EXPECT_EQ(expected.back(), inputs.back() + ": cannot open");
+}
+
+TEST(DriverTest, RejectsInputsWritingTheSameOutput) {
+  TempDir dir;
+  fs::create_directories(dir.path / "a");
+  fs::create_directories(dir.path / "b");
+  std::vector<std::string> inputs{dir.write("a/p.sc", "{ }"),
+                                  dir.write("b/p.sc", "{ }")};
+  driver::Options options;
+  options.outDir = (dir.path / "out").string();
+  task::ThreadPool pool(1);
+  EXPECT_THROW(driver::compileAll(inputs, options, pool), std::runtime_error);
+  options.outDir.clear();
+  auto results = driver::compileAll(inputs, options, pool);
+  EXPECT_TRUE(results[0].ok() && results[1].ok());
+  EXPECT_EQ(results[1].output, (dir.path / "b/p.txt").string());
+}
+
+TEST(DriverTest, RejectsOutputsOverwritingAnInput) {
+  TempDir dir;
+  std::string source = "{ int x; x = 1; }";
+  std::vector<std::string> inputs{dir.write("p.txt", source)};
+  driver::Options options;
+  task::ThreadPool pool(1);
+  EXPECT_THROW(driver::compileAll(inputs, options, pool), std::runtime_error);
+  EXPECT_EQ(readFile(inputs[0]), source);
+
+  // another input's output, spelled differently
+  inputs = {dir.write("q.sc", source), (dir.path / "./q.txt").string()};
+  dir.write("q.txt", source);
+  EXPECT_THROW(driver::compileAll(inputs, options, pool), std::runtime_error);
+  EXPECT_EQ(readFile(inputs[1]), source);
+
+  // written elsewhere, the same inputs are fine
+  options.outDir = (dir.path / "out").string();
+  inputs = {dir.write("r.sc", source)};
+  inputs.push_back((dir.path / "p.txt").string());
+  auto results = driver::compileAll(inputs, options, pool);
+  EXPECT_TRUE(results[0].ok() && results[1].ok());
+}
+
+TEST(DriverTest, CommandLine) {
+  TempDir dir;
+  std::string good = dir.write("good.sc", "{ int x; x = 2; }");
+  std::string bad = dir.write("bad.sc", "{ break; }");
+  dir.write("list", "good.sc\nbad.sc\n");
+  std::string out, err;
+
+  EXPECT_EQ(run({"-j", "2", "-t", "c", good}, out, err), 0);
+  EXPECT_EQ(out, "compiled 1 of 1 files\n");
+  EXPECT_TRUE(fs::exists(dir.path / "good.c"));
+
+  EXPECT_EQ(run({"-o", (dir.path / "o").string(), "-m",
+                 (dir.path / "list").string()},
+                out, err),
+            1);
+  EXPECT_EQ(out, "compiled 1 of 2 files\n");
+  EXPECT_EQ(err, bad + ": Line 1, column 3 Unenclosed break\n");
+  EXPECT_EQ(readFile((dir.path / "o/good.txt").string()), "x = 2;\n");
+
+  EXPECT_EQ(run({}, out, err), 2);
+  EXPECT_EQ(run({"-j", "0", good}, out, err), 2);
+  EXPECT_EQ(run({"-t", "asm", good}, out, err), 2);
+  EXPECT_EQ(run({"--bogus", good}, out, err), 2);
+  EXPECT_EQ(run({"-h"}, out, err), 0);
+  EXPECT_EQ(out.rfind("usage: main", 0), 0u);
+}
+
+TEST(CompilerContextTest, CompilesLikeAFreshPipelineEachTime) {
+  const std::vector<std::string> programs{
+      "{ int i; while (i < 3) i = i + 1; }",
+      "{ float[2][2] m; int k;\n m[1][k] = 2.5; }",
+      "{ int x; { bool b; b = x > ; } }",
+      "{ char c; bool b; b = c == c; }",
+      "{ int x; x = 1;\n\n y = 2; }",
+      "{ int i; while (i < 3) i = i + 1; }",
+  };
+  driver::CompilerContext context;
+  for (auto target : {driver::Target::Text, driver::Target::C}) {
+    for (const auto& src : programs) {
+      std::istringstream fresh(src);
+      std::string expected, error;
+      try {
+        expected = driver::compile(fresh, target);
+      } catch (const std::runtime_error& e) {
+        error = e.what();
+      }
+      if (error.empty()) {
+        EXPECT_EQ(context.compile(src, target), expected) << src;
+      } else {
+        try {
+          context.compile(src, target);
+          ADD_FAILURE() << "no error for " << src;
+        } catch (const std::runtime_error& e) {
+          EXPECT_EQ(e.what(), error);
+        }
+      }
+    }
+  }
+  context.compile(programs[1]);
+  EXPECT_EQ(context.layout().vars.size(), 2u);
+  EXPECT_EQ(context.layout().size, 36);
+}
@@ -0,0 +1,197 @@
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <sstream>
+
+#include "AllocCounter.hpp"
+#include "EmitParallel.hpp"
+#include "EmitStatic.hpp"
+#include "Emitter.h"
+#include "FunctionRef.hpp"
+#include "Parser.hpp"
+#include "Sink.hpp"
+#include "TestUtil.hpp"
+
+using namespace emit;
+
+TEST(SinkTest, AppendsStringsCharactersAndIntegers) {
+  StringSink out;
+  std::string s = "str";
+  out.append("a", ' ', s, ' ', 42, ' ', -7, ' ', 18446744073709551615ull);
+  out.put('\n').put(std::string_view("end"));
+  EXPECT_EQ(out.str(), "a str 42 -7 18446744073709551615\nend");
+  EXPECT_EQ(out.size(), out.str().size());
+}
+
+TEST(SinkTest, FormatFillsPlaceholdersInOrder) {
+  StringSink out;
+  out.format("{} = {}[{}];", "x", "a", 3);
+  out.format(" {{{}}} }}", 'c');
+  EXPECT_EQ(out.str(), "x = a[3]; {c} }");
+
+  StringSink bad;
+  EXPECT_THROW(bad.format("{} {}", 1), std::runtime_error);
+  EXPECT_THROW(bad.format("{}", 1, 2), std::runtime_error);
+  EXPECT_THROW(bad.format("{x}"), std::runtime_error);
+  EXPECT_THROW(bad.format("}"), std::runtime_error);
+}
+
+TEST(SinkTest, SmallBufferKeepsOrder) {
+  StringSink out(4);
+  std::string expected;
+  for (int k = 0; k < 100; ++k) {
+    std::string piece(k % 9, static_cast<char>('a' + k % 26));
+    out.append(piece, k);
+    expected += piece + std::to_string(k);
+  }
+  EXPECT_EQ(out.size(), expected.size());
+  EXPECT_EQ(out.str(), expected);
+}
+
+TEST(SinkTest, FdAndStreamSinksFlushOnDestruction) {
+  std::ostringstream os;
+  {
+    StreamSink out(os, 8);
+    out.format("while ({}) {{\n", "i < n");
+    EXPECT_EQ(os.str(), "while (i < n) {");  // full buffers only
+  }
+  EXPECT_EQ(os.str(), "while (i < n) {\n");
+
+  std::FILE* f = std::tmpfile();
+  ASSERT_NE(f, nullptr);
+  {
+    FdSink out(fileno(f));
+    for (int k = 0; k < 20000; ++k) out.append(k, '\n');
+  }
+  std::rewind(f);
+  int value = -1, count = 0;
+  while (std::fscanf(f, "%d", &value) == 1) EXPECT_EQ(value, count++);
+  EXPECT_EQ(count, 20000);
+  std::fclose(f);
+
+  FdSink closed(-1, 1);
+  closed.put('x');
+  EXPECT_THROW(closed.put('y'), std::system_error);  // flushes the 'x'
+  EXPECT_THROW(closed.put("longer than the buffer"), std::system_error);
+}
+
+TEST(SinkTest, TextEmitterWritesStatementsToTheSink) {
+  auto prog = testutil::parse(
+      "{ int i; int[4] a; bool b;"
+      "  while (i < 4) { a[i] = i * 2; if (a[i] > 3) break; i = i + 1; }"
+      "  do i = i - 1; while (i > 0);"
+      "  if (b) i = 1; else i = 2; }");
+  const auto& root = prog.root;
+
+  TextEmitter memory;
+  root->emit(memory);
+  std::ostringstream os;
+  {
+    StreamSink sink(os, 16);
+    TextEmitter stream(sink);
+    root->emit(stream);
+    EXPECT_THROW(stream.code(), std::runtime_error);
+  }
+  EXPECT_EQ(os.str(), memory.code());
+  EXPECT_EQ(memory.code(),
+            "while (i < 4) {\n"
+            "a[i] = i * 2;\n"
+            "if (a[i] > 3) {\n"
+            "break;\n"
+            "}\n"
+            "i = i + 1;\n"
+            "}\n"
+            "do {\n"
+            "i = i - 1;\n"
+            "} while (i > 0);\n"
+            "if (b) {\n"
+            "i = 1;\n"
+            "} else {\n"
+            "i = 2;\n"
+            "}\n");
+}
+
+TEST(FunctionRefTest, CallsTheReferencedCallable) {
+  int calls = 0;
+  auto twice = [&calls](int x) {
+    ++calls;
+    return 2 * x;
+  };
+  FunctionRef<int(int)> ref = twice;
+  EXPECT_EQ(ref(21), 42);
+  FunctionRef<int(int)> copy = ref;
+  EXPECT_EQ(copy(1), 2);
+  EXPECT_EQ(calls, 2);
+
+  std::string log;
+  auto run = [](FunctionRef<void(const std::string&)> f) { f("a"); f("b"); };
+  run([&log](const std::string& s) { log += s; });
+  EXPECT_EQ(log, "ab");
+}
+
+TEST(TextEmitterTest, AllocatesNothingOnceWarm) {
+  auto prog = testutil::parse(
+      "{ int i; int[8] a; float f; bool b;"
+      "  while (i < 8 && !b) { a[i] = (i + 1) * (i - 2) / 3; i = i + 1; }"
+      "  if (a[1] > a[2] || b) f = f + 1.5; else f = -f;"
+      "  do { i = i - 1; b = a[i] != 0; } while (i > 0); }");
+  const auto& root = prog.root;
+
+  std::FILE* f = std::tmpfile();
+  ASSERT_NE(f, nullptr);
+  {
+    FdSink sink(fileno(f));
+    TextEmitter em(sink);
+    root->emit(em);  // sizes the arena
+    testutil::AllocCounts before = testutil::allocCounts();
+    for (int k = 0; k < 10; ++k) root->emit(em);
+    EXPECT_EQ(testutil::allocCounts().count, before.count);
+  }
+  std::fclose(f);
+}
+
+TEST(TextEmitterTest, StaticWalkWritesWhatTheVirtualOneDoes) {
+  for (const auto& name : testutil::corpus) {
+    auto root = testutil::parseCorpus(name).root;
+    for (bool rotate : {false, true}) {
+      TextEmitter virt, stat;
+      virt.rotateLoops = stat.rotateLoops = rotate;
+      root->emit(virt);
+      ast::emitStatic(*root, stat);
+      EXPECT_EQ(stat.code(), virt.code()) << name;
+      EXPECT_FALSE(stat.code().empty()) << name;
+    }
+  }
+}
+
+TEST(TextEmitterTest, ParallelEmissionIsByteIdenticalToSerial) {
+  // the corpus programs, 50 times over, joined the way the parser joins
+  // statements
+  std::vector<sptr<ast::Stmt>> programs;
+  for (const auto& name : testutil::corpus) {
+    programs.push_back(testutil::parseCorpus(name).root);
+  }
+  sptr<ast::Stmt> root;
+  for (int copy = 0; copy < 50; ++copy)
+    for (auto it = programs.rbegin(); it != programs.rend(); ++it)
+      root = root ? std::make_shared<ast::Seq>((*it)->location, *it, root)
+                  : *it;
+  EXPECT_GT(ast::topLevel(*root).size(), 400u);
+
+  for (bool rotate : {false, true}) {
+    TextEmitter serial;
+    serial.rotateLoops = rotate;
+    root->emit(serial);
+    for (unsigned workers : {0u, 1u, 2u, 3u, 7u}) {
+      task::ThreadPool pool(workers);
+      for (int run = 0; run < 10; ++run) {
+        emit::StringSink out(64);
+        ast::emitTextParallel(*root, out, pool, rotate);
+        ASSERT_EQ(out.str(), serial.code())
+            << workers << " workers, run " << run;
+      }
+    }
+  }
+}
@@ -0,0 +1,282 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+#include "Cfg.hpp"
+#include "Interp.hpp"
+#include "Liveness.hpp"
+#include "Lower.hpp"
+#include "TestUtil.hpp"
+
+using namespace ir;
+using testutil::readCorpus;
+
+namespace {
+Function compile(const std::string& src) {
+  auto prog = testutil::parse(src);
+  return lower(prog.root, prog.frame);
+}
+
+const symbols::Id& var(const Function& fn, const std::string& name) {
+  for (const auto& id : fn.frame.vars)
+    if (id->name == name) return *id;
+  throw std::runtime_error("no variable " + name);
+}
+}  // namespace
+
+/* Lowering */
+
+TEST(LowerTest, WhileLoopWithArray) {
+  auto fn = compile(
+      "{ int i; int[4] a; i = 0; while (i < 4) { a[i] = i; i = i + 1; } }");
+  EXPECT_EQ(toString(fn),
+            "\ti = 0\n"
+            "L1:\n"
+            "\tif i >= 4 goto L2\n"
+            "\tt1 = i * 4\n"
+            "\ta [ t1 ] = i\n"
+            "\tt2 = i + 1\n"
+            "\ti = t2\n"
+            "\tgoto L1\n"
+            "L2:\n");
+}
+
+TEST(LowerTest, MultiDimensionalOffsetAndConversion) {
+  auto fn = compile("{ float[2][3] m; int i; m[i][2] = i; }");
+  EXPECT_EQ(toString(fn),
+            "\tt1 = i * 24\n"
+            "\tt2 = 2 * 8\n"
+            "\tt3 = t1 + t2\n"
+            "\tt4 = (float) i\n"
+            "\tm [ t3 ] = t4\n");
+}
+
+TEST(LowerTest, FoldedConversionsWrapToTheTargetWidth) {
+  auto fn = compile(
+      "{ char c; char[2] a; int i; c = 200; a[1] = 300; i = 3000000000.0; }");
+  EXPECT_EQ(toString(fn),
+            "\tc = -56\n"
+            "\tt1 = 1 * 1\n"
+            "\ta [ t1 ] = 44\n"
+            "\ti = -1294967296\n");
+}
+
+TEST(LowerTest, DoWhileAndBreak) {
+  auto fn = compile(
+      "{ int n; do { n = n + 1; if (n > 3) break; } while (true); }");
+  EXPECT_EQ(toString(fn),
+            "L1:\n"
+            "\tt1 = n + 1\n"
+            "\tn = t1\n"
+            "\tif n <= 3 goto L3\n"
+            "\tgoto L2\n"
+            "L3:\n"
+            "\tgoto L1\n"
+            "L2:\n");
+}
+
+TEST(LowerTest, ShortCircuitConditions) {
+  auto fn = compile(
+      "{ int[4] a; int i; int n; if (i < 4 && a[i] > 0 || !(n == 2)) n = 1; }");
+  EXPECT_EQ(toString(fn),
+            "\tif i >= 4 goto L3\n"
+            "\tt1 = i * 4\n"
+            "\tt2 = a [ t1 ]\n"
+            "\tif t2 > 0 goto L2\n"
+            "L3:\n"
+            "\tif n == 2 goto L1\n"
+            "L2:\n"
+            "\tn = 1\n"
+            "L1:\n");
+}
+
+TEST(LowerTest, ValueCodeEvaluatesBothOperands) {
+  const char* src = "{ int[4] a; int i; bool b; i = 9; b = i < 4 && a[i] > 0; }";
+  auto fn = compile(src);
+  EXPECT_NO_THROW(Interpreter(fn).run());
+
+  auto prog = testutil::parse(src);
+  LowerOptions opts;
+  opts.jumpingCode = false;
+  auto eager = lower(prog.root, prog.frame, opts);
+  EXPECT_NE(toString(eager).find(" && "), std::string::npos);
+  EXPECT_THROW(Interpreter(eager).run(), std::runtime_error);
+}
+
+TEST(LowerTest, JumpingCodeKeepsCorpusResults) {
+  for (const auto& name : testutil::corpus) {
+    auto prog = testutil::parseCorpus(name);
+    LowerOptions eager;
+    eager.jumpingCode = false;
+    Function slow = lower(prog.root, prog.frame, eager);
+    Function fast = lower(prog.root, prog.frame);
+    Interpreter a(slow), b(fast);
+    EXPECT_EQ(a.run(), b.run()) << name;
+    EXPECT_LE(b.executed, a.executed) << name;
+  }
+}
+
+TEST(LowerTest, FloatConditionsAreNotInverted) {
+  auto fn = compile("{ float x; int n; while (x < 1.0) { x = x + 0.5; } }");
+  auto text = toString(fn);
+  EXPECT_NE(text.find("t1 = x < 1.0"), std::string::npos);
+  EXPECT_NE(text.find("iffalse t1 goto"), std::string::npos);
+}
+
+namespace {
+Function vectorized(const std::string& src) {
+  auto prog = testutil::parse(src);
+  LowerOptions opts;
+  opts.vectorize = true;
+  return lower(prog.root, prog.frame, opts);
+}
+
+uint64_t vectorOps(const Interpreter& in) {
+  uint64_t n = 0;
+  for (size_t op = 0; op < kOpcodeCount; ++op)
+    if (Instr{static_cast<Opcode>(op)}.isVector()) n += in.profile[op];
+  return n;
+}
+}  // namespace
+
+TEST(LowerTest, VectorizesElementwiseLoops) {
+  const char* src =
+      "{ int[10] a; int[10] b; int[10] c; float[10] x; float s; int i;"
+      "  int n;"
+      "  while (i < 10) { b[i] = i; c[i] = 2147483000 + i; i = i + 1; }"
+      "  s = 1.5; i = 0;"
+      "  while (i < 10) {"
+      "    a[i] = b[i] + c[i] * 3; x[i] = -(x[i] + s) / 2; i = i + 1; }"
+      "  n = 9; i = 1;"
+      "  while (i < n) { a[i] = a[i] - b[i]; i = i + 1; } }";
+  auto scalar = compile(src);
+  auto vec = vectorized(src);
+  auto text = toString(vec);
+  EXPECT_NE(text.find("= vload b [ "), std::string::npos);
+  EXPECT_NE(text.find("vstore x [ "), std::string::npos);
+  EXPECT_NE(text.find(" = vsplat 2.0"), std::string::npos);
+  EXPECT_NE(text.find("if i >= 7 goto"), std::string::npos);
+
+  Interpreter a(scalar), b(vec);
+  EXPECT_EQ(a.run(), b.run());
+  // two vector iterations per loop, with two stores in the first
+  EXPECT_EQ(b.profile[static_cast<size_t>(Opcode::VStore)], 2u * 2 + 2);
+  EXPECT_LT(b.executed, a.executed);
+}
+
+TEST(LowerTest, OnlyElementwiseLoopsAreVectorized) {
+  for (const char* src :
+       {"{ int[8] a; int i; i = 1; while (i < 8) { a[i] = a[i - 1] + 1;"
+        "  i = i + 1; } }",
+        "{ int[8] a; int i; while (i < 8) { a[i] = i; i = i + 1; } }",
+        "{ int[8] a; int i; while (i < 8) { a[i] = a[i] / 2; i = i + 1; } }",
+        "{ int[8][8] a; int i; while (i < 8) { a[i][i] = 1; i = i + 1; } }",
+        "{ int[8] a; int i; while (i < 8) { if (i > 2) a[i] = 1;"
+        "  i = i + 1; } }",
+        "{ int[8] a; int i; while (i < 8) { a[i] = 1; i = i + 2; } }",
+        "{ char[8] a; int i; while (i < 8) { a[i] = a[i]; i = i + 1; } }"}) {
+    auto fn = vectorized(src);
+    Interpreter in(fn);
+    in.run();
+    EXPECT_EQ(vectorOps(in), 0u) << src;
+  }
+}
+
+TEST(LowerTest, VectorLoopKeepsBoundsErrors) {
+  auto fn = vectorized(
+      "{ int[3] a; int i; while (i < 5) { a[i] = a[i] + 1; i = i + 1; } }");
+  EXPECT_THROW(Interpreter(fn).run(), std::runtime_error);
+}
+
+/* Interpreter */
+
+TEST(InterpTest, SumCorpusProgram) {
+  auto fn = compile(readCorpus("sum.sc"));
+  Interpreter interp(fn);
+  auto frame = interp.run();
+  EXPECT_EQ(readVar(frame, var(fn, "sum")), 5601);
+  EXPECT_EQ(readVar(frame, var(fn, "i")), 64);
+  EXPECT_GT(interp.executed, 64u * 2);
+}
+
+TEST(InterpTest, FloatArithmeticAndSearch) {
+  auto fn = compile("{ float f; int k; k = 7; f = k / 2 + 0.25; }");
+  auto frame = Interpreter(fn).run();
+  EXPECT_DOUBLE_EQ(readVar(frame, var(fn, "f")), 3.25);
+
+  auto search = compile(readCorpus("search.sc"));
+  auto sframe = Interpreter(search).run();
+  EXPECT_EQ(readVar(sframe, var(search, "hit")), 1);
+  int found = static_cast<int>(readVar(sframe, var(search, "found")));
+  EXPECT_EQ(readVar(sframe, var(search, "data"), found * 4), 42);
+}
+
+TEST(InterpTest, OutOfBoundsAccessThrows) {
+  auto fn = compile("{ int[2] a; int i; i = 2; a[i] = 1; }");
+  EXPECT_THROW(Interpreter(fn).run(), std::runtime_error);
+}
+
+/* CFG, dominators, loops */
+
+TEST(CfgTest, NestedLoopsAreFoundInnermostFirst) {
+  auto fn = compile(readCorpus("matmul.sc"));
+  Cfg cfg(fn);
+  DominatorTree dom(cfg);
+  LoopInfo li(cfg, dom);
+
+  ASSERT_EQ(li.loops.size(), 5u);
+  int maxDepth = 0;
+  for (const Loop& loop : li.loops) {
+    maxDepth = std::max(maxDepth, loop.depth);
+    for (int b : loop.blocks) EXPECT_TRUE(dom.dominates(loop.header, b));
+    EXPECT_FALSE(loop.exits.empty());
+    if (loop.parent >= 0) {
+      EXPECT_TRUE(li.loops[loop.parent].contains(loop.header));
+      EXPECT_EQ(loop.depth, li.loops[loop.parent].depth + 1);
+      EXPECT_LT(&loop, &li.loops[loop.parent]);
+    }
+  }
+  EXPECT_EQ(maxDepth, 3);
+}
+
+TEST(LivenessTest, ValueOfConditionIsLiveAcrossBlocks) {
+  auto fn = compile("{ int x; bool b; b = x < 3 && x > 0; }");
+  Cfg cfg(fn);
+  Liveness live(fn, cfg);
+  ASSERT_EQ(cfg.blocks.size(), 5u);
+
+  // t1 = true / t1 = false in two blocks, read after the join
+  const Instr& last = fn.code.back();
+  ASSERT_TRUE(last.a.isTemp());
+  int t = last.a.temp;
+  EXPECT_TRUE(live.in[0].empty());
+  EXPECT_TRUE(live.liveOut(2, t));
+  EXPECT_TRUE(live.liveOut(3, t));
+  EXPECT_FALSE(live.liveIn(3, t));
+  EXPECT_EQ(live.in[4], std::vector<int>{t});
+  EXPECT_TRUE(live.out[4].empty());
+}
+
+TEST(LivenessTest, LoopCarriedTemporaries) {
+  auto fn = compile("{ int i; float x; while (i < 10) { x = x + 1.5; i = i + 1; } }");
+  // a temporary that is read at the loop head and written at its end
+  Operand t = fn.newTemp(symbols::Type::Int);
+  Instr def{Opcode::Copy, t, Operand::constInt(1, symbols::Type::Int)};
+  fn.code.insert(fn.code.begin(), def);
+  Instr use{Opcode::Add, Operand::variable(&var(fn, "i")),
+            Operand::variable(&var(fn, "i")), t};
+  fn.code.insert(fn.code.end() - 2, use);
+
+  Cfg cfg(fn);
+  DominatorTree dom(cfg);
+  LoopInfo li(cfg, dom);
+  Liveness live(fn, cfg);
+  ASSERT_EQ(li.loops.size(), 1u);
+  for (int b : li.loops[0].blocks) {
+    EXPECT_TRUE(live.liveIn(b, t.temp)) << b;
+    EXPECT_TRUE(live.liveOut(b, t.temp)) << b;
+  }
+  EXPECT_TRUE(live.liveOut(0, t.temp));
+  EXPECT_FALSE(live.liveIn(0, t.temp));
+  EXPECT_FALSE(live.liveIn(static_cast<int>(cfg.blocks.size()) - 1, t.temp));
+}
@@ -59,3 +59,39 @@ TEST(LexerTest, RecognizesIdentifier) {
   EXPECT_EQ(t->tag, Tag::ID);
   EXPECT_EQ(t->lexeme, "hello");
 }
+
+TEST(LexerTest, ResetStartsOverAtLineOne) {
+  std::istringstream input("a\n\nb");
+  Lexer lex(input);
+  lex.scan();
+  EXPECT_GT(lex.scan()->loc.line, 1);
+  EXPECT_EQ(lex.scan()->tag, Tag::END);
+
+  input.clear();
+  input.str("while b");
+  lex.reset();
+  EXPECT_EQ(lex.scan()->tag, Tag::WHILE);
+  sptr<Token> b = lex.scan();
+  EXPECT_EQ(b->tag, Tag::ID);
+  EXPECT_EQ(b->loc.line, 1);
+  EXPECT_EQ(b->loc.column, 7);
+}
+
+TEST(LexerTest, ResetCutsTheTableBackToTheKeywords) {
+  std::string many;
+  for (size_t k = 0; k <= Lexer::kMaxWords; ++k)
+    many += "v" + std::to_string(k) + " ";
+  std::istringstream input(many);
+  Lexer lex(input);
+  size_t keywords = lex.words.size();
+  while (lex.scan()->tag != Tag::END) {
+  }
+  EXPECT_GT(lex.words.size(), Lexer::kMaxWords);
+
+  input.clear();
+  input.str("if x");
+  lex.reset();
+  EXPECT_EQ(lex.words.size(), keywords);
+  EXPECT_EQ(lex.scan()->tag, Tag::IF);
+  EXPECT_EQ(lex.scan()->tag, Tag::ID);
+}
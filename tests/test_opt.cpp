@@ -0,0 +1,848 @@
+#include <gtest/gtest.h>
+
+#include "BoundsCheck.hpp"
+#include "Cfg.hpp"
+#include "Coalesce.hpp"
+#include "DeadCode.hpp"
+#include "EmitStatic.hpp"
+#include "Emitter.h"
+#include "Interp.hpp"
+#include "Layout.hpp"
+#include "Licm.hpp"
+#include "Lower.hpp"
+#include "Parser.hpp"
+#include "PassManager.hpp"
+#include "Peephole.hpp"
+#include "StrengthReduce.hpp"
+#include "TestUtil.hpp"
+#include "Unroll.hpp"
+
+using namespace opt;
+
+using testutil::parse;
+using testutil::readCorpus;
+using testutil::text;
+
+/* Dead code elimination */
+
+TEST(DeadCodeTest, RemovesOverwrittenStore) {
+  auto r = parse("{ int x; int y; x = 1; x = 2; y = x; }");
+  DeadCodeStats st;
+  auto root = eliminateDeadCode(r.root, r.frame, &st);
+
+  EXPECT_EQ(text(root), "x = 2;\ny = x;\n");
+  EXPECT_EQ(st.storesRemoved, 1);
+}
+
+TEST(DeadCodeTest, InnerScopeVariablesDieAtExit) {
+  auto r = parse("{ int x; { int t; t = 5; x = 1; t = x; } }");
+  DeadCodeStats st;
+  auto root = eliminateDeadCode(r.root, r.frame, &st);
+
+  EXPECT_EQ(text(root), "x = 1;\n");
+  EXPECT_EQ(st.storesRemoved, 2);
+  EXPECT_EQ(st.varsRemoved, 1);
+  EXPECT_EQ(st.bytesSaved, 4);
+  ASSERT_EQ(r.frame.vars.size(), 1);
+  EXPECT_EQ(r.frame.size, 4);
+}
+
+TEST(DeadCodeTest, KeepsStoresReadInLaterIterations) {
+  auto r = parse(
+      "{ int s; int i; s = 0; i = 0;"
+      "  while (i < 3) { { int p; s = s + p; p = i; } i = i + 1; } }");
+  auto root = eliminateDeadCode(r.root, r.frame);
+
+  // p is read at the top of the next iteration, so `p = i` stays.
+  EXPECT_NE(text(root).find("p = i;"), std::string::npos);
+}
+
+TEST(DeadCodeTest, DropsCodeAfterBreak) {
+  auto r = parse(
+      "{ int i; i = 0; while (true) { i = i + 1; break; i = 7; i = 8; } }");
+  DeadCodeStats st;
+  auto root = eliminateDeadCode(r.root, r.frame, &st);
+
+  EXPECT_EQ(st.unreachableRemoved, 2);
+  EXPECT_EQ(text(root),
+            "i = 0;\n"
+            "while (true) {\n"
+            "i = i + 1;\n"
+            "break;\n"
+            "}\n");
+}
+
+TEST(DeadCodeTest, ArrayStoreIsDeadOnlyIfArrayIsNeverRead) {
+  auto r = parse(
+      "{ int x; { int[4] a; int[4] b; a[0] = 1; b[1] = 2; x = a[0]; } }");
+  DeadCodeStats st;
+  auto root = eliminateDeadCode(r.root, r.frame, &st);
+
+  EXPECT_EQ(st.storesRemoved, 1);
+  EXPECT_EQ(st.varsRemoved, 1);
+  EXPECT_EQ(r.frame.size, 20);
+  EXPECT_EQ(r.frame.vars[1]->offset, 4);
+}
+
+TEST(DeadCodeTest, RemovedBranchesAndLoopBodiesStillEmit) {
+  // a dead store that is a whole branch or loop body leaves an empty block
+  const std::pair<const char*, const char*> cases[] = {
+      {"{ int x; int i; i = 0;"
+       "  { int y; if (i < 1) y = 1; else x = 2; } }",
+       "i = 0;\nif (i < 1) {\n} else {\nx = 2;\n}\n"},
+      {"{ int x; int i; i = 0;"
+       "  { int y; if (i < 1) x = 1; else y = 2; } }",
+       "i = 0;\nif (i < 1) {\nx = 1;\n} else {\n}\n"},
+      {"{ int i; i = 0; { int y; do y = 3; while (i > 10); } }",
+       "i = 0;\ndo {\n} while (i > 10);\n"},
+      {"{ int i; i = 0; { int y; while (i > 10) y = 3; } }",
+       "i = 0;\nwhile (i > 10) {\n}\n"},
+      {"{ int i; i = 0; { int y; if (i < 1) y = 1; else y = 2; } }",
+       "i = 0;\n"},
+  };
+  for (const auto& [src, expected] : cases) {
+    auto r = parse(src);
+    auto root = eliminateDeadCode(r.root, r.frame);
+    EXPECT_EQ(text(root), expected) << src;
+    emit::TextEmitter em;
+    ast::emitStatic(*root, em);
+    EXPECT_EQ(em.code(), expected) << src;
+  }
+}
+
+TEST(DeadCodeTest, CorpusProgramsKeepTheirResults) {
+  for (const char* name : {"sum.sc", "matmul.sc", "search.sc", "bubble.sc",
+                           "sieve.sc", "scratch.sc"}) {
+    auto r = parse(readCorpus(name));
+    size_t globals = r.frame.globals;
+    DeadCodeStats st;
+    auto root = eliminateDeadCode(r.root, r.frame, &st);
+    ASSERT_NE(root, nullptr) << name;
+    EXPECT_LE(r.frame.globals, globals) << name;
+    EXPECT_GE(st.bytesSaved, 0) << name;
+  }
+}
+
+/* Loop-invariant code motion */
+
+namespace {
+ir::Function lowerSrc(const std::string& src) {
+  auto r = parse(src);
+  return ir::lower(r.root, r.frame);
+}
+
+void expectSameResult(const ir::Function& a, const ir::Function& b) {
+  EXPECT_EQ(ir::Interpreter(a).run(), ir::Interpreter(b).run());
+}
+}  // namespace
+
+TEST(LicmTest, HoistsInvariantArithmeticOutOfNestedLoops) {
+  auto fn = lowerSrc(
+      "{ int i; int j; int k; int s; k = 5; i = 0;"
+      "  while (i < 4) { j = 0;"
+      "    while (j < 4) { s = s + k * 3 + i * 2; j = j + 1; }"
+      "    i = i + 1; } }");
+  auto orig = fn;
+  LicmStats st;
+  EXPECT_TRUE(hoistLoopInvariants(fn, &st));
+
+  // k * 3 leaves both loops (two moves), i * 2 only the inner one
+  EXPECT_EQ(st.hoisted, 3);
+  auto text = ir::toString(fn);
+  EXPECT_LT(text.find("k * 3"), text.find("L1:"));
+  EXPECT_LT(text.find("i * 2"), text.find("L3:"));
+  EXPECT_GT(text.find("i * 2"), text.find("L1:"));
+  expectSameResult(orig, fn);
+
+  ir::Interpreter before(orig), after(fn);
+  before.run();
+  after.run();
+  EXPECT_LT(after.executed, before.executed);
+}
+
+TEST(LicmTest, LoadsStayWhenArrayIsStoredOrMayNotExecute) {
+  // a[0] is written inside the loop; b[k] sits behind the loop test
+  auto fn = lowerSrc(
+      "{ int[4] a; int[4] b; int i; int k; int s; k = 9; i = 5;"
+      "  while (i < 3) { a[0] = a[0] + 1; s = b[k]; i = i + 1; } }");
+  LicmStats st;
+  hoistLoopInvariants(fn, &st);
+  auto text = ir::toString(fn);
+  EXPECT_GT(text.find("a [ 0 ]"), text.find("L1:"));
+  EXPECT_GT(text.find("= b ["), text.find("L1:"));
+  // the loop never runs, so b[9] must not be read
+  EXPECT_NO_THROW(ir::Interpreter(fn).run());
+}
+
+TEST(LicmTest, HoistsLoadsFromDoWhileBody) {
+  auto fn = lowerSrc(
+      "{ int[4] a; int i; int s; a[2] = 7;"
+      "  do { s = s + a[2]; i = i + 1; } while (i < 5); }");
+  auto orig = fn;
+  LicmStats st;
+  hoistLoopInvariants(fn, &st);
+  auto text = ir::toString(fn);
+  EXPECT_LT(text.find("= a ["), text.find("L1:"));
+  expectSameResult(orig, fn);
+}
+
+TEST(LicmTest, CorpusProgramsKeepTheirResults) {
+  for (const char* name : {"sum.sc", "matmul.sc", "search.sc", "bubble.sc",
+                           "sieve.sc", "scratch.sc", "nested.sc"}) {
+    auto fn = lowerSrc(readCorpus(name));
+    auto orig = fn;
+    hoistLoopInvariants(fn);
+    expectSameResult(orig, fn);
+  }
+}
+
+/* Strength reduction */
+
+namespace {
+uint64_t multiplies(const ir::Function& fn) {
+  ir::Interpreter in(fn);
+  in.run();
+  return in.profile[static_cast<size_t>(ir::Opcode::Mul)];
+}
+}  // namespace
+
+TEST(StrengthTest, ArrayIndexBecomesRunningOffset) {
+  auto fn = lowerSrc(
+      "{ int[8] a; int i; i = 0; while (i < 8) { a[i] = i; i = i + 1; } }");
+  auto orig = fn;
+  StrengthStats st;
+  EXPECT_TRUE(reduceStrength(fn, &st));
+  EXPECT_EQ(st.inductionVars, 1);
+  EXPECT_EQ(st.reduced, 1);
+  EXPECT_EQ(ir::toString(fn),
+            "\ti = 0\n"
+            "\tt3 = i * 4\n"
+            "L1:\n"
+            "\tif i >= 8 goto L2\n"
+            "\ta [ t3 ] = i\n"
+            "\tt2 = i + 1\n"
+            "\ti = t2\n"
+            "\tt3 = t3 + 4\n"
+            "\tgoto L1\n"
+            "L2:\n");
+  expectSameResult(orig, fn);
+  EXPECT_EQ(multiplies(orig), 8u);
+  EXPECT_EQ(multiplies(fn), 1u);
+}
+
+TEST(StrengthTest, MatrixOffsetsAfterLicm) {
+  auto fn = lowerSrc(readCorpus("matmul.sc"));
+  hoistLoopInvariants(fn);
+  auto orig = fn;
+  StrengthStats st;
+  reduceStrength(fn, &st);
+  EXPECT_GT(st.reduced, 0);
+  EXPECT_GT(st.removed, 0);
+  expectSameResult(orig, fn);
+  EXPECT_LT(multiplies(fn) * 2, multiplies(orig));
+}
+
+TEST(StrengthTest, DecrementingDoWhileAndSharedOffsets) {
+  // a[i] is read and written: both offsets share one running temporary
+  auto fn = lowerSrc(
+      "{ int[6] a; int i; i = 5;"
+      "  do { a[i] = a[i] + i; i = i - 1; } while (i >= 0); }");
+  auto orig = fn;
+  StrengthStats st;
+  reduceStrength(fn, &st);
+  EXPECT_EQ(st.reduced, 2);
+  auto text = ir::toString(fn);
+  EXPECT_NE(text.find(" - 4\n"), std::string::npos);
+  EXPECT_EQ(text.find("* 4", text.find("L1:")), std::string::npos);
+  expectSameResult(orig, fn);
+}
+
+TEST(StrengthTest, VariableWrittenTwiceIsNotAnInductionVariable) {
+  auto fn = lowerSrc(
+      "{ int[16] a; int i; i = 0;"
+      "  while (i < 15) { a[i] = 1; if (a[0] > 0) i = i + 2; else i = i + 1; }"
+      "}");
+  EXPECT_FALSE(reduceStrength(fn));
+}
+
+TEST(StrengthTest, CorpusProgramsKeepTheirResults) {
+  for (const char* name : {"sum.sc", "matmul.sc", "search.sc", "bubble.sc",
+                           "sieve.sc", "scratch.sc", "nested.sc"}) {
+    auto fn = lowerSrc(readCorpus(name));
+    auto orig = fn;
+    hoistLoopInvariants(fn);
+    reduceStrength(fn);
+    expectSameResult(orig, fn);
+    EXPECT_LE(multiplies(fn), multiplies(orig)) << name;
+  }
+}
+
+/* Bounds check elimination */
+
+namespace {
+ir::Function lowerChecked(const std::string& src) {
+  auto r = parse(src);
+  ir::LowerOptions opts;
+  opts.boundsChecks = true;
+  return ir::lower(r.root, r.frame, opts);
+}
+
+uint64_t checksRun(const ir::Function& fn) {
+  ir::Interpreter in(fn);
+  in.run();
+  return in.profile[static_cast<size_t>(ir::Opcode::Check)];
+}
+}  // namespace
+
+TEST(BoundsTest, LoopIndexWithinConstantBound) {
+  auto fn = lowerChecked(
+      "{ int[8] a; int[4][8] m; int i; int j; i = 0;"
+      "  while (i < 4) { j = 7;"
+      "    do { m[i][j] = a[j] + a[7 - j]; j = j - 1; } while (j >= 0);"
+      "    i = i + 1; } }");
+  auto orig = fn;
+  BoundsStats st;
+  EXPECT_TRUE(eliminateBoundsChecks(fn, &st));
+  EXPECT_EQ(st.checks, 4);
+  EXPECT_EQ(st.eliminated, 4);
+  EXPECT_EQ(ir::toString(fn).find("check"), std::string::npos);
+  expectSameResult(orig, fn);
+}
+
+TEST(BoundsTest, OffByOneKeepsTheCheck) {
+  auto fn = lowerChecked(
+      "{ int[8] a; int i; while (i <= 8) { a[i] = 1; i = i + 1; } }");
+  BoundsStats st;
+  EXPECT_FALSE(eliminateBoundsChecks(fn, &st));
+  EXPECT_EQ(st.checks, 1);
+  EXPECT_THROW(ir::Interpreter(fn).run(), std::runtime_error);
+}
+
+TEST(BoundsTest, InvariantIndexIsHoistedUnknownBoundStays) {
+  auto fn = lowerChecked(
+      "{ int[8] a; int[8] b; int i; int n; int k; n = b[0] + 5; k = b[1];"
+      "  do { a[i] = b[k]; i = i + 1; } while (i < n); }");
+  auto orig = fn;
+  BoundsStats st;
+  eliminateBoundsChecks(fn, &st);
+  EXPECT_EQ(st.eliminated, 2);
+  EXPECT_EQ(st.hoisted, 1);
+  auto text = ir::toString(fn);
+  EXPECT_LT(text.find("check 0 <= k < 8"), text.find("L1:"));
+  EXPECT_GT(text.find("check 0 <= i < 8"), text.find("L1:"));
+  expectSameResult(orig, fn);
+  EXPECT_EQ(checksRun(fn), 6u);
+}
+
+TEST(BoundsTest, HoistsFromSiblingLoopsAndOutOfNests) {
+  auto fn = lowerChecked(
+      "{ int[8] a; int[8] b; int i; int j; int n; int k; int m;"
+      "  n = b[0] + 5; k = b[1]; m = b[2];"
+      "  do { a[i] = b[k]; i = i + 1; } while (i < n);"
+      "  do { j = 0; do { a[j] = b[m]; j = j + 1; } while (j < n);"
+      "    i = i + 1; } while (i < n); }");
+  auto orig = fn;
+  BoundsStats st;
+  eliminateBoundsChecks(fn, &st);
+  EXPECT_EQ(st.hoisted, 3);
+  expectSameResult(orig, fn);
+  EXPECT_EQ(checksRun(fn), 7u);
+}
+
+TEST(BoundsTest, CorpusChecksAreAllProven) {
+  for (const auto& name : testutil::corpus) {
+    auto fn = lowerChecked(readCorpus(name));
+    auto orig = fn;
+    BoundsStats st;
+    eliminateBoundsChecks(fn, &st);
+    EXPECT_EQ(st.eliminated, st.checks) << name;
+    expectSameResult(orig, fn);
+    EXPECT_EQ(checksRun(fn), 0u) << name;
+  }
+}
+
+/* Peephole */
+
+namespace {
+size_t ruleIndex(const Peephole& ph, const std::string& name) {
+  for (size_t i = 0; i < ph.rules().size(); ++i)
+    if (name == ph.rules()[i].name) return i;
+  throw std::runtime_error("no rule " + name);
+}
+}  // namespace
+
+TEST(PeepholeTest, FoldsTemporariesIntoTheirDestination) {
+  auto fn = lowerSrc("{ int x; int y; x = y + 1; y = x * 2; x = 3 * 4; }");
+  auto orig = fn;
+  Peephole ph;
+  EXPECT_EQ(ph.run(fn), 3);
+  EXPECT_EQ(ir::toString(fn),
+            "\tx = y + 1\n"
+            "\ty = x * 2\n"
+            "\tx = 12\n");
+  EXPECT_EQ(ph.hits[ruleIndex(ph, "fold-temp")], 2u);
+  EXPECT_EQ(ph.hits[ruleIndex(ph, "forward-copy")], 1u);
+  EXPECT_EQ(ph.hits[ruleIndex(ph, "fold-constants")], 1u);
+  expectSameResult(orig, fn);
+}
+
+TEST(PeepholeTest, ForwardsStoredValues) {
+  auto fn = lowerSrc("{ int[4] a; int x; int y; x = 5; y = x; a[2] = y; y = a[2]; }");
+  auto orig = fn;
+  Peephole ph;
+  ph.run(fn);
+  EXPECT_EQ(ir::toString(fn),
+            "\tx = 5\n"
+            "\ty = 5\n"
+            "\ta [ 8 ] = 5\n"
+            "\ty = 5\n");
+  EXPECT_GT(ph.hits[ruleIndex(ph, "store-reload")], 0u);
+  EXPECT_EQ(ph.hits[ruleIndex(ph, "store-reload-element")], 1u);
+  expectSameResult(orig, fn);
+}
+
+TEST(PeepholeTest, NarrowsValuesForwardedThroughCharStores) {
+  auto fn = lowerSrc(
+      "{ char d; int y; char[2] c; int x;"
+      "  d = 200; y = d; c[0] = 300; x = c[0]; }");
+  auto orig = fn;
+  Peephole().run(fn);
+  auto frame = ir::Interpreter(fn).run();
+  EXPECT_EQ(ir::readVar(frame, *fn.frame.vars[1]), -56);
+  EXPECT_EQ(ir::readVar(frame, *fn.frame.vars[3]), 44);
+  expectSameResult(orig, fn);
+}
+
+TEST(PeepholeTest, BranchesOnComparisonsDirectly) {
+  auto r = parse(
+      "{ int i; int n; float x; while (i < 4) i = i + 1;"
+      "  if (x < 1.0) n = 1; }");
+  ir::LowerOptions eager;
+  eager.jumpingCode = false;
+  auto fn = ir::lower(r.root, r.frame, eager);
+  Peephole ph(selectPeepholeRules("bool-branch"));
+  ph.run(fn);
+  auto text = ir::toString(fn);
+  EXPECT_NE(text.find("if i >= 4 goto L2"), std::string::npos);
+  // the float test cannot be inverted
+  EXPECT_NE(text.find("iffalse t"), std::string::npos);
+  EXPECT_EQ(ph.hits[0], 1u);
+}
+
+TEST(PeepholeTest, JumpRulesAndRuleSelection) {
+  ir::Function fn;
+  auto id = std::make_shared<symbols::Id>("n", symbols::Type::Int, 0);
+  fn.frame.vars.push_back(id);
+  fn.frame.size = 4;
+  ir::Operand n = ir::Operand::variable(id.get());
+  ir::Operand t = fn.newTemp(symbols::Type::Int);
+  auto jump = [](ir::Opcode op, int l, ir::Operand a = {}, ir::Operand b = {}) {
+    ir::Instr in{op, ir::Operand(), a, b};
+    in.label = l;
+    return in;
+  };
+  auto label = [](int l) {
+    ir::Instr in{ir::Opcode::Label};
+    in.label = l;
+    return in;
+  };
+  fn.numLabels = 3;
+  fn.code = {
+      {ir::Opcode::Sub, t, n, ir::Operand::constInt(3, symbols::Type::Int)},
+      jump(ir::Opcode::JumpEq, 1, t, ir::Operand::constInt(0, symbols::Type::Int)),
+      jump(ir::Opcode::Jump, 2),
+      label(1),
+      {ir::Opcode::Copy, n, ir::Operand::constInt(7, symbols::Type::Int)},
+      jump(ir::Opcode::Jump, 3),
+      label(3),
+      label(2),
+  };
+  auto orig = fn;
+
+  Peephole ph(selectPeepholeRules("cmp-zero-after-sub,jump-to-next,branch-over-jump"));
+  EXPECT_EQ(ph.run(fn), 3);
+  EXPECT_EQ(ir::toString(fn),
+            "\tif n != 3 goto L2\n"
+            "L1:\n"
+            "\tn = 7\n"
+            "L3:\n"
+            "L2:\n");
+  EXPECT_EQ(ph.hits, (std::vector<uint64_t>{1, 1, 1}));
+  expectSameResult(orig, fn);
+
+  EXPECT_EQ(selectPeepholeRules("all").size(), peepholeRules().size());
+  EXPECT_THROW(selectPeepholeRules("no-such-rule"), std::runtime_error);
+}
+
+TEST(PeepholeTest, CorpusProgramsKeepTheirResults) {
+  for (const auto& name : testutil::corpus) {
+    auto fn = lowerSrc(readCorpus(name));
+    hoistLoopInvariants(fn);
+    reduceStrength(fn);
+    auto orig = fn;
+    Peephole().run(fn);
+    expectSameResult(orig, fn);
+    EXPECT_LT(fn.code.size(), orig.code.size()) << name;
+  }
+}
+
+/* Loop unrolling */
+
+namespace {
+uint64_t branchesRun(const ir::Function& fn) {
+  ir::Interpreter in(fn);
+  in.run();
+  return in.branches;
+}
+}  // namespace
+
+TEST(UnrollTest, FullyUnrollsSmallWhileAndDoLoops) {
+  auto fn = lowerSrc(
+      "{ int[8] a; int i; int s; i = 0;"
+      "  while (i < 8) { a[i] = i * 3; i = i + 1; }"
+      "  i = 7; do { s = s + a[i]; i = i - 1; } while (i >= 0); }");
+  auto orig = fn;
+  UnrollStats st;
+  EXPECT_TRUE(unrollLoops(fn, {}, &st));
+  EXPECT_EQ(st.counted, 2);
+  EXPECT_EQ(st.full, 2);
+  EXPECT_EQ(branchesRun(fn), 0u);
+  expectSameResult(orig, fn);
+
+  ir::Cfg cfg(fn);
+  ir::DominatorTree dom(cfg);
+  EXPECT_TRUE(ir::LoopInfo(cfg, dom).loops.empty());
+}
+
+TEST(UnrollTest, PartialUnrollPeelsTheRemainder) {
+  for (const char* src :
+       {"{ int[50] a; int i; while (i < 50) { a[i] = i; i = i + 1; } }",
+        "{ int[51] a; int i; i = 1; do { a[i] = a[i - 1] + i; i = i + 1; }"
+        "  while (i <= 50); }",
+        "{ int[99] a; int i; int n; n = 2; i = 98;"
+        "  while (i != n) { a[i] = i; i = i - 2; } }"}) {
+    auto fn = lowerSrc(src);
+    auto orig = fn;
+    UnrollStats st;
+    UnrollOptions opts;
+    opts.maxFullSize = 16;
+    EXPECT_TRUE(unrollLoops(fn, opts, &st)) << src;
+    EXPECT_EQ(st.partial, 1) << src;
+    expectSameResult(orig, fn);
+    EXPECT_LT(branchesRun(fn), branchesRun(orig) / 3) << src;
+  }
+}
+
+TEST(UnrollTest, ValueConditionsAndNestedLoops) {
+  auto r = parse(
+      "{ int[4][4] m; int i; int j; i = 0;"
+      "  while (i < 4) { j = 0;"
+      "    while (j < 4) { if (i == j) m[i][j] = 1; j = j + 1; }"
+      "    i = i + 1; } }");
+  ir::LowerOptions value;
+  value.jumpingCode = false;
+  for (const auto& fn0 : {ir::lower(r.root, r.frame),
+                          ir::lower(r.root, r.frame, value)}) {
+    // the inner loop goes first, then the outer one holding its copies
+    auto fn = fn0;
+    UnrollStats st;
+    unrollLoops(fn, {}, &st);
+    EXPECT_EQ(st.full, 1);
+    expectSameResult(fn0, fn);
+
+    fn = fn0;
+    UnrollOptions opts;
+    opts.maxFullSize = 1000;
+    unrollLoops(fn, opts, &st);
+    EXPECT_EQ(st.full, 3);
+    EXPECT_EQ(branchesRun(fn), 16u);
+    expectSameResult(fn0, fn);
+  }
+}
+
+TEST(UnrollTest, LeavesUnknownTripCountsAlone) {
+  for (const char* src :
+       {// bound read from memory
+        "{ int[8] a; int i; a[0] = 5; while (i < a[0]) i = i + 1; }",
+        // counter advanced on one path only
+        "{ int[8] a; int i; while (i < 8) { if (a[i] > 0) i = i + 1; "
+        "  a[i] = 1; } }",
+        // second exit
+        "{ int i; while (i < 8) { if (i == 3) break; i = i + 1; } }",
+        // wraps around
+        "{ int i; i = 2147483600; while (i > 0) i = i + 100; }"}) {
+    auto fn = lowerSrc(src);
+    UnrollStats st;
+    EXPECT_FALSE(unrollLoops(fn, {}, &st)) << src;
+    EXPECT_EQ(st.counted, 0) << src;
+  }
+}
+
+TEST(UnrollTest, CorpusProgramsKeepTheirResults) {
+  for (const auto& name : testutil::corpus) {
+    auto fn = lowerSrc(readCorpus(name));
+    auto orig = fn;
+    hoistLoopInvariants(fn);
+    reduceStrength(fn);
+    unrollLoops(fn);
+    Peephole().run(fn);
+    expectSameResult(orig, fn);
+    EXPECT_LE(branchesRun(fn), branchesRun(orig)) << name;
+  }
+}
+
+/* Loop rotation and block layout */
+
+namespace {
+uint64_t takenRun(const ir::Function& fn) {
+  ir::Interpreter in(fn);
+  in.run();
+  return in.taken;
+}
+}  // namespace
+
+TEST(LayoutTest, RotatesWhileIntoGuardedBottomTest) {
+  auto fn = lowerSrc(
+      "{ int[8] a; int i; while (i < 8) { a[i] = i; i = i + 1; } }");
+  auto orig = fn;
+  LayoutStats st;
+  EXPECT_TRUE(rotateLoops(fn, &st));
+  EXPECT_EQ(st.rotated, 1);
+  expectSameResult(orig, fn);
+  // guard plus one test per iteration, instead of test and goto
+  EXPECT_EQ(branchesRun(orig), 17u);
+  EXPECT_EQ(branchesRun(fn), 9u);
+  EXPECT_FALSE(rotateLoops(fn, &st));
+
+  // the rotated loop still has a known trip count
+  UnrollStats us;
+  EXPECT_TRUE(unrollLoops(fn, {}, &us));
+  EXPECT_EQ(us.full, 1);
+  expectSameResult(orig, fn);
+
+  auto r = parse("{ int i; while (i < 3) i = i + 1; }");
+  emit::TextEmitter em;
+  em.rotateLoops = true;
+  r.root->emit(em);
+  EXPECT_EQ(em.code(),
+            "if (i < 3) {\n"
+            "do {\n"
+            "i = i + 1;\n"
+            "} while (i < 3);\n"
+            "}\n");
+}
+
+TEST(LayoutTest, NestedLoopsAndLongHeaders) {
+  auto fn = lowerSrc(
+      "{ int[4][4] m; int i; int j; int s;"
+      "  while (i < 4) { j = 0; while (j < 4) { m[i][j] = i + j; j = j + 1; }"
+      "    i = i + 1; }"
+      "  i = 0;"
+      "  while (i * 3 + i * 5 + i * 7 + i * 9 + i * 11 + i * 13 + i * 15 < 999)"
+      "    i = i + 1; }");
+  auto orig = fn;
+  LayoutStats st;
+  rotateLoops(fn, &st);
+  EXPECT_EQ(st.rotated, 2);
+  expectSameResult(orig, fn);
+  EXPECT_LT(branchesRun(fn), branchesRun(orig));
+}
+
+TEST(LayoutTest, BreakPathsMoveBehindTheLoop) {
+  auto fn = lowerSrc(
+      "{ int[8] a; int i; int s;"
+      "  while (i < 8) { if (a[i] == 3) break; s = s + a[i]; i = i + 1; } }");
+  auto orig = fn;
+  LayoutStats st;
+  rotateLoops(fn, &st);
+
+  ir::Cfg cfg(fn);
+  ir::DominatorTree dom(cfg);
+  ir::LoopInfo li(cfg, dom);
+  BranchWeights w(fn, cfg, dom, li);
+  ASSERT_EQ(li.loops.size(), 1u);
+  const ir::Loop& loop = li.loops[0];
+  EXPECT_DOUBLE_EQ(w.taken[loop.latches[0]], 0.9);
+  EXPECT_EQ(std::count(w.cold.begin(), w.cold.end(), 1), 1);
+
+  EXPECT_TRUE(layoutBlocks(fn, &st));
+  EXPECT_EQ(st.cold, 1);
+  EXPECT_EQ(st.inverted, 1);
+  expectSameResult(orig, fn);
+  // the `break` is now the only jump at the end of the code
+  ASSERT_GE(fn.code.size(), 3u);
+  EXPECT_EQ(fn.code[fn.code.size() - 2].op, ir::Opcode::Jump);
+  EXPECT_LT(takenRun(fn), takenRun(orig));
+
+  ir::Function empty;
+  EXPECT_FALSE(layoutBlocks(empty));
+}
+
+TEST(LayoutTest, CorpusProgramsKeepTheirResults) {
+  for (const auto& name : testutil::corpus) {
+    auto fn = lowerSrc(readCorpus(name));
+    auto orig = fn;
+    LayoutStats st;
+    EXPECT_TRUE(rotateLoops(fn, &st)) << name;
+    layoutBlocks(fn, &st);
+    expectSameResult(orig, fn);
+    EXPECT_LT(branchesRun(fn), branchesRun(orig)) << name;
+    EXPECT_LE(takenRun(fn), takenRun(orig)) << name;
+
+    fn = orig;
+    rotateLoops(fn);
+    hoistLoopInvariants(fn);
+    reduceStrength(fn);
+    unrollLoops(fn);
+    Peephole().run(fn);
+    layoutBlocks(fn);
+    expectSameResult(orig, fn);
+  }
+}
+
+/* Copy propagation and temporary coalescing */
+
+TEST(CoalesceTest, PropagatesCopiesThroughTemporaries) {
+  ir::Function fn;
+  auto idx = std::make_shared<symbols::Id>("x", symbols::Type::Int, 0);
+  auto idy = std::make_shared<symbols::Id>("y", symbols::Type::Int, 4);
+  fn.frame.vars = {idx, idy};
+  fn.frame.size = 8;
+  ir::Operand x = ir::Operand::variable(idx.get());
+  ir::Operand y = ir::Operand::variable(idy.get());
+  auto num = [](int v) { return ir::Operand::constInt(v, symbols::Type::Int); };
+  ir::Operand t1 = fn.newTemp(symbols::Type::Int);
+  ir::Operand t2 = fn.newTemp(symbols::Type::Int);
+  ir::Operand t3 = fn.newTemp(symbols::Type::Int);
+  ir::Operand t4 = fn.newTemp(symbols::Type::Int);
+  ir::Operand t5 = fn.newTemp(symbols::Type::Int);
+  fn.code = {
+      {ir::Opcode::Copy, x, num(4)},
+      {ir::Opcode::Copy, t1, x},
+      {ir::Opcode::Add, t2, t1, num(1)},
+      {ir::Opcode::Copy, y, t2},
+      {ir::Opcode::Copy, t3, num(5)},
+      {ir::Opcode::Mul, t4, t3, y},
+      {ir::Opcode::Copy, x, t4},
+      // x changes before t5 is read, so t5 keeps the old value
+      {ir::Opcode::Copy, t5, x},
+      {ir::Opcode::Copy, x, num(2)},
+      {ir::Opcode::Copy, y, t5},
+  };
+  auto orig = fn;
+  CoalesceStats st;
+  EXPECT_TRUE(propagateCopies(fn, &st));
+  EXPECT_EQ(ir::toString(fn),
+            "\tx = 4\n"
+            "\ty = x + 1\n"
+            "\tx = 5 * y\n"
+            "\ty = x\n"
+            "\tx = 2\n");
+  EXPECT_EQ(st.propagated, 2);
+  EXPECT_EQ(st.retargeted, 3);
+  expectSameResult(orig, fn);
+  EXPECT_FALSE(propagateCopies(fn));
+}
+
+TEST(CoalesceTest, TemporariesShareSlotsWhenNotLiveTogether) {
+  auto fn = lowerSrc(
+      "{ int[8] a; float[8] f; int i; while (i < 8) {"
+      "    a[i] = i * i + 1; f[i] = i * 0.5 + f[i]; i = i + 1; } }");
+  auto orig = fn;
+  CoalesceStats st;
+  EXPECT_TRUE(coalesceTemps(fn, &st));
+  EXPECT_EQ(st.tempsBefore, orig.numTemps);
+  EXPECT_EQ(st.tempsAfter, fn.numTemps);
+  // one int and one float slot for the expression, one int for the offset
+  EXPECT_LE(fn.numTemps, 4);
+  EXPECT_LT(st.bytesAfter, st.bytesBefore);
+  expectSameResult(orig, fn);
+
+  // a temporary hoisted out of the loop stays live through all of it
+  fn = orig;
+  hoistLoopInvariants(fn);
+  auto hoisted = fn;
+  coalesceTemps(fn);
+  expectSameResult(hoisted, fn);
+
+  ir::Function empty;
+  EXPECT_FALSE(coalesceTemps(empty));
+}
+
+TEST(CoalesceTest, CorpusProgramsKeepTheirResults) {
+  for (const auto& name : testutil::corpus) {
+    auto fn = lowerSrc(readCorpus(name));
+    auto orig = fn;
+    rotateLoops(fn);
+    hoistLoopInvariants(fn);
+    reduceStrength(fn);
+    Peephole().run(fn);
+    CoalesceStats st;
+    propagateCopies(fn, &st);
+    coalesceTemps(fn, &st);
+    layoutBlocks(fn);
+    expectSameResult(orig, fn);
+    EXPECT_LE(st.tempsAfter, st.tempsBefore) << name;
+    EXPECT_LE(st.bytesAfter, st.bytesBefore) << name;
+    EXPECT_EQ(fn.numTemps, st.tempsAfter) << name;
+  }
+}
+
+TEST(PassManagerTest, ParsesPipelines) {
+  auto passes = parsePipeline("cfg,peephole,,peephole,layout");
+  ASSERT_EQ(passes.size(), 4u);
+  EXPECT_STREQ(passes[0].name, "cfg");
+  EXPECT_STREQ(passes[2].name, "peephole");
+  EXPECT_TRUE(parsePipeline("").empty());
+  EXPECT_THROW(parsePipeline("licm,nosuchpass"), std::runtime_error);
+  EXPECT_THROW(PassManager("cfg,LICM"), std::runtime_error);
+  EXPECT_NO_THROW(PassManager{});
+}
+
+TEST(PassManagerTest, CachesAnalysesUntilTheCodeChanges) {
+  auto fn = lowerSrc("{ int i; int s; while (i < 10) { s = s + i; i = i + 1; } }");
+  AnalysisCache cache(fn);
+  const ir::Cfg* g = &cache.cfg();
+  cache.loops();
+  cache.liveness();
+  EXPECT_EQ(cache.built, 4);  // cfg, dominators, loops, liveness
+  EXPECT_EQ(&cache.cfg(), g);
+  EXPECT_EQ(cache.built, 4);
+  EXPECT_EQ(cache.reused, 0);  // built in this pass
+  cache.nextPass();
+  cache.loops();
+  EXPECT_EQ(cache.reused, 1);  // not counting the cfg and dominators
+  cache.invalidate();
+  cache.dominators();
+  EXPECT_EQ(cache.built, 6);
+
+  // layout after analyses reuses them; rotate invalidates them when it
+  // changes the code and leaves the ones its last round built
+  PassManager pm("cfg,domtree,loops,layout,rotate,layout");
+  pm.run(fn);
+  const auto& rec = pm.records();
+  ASSERT_EQ(rec.size(), 6u);
+  EXPECT_EQ(rec[3].built, 0);
+  EXPECT_EQ(rec[3].reused, 3);
+  EXPECT_EQ(rec[4].changed, 1);
+  EXPECT_EQ(rec[4].reused, 2);  // cfg and loops
+  EXPECT_EQ(rec[4].built, 3);
+  EXPECT_EQ(rec[5].built, 0);
+  EXPECT_EQ(rec[5].reused, 3);
+  EXPECT_EQ(rec[4].instrsAfter, rec[5].instrsBefore);
+}
+
+TEST(PassManagerTest, DefaultPipelineKeepsCorpusResults) {
+  PassManager pm;
+  for (const auto& name : testutil::corpus) {
+    auto fn = lowerSrc(readCorpus(name));
+    auto orig = fn;
+    pm.run(fn);
+    expectSameResult(orig, fn);
+  }
+  for (const PassRecord& r : pm.records()) EXPECT_EQ(r.runs, 8) << r.name;
+  std::string report = pm.report();
+  for (const Pass& p : pm.passes())
+    EXPECT_NE(report.find(p.name), std::string::npos) << p.name;
+  EXPECT_NE(report.find("Total"), std::string::npos);
+}
@@ -0,0 +1,100 @@
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+#include "Parser.hpp"
+#include "TestUtil.hpp"
+
+using namespace parser;
+using testutil::parse;
+using testutil::text;
+
+TEST(ParserTest, DeclsAllocateFrameSlots) {
+  auto r = parse("{ int x; float y; bool[3] b; { char c; } }");
+
+  ASSERT_EQ(r.frame.vars.size(), 4);
+  EXPECT_EQ(r.frame.globals, 3);
+  EXPECT_EQ(r.frame.vars[0]->offset, 0);
+  EXPECT_EQ(r.frame.vars[1]->offset, 4);
+  EXPECT_EQ(r.frame.vars[2]->offset, 12);
+  EXPECT_EQ(r.frame.vars[3]->offset, 15);
+  EXPECT_EQ(r.frame.size, 16);
+}
+
+TEST(ParserTest, BuildsStatements) {
+  auto r = parse(
+      "{ int i; i = 0;"
+      "  while (i < 4) { if (i == 2) break; i = i + 1; } }");
+
+  EXPECT_EQ(text(r.root),
+            "i = 0;\n"
+            "while (i < 4) {\n"
+            "if (i == 2) {\n"
+            "break;\n"
+            "}\n"
+            "i = i + 1;\n"
+            "}\n");
+}
+
+TEST(ParserTest, InitializerBecomesAssignment) {
+  auto r = parse("{ int x = 3; x = -x; }");
+  EXPECT_EQ(text(r.root), "x = 3;\nx = -x;\n");
+}
+
+TEST(ParserTest, MultiDimensionalAccess) {
+  auto r = parse("{ int[2][3] m; m[1][2] = 5; }");
+  auto set = std::dynamic_pointer_cast<ast::SetElem>(r.root);
+  ASSERT_NE(set, nullptr);
+  auto outer = std::dynamic_pointer_cast<ast::Access>(set->arrayAccess);
+  ASSERT_NE(outer, nullptr);
+  EXPECT_EQ(outer->exprType, symbols::Type::Int);
+  EXPECT_NE(std::dynamic_pointer_cast<ast::Access>(outer->array), nullptr);
+}
+
+TEST(ParserTest, DoWhileAndElse) {
+  auto r = parse(
+      "{ int n; n = 0; do { if (n > 2) n = n + 2; else n = n + 1; }"
+      " while (n < 10); }");
+  EXPECT_EQ(text(r.root),
+            "n = 0;\n"
+            "do {\n"
+            "if (n > 2) {\n"
+            "n = n + 2;\n"
+            "} else {\n"
+            "n = n + 1;\n"
+            "}\n"
+            "} while (n < 10);\n");
+}
+
+TEST(ParserTest, RejectsUnenclosedBreak) {
+  EXPECT_THROW(parse("{ break; }"), std::runtime_error);
+}
+
+TEST(ParserTest, RejectsBadAssignment) {
+  EXPECT_THROW(parse("{ int x; bool b; x = b; }"), std::runtime_error);
+  EXPECT_THROW(parse("{ int[2] a; int[2] c; a = c; }"), std::runtime_error);
+}
+
+TEST(ParserTest, ResetParsesTheNextProgram) {
+  std::istringstream in("{ int x; { int y; x = ");
+  auto lex = std::make_shared<lexer::Lexer>(in);
+  Parser p(lex);
+  EXPECT_THROW(p.program(), std::runtime_error);
+
+  // y was declared in a block the failed parse never closed
+  in.clear();
+  in.str("{ float y; y = 1.5; }");
+  lex->reset();
+  p.reset();
+  auto root = p.program();
+  EXPECT_EQ(text(root), "y = 1.500000;\n");
+  ASSERT_EQ(p.layout().vars.size(), 1u);
+  EXPECT_EQ(p.layout().size, 8);
+  EXPECT_EQ(p.layout().globals, 1u);
+
+  in.clear();
+  in.str("{ x = 1; }");
+  lex->reset();
+  p.reset();
+  EXPECT_THROW(p.program(), std::runtime_error);
+}
@@ -0,0 +1,63 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "ThreadPool.hpp"
+
+using task::ThreadPool;
+
+TEST(ThreadPoolTest, RunsEveryIndexOnce) {
+  for (unsigned workers : {0u, 1u, 4u}) {
+    ThreadPool pool(workers);
+    std::vector<std::atomic<int>> hits(1000);
+    pool.parallelFor(hits.size(), [&](size_t k) { ++hits[k]; });
+    for (size_t k = 0; k < hits.size(); ++k)
+      ASSERT_EQ(hits[k].load(), 1) << workers << " workers, index " << k;
+  }
+}
+
+TEST(ThreadPoolTest, SpreadsWorkOverThreads) {
+  ThreadPool pool(3);
+  std::mutex mutex;
+  std::vector<std::thread::id> seen;
+  pool.parallelFor(64, [&](size_t) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    std::lock_guard<std::mutex> lock(mutex);
+    if (std::find(seen.begin(), seen.end(), std::this_thread::get_id()) ==
+        seen.end())
+      seen.push_back(std::this_thread::get_id());
+  });
+  EXPECT_GT(seen.size(), 1u);
+}
+
+TEST(ThreadPoolTest, NestedCallsFinish) {
+  ThreadPool pool(2);
+  std::atomic<int> sum{0};
+  pool.parallelFor(8, [&](size_t k) {
+    pool.parallelFor(8, [&](size_t j) { sum += static_cast<int>(k * j); });
+  });
+  EXPECT_EQ(sum.load(), 28 * 28);
+}
+
+TEST(ThreadPoolTest, RethrowsAfterAllCallsReturn) {
+  ThreadPool pool(2);
+  std::atomic<int> ran{0};
+  EXPECT_THROW(pool.parallelFor(100,
+                                [&](size_t k) {
+                                  ++ran;
+                                  if (k % 10 == 3)
+                                    throw std::runtime_error("boom");
+                                }),
+               std::runtime_error);
+  EXPECT_EQ(ran.load(), 100);
+  // the pool is still usable
+  std::atomic<int> again{0};
+  pool.parallelFor(10, [&](size_t) { ++again; });
+  EXPECT_EQ(again.load(), 10);
+}
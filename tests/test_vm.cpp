@@ -0,0 +1,263 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+#include "Bytecode.hpp"
+#include "Interp.hpp"
+#include "Lower.hpp"
+#include "PassManager.hpp"
+#include "Rewrite.hpp"
+#include "TestUtil.hpp"
+#include "Vm.hpp"
+
+using namespace vm;
+using testutil::corpus;
+using testutil::readCorpus;
+
+namespace {
+ir::Function lower(const std::string& src,
+                   const ir::LowerOptions& options = {}) {
+  auto prog = testutil::parse(src);
+  return ir::lower(prog.root, prog.frame, options);
+}
+
+const symbols::Id& var(const ir::Function& fn, const std::string& name) {
+  for (const auto& id : fn.frame.vars)
+    if (id->name == name) return *id;
+  throw std::runtime_error("no variable " + name);
+}
+
+const Dispatch kDispatch[] = {Dispatch::Switch, Dispatch::Threaded};
+
+/// Both dispatch modes leave the frame the reference interpreter does.
+void expectSameAsInterpreter(const ir::Function& fn,
+                             const std::string& what = "") {
+  ir::Interpreter interp(fn);
+  std::vector<uint8_t> expected = interp.run(10000000);
+  Program prog = compile(fn);
+  Vm machine(prog);
+  for (Dispatch d : kDispatch) {
+    EXPECT_EQ(machine.run(d), expected) << what;
+    EXPECT_GT(machine.dispatched, 0u) << what;
+  }
+}
+
+/// Quicken @p prog, profile one run and fuse from the profile.
+FuseStats specialize(Program& prog) {
+  quicken(prog);
+  Profile profile;
+  std::vector<uint8_t> frame(prog.frameSize, 0);
+  Vm(prog).run(frame.data(), profile);
+  return fuse(prog, profile);
+}
+}  // namespace
+
+TEST(BytecodeTest, TypedRegisterCode) {
+  auto fn = lower(
+      "{ int i; float f; char c; int[4][2] a;"
+      "  while (i < 4) { a[i][1] = i * 2; i = i + 1; }"
+      "  f = f + a[3][1]; c = c + c; }");
+  Program prog = compile(fn);
+  std::string text = toString(prog);
+  EXPECT_NE(text.find("jgei "), std::string::npos) << text;
+  EXPECT_NE(text.find("sti "), std::string::npos) << text;
+  EXPECT_NE(text.find("ldi "), std::string::npos) << text;
+  EXPECT_NE(text.find("i2f "), std::string::npos) << text;
+  EXPECT_NE(text.find("addf "), std::string::npos) << text;
+  EXPECT_NE(text.find("wrapc "), std::string::npos) << text;
+  EXPECT_EQ(text.find("label"), std::string::npos) << text;
+  // i, f and c live in registers, the array in the frame
+  EXPECT_EQ(prog.vars.size(), 3u);
+  EXPECT_EQ(prog.frameSize, fn.frame.size);
+  EXPECT_EQ(static_cast<Op>(prog.code.back()), Op::Halt);
+}
+
+TEST(BytecodeTest, RejectsVectorCode) {
+  ir::LowerOptions vec;
+  vec.vectorize = true;
+  auto fn = lower(
+      "{ int[16] a; int i; while (i < 16) { a[i] = a[i] * 2; i = i + 1; } }",
+      vec);
+  EXPECT_THROW(compile(fn), std::runtime_error);
+}
+
+TEST(VmTest, CorpusMatchesInterpreter) {
+  ir::LowerOptions checked;
+  checked.boundsChecks = true;
+  ir::LowerOptions values;
+  values.jumpingCode = false;
+  for (const auto& name : corpus) {
+    auto fn = lower(readCorpus(name));
+    expectSameAsInterpreter(fn, name);
+    opt::PassManager().run(fn);
+    expectSameAsInterpreter(fn, std::string(name) + " optimized");
+    expectSameAsInterpreter(lower(readCorpus(name), checked),
+                            std::string(name) + " checked");
+    expectSameAsInterpreter(lower(readCorpus(name), values),
+                            std::string(name) + " value code");
+  }
+}
+
+TEST(VmTest, ScalarSemantics) {
+  auto fn = lower(
+      "{ char c; bool b; int i; int q; float f; float g; float z; bool lt;"
+      "  bool eq; int[4] a; float[4] x; char[4] s; bool[2] t; int m;"
+      "  c = 100; c = c + c; i = 0 - 7; q = i / 2; b = i < q;"
+      "  f = 0.0; z = -f; g = i; g = g / 4.0; i = g; lt = g < f;"
+      "  eq = g == g; a[3] = q; x[1] = g * 2.0; s[2] = c; t[1] = !b;"
+      "  m = 2147483647; m = m + 1; c = 300; b = m < 3000000000;"
+      "  m = 0 - 2147483647 - 1; m = m / (0 - 1);"
+      "  if (!(q >= 0) && c != 0 || t[1]) i = i * 3; }");
+  expectSameAsInterpreter(fn);
+  ir::Interpreter interp(fn);
+  auto frame = interp.run();
+  EXPECT_EQ(ir::readVar(frame, *fn.frame.vars[0]), 44);  // 300 wrapped
+}
+
+TEST(VmTest, TrapsThrowAndKeepVariables) {
+  ir::LowerOptions checked;
+  checked.boundsChecks = true;
+  const char* programs[] = {
+      "{ int[4] a; int i; i = 4; a[i] = 1; }",
+      "{ int[4] a; int i; i = 0 - 1; a[i] = 1; }",
+      "{ int[4] a; int i; i = 0; while (i < 5) { a[i] = i; i = i + 1; } }",
+      "{ int i; int j; i = 7; i = 5 / j; }",
+  };
+  for (const char* src : programs) {
+    for (bool checks : {false, true}) {
+      auto fn = checks ? lower(src, checked) : lower(src);
+      Program prog = compile(fn);
+      Vm machine(prog);
+      for (Dispatch d : kDispatch) {
+        std::vector<uint8_t> frame(prog.frameSize, 0);
+        EXPECT_THROW(machine.run(frame.data(), d), std::runtime_error) << src;
+        // i was stored back before the exception
+        EXPECT_NE(ir::readVar(frame, var(fn, "i")), 0) << src;
+      }
+    }
+  }
+}
+
+TEST(VmTest, DispatchModesCountTheSameInstructions) {
+  auto fn = lower(readCorpus("bubble.sc"));
+  Program prog = compile(fn);
+  Vm machine(prog);
+  machine.run(Dispatch::Switch);
+  uint64_t viaSwitch = machine.dispatched;
+  machine.run(Dispatch::Threaded);
+  EXPECT_EQ(machine.dispatched, viaSwitch);
+  ir::Interpreter interp(fn);
+  interp.run();
+  // labels are gone, everything else is one instruction
+  uint64_t labels = interp.profile[static_cast<size_t>(ir::Opcode::Label)];
+  EXPECT_EQ(viaSwitch, interp.executed - labels + 1);
+}
+
+TEST(VmTest, ProfileCountsStraightLineSequences) {
+  auto fn = lower(
+      "{ int i; int s; while (i < 10) { s = s + i * i; i = i + 1; } }");
+  Program prog = compile(fn);
+  Vm machine(prog);
+  Profile profile;
+  std::vector<uint8_t> frame(prog.frameSize, 0);
+  machine.run(frame.data(), profile);
+  uint64_t total = 0;
+  for (uint64_t c : profile.ops) total += c;
+  EXPECT_EQ(total, machine.dispatched);
+  // muli, addi, mov, addi, mov, jmp on each iteration, after the jgei
+  EXPECT_EQ(profile.triples[Profile::key(Op::MulI, Op::AddI, Op::Mov)], 10u);
+  EXPECT_EQ(profile.pairs[Profile::key(Op::Mov, Op::Jmp)], 10u);
+  EXPECT_EQ(profile.pairs.count(Profile::key(Op::JGeI, Op::MulI)), 0u);
+  EXPECT_EQ(profile.pairs.count(Profile::key(Op::Jmp, Op::JGeI)), 0u);
+  for (const Sequence& s : hottest(profile, 2, kOpCount * kOpCount)) {
+    EXPECT_FALSE(isJump(s.ops[0])) << opName(s.ops[0]);
+    EXPECT_GT(s.count, 0u);
+  }
+  // counts accumulate
+  machine.run(frame.data(), profile);
+  EXPECT_EQ(profile.ops[static_cast<size_t>(Op::Halt)], 2u);
+}
+
+TEST(RewriteTest, QuickenUsesImmediates) {
+  auto fn = lower(
+      "{ int i; int b; while (i < 10) { i = i + 1; b = 2 * i - 3;"
+      "  if (7 > b) b = b * i; } }");
+  Program prog = compile(fn);
+  EXPECT_EQ(quicken(prog), 5);
+  EXPECT_EQ(quicken(prog), 0);
+  std::string text = toString(prog);
+  EXPECT_NE(text.find("addik r"), std::string::npos) << text;
+  EXPECT_NE(text.find(", 1\n"), std::string::npos) << text;
+  EXPECT_NE(text.find("mulik r"), std::string::npos) << text;
+  EXPECT_NE(text.find("subik r"), std::string::npos) << text;
+  EXPECT_NE(text.find("jgeik r0, 10, @"), std::string::npos) << text;
+  // 7 > b is mirrored to b < 7
+  EXPECT_NE(text.find("jgeik r1, 7, @"), std::string::npos) << text;
+  EXPECT_NE(text.find("muli r"), std::string::npos) << text;
+  ir::Interpreter interp(fn);
+  EXPECT_EQ(Vm(prog).run(), interp.run());
+}
+
+TEST(RewriteTest, CorpusMatchesInterpreterAfterRewrites) {
+  ir::LowerOptions checked;
+  checked.boundsChecks = true;
+  uint64_t before = 0, after = 0;
+  for (const auto& name : corpus) {
+    for (bool check : {false, true}) {
+      auto fn = lower(readCorpus(name), check ? checked : ir::LowerOptions{});
+      opt::PassManager().run(fn);
+      std::vector<uint8_t> expected = ir::Interpreter(fn).run(10000000);
+      Program prog = compile(fn);
+      Vm plain(prog);
+      plain.run();
+      before += plain.dispatched;
+
+      Program fast = compile(fn);
+      FuseStats stats = specialize(fast);
+      EXPECT_EQ(stats.chosen.size() > 0, stats.pairs + stats.triples > 0);
+      EXPECT_EQ(fast.code.size(), prog.code.size());
+      Vm machine(fast);
+      for (Dispatch d : kDispatch) {
+        EXPECT_EQ(machine.run(d), expected) << name;
+        EXPECT_LE(machine.dispatched, plain.dispatched) << name;
+      }
+      after += machine.dispatched;
+    }
+  }
+  EXPECT_LT(after * 4, before * 3);
+}
+
+TEST(RewriteTest, SuperinstructionsKeepJumpTargetsAndTraps) {
+  // off = 8; do { f = x[off]; off = off + 8; } while (true) over float[2] x
+  auto w = [](Op op) { return static_cast<uint32_t>(op); };
+  Program prog;
+  prog.code = {w(Op::AddIK), 0, 0, 8,      //
+               w(Op::LdF),   2, 0, 0, 16,  // jump target
+               w(Op::AddIK), 0, 0, 8,      //
+               w(Op::Jmp),   4,            //
+               w(Op::Halt)};
+  prog.registers.resize(3);
+  prog.firstConstant = 3;
+  prog.vars = {{0, 16, Scalar::Int}};
+  prog.frameSize = 20;
+
+  Profile profile;
+  std::vector<uint8_t> frame(prog.frameSize, 0);
+  EXPECT_THROW(Vm(prog).run(frame.data(), profile), std::runtime_error);
+  EXPECT_EQ(profile.ops[static_cast<size_t>(Op::LdF)], 2u);
+  FuseStats stats = fuse(prog, profile);
+  ASSERT_EQ(stats.chosen, std::vector<Op>{Op::AddIKLdF});
+  EXPECT_EQ(stats.pairs, 1);
+  EXPECT_EQ(toString(prog, 0), "{addik r0, r0, 8; ldf r2, r0, 0, 16}");
+  EXPECT_EQ(toString(prog, 4), "ldf r2, r0, 0, 16");
+
+  Vm machine(prog);
+  for (Dispatch d : kDispatch) {
+    std::vector<uint8_t> frame(prog.frameSize, 0);
+    EXPECT_THROW(machine.run(frame.data(), d), std::runtime_error);
+    int32_t off;
+    std::memcpy(&off, frame.data() + 16, sizeof off);
+    EXPECT_EQ(off, 16);
+    EXPECT_EQ(machine.dispatched, 4u);  // addik+ldf, addik, jmp, ldf
+  }
+}